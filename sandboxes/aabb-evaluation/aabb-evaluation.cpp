@@ -4,212 +4,166 @@
 
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/AABBTreeIndirect.hpp>
-#include <libslic3r/SLA/EigenMesh3D.hpp>
 
-#include <Shiny/Shiny.h>
+#include "libnest2d/tools/benchmark.h"
 
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable: 4244)
 #pragma warning(disable: 4267)
 #endif
-#include <igl/ray_mesh_intersect.h>
-#include <igl/point_mesh_squared_distance.h>
-#include <igl/remove_duplicate_vertices.h>
-#include <igl/signed_distance.h>
+#include <igl/AABB.h>
+#include <igl/per_vertex_normals.h>
 #include <igl/random_dir.h>
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
 
+// Ambient occlusion of the mesh vertices and closest point queries by the binary and the wide AABBTreeIndirect
+// compared to igl::AABB.
+
 const std::string USAGE_STR = {
-    "Usage: aabb-evaluation stlfilename.stl"
+    "Usage: aabb-evaluation [stlfilename.stl]\n"
+    "Without a file, two overlapping spheres of 500k triangles are evaluated."
 };
 
 using namespace Slic3r;
 
+template<class Fn> static double measure(Fn &&fn)
+{
+    Benchmark b;
+    b.start();
+    fn();
+    b.stop();
+    return b.getElapsedSec();
+}
+
+static void print(const char *name, double t, int num_hits)
+{
+    std::cout << "  " << name << t << " s, " << num_hits << " hits" << std::endl;
+}
+
 void profile(const TriangleMesh &mesh)
 {
-    Eigen::MatrixXd V;
-    Eigen::MatrixXi F;
+    Eigen::MatrixXd V(mesh.its.vertices.size(), 3);
+    Eigen::MatrixXi F(mesh.its.indices.size(), 3);
+    for (size_t i = 0; i < mesh.its.vertices.size(); ++ i)
+        V.row(i) = mesh.its.vertices[i].cast<double>();
+    for (size_t i = 0; i < mesh.its.indices.size(); ++ i)
+        F.row(i) = mesh.its.indices[i];
     Eigen::MatrixXd vertex_normals;
-    sla::to_eigen_mesh(mesh, V, F);
     igl::per_vertex_normals(V, F, vertex_normals);
 
     static constexpr int num_samples = 100;
     const int num_vertices = std::min(10000, int(mesh.its.vertices.size()));
     const Eigen::MatrixXd dirs = igl::random_dir_stratified(num_samples).cast<double>();
 
-    Eigen::MatrixXd occlusion_output0;
-    {
-        AABBTreeIndirect::Tree3f tree;
-        {
-            PROFILE_BLOCK(AABBIndirect_Init);
-            tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices);
-        }
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABBIndirectF_AmbientOcclusion);
-            occlusion_output0.resize(num_vertices, 1);
-            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
-                const Eigen::Vector3d origin = mesh.its.vertices[ivertex].template cast<double>();
-                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
-                int num_hits = 0;
-                for (int s = 0; s < num_samples; s++) {
-                    Eigen::Vector3d d = dirs.row(s);
-                    if(d.dot(normal) < 0) {
-                        // reverse ray
-                        d *= -1;
-                    }
-                    igl::Hit hit;
-                    if (AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, (origin + 1e-4 * d).eval(), d, hit))
-                        ++ num_hits;
-                }
-                occlusion_output0(ivertex) = (double)num_hits/(double)num_samples;
-            }
-        }
-
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABBIndirectFF_AmbientOcclusion);
-            occlusion_output0.resize(num_vertices, 1);
-            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
-                const Eigen::Vector3d origin = mesh.its.vertices[ivertex].template cast<double>();
-                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
-                int num_hits = 0;
-                for (int s = 0; s < num_samples; s++) {
-                    Eigen::Vector3d d = dirs.row(s);
-                    if(d.dot(normal) < 0) {
-                        // reverse ray
-                        d *= -1;
-                    }
-                    igl::Hit hit;
-                    if (AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, 
-                            Eigen::Vector3f((origin + 1e-4 * d).template cast<float>()),
-                            Eigen::Vector3f(d.template cast<float>()), hit))
-                        ++ num_hits;
-                }
-                occlusion_output0(ivertex) = (double)num_hits/(double)num_samples;
+    // Rays of the ambient occlusion, num_samples rays shot from each of the vertices evenly picked from the mesh.
+    std::vector<Vec3d> ray_origins, ray_dirs;
+    ray_origins.reserve(num_vertices * num_samples);
+    ray_dirs.reserve(num_vertices * num_samples);
+    for (int i = 0; i < num_vertices; ++ i) {
+        const size_t          ivertex = size_t(i) * mesh.its.vertices.size() / num_vertices;
+        const Eigen::Vector3d origin  = mesh.its.vertices[ivertex].template cast<double>();
+        const Eigen::Vector3d normal  = vertex_normals.row(ivertex).template cast<double>();
+        for (int s = 0; s < num_samples; s++) {
+            Eigen::Vector3d d = dirs.row(s);
+            if(d.dot(normal) < 0) {
+                // reverse ray
+                d *= -1;
             }
+            ray_origins.emplace_back(origin + 1e-4 * d);
+            ray_dirs.emplace_back(d);
         }
     }
-
-    Eigen::MatrixXd occlusion_output1;
-    {
-        std::vector<Vec3d> vertices;
-        std::vector<Vec3i> triangles;
-        for (int i = 0; i < V.rows(); ++ i)
-            vertices.emplace_back(V.row(i).transpose());
-        for (int i = 0; i < F.rows(); ++ i)
-            triangles.emplace_back(F.row(i).transpose());
-        AABBTreeIndirect::Tree3d tree;
-        {
-            PROFILE_BLOCK(AABBIndirectD_Init);
-            tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(vertices, triangles);
+    std::cout << mesh.its.indices.size() << " triangles, " << ray_origins.size() << " rays, " << num_vertices << " closest point queries" << std::endl;
+
+    AABBTreeIndirect::Tree3f tree;
+    std::cout << "  AABBIndirect init:                  " << measure([&]() {
+        tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices);
+    }) << " s" << std::endl;
+
+    AABBTreeIndirect::WideTree3f wide_tree;
+    std::cout << "  AABBIndirect wide init:             " << measure([&]() {
+        wide_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(mesh.its.vertices, mesh.its.indices);
+    }) << " s" << std::endl;
+
+    int num_hits = 0;
+    double t = measure([&]() {
+        for (size_t i = 0; i < ray_origins.size(); ++ i) {
+            igl::Hit hit;
+            if (AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, tree, ray_origins[i], ray_dirs[i], hit))
+                ++ num_hits;
         }
-
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABBIndirectD_AmbientOcclusion);
-            occlusion_output1.resize(num_vertices, 1);
-            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
-                const Eigen::Vector3d origin = V.row(ivertex).template cast<double>();
-                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
-                int num_hits = 0;
-                for (int s = 0; s < num_samples; s++) {
-                    Eigen::Vector3d d = dirs.row(s);
-                    if(d.dot(normal) < 0) {
-                        // reverse ray
-                        d *= -1;
-                    }
-                    igl::Hit hit;
-                    if (AABBTreeIndirect::intersect_ray_first_hit(vertices, triangles, tree, Eigen::Vector3d(origin + 1e-4 * d), d, hit))
-                        ++ num_hits;
-                }
-                occlusion_output1(ivertex) = (double)num_hits/(double)num_samples;
-            }
+    });
+    print("AABBIndirect double rays:           ", t, num_hits);
+
+    num_hits = 0;
+    t = measure([&]() {
+        for (size_t i = 0; i < ray_origins.size(); ++ i) {
+            igl::Hit hit;
+            if (AABBTreeIndirect::intersect_ray_first_hit(mesh.its.vertices, mesh.its.indices, wide_tree, ray_origins[i], ray_dirs[i], hit))
+                ++ num_hits;
         }
-    }
-
-    // Build the AABB accelaration tree
+    });
+    print("AABBIndirect wide double rays:      ", t, num_hits);
 
-    Eigen::MatrixXd occlusion_output2;
     {
         igl::AABB<Eigen::MatrixXd, 3> AABB;
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABB_Init);
-            AABB.init(V, F);
-        }
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABB_AmbientOcclusion);
-            occlusion_output2.resize(num_vertices, 1);
-            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
-                const Eigen::Vector3d origin = V.row(ivertex).template cast<double>();
-                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
-                int num_hits = 0;
-                for (int s = 0; s < num_samples; s++) {
-                    Eigen::Vector3d d = dirs.row(s);
-                    if(d.dot(normal) < 0) {
-                        // reverse ray
-                        d *= -1;
-                    }
-                    igl::Hit hit;
-                    if (AABB.intersect_ray(V, F, origin + 1e-4 * d, d, hit))
-                        ++ num_hits;
-                }
-                occlusion_output2(ivertex) = (double)num_hits/(double)num_samples;
+        std::cout << "  igl::AABB init:                     " << measure([&]() { AABB.init(V, F); }) << " s" << std::endl;
+        num_hits = 0;
+        t = measure([&]() {
+            for (size_t i = 0; i < ray_origins.size(); ++ i) {
+                igl::Hit hit;
+                if (AABB.intersect_ray(V, F, ray_origins[i].transpose(), ray_dirs[i].transpose(), hit))
+                    ++ num_hits;
             }
-        }
+        });
+        print("igl::AABB rays:                     ", t, num_hits);
     }
 
-    Eigen::MatrixXd occlusion_output3;
-    {
-        typedef Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor | Eigen::DontAlign>> MapMatrixXfUnaligned;
-        typedef Eigen::Map<const Eigen::Matrix<int, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor | Eigen::DontAlign>> MapMatrixXiUnaligned;
-        igl::AABB<MapMatrixXfUnaligned, 3> AABB;
-        auto vertices = MapMatrixXfUnaligned(mesh.its.vertices.front().data(), mesh.its.vertices.size(), 3);
-        auto faces = MapMatrixXiUnaligned(mesh.its.indices.front().data(), mesh.its.indices.size(), 3);
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABBf_Init);
-            AABB.init(
-                vertices,
-                faces);
+    // Closest points to points around the vertices.
+    double sum_binary = 0., sum_wide = 0.;
+    double t_binary = measure([&]() {
+        for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
+            size_t hit_idx;
+            Vec3d  hit_point;
+            sum_binary += AABBTreeIndirect::squared_distance_to_indexed_triangle_set(mesh.its.vertices, mesh.its.indices, tree,
+                Vec3d(ray_origins[ivertex * num_samples] + ray_dirs[ivertex * num_samples]), hit_idx, hit_point);
         }
-
-        {
-            PROFILE_BLOCK(EigenMesh3D_AABBf_AmbientOcclusion);
-            occlusion_output3.resize(num_vertices, 1);
-            for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
-                const Eigen::Vector3d origin = mesh.its.vertices[ivertex].template cast<double>();
-                const Eigen::Vector3d normal = vertex_normals.row(ivertex).template cast<double>();
-                int num_hits = 0;
-                for (int s = 0; s < num_samples; s++) {
-                    Eigen::Vector3d d = dirs.row(s);
-                    if(d.dot(normal) < 0) {
-                        // reverse ray
-                        d *= -1;
-                    }
-                    igl::Hit hit;
-                    if (AABB.intersect_ray(vertices, faces, (origin + 1e-4 * d).eval().template cast<float>(), d.template cast<float>(), hit))
-                        ++ num_hits;
-                }
-                occlusion_output3(ivertex) = (double)num_hits/(double)num_samples;
-            }
+    });
+    double t_wide = measure([&]() {
+        for (int ivertex = 0; ivertex < num_vertices; ++ ivertex) {
+            size_t hit_idx;
+            Vec3d  hit_point;
+            sum_wide += AABBTreeIndirect::squared_distance_to_indexed_triangle_set(mesh.its.vertices, mesh.its.indices, wide_tree,
+                Vec3d(ray_origins[ivertex * num_samples] + ray_dirs[ivertex * num_samples]), hit_idx, hit_point);
         }
-    }
-
-    PROFILE_UPDATE();
-    PROFILE_OUTPUT(nullptr);
+    });
+    std::cout << "  AABBIndirect closest points:        " << t_binary << " s, sum of squared distances " << sum_binary << std::endl
+              << "  AABBIndirect wide closest points:   " << t_wide << " s, sum of squared distances " << sum_wide << std::endl;
 }
 
 int main(const int argc, const char *argv[])
 {
-    if(argc < 2) {
+    if (argc > 2) {
         std::cout << USAGE_STR << std::endl;
         return EXIT_SUCCESS;
     }
 
     TriangleMesh mesh;
-    if (! mesh.ReadSTLFile(argv[1])) {
-        std::cerr << "Error loading " << argv[1] << std::endl;
-        return -1;
+    if (argc == 2) {
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Error loading " << argv[1] << std::endl;
+            return -1;
+        }
+    } else {
+        // 700 sectors by 350 stacks, about 250k triangles each.
+        indexed_triangle_set its = its_make_sphere(50., PI / 350.);
+        indexed_triangle_set its2 = its;
+        its_translate(its2, Vec3f(60.f, 0.f, 0.f));
+        its_merge(its, its2);
+        mesh = TriangleMesh(std::move(its));
     }
 
     if (mesh.empty()) {
@@ -217,7 +171,7 @@ int main(const int argc, const char *argv[])
         return -1;
     }
 
-    profile(mesh);    
+    profile(mesh);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <string>
+
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/TriangleSelector.hpp>
+#include <libslic3r/MultiMaterialSegmentation.hpp>
+
+#include "libnest2d/tools/benchmark.h"
+
+// Multi-material segmentation of a painted object, measured on the layers of a sliced object.
+
+const std::string USAGE_STR = {
+    "Usage: mm-segmentation [painted.3mf]\n"
+    "Without a file, a sphere of 500k triangles painted by spiral stripes of 4 colors is segmented."
+};
+
+using namespace Slic3r;
+
+static constexpr const int NUM_EXTRUDERS = 4;
+
+// Sphere painted by stripes winding around the Z axis, so that most layers contain all the colors.
+static Model make_painted_sphere()
+{
+    Model        model;
+    ModelObject *object = model.add_object();
+    object->name = "painted_sphere";
+    ModelVolume *volume = object->add_volume(TriangleMesh(its_make_sphere(25., PI / 360.)));
+    object->add_instance()->set_offset(Vec3d(100., 100., 0.));
+    object->ensure_on_bed();
+
+    const indexed_triangle_set &its = volume->mesh().its;
+    TriangleSelector            selector(volume->mesh());
+    for (int facet_idx = 0; facet_idx < int(its.indices.size()); ++ facet_idx) {
+        const Vec3f  center = (its.vertices[its.indices[facet_idx](0)] + its.vertices[its.indices[facet_idx](1)] + its.vertices[its.indices[facet_idx](2)]) / 3.f;
+        const double stripe = std::atan2(center.y(), center.x()) * NUM_EXTRUDERS / PI + center.z() / 5.;
+        selector.set_facet(facet_idx, EnforcerBlockerType(1 + (int(std::floor(stripe)) % NUM_EXTRUDERS + NUM_EXTRUDERS) % NUM_EXTRUDERS));
+    }
+    volume->mmu_segmentation_facets.set(selector);
+    return model;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize_strict({
+        { "nozzle_diameter", "0.4,0.4,0.4,0.4" },
+        { "layer_height",    0.1 }
+    });
+
+    Model model;
+    if (argc == 2) {
+        ConfigSubstitutionContext substitutions(ForwardCompatibilitySubstitutionRule::Enable);
+        model = Model::read_from_file(argv[1], &config, &substitutions);
+    } else
+        model = make_painted_sphere();
+
+    Print print;
+    print.apply(model, config);
+    print.set_status_silent();
+
+    Benchmark b;
+    for (PrintObject *print_object : print.objects_mutable()) {
+        if (! print_object->is_mm_painted())
+            continue;
+        // Slicing segments the painted object once.
+        b.start();
+        print_object->slice();
+        b.stop();
+        std::cout << print_object->model_object()->name << ": " << print_object->layers().size() << " layers" << std::endl;
+        std::cout << "  Slicing including the segmentation: " << b.getElapsedSec() << " s" << std::endl;
+
+        static constexpr const int num_runs = 5;
+        double segmentation_time = 0.;
+        for (int i = 0; i < num_runs; ++ i) {
+            b.start();
+            std::vector<std::vector<ExPolygons>> segmentation = multi_material_segmentation_by_painting(*print_object, []() {});
+            b.stop();
+            segmentation_time += b.getElapsedSec();
+        }
+        std::cout << "  Segmentation: " << segmentation_time / num_runs << " s" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
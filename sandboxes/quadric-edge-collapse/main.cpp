@@ -0,0 +1,83 @@
+#include <iostream>
+#include <string>
+
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/QuadricEdgeCollapse.hpp"
+
+#include "libnest2d/tools/benchmark.h"
+
+// Compares the sequential and the parallel simplification by the Quadric edge collapse
+// reducing the mesh to the same triangle count.
+
+const std::string USAGE_STR = {
+    "Usage: quadric-edge-collapse [file.stl [ratio]]\n"
+    "Ratio of the wanted triangle count, 0.05 by default.\n"
+    "Without a file, a sphere of 2M triangles is simplified."
+};
+
+namespace Slic3r {
+
+template<class Fn> static double measure(Fn &&fn)
+{
+    Benchmark b;
+    b.start();
+    fn();
+    b.stop();
+    return b.getElapsedSec();
+}
+
+static void measure_mesh(const indexed_triangle_set &its, double ratio)
+{
+    uint32_t wanted_count = uint32_t(its.indices.size() * ratio);
+
+    indexed_triangle_set its_seq = its;
+    float error_seq = std::numeric_limits<float>::max();
+    int   status_seq = 0;
+    double t_seq = measure([&]() {
+        its_quadric_edge_collapse(its_seq, wanted_count, &error_seq, nullptr, [&status_seq](int status) { status_seq = status; });
+    });
+
+    indexed_triangle_set its_par = its;
+    float error_par = std::numeric_limits<float>::max();
+    int   status_par = 0;
+    double t_par = measure([&]() {
+        its_quadric_edge_collapse_par(its_par, wanted_count, &error_par, nullptr, [&status_par](int status) { status_par = status; });
+    });
+
+    std::cout << its.indices.size() << " triangles reduced to " << wanted_count << std::endl
+              << "  sequential: " << t_seq << " s, " << its_seq.indices.size() << " triangles, error " << error_seq
+              << ", last status " << status_seq << std::endl
+              << "  parallel:   " << t_par << " s, " << its_par.indices.size() << " triangles, error " << error_par
+              << ", last status " << status_par << std::endl;
+}
+
+} // namespace Slic3r
+
+int main(const int argc, const char *argv[])
+{
+    using namespace Slic3r;
+
+    if (argc > 3) {
+        std::cerr << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double ratio = argc == 3 ? std::atof(argv[2]) : 0.05;
+    if (ratio <= 0. || ratio >= 1.) {
+        std::cerr << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (argc >= 2) {
+        TriangleMesh mesh;
+        if (! mesh.ReadSTLFile(argv[1])) {
+            std::cerr << "Cannot load " << argv[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+        measure_mesh(mesh.its, ratio);
+    } else
+        // 2000 sectors by 1000 stacks, about 4M triangles.
+        measure_mesh(its_make_sphere(50., PI / 1000.), ratio);
+
+    return EXIT_SUCCESS;
+}
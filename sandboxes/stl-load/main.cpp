@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/TriangleMesh.hpp"
+
+#include "libnest2d/tools/benchmark.h"
+
+// Measures the stages of loading an STL: parsing the memory mapped file, building the shared vertices
+// from the admesh connectivity as the repair path does and by the parallel vertex welding.
+
+const std::string USAGE_STR = {
+    "Usage: stl-load [file.stl]\n"
+    "Without a file, a sphere of 5M triangles is written into a temporary binary STL and loaded."
+};
+
+namespace Slic3r {
+
+template<class Fn> static double measure(Fn &&fn)
+{
+    Benchmark b;
+    b.start();
+    fn();
+    b.stop();
+    return b.getElapsedSec();
+}
+
+static void measure_file(const std::string &path)
+{
+    stl_file stl;
+    double t_parse = measure([&]() { stl_open(&stl, path.c_str()); });
+    if (stl.stats.number_of_facets == 0) {
+        std::cerr << "Cannot load " << path << std::endl;
+        return;
+    }
+
+    indexed_triangle_set its_admesh;
+    double t_admesh = measure([&]() {
+        stl_file s = stl;
+        stl_check_facets_exact(&s);
+        stl_generate_shared_vertices(&s, its_admesh);
+    });
+
+    indexed_triangle_set its_welded;
+    double t_weld = measure([&]() { stl_weld_shared_vertices(&stl, its_welded); });
+
+    TriangleMesh mesh;
+    double t_read = measure([&]() { mesh.ReadSTLFile(path.c_str()); });
+
+    std::cout << path << ": " << stl.stats.number_of_facets << " facets" << std::endl
+              << "  parse:                     " << t_parse << " s" << std::endl
+              << "  admesh exact + shared:     " << t_admesh << " s, " << its_admesh.vertices.size() << " vertices" << std::endl
+              << "  parallel weld:             " << t_weld << " s, " << its_welded.vertices.size() << " vertices" << std::endl
+              << "  TriangleMesh::ReadSTLFile: " << t_read << " s, " << (mesh.stats().repaired() ? "repaired" : "no repair needed") << std::endl;
+}
+
+} // namespace Slic3r
+
+int main(const int argc, const char *argv[])
+{
+    using namespace Slic3r;
+
+    if (argc > 2) {
+        std::cerr << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (argc == 2)
+        measure_file(argv[1]);
+    else {
+        const boost::filesystem::path path = boost::filesystem::temp_directory_path() / "stl-load-benchmark.stl";
+        // 2240 sectors by 1120 stacks, about 5M triangles.
+        its_write_stl_binary(path.string().c_str(), "stl-load", its_make_sphere(50., PI / 1120.));
+        measure_file(path.string());
+        boost::filesystem::remove(path);
+    }
+
+    return EXIT_SUCCESS;
+}
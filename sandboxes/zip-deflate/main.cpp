@@ -0,0 +1,83 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/Zipper.hpp"
+
+#include "libnest2d/tools/benchmark.h"
+
+// Compares the wall time of the serial miniz deflate with the chunked
+// parallel deflate used by Zipper for large entries.
+
+const std::string USAGE_STR = {
+    "Usage: zip-deflate [file_to_compress]\n"
+    "Without a file, 200MB of synthetic G-code is compressed."
+};
+
+namespace Slic3r {
+
+static std::string make_synthetic_gcode(size_t bytes)
+{
+    std::mt19937 rng{0};
+    std::uniform_real_distribution<double> dist(0., 200.);
+    std::ostringstream ss;
+    ss.precision(3);
+    ss << std::fixed;
+    while (size_t(ss.tellp()) < bytes)
+        ss << "G1 X" << dist(rng) << " Y" << dist(rng) << " E" << dist(rng) / 100. << "\n";
+    return ss.str();
+}
+
+static void measure(const std::string &data, Zipper::e_compression compression, const char *name)
+{
+    const boost::filesystem::path path = boost::filesystem::temp_directory_path() / "zip-deflate-benchmark.zip";
+
+    auto run = [&](size_t threshold) {
+        Benchmark b;
+        b.start();
+        {
+            Zipper zipper(path.string(), compression);
+            zipper.set_parallel_threshold(threshold);
+            zipper.add_entry("data.zaxe_code", data.data(), data.size());
+            zipper.finalize();
+        }
+        b.stop();
+        return std::make_pair(b.getElapsedSec(), boost::filesystem::file_size(path));
+    };
+
+    auto serial   = run(0);
+    auto parallel = run(1);
+    boost::filesystem::remove(path);
+
+    std::cout << name << ": serial " << serial.first << " s (" << serial.second << " B), "
+              << "parallel " << parallel.first << " s (" << parallel.second << " B), "
+              << "speedup " << serial.first / parallel.first << "x" << std::endl;
+}
+
+} // namespace Slic3r
+
+int main(const int argc, const char *argv[])
+{
+    using namespace Slic3r;
+
+    std::string data;
+    if (argc > 1) {
+        std::ifstream ifs(argv[1], std::ios::binary);
+        if (!ifs) {
+            std::cerr << USAGE_STR << std::endl;
+            return EXIT_FAILURE;
+        }
+        data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    } else
+        data = make_synthetic_gcode(200 << 20);
+
+    std::cout << "Compressing " << data.size() << " bytes" << std::endl;
+    measure(data, Zipper::FAST_COMPRESSION, "Fast compression");
+    measure(data, Zipper::TIGHT_COMPRESSION, "Tight compression");
+
+    return EXIT_SUCCESS;
+}
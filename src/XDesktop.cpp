@@ -17,15 +17,21 @@
     #endif /* SLIC3R_GUI */
 #endif /* WIN32 */
 
+#include <chrono>
 #include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <map>
 #include <string>
 #include <cstring>
 #include <iostream>
 #include <math.h>
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/trim.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
 #include <boost/nowide/cenv.hpp>
+#include <boost/nowide/fstream.hpp>
 #include <boost/nowide/iostream.hpp>
 #include <boost/nowide/integration/filesystem.hpp>
 #include <boost/dll/runtime_symbol_info.hpp>
@@ -36,17 +42,21 @@
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
+#include "libslic3r/JsonMessage.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
 #include "libslic3r/Platform.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/SliceCache.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
 #include "libslic3r/Format/STL.hpp"
 #include "libslic3r/Format/OBJ.hpp"
+#include "libslic3r/Format/MeshCache.hpp"
 #include "libslic3r/Format/SL1.hpp"
+#include "libslic3r/Format/ZaxeArchive.hpp"
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/Thread.hpp"
 #include "libslic3r/BlacklistedLibraryCheck.hpp"
@@ -55,6 +65,7 @@
 
 #ifdef SLIC3R_GUI
     #include "slic3r/GUI/GUI_Init.hpp"
+    #include "slic3r/Utils/Fleet.hpp"
 #endif /* SLIC3R_GUI */
 
 using namespace Slic3r;
@@ -459,6 +470,18 @@ int CLI::run(int argc, char **argv)
                 model.add_default_instances();
                 model.print_info();
             }
+        } else if (opt_key == "fleet") {
+            if (printer_technology == ptSLA) {
+                boost::nowide::cerr << "error: the fleet daemon needs an FFF configuration" << std::endl;
+                return 1;
+            }
+            return this->run_fleet();
+        } else if (opt_key == "server") {
+            if (printer_technology == ptSLA) {
+                boost::nowide::cerr << "error: the slicing server needs an FFF configuration" << std::endl;
+                return 1;
+            }
+            return this->run_server();
         } else if (opt_key == "export_stl") {
             for (auto &model : m_models)
                 model.add_default_instances();
@@ -627,6 +650,264 @@ int CLI::run(int argc, char **argv)
     return 0;
 }
 
+struct CLI::WarmState
+{
+    struct LoadedConfig {
+        std::time_t         mtime;
+        DynamicPrintConfig  config;
+    };
+    // Config files applied on top of the command line config, reloaded when modified.
+    std::map<std::string, LoadedConfig> configs;
+
+    // The last input loaded and its Print. Sliced again with the same Model, Print::apply() only invalidates
+    // the steps affected by the changed configuration, if any.
+    std::string                 input;
+    std::time_t                 input_mtime { 0 };
+    uintmax_t                   input_size { 0 };
+    Model                       model;
+    DynamicPrintConfig          model_config;
+    // Bed and object distance the model was arranged for.
+    Points                      bed;
+    coord_t                     min_obj_distance { 0 };
+    std::unique_ptr<Print>      print;
+};
+
+CLI::CLI() = default;
+CLI::~CLI() = default;
+
+int CLI::run_fleet()
+{
+#ifdef SLIC3R_GUI
+    Fleet::Params params;
+    params.http_port = (unsigned short)m_config.opt_int("fleet_port");
+    try {
+        Fleet fleet(params, [this](const std::string &input, const std::string &config, bool make_zaxe, Fleet::SliceResult &result) {
+            SliceRequest request;
+            request.input       = input;
+            request.config_file = config;
+            request.make_zaxe   = make_zaxe;
+            SliceResult slice_result;
+            std::string err = this->slice_file(request, slice_result);
+            result.gcode_path = std::move(slice_result.gcode_path);
+            result.zaxe_path  = std::move(slice_result.zaxe_path);
+            result.temp_dir   = std::move(slice_result.temp_dir);
+            return err;
+        });
+        boost::nowide::cout << "Fleet daemon serving on http://" << params.http_address << ":" << fleet.httpPort() << ", press Ctrl+C to stop." << std::endl;
+        fleet.run();
+    } catch (const std::exception &ex) {
+        boost::nowide::cerr << "error: cannot run the fleet daemon: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+#else // SLIC3R_GUI
+    boost::nowide::cerr << "error: the fleet daemon is not available in a build without the GUI" << std::endl;
+    return 1;
+#endif // SLIC3R_GUI
+}
+
+int CLI::run_server()
+{
+    // One job per line: {"id": 1, "input": "model.3mf", "config": "profile.ini", "output": "model.gcode", "zaxe": false},
+    // only "input" is required. One result line is written per job, the server exits at the end of the input.
+    // Files of a job without "output" go to a temp directory, which is kept until the next job is read,
+    // so that the client can pick them up after the result line.
+    std::string job_dir;
+    auto remove_job_files = [&job_dir]() {
+        boost::system::error_code ec;
+        if (! job_dir.empty())
+            boost::filesystem::remove_all(job_dir, ec);
+        job_dir.clear();
+    };
+    ScopeGuard  remove_at_exit(remove_job_files);
+    std::string line;
+    while (std::getline(boost::nowide::cin, line)) {
+        boost::algorithm::trim(line);
+        if (line.empty())
+            continue;
+        remove_job_files();
+        auto        t_start = std::chrono::steady_clock::now();
+        JsonReader  job;
+        JsonWriter  out;
+        SliceResult result;
+        std::string err;
+        if (! job.parse(line) || job.get_string("input").empty())
+            err = "invalid job, expected a JSON object with an \"input\" file";
+        else {
+            if (job.has("id"))
+                out.add_number_or_string("id", job.get_string("id"));
+            SliceRequest request;
+            request.input       = job.get_string("input");
+            request.config_file = job.get_string("config");
+            request.output      = job.get_string("output");
+            request.make_zaxe   = job.get_bool("zaxe");
+            err = this->slice_file(request, result);
+            job_dir = result.temp_dir;
+        }
+        out.add("status", err.empty() ? "ok" : "error");
+        if (err.empty()) {
+            out.add("gcode", result.gcode_path);
+            if (! result.zaxe_path.empty())
+                out.add("zaxe", result.zaxe_path);
+        } else
+            out.add("error", err);
+        out.add("reused", result.reused)
+           .add("cached", result.cached)
+           .add("load_time", result.load_time)
+           .add("slice_time", result.slice_time)
+           .add("export_time", result.export_time)
+           .add("total_time", std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count());
+        boost::nowide::cout << std::move(out).str() << std::endl;
+    }
+    return 0;
+}
+
+std::string CLI::slice_file(const SliceRequest &request, SliceResult &result)
+{
+    namespace fs = boost::filesystem;
+    using clock = std::chrono::steady_clock;
+    auto seconds_since = [](clock::time_point t) { return std::chrono::duration<double>(clock::now() - t).count(); };
+
+    if (! m_warm)
+        m_warm = std::make_unique<WarmState>();
+    WarmState &warm = *m_warm;
+    try {
+        auto t_start = clock::now();
+        DynamicPrintConfig print_config = m_print_config;
+        if (! request.config_file.empty()) {
+            std::time_t mtime = fs::last_write_time(request.config_file);
+            auto it = warm.configs.find(request.config_file);
+            if (it == warm.configs.end() || it->second.mtime != mtime) {
+                WarmState::LoadedConfig loaded { mtime, {} };
+                loaded.config.load(request.config_file, ForwardCompatibilitySubstitutionRule::Enable);
+                loaded.config.normalize_fdm();
+                it = warm.configs.insert_or_assign(request.config_file, std::move(loaded)).first;
+            }
+            print_config.apply(it->second.config);
+        }
+        std::time_t mtime = fs::last_write_time(request.input);
+        uintmax_t   size  = fs::file_size(request.input);
+        if (warm.input != request.input || warm.input_mtime != mtime || warm.input_size != size) {
+            // Drop the previous input first, a failed load shall not leave it behind for the next job.
+            warm.input.clear();
+            warm.print.reset();
+            warm.model_config.clear();
+            ConfigSubstitutionContext config_substitutions(ForwardCompatibilitySubstitutionRule::Enable);
+            warm.model = Model::read_from_file(request.input, &warm.model_config, &config_substitutions, Model::LoadAttribute::AddDefaultInstances);
+            if (warm.model.objects.empty())
+                return "file is empty: " + request.input;
+            for (ModelObject *o : warm.model.objects)
+                o->ensure_on_bed();
+            warm.bed.clear();
+            warm.input       = request.input;
+            warm.input_mtime = mtime;
+            warm.input_size  = size;
+        }
+        // As in run(), the config of a 3MF / AMF goes below the configs given.
+        DynamicPrintConfig model_config = warm.model_config;
+        model_config += std::move(print_config);
+        print_config = std::move(model_config);
+        print_config.normalize_fdm();
+        if (get_printer_technology(print_config) == ptSLA)
+            return "cannot slice for a SLA configuration";
+
+        FullPrintConfig fff_print_config;
+        fff_print_config.apply(print_config, true);
+        print_config.apply(fff_print_config, true);
+        if (std::string validity = print_config.validate(); ! validity.empty())
+            return validity;
+
+        // Arranging again for the same bed would move the instances and invalidate the whole Print.
+        Points  bed              = get_bed_shape(print_config);
+        coord_t min_obj_distance = scaled(min_object_distance(print_config));
+        if (bed != warm.bed || min_obj_distance != warm.min_obj_distance) {
+            ArrangeParams arrange_cfg;
+            arrange_cfg.min_obj_distance = min_obj_distance;
+            arrange_objects(warm.model, bed, arrange_cfg);
+            warm.bed              = std::move(bed);
+            warm.min_obj_distance = min_obj_distance;
+        }
+        result.load_time = seconds_since(t_start);
+
+        fs::path    gcode_path(request.output);
+        std::string stem = fs::path(request.input).stem().string();
+        if (gcode_path.empty()) {
+            // A directory per slice, the files of the previous jobs may still be uploading.
+            fs::path dir = fs::temp_directory_path() / "xdesktop-slices" / fs::unique_path();
+            fs::create_directories(dir);
+            result.temp_dir = dir.string();
+            gcode_path = dir / (stem + ".gcode");
+        }
+
+        // Files of the same model sliced with the same config before are copied from the slice cache.
+        const std::string slice_cache        = m_config.opt_string("slice_cache");
+        const bool        zaxe_indexed_model = m_config.opt_bool("zaxe_indexed_model");
+        CacheDigest       slice_key;
+        if (! slice_cache.empty()) {
+            auto t_export = clock::now();
+            // The name of the archive is stored in the archive.
+            slice_key = slice_cache_key(warm.model, print_config, request.make_zaxe ?
+                gcode_path.stem().string() + (zaxe_indexed_model ? ".indexed" : ".stl") : std::string());
+            SlicedFiles files;
+            if (load_slice_cache(slice_cache, slice_key, files)) {
+                // The files of a job making a Zaxe archive are stored under another key than the G-code alone.
+                for (const auto &[extension, content] : files) {
+                    std::string path = extension == ".gcode" ? gcode_path.string() : fs::path(gcode_path).replace_extension(extension).string();
+                    boost::nowide::ofstream out(path, std::ios::binary);
+                    if (! out.write(content.data(), content.size()))
+                        throw Slic3r::FileIOError("Cannot write " + path);
+                    (extension == ".gcode" ? result.gcode_path : result.zaxe_path) = path;
+                }
+                result.cached      = true;
+                result.export_time = seconds_since(t_export);
+                return std::string();
+            }
+        }
+
+        auto t_slice = clock::now();
+        result.reused = warm.print != nullptr;
+        if (! warm.print)
+            warm.print = std::make_unique<Print>();
+        Print &print = *warm.print;
+        for (ModelObject *mo : warm.model.objects)
+            print.auto_assign_extruders(mo);
+        print.apply(warm.model, print_config);
+        if (std::string err = print.validate(); ! err.empty())
+            return err;
+        if (print.empty())
+            return "nothing to print, either the model is empty or no object is fully inside the print volume";
+        print.process();
+        result.slice_time = seconds_since(t_slice);
+
+        auto t_export = clock::now();
+        result.gcode_path = print.export_gcode(gcode_path.string(), nullptr, nullptr);
+        run_post_process_scripts(result.gcode_path, print.full_print_config());
+        if (request.make_zaxe) {
+            result.zaxe_path = fs::path(result.gcode_path).replace_extension(".zaxe").string();
+            ZaxeArchive archive;
+            archive.set_model_format(zaxe_indexed_model ? ZaxeArchive::ModelFormat::Indexed : ZaxeArchive::ModelFormat::STL);
+            archive.export_print(result.zaxe_path, {}, print, result.gcode_path);
+        }
+        if (! slice_cache.empty()) {
+            auto read_file = [](const std::string &path) {
+                boost::nowide::ifstream in(path, std::ios::binary);
+                return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            };
+            SlicedFiles files { { ".gcode", read_file(result.gcode_path) } };
+            if (! result.zaxe_path.empty())
+                files.emplace_back(".zaxe", read_file(result.zaxe_path));
+            store_slice_cache(slice_cache, slice_key, files);
+        }
+        result.export_time = seconds_since(t_export);
+    } catch (const std::exception &ex) {
+        // The state of a Print interrupted by an exception is not to be trusted.
+        warm.input.clear();
+        warm.print.reset();
+        return ex.what();
+    }
+    return std::string();
+}
+
 bool CLI::setup(int argc, char **argv)
 {
     {
@@ -722,6 +1003,7 @@ bool CLI::setup(int argc, char **argv)
             m_config.option(optdef.first, true);
 
     set_data_dir(m_config.opt_string("datadir"));
+    set_mesh_cache_dir(m_config.opt_string("mesh_cache"));
     
     //FIXME Validating at this stage most likely does not make sense, as the config is not fully initialized yet.
     if (!validity.empty()) {
@@ -1,6 +1,8 @@
 #ifndef SLIC3R_HPP
 #define SLIC3R_HPP
 
+#include <memory>
+
 #include "libslic3r/Config.hpp"
 #include "libslic3r/Model.hpp"
 
@@ -19,9 +21,39 @@ namespace IO {
 
 class CLI {
 public:
+    CLI();
+    ~CLI();
+
     int run(int argc, char **argv);
 
+    struct SliceRequest {
+        std::string input;
+        // Applied on top of the command line config, optional.
+        std::string config_file;
+        // G-code output path, a temporary one if empty.
+        std::string output;
+        bool        make_zaxe { false };
+    };
+    struct SliceResult {
+        std::string gcode_path;
+        std::string zaxe_path;
+        // Directory created for the output files if no output was requested, to be removed by the caller.
+        std::string temp_dir;
+        // The model and print of the previous slice were reused, only what changed was processed.
+        bool        reused { false };
+        // The files were copied from the slice cache, nothing was sliced.
+        bool        cached { false };
+        // Seconds spent loading the input & config, slicing and exporting.
+        double      load_time { 0. };
+        double      slice_time { 0. };
+        double      export_time { 0. };
+    };
+
 private:
+    // Loaded configs, the last model and its Print, kept between the slices of --server and --fleet.
+    struct WarmState;
+    std::unique_ptr<WarmState>  m_warm;
+
     DynamicPrintAndCLIConfig    m_config;
     DynamicPrintConfig			m_print_config;
     DynamicPrintConfig          m_extra_config;
@@ -38,6 +70,16 @@ private:
     /// Exports loaded models to a file of the specified format, according to the options affecting output filename.
     bool export_models(IO::ExportFormat format);
     
+    /// Runs XDesktop --fleet until interrupted.
+    int run_fleet();
+
+    /// Runs XDesktop --server: slice jobs read as JSON lines from stdin, results written as JSON lines to stdout.
+    int run_server();
+
+    /// Slices a single model file with m_print_config and the config file of the request applied on top of it.
+    /// Returns an empty string on success, the error message otherwise.
+    std::string slice_file(const SliceRequest &request, SliceResult &result);
+
     bool has_print_action() const { return m_config.opt_bool("export_gcode") || m_config.opt_bool("export_sla"); }
     
     std::string output_filepath(const Model &model, IO::ExportFormat format) const;
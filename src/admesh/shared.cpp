@@ -23,11 +23,15 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <array>
 #include <vector>
 
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include "stl.h"
 
 #include "libslic3r/LocalesUtils.hpp"
@@ -127,6 +131,134 @@ void stl_generate_shared_vertices(stl_file *stl, indexed_triangle_set &its)
 	}
 }
 
+void stl_weld_shared_vertices(const stl_file *stl, indexed_triangle_set &its)
+{
+	// Vertex of a facet is referenced as 3 * facet_idx + vertex_idx, a "corner".
+	const size_t num_corners = 3 * size_t(stl->stats.number_of_facets);
+	its.indices.assign(stl->stats.number_of_facets, stl_triangle_vertex_indices(-1, -1, -1));
+	its.vertices.clear();
+	if (num_corners == 0)
+		return;
+
+	// Key of a vertex: its coordinates as bits, negative zeros switched to positive zeros, so that they compare equal.
+	typedef std::array<uint32_t, 3> VertexKey;
+	auto vertex_key = [stl](size_t corner) {
+		const stl_vertex &v = stl->facet_start[corner / 3].vertex[corner % 3];
+		VertexKey key;
+		for (int i = 0; i < 3; ++ i) {
+			float f = v(i) + 0.f;
+			memcpy(&key[i], &f, sizeof(float));
+		}
+		return key;
+	};
+	struct VertexKeyHash {
+		uint64_t operator()(const VertexKey &key) const {
+			uint64_t h = ((uint64_t(key[0]) * 0x9e3779b97f4a7c15ull) ^ key[1]) * 0x9e3779b97f4a7c15ull ^ key[2];
+			// splitmix64 finalizer, the bucket index below is taken from the upper bits.
+			h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+			h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+			return h ^ (h >> 31);
+		}
+	};
+	// The corners are partitioned into buckets by their hash, each bucket is welded independently.
+	static constexpr size_t bucket_bits = 8;
+	static constexpr size_t num_buckets = size_t(1) << bucket_bits;
+	auto bucket_of = [](const VertexKey &key) { return size_t(VertexKeyHash()(key) >> (64 - bucket_bits)); };
+
+	const size_t num_chunks = std::min<size_t>(64, (num_corners + 65535) / 65536);
+	const size_t chunk_size = (num_corners + num_chunks - 1) / num_chunks;
+	auto chunk_range = [num_corners, chunk_size](size_t chunk) {
+		return std::make_pair(chunk * chunk_size, std::min(num_corners, (chunk + 1) * chunk_size));
+	};
+
+	// 1) Count the corners of each bucket per chunk, then sort the corners by bucket, keeping their order inside a bucket.
+	//    The keys are copied along, so that the buckets are processed without touching the facets again.
+	struct Corner {
+		VertexKey key;
+		uint32_t  corner;
+	};
+	std::vector<Corner>   corners(num_corners);
+	std::vector<uint32_t> offsets(num_chunks * num_buckets, 0);
+	std::vector<uint32_t> bucket_begin(num_buckets + 1, 0);
+	tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+		auto [begin, end] = chunk_range(chunk);
+		uint32_t *counts = offsets.data() + chunk * num_buckets;
+		for (size_t corner = begin; corner < end; ++ corner)
+			++ counts[bucket_of(vertex_key(corner))];
+	});
+	for (size_t bucket = 0, offset = 0; bucket < num_buckets; ++ bucket) {
+		bucket_begin[bucket] = uint32_t(offset);
+		for (size_t chunk = 0; chunk < num_chunks; ++ chunk) {
+			uint32_t cnt = offsets[chunk * num_buckets + bucket];
+			offsets[chunk * num_buckets + bucket] = uint32_t(offset);
+			offset += cnt;
+		}
+	}
+	bucket_begin[num_buckets] = uint32_t(num_corners);
+	tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+		auto [begin, end] = chunk_range(chunk);
+		uint32_t *offset = offsets.data() + chunk * num_buckets;
+		for (size_t corner = begin; corner < end; ++ corner) {
+			VertexKey key = vertex_key(corner);
+			corners[offset[bucket_of(key)] ++] = { key, uint32_t(corner) };
+		}
+	});
+
+	// 2) Weld the vertices of each bucket with an open addressing hash table of the unique vertices.
+	//    Each corner is assigned the first corner of equal coordinates.
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_buckets, 1), [&](const tbb::blocked_range<size_t> &range) {
+		std::vector<uint32_t> table;
+		for (size_t bucket = range.begin(); bucket < range.end(); ++ bucket) {
+			size_t table_size = 16;
+			while (table_size < 2 * (bucket_begin[bucket + 1] - bucket_begin[bucket]))
+				table_size *= 2;
+			table.assign(table_size, uint32_t(-1));
+			for (size_t i = bucket_begin[bucket]; i < bucket_begin[bucket + 1]; ++ i) {
+				const Corner &c    = corners[i];
+				size_t        slot = VertexKeyHash()(c.key) & (table_size - 1);
+				while (table[slot] != uint32_t(-1) && corners[table[slot]].key != c.key)
+					slot = (slot + 1) & (table_size - 1);
+				if (table[slot] == uint32_t(-1))
+					table[slot] = uint32_t(i);
+				its.indices[c.corner / 3][c.corner % 3] = int(corners[table[slot]].corner);
+			}
+		}
+	});
+	corners = std::vector<Corner>();
+
+	// 3) Number the shared vertices by the order of their first corners: prefix sum of the first corners per chunk.
+	std::vector<uint32_t> vertex_idx(num_corners);
+	auto is_first = [&its](size_t corner) { return its.indices[corner / 3][corner % 3] == int(corner); };
+	std::vector<uint32_t> chunk_vertices(num_chunks + 1, 0);
+	tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+		auto [begin, end] = chunk_range(chunk);
+		uint32_t cnt = 0;
+		for (size_t corner = begin; corner < end; ++ corner)
+			cnt += is_first(corner);
+		chunk_vertices[chunk + 1] = cnt;
+	});
+	for (size_t chunk = 0; chunk < num_chunks; ++ chunk)
+		chunk_vertices[chunk + 1] += chunk_vertices[chunk];
+	its.vertices.resize(chunk_vertices.back());
+	tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+		auto [begin, end] = chunk_range(chunk);
+		uint32_t idx = chunk_vertices[chunk];
+		for (size_t corner = begin; corner < end; ++ corner)
+			if (is_first(corner)) {
+				its.vertices[idx] = stl->facet_start[corner / 3].vertex[corner % 3];
+				vertex_idx[corner] = idx ++;
+			}
+	});
+	// The first corners are numbered already, now the indices may be overwritten.
+	tbb::parallel_for(size_t(0), num_chunks, [&](size_t chunk) {
+		auto [begin, end] = chunk_range(chunk);
+		for (size_t corner = begin; corner < end; ++ corner) {
+			int &idx = its.indices[corner / 3][corner % 3];
+			idx = int(vertex_idx[idx]);
+		}
+	});
+}
+
 bool its_write_off(const indexed_triangle_set &its, const char *file)
 {
     Slic3r::CNumericLocalesSetter locales_setter;
@@ -299,6 +299,9 @@ extern void its_rotate_y(indexed_triangle_set &its, float angle);
 extern void its_rotate_z(indexed_triangle_set &its, float angle);
 
 extern void stl_generate_shared_vertices(stl_file *stl, indexed_triangle_set &its);
+// Merges the vertices of the facets with bitwise equal coordinates into shared vertices, in parallel.
+// Unlike stl_generate_shared_vertices(), the neighbors need not be calculated. Shared vertices are ordered by their first use.
+extern void stl_weld_shared_vertices(const stl_file *stl, indexed_triangle_set &its);
 extern bool its_write_obj(const indexed_triangle_set &its, const char *file);
 extern bool its_write_off(const indexed_triangle_set &its, const char *file);
 extern bool its_write_vrml(const indexed_triangle_set &its, const char *file);
@@ -26,223 +26,276 @@
 #include <math.h>
 #include <assert.h>
 
+#include <string_view>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/log/trivial.hpp>
-#include <boost/nowide/cstdio.hpp>
 #include <boost/predef/other/endian.h>
 
-#include "stl.h"
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
-#include "libslic3r/LocalesUtils.hpp"
+#include <fast_float/fast_float.h>
 
-#ifndef SEEK_SET
-#error "SEEK_SET not defined"
-#endif
+#include "stl.h"
 
 #if BOOST_ENDIAN_BIG_BYTE
 extern void stl_internal_reverse_quads(char *buf, size_t cnt);
 #endif /* BOOST_ENDIAN_BIG_BYTE */
 
-static FILE* stl_open_count_facets(stl_file *stl, const char *file) 
+// Number of facets processed by a single task when loading in parallel.
+static constexpr size_t STL_FACETS_PER_TASK = 16384;
+// Size of a chunk of an ASCII STL parsed by a single task.
+static constexpr size_t STL_ASCII_CHUNK_SIZE = 4 * 1024 * 1024;
+
+static bool stl_read_binary(stl_file *stl, const char *data, size_t size, const char *file)
 {
-  	// Open the file in binary mode first.
-  	FILE *fp = boost::nowide::fopen(file, "rb");
-  	if (fp == nullptr) {
-		BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: Couldn't open " << file << " for reading";
-    	return nullptr;
-  	}
-  	// Find size of file.
-  	fseek(fp, 0, SEEK_END);
-  	long file_size = ftell(fp);
-
-  	// Check for binary or ASCII file.
-  	fseek(fp, HEADER_SIZE, SEEK_SET);
-	unsigned char chtest[128];
-  	if (! fread(chtest, sizeof(chtest), 1, fp)) {
-		BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: The input is an empty file: " << file;
-    	fclose(fp);
-    	return nullptr;
-  	}
-  	stl->stats.type = ascii;
-  	for (size_t s = 0; s < sizeof(chtest); s++) {
-    	if (chtest[s] > 127) {
-      		stl->stats.type = binary;
-      		break;
-    	}
-  	}
-  	rewind(fp);
-
-  	uint32_t num_facets = 0;
-
-  	// Get the header and the number of facets in the .STL file.
-  	// If the .STL file is binary, then do the following:
-  	if (stl->stats.type == binary) {
-    	// Test if the STL file has the right size.
-    	if (((file_size - HEADER_SIZE) % SIZEOF_STL_FACET != 0) || (file_size < STL_MIN_FILE_SIZE)) {
-			BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: The file " << file << " has the wrong size.";
-      		fclose(fp);
-      		return nullptr;
-    	}
-    	num_facets = (file_size - HEADER_SIZE) / SIZEOF_STL_FACET;
-
-    	// Read the header.
-    	if (fread(stl->stats.header, LABEL_SIZE, 1, fp) > 79)
-      		stl->stats.header[80] = '\0';
-
-    	// Read the int following the header.  This should contain # of facets.
-	  	uint32_t header_num_facets;
-    	bool header_num_faces_read = fread(&header_num_facets, sizeof(uint32_t), 1, fp) != 0;
+	// Test if the STL file has the right size.
+	if (((size - HEADER_SIZE) % SIZEOF_STL_FACET != 0) || (size < STL_MIN_FILE_SIZE)) {
+		BOOST_LOG_TRIVIAL(error) << "stl_open: The file " << file << " has the wrong size.";
+		return false;
+	}
+	uint32_t num_facets = uint32_t((size - HEADER_SIZE) / SIZEOF_STL_FACET);
+
+	memcpy(stl->stats.header, data, LABEL_SIZE);
+	stl->stats.header[80] = '\0';
+
+	// The int following the header should contain # of facets.
+	uint32_t header_num_facets;
+	memcpy(&header_num_facets, data + LABEL_SIZE, sizeof(uint32_t));
 #if BOOST_ENDIAN_BIG_BYTE
-    	// Convert from little endian to big endian.
-    	stl_internal_reverse_quads((char*)&header_num_facets, 4);
+	// Convert from little endian to big endian.
+	stl_internal_reverse_quads((char*)&header_num_facets, 4);
+#endif /* BOOST_ENDIAN_BIG_BYTE */
+	if (num_facets != header_num_facets)
+		BOOST_LOG_TRIVIAL(info) << "stl_open: Warning: File size doesn't match number of facets in the header: " << file;
+
+	stl->stats.number_of_facets = num_facets;
+	stl_allocate(stl);
+	const char *facets = data + HEADER_SIZE;
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, num_facets, STL_FACETS_PER_TASK), [stl, facets](const tbb::blocked_range<size_t> &range) {
+		for (size_t i = range.begin(); i < range.end(); ++ i) {
+			// We assume little-endian architecture!
+			stl_facet &facet = stl->facet_start[i];
+			memcpy((void*)&facet, facets + i * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+#if BOOST_ENDIAN_BIG_BYTE
+			// Convert the loaded little endian data to big endian.
+			stl_internal_reverse_quads((char*)&facet, 48);
 #endif /* BOOST_ENDIAN_BIG_BYTE */
-    	if (! header_num_faces_read || num_facets != header_num_facets)
-			BOOST_LOG_TRIVIAL(info) << "stl_open_count_facets: Warning: File size doesn't match number of facets in the header: " << file;
-  	}
-  	// Otherwise, if the .STL file is ASCII, then do the following:
-  	else
-  	{
-    	// Reopen the file in text mode (for getting correct newlines on Windows)
-    	// fix to silence a warning about unused return value.
-    	// obviously if it fails we have problems....
-    	fp = boost::nowide::freopen(file, "r", fp);
-
-		// do another null check to be safe
-    	if (fp == nullptr) {
-			BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: Couldn't open " << file << " for reading";
-      		fclose(fp);
-      		return nullptr;
-    	}
-    
-    	// Find the number of facets.
-		char linebuf[100];
-		int num_lines = 1;
-		while (fgets(linebuf, 100, fp) != nullptr) {
-		    // Don't count short lines.
-		    if (strlen(linebuf) <= 4)
-		    	continue;
-		    // Skip solid/endsolid lines as broken STL file generators may put several of them.
-		    if (strncmp(linebuf, "solid", 5) == 0 || strncmp(linebuf, "endsolid", 8) == 0)
-		    	continue;
-		    ++ num_lines;
 		}
+	});
+	return true;
+}
+
+namespace {
 
-    	rewind(fp);
-    
-    	// Get the header.
-		int i = 0;
-    	for (; i < 80 && (stl->stats.header[i] = getc(fp)) != '\n'; ++ i) ;
-    	stl->stats.header[i] = '\0'; // Lose the '\n'
-    	stl->stats.header[80] = '\0';
+// Parser of the facets of an ASCII STL, working on a memory mapped file.
+struct AsciiStlParser
+{
+	const char *p;
+	const char *end;
 
-    	num_facets = num_lines / ASCII_LINES_PER_FACET;
-  	}
+	static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+	// Old Mac files end the lines with a single CR.
+	static bool is_eol(char c) { return c == '\r' || c == '\n'; }
 
-  	stl->stats.number_of_facets += num_facets;
-  	stl->stats.original_num_facets = stl->stats.number_of_facets;
-  	return fp;
-}
+	void skip_whitespaces() { while (p != end && is_space(*p)) ++ p; }
+	void skip_line() { 
+		while (p != end && ! is_eol(*p)) ++ p;
+		this->skip_whitespaces();
+	}
+	bool starts_with(std::string_view keyword) const { return size_t(end - p) >= keyword.size() && memcmp(p, keyword.data(), keyword.size()) == 0; }
+	// Consumes the keyword and the whitespaces following it.
+	bool keyword(std::string_view keyword) {
+		if (! this->starts_with(keyword))
+			return false;
+		p += keyword.size();
+		this->skip_whitespaces();
+		return true;
+	}
+	// Consumes a keyword ending a line, ignoring any text following it.
+	bool end_keyword(std::string_view keyword) {
+		if (! this->starts_with(keyword) || (p + keyword.size() != end && ! is_space(p[keyword.size()])))
+			return false;
+		this->skip_line();
+		return true;
+	}
+	bool number(float &out) {
+		// fast_float does not accept the plus sign, fscanf() did.
+		if (p != end && *p == '+')
+			++ p;
+		auto [ptr, ec] = fast_float::from_chars(p, end, out);
+		if (ec != std::errc() || (ptr != end && ! is_space(*ptr)))
+			return false;
+		p = ptr;
+		this->skip_whitespaces();
+		return true;
+	}
+	// The facet normal is parsed leniently, as some exporters store not a numbers or infinities there.
+	void normal(stl_normal &out) {
+		bool valid = true;
+		for (int i = 0; i < 3; ++ i) {
+			const char *token_end = p;
+			while (token_end != end && ! is_space(*token_end)) ++ token_end;
+			float v;
+			auto [ptr, ec] = fast_float::from_chars(p != token_end && *p == '+' ? p + 1 : p, token_end, v);
+			if (ec != std::errc() || ptr != token_end)
+				valid = false;
+			else
+				out(i) = v;
+			p = token_end;
+			this->skip_whitespaces();
+		}
+		if (! valid)
+			// Normal was mangled. Maybe denormals or "not a number" were stored?
+			// Just reset the normal and silently ignore it.
+			out = stl_normal::Zero();
+	}
 
-/* Reads the contents of the file pointed to by fp into the stl structure,
-   starting at facet first_facet.  The second argument says if it's our first
-   time running this for the stl and therefore we should reset our max and min stats. */
-static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
-{
-	if (stl->stats.type == binary)
-    	fseek(fp, HEADER_SIZE, SEEK_SET);
-  	else
-    	rewind(fp);
-
-  	char normal_buf[3][32];
-  	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
-  	  	stl_facet facet;
-
-    	if (stl->stats.type == binary) {
-      		// Read a single facet from a binary .STL file. We assume little-endian architecture!
-      		if (fread(&facet, 1, SIZEOF_STL_FACET, fp) != SIZEOF_STL_FACET)
-      			return false;
-#if BOOST_ENDIAN_BIG_BYTE
-      		// Convert the loaded little endian data to big endian.
-      		stl_internal_reverse_quads((char*)&facet, 48);
-#endif /* BOOST_ENDIAN_BIG_BYTE */
-    	} else {
-			// Read a single facet from an ASCII .STL file
-			// skip solid/endsolid
-			// (in this order, otherwise it won't work when they are paired in the middle of a file)
-			fscanf(fp, " endsolid%*[^\n]\n");
-			fscanf(fp, " solid%*[^\n]\n");  // name might contain spaces so %*s doesn't work and it also can be empty (just "solid")
-			// Leading space in the fscanf format skips all leading white spaces including numerous new lines and tabs.
-			int res_normal     = fscanf(fp, " facet normal %31s %31s %31s", normal_buf[0], normal_buf[1], normal_buf[2]);
-			assert(res_normal == 3);
-			int res_outer_loop = fscanf(fp, " outer loop");
-			assert(res_outer_loop == 0);
-			int res_vertex1    = fscanf(fp, " vertex %f %f %f", &facet.vertex[0](0), &facet.vertex[0](1), &facet.vertex[0](2));
-			assert(res_vertex1 == 3);
-			int res_vertex2    = fscanf(fp, " vertex %f %f %f", &facet.vertex[1](0), &facet.vertex[1](1), &facet.vertex[1](2));
-			assert(res_vertex2 == 3);
-			// Trailing whitespace is there to eat all whitespaces and empty lines up to the next non-whitespace.
-			int res_vertex3    = fscanf(fp, " vertex %f %f %f ", &facet.vertex[2](0), &facet.vertex[2](1), &facet.vertex[2](2));
-			assert(res_vertex3 == 3);
+	// Parses all facets up to the end of the block.
+	bool parse(std::vector<stl_facet> &out) {
+		this->skip_whitespaces();
+		while (p != end) {
+			// Skip solid / endsolid as broken STL file generators may put several of them.
+			// The name might contain spaces and it also can be empty (just "solid").
+			if (this->starts_with("endsolid") || this->starts_with("solid")) {
+				this->skip_line();
+				continue;
+			}
+			stl_facet facet;
+			memset(facet.extra, 0, sizeof(facet.extra));
+			if (! this->keyword("facet") || ! this->keyword("normal"))
+				return false;
+			this->normal(facet.normal);
+			if (! this->keyword("outer") || ! this->keyword("loop"))
+				return false;
+			for (int i = 0; i < 3; ++ i)
+				if (! this->keyword("vertex") || ! this->number(facet.vertex[i](0)) || ! this->number(facet.vertex[i](1)) || ! this->number(facet.vertex[i](2)))
+					return false;
 			// Some G-code generators tend to produce text after "endloop" and "endfacet". Just ignore it.
-			char buf[2048];
-			fgets(buf, 2047, fp);
-			bool endloop_ok = strncmp(buf, "endloop", 7) == 0 && (buf[7] == '\r' || buf[7] == '\n' || buf[7] == ' ' || buf[7] == '\t');
-			assert(endloop_ok);
-			// Skip the trailing whitespaces and empty lines.
-			fscanf(fp, " ");
-			fgets(buf, 2047, fp);
-			bool endfacet_ok = strncmp(buf, "endfacet", 8) == 0 && (buf[8] == '\r' || buf[8] == '\n' || buf[8] == ' ' || buf[8] == '\t');
-			assert(endfacet_ok);
-			if (res_normal != 3 || res_outer_loop != 0 || res_vertex1 != 3 || res_vertex2 != 3 || res_vertex3 != 3 || ! endloop_ok || ! endfacet_ok) {
-				BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+			if (! this->end_keyword("endloop") || ! this->end_keyword("endfacet"))
 				return false;
-			}
+			out.emplace_back(facet);
+		}
+		return true;
+	}
+};
+
+} // namespace
+
+static bool stl_read_ascii(stl_file *stl, const char *data, size_t size)
+{
+	// Get the header.
+	size_t i = 0;
+	for (; i < 80 && i < size && data[i] != '\n'; ++ i)
+		stl->stats.header[i] = data[i];
+	stl->stats.header[i] = '\0';
+
+	// Split the file into chunks ending with an "endfacet" line, to be parsed in parallel.
+	std::vector<const char*> chunks { data };
+	const std::string_view text(data, size);
+	for (size_t pos = STL_ASCII_CHUNK_SIZE; pos < size; pos = chunks.back() - data + STL_ASCII_CHUNK_SIZE) {
+		size_t endfacet = text.find("endfacet", pos);
+		if (endfacet == std::string_view::npos)
+			break;
+		size_t eol = text.find_first_of("\r\n", endfacet);
+		if (eol == std::string_view::npos)
+			break;
+		chunks.emplace_back(data + eol);
+	}
+	chunks.emplace_back(data + size);
 
-			// The facet normal has been parsed as a single string as to workaround for not a numbers in the normal definition.
-			if (sscanf(normal_buf[0], "%f", &facet.normal(0)) != 1 ||
-			    sscanf(normal_buf[1], "%f", &facet.normal(1)) != 1 ||
-			    sscanf(normal_buf[2], "%f", &facet.normal(2)) != 1) {
-			    // Normal was mangled. Maybe denormals or "not a number" were stored?
-			  	// Just reset the normal and silently ignore it.
-			  	memset(&facet.normal, 0, sizeof(facet.normal));
+	std::vector<std::vector<stl_facet>> facets(chunks.size() - 1);
+	bool valid = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, facets.size(), 1), true,
+		[&chunks, &facets](const tbb::blocked_range<size_t> &range, bool valid) {
+			for (size_t i = range.begin(); i < range.end() && valid; ++ i) {
+				facets[i].reserve((chunks[i + 1] - chunks[i]) / 256);
+				valid = AsciiStlParser{ chunks[i], chunks[i + 1] }.parse(facets[i]);
 			}
-		}
+			return valid;
+		},
+		[](bool a, bool b) { return a && b; });
+	if (! valid) {
+		BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+		return false;
+	}
 
-#if 0
-		// Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
-		// close to zero values may be represented with singificantly higher precision than the rest of the vertices.
-		// It may be worth to round these numbers to zero during loading to reduce the number of errors reported
-		// during the STL import.
-		for (size_t j = 0; j < 3; ++ j) {
-		if (facet.vertex[j](0) > -1e-12f && facet.vertex[j](0) < 1e-12f)
-		    printf("stl_read: facet %d(0) = %e\r\n", j, facet.vertex[j](0));
-		if (facet.vertex[j](1) > -1e-12f && facet.vertex[j](1) < 1e-12f)
-		    printf("stl_read: facet %d(1) = %e\r\n", j, facet.vertex[j](1));
-		if (facet.vertex[j](2) > -1e-12f && facet.vertex[j](2) < 1e-12f)
-		    printf("stl_read: facet %d(2) = %e\r\n", j, facet.vertex[j](2));
-		}
-#endif
-
-		// Write the facet into memory.
-		stl->facet_start[i] = facet;
-		stl_facet_stats(stl, facet, first);
-  	}
-  
-  	stl->stats.size = stl->stats.max - stl->stats.min;
-  	stl->stats.bounding_diameter = stl->stats.size.norm();
-  	return true;
+	size_t num_facets = 0;
+	for (const std::vector<stl_facet> &f : facets)
+		num_facets += f.size();
+	stl->stats.number_of_facets = uint32_t(num_facets);
+	stl_allocate(stl);
+	for (size_t i = 0, offset = 0; i < facets.size(); offset += facets[i ++].size())
+		std::copy(facets[i].begin(), facets[i].end(), stl->facet_start.begin() + offset);
+	return true;
+}
+
+// Bounding box of the facets read.
+static void stl_read_stats(stl_file *stl)
+{
+	if (stl->stats.number_of_facets == 0)
+		return;
+	// Initialize the max and min values and the shortest edge by the first facet.
+	bool first = true;
+	stl_facet_stats(stl, stl->facet_start.front(), first);
+	using BBox = std::pair<stl_vertex, stl_vertex>;
+	BBox bbox = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, stl->stats.number_of_facets, STL_FACETS_PER_TASK), BBox(stl->stats.min, stl->stats.max),
+		[stl](const tbb::blocked_range<size_t> &range, BBox bbox) {
+			for (size_t i = range.begin(); i < range.end(); ++ i)
+				for (const stl_vertex &v : stl->facet_start[i].vertex) {
+					bbox.first  = bbox.first.cwiseMin(v);
+					bbox.second = bbox.second.cwiseMax(v);
+				}
+			return bbox;
+		},
+		[](const BBox &a, const BBox &b) { return BBox(a.first.cwiseMin(b.first), a.second.cwiseMax(b.second)); });
+	stl->stats.min = bbox.first;
+	stl->stats.max = bbox.second;
+	stl->stats.size = stl->stats.max - stl->stats.min;
+	stl->stats.bounding_diameter = stl->stats.size.norm();
 }
 
 bool stl_open(stl_file *stl, const char *file)
 {
-    Slic3r::CNumericLocalesSetter locales_setter;
 	stl->clear();
-	FILE *fp = stl_open_count_facets(stl, file);
-	if (fp == nullptr)
+
+	// Map the file into memory. Mapping an empty file fails, thus the size is checked first.
+	boost::filesystem::path path(file);
+	boost::system::error_code ec;
+	uintmax_t file_size = boost::filesystem::file_size(path, ec);
+	if (ec) {
+		BOOST_LOG_TRIVIAL(error) << "stl_open: Couldn't open " << file << " for reading";
 		return false;
-	stl_allocate(stl);
-	bool result = stl_read(stl, fp, 0, true);
-  	fclose(fp);
-  	return result;
+	}
+	if (file_size < HEADER_SIZE + 128) {
+		BOOST_LOG_TRIVIAL(error) << "stl_open: The input is an empty file: " << file;
+		return false;
+	}
+	boost::iostreams::mapped_file_source mapped;
+	try {
+		mapped.open(path);
+	} catch (const std::exception &ex) {
+		BOOST_LOG_TRIVIAL(error) << "stl_open: Couldn't open " << file << " for reading: " << ex.what();
+		return false;
+	}
+	const char *data = mapped.data();
+	const size_t size = mapped.size();
+
+	// Check for binary or ASCII file.
+	stl->stats.type = ascii;
+	for (size_t s = HEADER_SIZE; s < HEADER_SIZE + 128; ++ s)
+		if ((unsigned char)data[s] > 127) {
+			stl->stats.type = binary;
+			break;
+		}
+
+	if (! (stl->stats.type == binary ? stl_read_binary(stl, data, size, file) : stl_read_ascii(stl, data, size)))
+		return false;
+	stl->stats.original_num_facets = stl->stats.number_of_facets;
+	stl_read_stats(stl);
+	return true;
 }
 
 void stl_allocate(stl_file *stl) 
@@ -80,6 +80,10 @@ void AppConfig::set_defaults()
         if (get("export_sources_full_pathnames").empty())
             set("export_sources_full_pathnames", "0");
 
+        // Embed the model into the Zaxe archives as a binary STL by default, see ZaxeArchive::ModelFormat.
+        if (get("zaxe_indexed_model").empty())
+            set("zaxe_indexed_model", "0");
+
 #ifdef _WIN32
         if (get("associate_3mf").empty())
             set("associate_3mf", "0");
@@ -151,6 +155,19 @@ void AppConfig::set_defaults()
 
         if (get("clear_undo_redo_stack_on_new_project").empty())
             set("clear_undo_redo_stack_on_new_project", "1");
+
+        // Tessellation tolerances of the imported STEP files, see LoadStepParams.
+        // Reset the values, which are not positive numbers, as the tessellation would not terminate with them.
+        for (auto [key, default_value] : { std::make_pair("step_linear_deflection", "0.005"), std::make_pair("step_angle_deflection", "1") }) {
+            size_t      idx   = 0;
+            std::string value = get(key);
+            double      deflection = value.empty() ? 0. : string_to_double_decimal_point(value, &idx);
+            if (idx != value.size() || ! (deflection > 0.)) {
+                if (! value.empty())
+                    BOOST_LOG_TRIVIAL(warning) << "Invalid value \"" << value << "\" of " << key << " replaced with " << default_value;
+                set(key, default_value);
+            }
+        }
     }
     else {
 #ifdef _WIN32
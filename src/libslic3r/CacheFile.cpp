@@ -0,0 +1,143 @@
+#include "libslic3r.h"
+#include "CacheFile.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+#include <boost/algorithm/hex.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+
+#include <openssl/evp.h> // for the sha256 digest.
+
+namespace Slic3r {
+
+std::string CacheDigest::hex() const
+{
+    std::string out;
+    boost::algorithm::hex_lower(this->bytes.begin(), this->bytes.end(), std::back_inserter(out));
+    return out;
+}
+
+CacheDigest cache_digest(const void *data, size_t size)
+{
+    CacheDigest digest;
+    EVP_Digest(data, size, digest.bytes.data(), nullptr, EVP_sha256(), nullptr);
+    return digest;
+}
+
+CacheHasher::CacheHasher() : m_context(EVP_MD_CTX_new())
+{
+    EVP_DigestInit_ex(static_cast<EVP_MD_CTX*>(m_context), EVP_sha256(), nullptr);
+}
+
+CacheHasher::~CacheHasher()
+{
+    EVP_MD_CTX_free(static_cast<EVP_MD_CTX*>(m_context));
+}
+
+void CacheHasher::update(const void *data, size_t size)
+{
+    EVP_DigestUpdate(static_cast<EVP_MD_CTX*>(m_context), data, size);
+}
+
+void CacheHasher::update(const std::string &data)
+{
+    this->update_pod(uint64_t(data.size()));
+    this->update(data.data(), data.size());
+}
+
+CacheDigest CacheHasher::digest()
+{
+    CacheDigest digest;
+    EVP_DigestFinal_ex(static_cast<EVP_MD_CTX*>(m_context), digest.bytes.data(), nullptr);
+    return digest;
+}
+
+bool cache_digest_file(const char *path, CacheDigest &digest, uint64_t &size)
+{
+    try {
+        boost::system::error_code ec;
+        size = boost::filesystem::file_size(path, ec);
+        if (ec)
+            return false;
+        if (size == 0) {
+            // An empty file cannot be mapped.
+            digest = cache_digest(nullptr, 0);
+            return true;
+        }
+        boost::iostreams::mapped_file_source file(path);
+        size   = file.size();
+        digest = cache_digest(file.data(), file.size());
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+void touch_cache_file(const std::string &path)
+{
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+}
+
+bool write_cache_file(const std::string &path, const std::function<void(std::ostream&)> &write)
+{
+    boost::filesystem::path tmp_path = path;
+    try {
+        boost::filesystem::create_directories(tmp_path.parent_path());
+        tmp_path += boost::filesystem::unique_path(".%%%%-%%%%.tmp");
+        {
+            boost::filesystem::ofstream out(tmp_path, std::ios::binary);
+            write(out);
+            if (! out)
+                throw Slic3r::FileIOError("Cannot write " + tmp_path.string());
+        }
+        boost::filesystem::rename(tmp_path, path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(warning) << "Cannot write the cache file " << path << ": " << ex.what();
+        boost::system::error_code ec;
+        boost::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+void evict_cache_files(const std::string &dir, const std::string &extension, uint64_t max_size)
+{
+    struct File {
+        boost::filesystem::path path;
+        uint64_t                size;
+        std::time_t             time;
+    };
+    std::vector<File> files;
+    uint64_t          total = 0;
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it(dir, ec), end; ! ec && it != end; it.increment(ec)) {
+        if (it->path().extension() != extension || ! boost::filesystem::is_regular_file(it->status()))
+            continue;
+        boost::system::error_code ec2;
+        File file { it->path(), boost::filesystem::file_size(it->path(), ec2), boost::filesystem::last_write_time(it->path(), ec2) };
+        if (! ec2) {
+            files.emplace_back(std::move(file));
+            total += files.back().size;
+        }
+    }
+    if (total <= max_size)
+        return;
+    // The least recently used files first.
+    std::sort(files.begin(), files.end(), [](const File &f1, const File &f2) { return f1.time < f2.time; });
+    for (const File &file : files) {
+        if (total <= max_size)
+            break;
+        if (boost::filesystem::remove(file.path, ec)) {
+            total -= file.size;
+            BOOST_LOG_TRIVIAL(debug) << "Evicted the cache file " << file.path;
+        }
+    }
+}
+
+} // namespace Slic3r
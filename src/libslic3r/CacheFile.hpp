@@ -0,0 +1,60 @@
+#ifndef slic3r_CacheFile_hpp_
+#define slic3r_CacheFile_hpp_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace Slic3r {
+
+// SHA-256 digest of the content a cache file was derived from. The cache files are named by the digest
+// and they store it in their header, so that a loaded cache file is verified to belong to its source.
+struct CacheDigest
+{
+    std::array<unsigned char, 32> bytes {};
+
+    bool        operator==(const CacheDigest &rhs) const { return this->bytes == rhs.bytes; }
+    bool        operator!=(const CacheDigest &rhs) const { return this->bytes != rhs.bytes; }
+    // 64 lower case hex digits.
+    std::string hex() const;
+};
+
+// Digest of a block of memory.
+CacheDigest cache_digest(const void *data, size_t size);
+inline CacheDigest cache_digest(const std::string &data) { return cache_digest(data.data(), data.size()); }
+// Digest of data fed in pieces, for the cache keys derived from several sources.
+class CacheHasher
+{
+public:
+    CacheHasher();
+    ~CacheHasher();
+    CacheHasher(const CacheHasher&) = delete;
+    CacheHasher& operator=(const CacheHasher&) = delete;
+
+    void        update(const void *data, size_t size);
+    // The size is hashed first, so that the boundaries of consecutive strings are part of the digest.
+    void        update(const std::string &data);
+    template<typename T> void update_pod(const T &value) { this->update(&value, sizeof(T)); }
+    CacheDigest digest();
+
+private:
+    void       *m_context;
+};
+
+// Digest and size of the content of the file at path. Returns false if the file cannot be read.
+bool        cache_digest_file(const char *path, CacheDigest &digest, uint64_t &size);
+
+// Marks a cache file as recently used, see evict_cache_files().
+void        touch_cache_file(const std::string &path);
+// Writes a cache file through a temporary file renamed to path, so that a concurrent reader never sees a partial file.
+// Returns false and logs a warning if the file could not be written.
+bool        write_cache_file(const std::string &path, const std::function<void(std::ostream&)> &write);
+// Removes the least recently used files with the given extension from dir, until their total size is at most max_size.
+void        evict_cache_files(const std::string &dir, const std::string &extension, uint64_t max_size);
+
+} // namespace Slic3r
+
+#endif // slic3r_CacheFile_hpp_
@@ -13,8 +13,12 @@
 
 #include "3mf.hpp"
 
+#include <charconv>
+#include <functional>
 #include <limits>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -36,6 +40,9 @@ namespace pt = boost::property_tree;
 
 #include <fast_float/fast_float.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 // Slightly faster than sprintf("%.9g"), but there is an issue with the karma floating point formatter,
 // https://github.com/boostorg/spirit/pull/586
 // where the exported string is one digit shorter than it should be to guarantee lossless round trip.
@@ -112,6 +119,8 @@ static constexpr const char* INSTANCESCOUNT_ATTR = "instances_count";
 static constexpr const char* CUSTOM_SUPPORTS_ATTR = "slic3rpe:custom_supports";
 static constexpr const char* CUSTOM_SEAM_ATTR = "slic3rpe:custom_seam";
 static constexpr const char* MMU_SEGMENTATION_ATTR = "slic3rpe:mmu_segmentation";
+// Not stored into the 3MF, marks the meshes parsed ahead of expat, see _3MF_Importer::_parse_meshes().
+static constexpr const char* PARSED_MESH_ATTR = "xdesktop:parsed_mesh";
 
 static constexpr const char* KEY_ATTR = "key";
 static constexpr const char* VALUE_ATTR = "value";
@@ -265,6 +274,165 @@ bool is_valid_object_type(const std::string& type)
     return false;
 }
 
+// Triangles with a painted state: index of the triangle and its serialized state, sorted by the triangle index.
+typedef std::vector<std::pair<unsigned int, std::string>> TrianglesPainting;
+
+// Upper bound of the uncompressed size of the archive entries inflated at once when loading.
+static constexpr size_t INFLATE_BATCH_SIZE = 256 * 1024 * 1024;
+// Size of a block of <vertex> or <triangle> elements parsed by a single task.
+static constexpr size_t MESH_XML_CHUNK_SIZE = 1024 * 1024;
+// Number of vertices or triangles serialized by a single task.
+static constexpr size_t MESH_XML_BLOCK_ELEMENTS = 16384;
+
+// Parser of the content of the <mesh> elements, which make up most of a .model file.
+// It accepts a subset of XML only: elements without children, attribute values without entity references
+// and no comments. Anything else is reported as a failure and the mesh is left to expat.
+// The attribute values are parsed the same way get_attribute_value_float() / get_attribute_value_int() do.
+struct MeshXmlParser
+{
+    const char *p;
+    const char *end;
+
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    void skip_spaces() { while (p != end && is_space(*p)) ++ p; }
+
+    // Consumes the prefix and the name of a tag, if followed by a whitespace, '/' or '>'.
+    bool tag_name(std::string_view prefix, std::string_view name) {
+        size_t len = prefix.size() + name.size();
+        if (size_t(end - p) <= len || memcmp(p, prefix.data(), prefix.size()) != 0 || memcmp(p + prefix.size(), name.data(), name.size()) != 0)
+            return false;
+        if (char c = p[len]; ! is_space(c) && c != '/' && c != '>')
+            return false;
+        p += len;
+        return true;
+    }
+
+    // Parses the attributes up to the end of a start tag, calling attribute(name, value_begin, value_end) for each of them.
+    // Sets closed if the tag is an empty element tag.
+    template<typename AttributeFn>
+    bool attributes(bool &closed, AttributeFn attribute) {
+        for (;;) {
+            this->skip_spaces();
+            if (p == end)
+                return false;
+            if (*p == '>' || *p == '/') {
+                closed = *p == '/';
+                if (closed && (++ p == end || *p != '>'))
+                    return false;
+                ++ p;
+                return true;
+            }
+            const char *name = p;
+            while (p != end && ! is_space(*p) && *p != '=' && *p != '>' && *p != '/')
+                ++ p;
+            std::string_view key(name, p - name);
+            this->skip_spaces();
+            if (key.empty() || p == end || *p != '=')
+                return false;
+            ++ p;
+            this->skip_spaces();
+            if (p == end || (*p != '"' && *p != '\''))
+                return false;
+            const char  quote = *p ++;
+            const char *value = p;
+            for (; p != end && *p != quote; ++ p)
+                if (*p == '&' || *p == '<')
+                    return false;
+            if (p == end)
+                return false;
+            attribute(key, value, p ++);
+        }
+    }
+
+    bool end_tag(std::string_view name) {
+        if (! this->tag_name("</", name))
+            return false;
+        this->skip_spaces();
+        if (p == end || *p != '>')
+            return false;
+        ++ p;
+        return true;
+    }
+
+    // Parses an element without children.
+    template<typename AttributeFn>
+    bool element(std::string_view name, AttributeFn attribute) {
+        bool closed = false;
+        if (! this->tag_name("<", name) || ! this->attributes(closed, attribute))
+            return false;
+        if (! closed)
+            this->skip_spaces();
+        return closed || this->end_tag(name);
+    }
+
+    // Parses the content of an element up to its end tag, returning the content.
+    bool content(std::string_view name, std::string_view &out) {
+        bool closed = false;
+        if (! this->tag_name("<", name) || ! this->attributes(closed, [](std::string_view, const char*, const char*) {}) || closed)
+            return false;
+        std::string_view rest(p, end - p);
+        size_t content_end = rest.find("</");
+        for (; content_end != std::string_view::npos; content_end = rest.find("</", content_end + 2))
+            if (MeshXmlParser{ p + content_end, end }.tag_name("</", name))
+                break;
+        if (content_end == std::string_view::npos)
+            return false;
+        out = rest.substr(0, content_end);
+        p += content_end;
+        return this->end_tag(name);
+    }
+
+    // Splits the content of a <mesh> element into the content of its <vertices> and <triangles> elements.
+    bool mesh(std::string_view &vertices, std::string_view &triangles) {
+        this->skip_spaces();
+        if (! this->content(VERTICES_TAG, vertices))
+            return false;
+        this->skip_spaces();
+        if (! this->content(TRIANGLES_TAG, triangles))
+            return false;
+        this->skip_spaces();
+        return p == end;
+    }
+
+    bool vertices(std::vector<Slic3r::Vec3f> &out) {
+        for (this->skip_spaces(); p != end; this->skip_spaces()) {
+            // missing values are set equal to ZERO
+            Slic3r::Vec3f v = Slic3r::Vec3f::Zero();
+            if (! this->element(VERTEX_TAG, [&v](std::string_view key, const char *value, const char *value_end) {
+                    if (key.size() == 1 && key.front() >= 'x' && key.front() <= 'z')
+                        fast_float::from_chars(value, value_end, v(key.front() - 'x'));
+                }))
+                return false;
+            out.emplace_back(v);
+        }
+        return true;
+    }
+
+    bool triangles(std::vector<Slic3r::Vec3i> &out, TrianglesPainting &custom_supports, TrianglesPainting &custom_seam, TrianglesPainting &mmu_segmentation) {
+        for (this->skip_spaces(); p != end; this->skip_spaces()) {
+            // missing values are set equal to ZERO
+            Slic3r::Vec3i t = Slic3r::Vec3i::Zero();
+            unsigned int  idx = (unsigned int)out.size();
+            if (! this->element(TRIANGLE_TAG, [&](std::string_view key, const char *value, const char *value_end) {
+                    if (key.size() == 2 && key.front() == 'v' && key.back() >= '1' && key.back() <= '3')
+                        boost::spirit::qi::parse(value, value_end, boost::spirit::qi::int_, t(key.back() - '1'));
+                    else if (value != value_end) {
+                        if (key == CUSTOM_SUPPORTS_ATTR)
+                            custom_supports.emplace_back(idx, std::string(value, value_end));
+                        else if (key == CUSTOM_SEAM_ATTR)
+                            custom_seam.emplace_back(idx, std::string(value, value_end));
+                        else if (key == MMU_SEGMENTATION_ATTR)
+                            mmu_segmentation.emplace_back(idx, std::string(value, value_end));
+                    }
+                }))
+                return false;
+            out.emplace_back(t);
+        }
+        return true;
+    }
+};
+
 namespace Slic3r {
 
 //! macro used to mark string used at localization,
@@ -315,9 +483,10 @@ namespace Slic3r {
         {
             std::vector<Vec3f> vertices;
             std::vector<Vec3i> triangles;
-            std::vector<std::string> custom_supports;
-            std::vector<std::string> custom_seam;
-            std::vector<std::string> mmu_segmentation;
+            // Only the painted triangles are stored.
+            TrianglesPainting custom_supports;
+            TrianglesPainting custom_seam;
+            TrianglesPainting mmu_segmentation;
 
             bool empty() { return vertices.empty() || triangles.empty(); }
 
@@ -427,6 +596,8 @@ namespace Slic3r {
         unsigned int m_mm_painting_version           = 0;
 
         XML_Parser m_xml_parser;
+        // Meshes of the .model file being parsed, parsed ahead of expat, see _parse_meshes().
+        std::vector<Geometry> m_parsed_meshes;
         // Error code returned by the application side of the parser. In that case the expat may not reliably deliver the error state
         // after returning from XML_Parse() function, thus we keep the error state here.
         bool m_parse_error { false };
@@ -470,16 +641,17 @@ namespace Slic3r {
         }
 
         bool _load_model_from_file(const std::string& filename, Model& model, DynamicPrintConfig& config, ConfigSubstitutionContext& config_substitutions);
-        bool _extract_model_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
-        void _extract_layer_heights_profile_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
-        void _extract_layer_config_ranges_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, ConfigSubstitutionContext& config_substitutions);
-        void _extract_sla_support_points_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
-        void _extract_sla_drain_holes_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
+        bool _extract_model_from_archive(const std::string& name, std::string& data);
+        void _parse_meshes(std::string& data);
+        void _extract_layer_heights_profile_config_from_archive(std::string& data);
+        void _extract_layer_config_ranges_from_archive(const std::string& data, ConfigSubstitutionContext& config_substitutions);
+        void _extract_sla_support_points_from_archive(std::string& data);
+        void _extract_sla_drain_holes_from_archive(std::string& data);
 
-        void _extract_custom_gcode_per_print_z_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat);
+        void _extract_custom_gcode_per_print_z_from_archive(const std::string& data);
 
-        void _extract_print_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, DynamicPrintConfig& config, ConfigSubstitutionContext& subs_context, const std::string& archive_filename);
-        bool _extract_model_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, Model& model);
+        void _extract_print_config_from_archive(const std::string& data, DynamicPrintConfig& config, ConfigSubstitutionContext& subs_context, const std::string& archive_filename);
+        bool _extract_model_config_from_archive(const std::string& data, Model& model);
 
         // handlers to parse the .model file
         void _handle_start_model_xml_element(const char* name, const char** attributes);
@@ -547,7 +719,8 @@ namespace Slic3r {
         bool _handle_start_config_metadata(const char** attributes, unsigned int num_attributes);
         bool _handle_end_config_metadata();
 
-        bool _generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions);
+        // If last_use is set, the buffers of the geometry may be taken over by the volumes.
+        bool _generate_volumes(ModelObject& object, Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions, bool last_use);
 
         // callbacks to parse the .model file
         static void XMLCALL _handle_start_model_xml_element(void* userData, const char* name, const char** attributes);
@@ -637,74 +810,145 @@ namespace Slic3r {
 
         m_name = boost::filesystem::path(filename).stem().string();
 
-        // we first loop the entries to read from the archive the .model file only, in order to extract the version from it
+        // Collect the .model files and the config files known to us.
+        struct Entry
+        {
+            Entry(std::string name, mz_uint index, size_t size, bool model) :
+                name(std::move(name)), index(index), size(size), model(model) {}
+
+            std::string name;
+            mz_uint     index;
+            size_t      size;
+            bool        model;
+            std::string data;
+            bool        extracted { false };
+        };
+        std::vector<Entry> entries;
         for (mz_uint i = 0; i < num_entries; ++i) {
             if (mz_zip_reader_file_stat(&archive, i, &stat)) {
                 std::string name(stat.m_filename);
                 std::replace(name.begin(), name.end(), '\\', '/');
 
-                if (boost::algorithm::istarts_with(name, MODEL_FOLDER) && boost::algorithm::iends_with(name, MODEL_EXTENSION)) {
-                    try
-                    {
-                        // valid model name -> extract model
-                        if (!_extract_model_from_archive(archive, stat)) {
-                            close_zip_reader(&archive);
-                            add_error("Archive does not contain a valid model");
-                            return false;
-                        }
-                    }
-                    catch (const std::exception& e)
-                    {
-                        // ensure the zip archive is closed and rethrow the exception
-                        close_zip_reader(&archive);
-                        throw Slic3r::FileIOError(e.what());
-                    }
-                }
+                bool model_file = boost::algorithm::istarts_with(name, MODEL_FOLDER) && boost::algorithm::iends_with(name, MODEL_EXTENSION);
+                if (model_file ||
+                    boost::algorithm::iequals(name, LAYER_HEIGHTS_PROFILE_FILE) ||
+                    boost::algorithm::iequals(name, LAYER_CONFIG_RANGES_FILE) ||
+                    boost::algorithm::iequals(name, SLA_SUPPORT_POINTS_FILE) ||
+                    boost::algorithm::iequals(name, SLA_DRAIN_HOLES_FILE) ||
+                    boost::algorithm::iequals(name, PRINT_CONFIG_FILE) ||
+                    boost::algorithm::iequals(name, CUSTOM_GCODE_PER_PRINT_Z_FILE) ||
+                    boost::algorithm::iequals(name, MODEL_CONFIG_FILE))
+                    entries.emplace_back(std::move(name), i, size_t(stat.m_uncomp_size), model_file);
             }
         }
+        close_zip_reader(&archive);
 
-        // we then loop again the entries to read other files stored in the archive
-        for (mz_uint i = 0; i < num_entries; ++i) {
-            if (mz_zip_reader_file_stat(&archive, i, &stat)) {
-                std::string name(stat.m_filename);
-                std::replace(name.begin(), name.end(), '\\', '/');
-
-                if (boost::algorithm::iequals(name, LAYER_HEIGHTS_PROFILE_FILE)) {
-                    // extract slic3r layer heights profile file
-                    _extract_layer_heights_profile_config_from_archive(archive, stat);
-                }
-                else if (boost::algorithm::iequals(name, LAYER_CONFIG_RANGES_FILE)) {
-                    // extract slic3r layer config ranges file
-                    _extract_layer_config_ranges_from_archive(archive, stat, config_substitutions);
+        // The .model files are read first, in order to extract the version from them.
+        std::stable_partition(entries.begin(), entries.end(), [](const Entry &entry) { return entry.model; });
+
+        // Inflate them in parallel, each task reads the archive through its own handle.
+        auto inflate = [&filename, &entries](size_t begin, size_t end) {
+            tbb::parallel_for(tbb::blocked_range<size_t>(begin, end, 1), [&filename, &entries](const tbb::blocked_range<size_t> &range) {
+                mz_zip_archive entry_archive;
+                mz_zip_zero_struct(&entry_archive);
+                if (! open_zip_reader(&entry_archive, filename))
+                    return;
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    Entry &entry = entries[i];
+                    try {
+                        entry.data.assign(entry.size, 0);
+                        entry.extracted = entry.size == 0 || mz_zip_reader_extract_to_mem(&entry_archive, entry.index, entry.data.data(), entry.size, 0);
+                    } catch (const std::bad_alloc&) {
+                        entry.data = std::string();
+                    }
                 }
-                else if (boost::algorithm::iequals(name, SLA_SUPPORT_POINTS_FILE)) {
-                    // extract sla support points file
-                    _extract_sla_support_points_from_archive(archive, stat);
+                close_zip_reader(&entry_archive);
+            });
+        };
+
+        auto extract = [this, &filename, &model, &config, &config_substitutions](Entry &entry) {
+            if (entry.model) {
+                if (! entry.extracted) {
+                    add_error("Error while extracting model data from zip archive");
+                    add_error("Archive does not contain a valid model");
+                    return false;
                 }
-                else if (boost::algorithm::iequals(name, SLA_DRAIN_HOLES_FILE)) {
-                    // extract sla support points file
-                    _extract_sla_drain_holes_from_archive(archive, stat);
+                try
+                {
+                    // valid model name -> extract model
+                    if (!_extract_model_from_archive(entry.name, entry.data)) {
+                        add_error("Archive does not contain a valid model");
+                        return false;
+                    }
                 }
-                else if (boost::algorithm::iequals(name, PRINT_CONFIG_FILE)) {
-                    // extract slic3r print config file
-                    _extract_print_config_from_archive(archive, stat, config, config_substitutions, filename);
+                catch (const std::exception& e)
+                {
+                    // rethrow the exception
+                    throw Slic3r::FileIOError(e.what());
                 }
-                else if (boost::algorithm::iequals(name, CUSTOM_GCODE_PER_PRINT_Z_FILE)) {
-                    // extract slic3r layer config ranges file
-                    _extract_custom_gcode_per_print_z_from_archive(archive, stat);
+                return true;
+            }
+
+            if (! entry.extracted) {
+                add_error("Error while reading " + entry.name + " from the archive");
+                if (boost::algorithm::iequals(entry.name, MODEL_CONFIG_FILE)) {
+                    add_error("Archive does not contain a valid model config");
+                    return false;
                 }
-                else if (boost::algorithm::iequals(name, MODEL_CONFIG_FILE)) {
-                    // extract slic3r model config file
-                    if (!_extract_model_config_from_archive(archive, stat, model)) {
-                        close_zip_reader(&archive);
-                        add_error("Archive does not contain a valid model config");
-                        return false;
-                    }
+                return true;
+            }
+
+            if (boost::algorithm::iequals(entry.name, LAYER_HEIGHTS_PROFILE_FILE)) {
+                // extract slic3r layer heights profile file
+                _extract_layer_heights_profile_config_from_archive(entry.data);
+            }
+            else if (boost::algorithm::iequals(entry.name, LAYER_CONFIG_RANGES_FILE)) {
+                // extract slic3r layer config ranges file
+                _extract_layer_config_ranges_from_archive(entry.data, config_substitutions);
+            }
+            else if (boost::algorithm::iequals(entry.name, SLA_SUPPORT_POINTS_FILE)) {
+                // extract sla support points file
+                _extract_sla_support_points_from_archive(entry.data);
+            }
+            else if (boost::algorithm::iequals(entry.name, SLA_DRAIN_HOLES_FILE)) {
+                // extract sla support points file
+                _extract_sla_drain_holes_from_archive(entry.data);
+            }
+            else if (boost::algorithm::iequals(entry.name, PRINT_CONFIG_FILE)) {
+                // extract slic3r print config file
+                _extract_print_config_from_archive(entry.data, config, config_substitutions, filename);
+            }
+            else if (boost::algorithm::iequals(entry.name, CUSTOM_GCODE_PER_PRINT_Z_FILE)) {
+                // extract slic3r layer config ranges file
+                _extract_custom_gcode_per_print_z_from_archive(entry.data);
+            }
+            else if (boost::algorithm::iequals(entry.name, MODEL_CONFIG_FILE)) {
+                // extract slic3r model config file
+                if (!_extract_model_config_from_archive(entry.data, model)) {
+                    add_error("Archive does not contain a valid model config");
+                    return false;
                 }
             }
-        }
+            return true;
+        };
 
-        close_zip_reader(&archive);
+        // The entries are inflated in batches of a bounded size and released once extracted,
+        // so that a large project is not held in memory all at once. A batch takes at least one entry.
+        for (size_t begin = 0; begin < entries.size();) {
+            size_t end   = begin;
+            size_t bytes = 0;
+            do
+                bytes += entries[end ++].size;
+            while (end < entries.size() && bytes + entries[end].size <= INFLATE_BATCH_SIZE);
+            inflate(begin, end);
+            for (; begin < end; ++ begin) {
+                Entry &entry = entries[begin];
+                bool   ok    = extract(entry);
+                entry.data = std::string();
+                if (! ok)
+                    return false;
+            }
+        }
 
         if (m_version == 0) {
             // if the 3mf was not produced by XDesktop and there is more than one instance,
@@ -715,10 +959,10 @@ namespace Slic3r {
                 ModelObject* model_object = m_model->objects[i];
                 if (model_object->instances.size() > 1) {
                     // select the geometry associated with the original model object
-                    const Geometry* geometry = nullptr;
+                    Geometry* geometry = nullptr;
                     for (const IdToModelObjectMap::value_type& object : m_objects) {
                         if (object.second == int(i)) {
-                            IdToGeometryMap::const_iterator obj_geometry = m_geometries.find(object.first);
+                            IdToGeometryMap::iterator obj_geometry = m_geometries.find(object.first);
                             if (obj_geometry == m_geometries.end()) {
                                 add_error("Unable to find object geometry");
                                 return false;
@@ -743,7 +987,7 @@ namespace Slic3r {
                         new_model_object->clear_instances();
                         new_model_object->add_instance(*model_object->instances.back());
                         model_object->delete_last_instance();
-                        if (!_generate_volumes(*new_model_object, *geometry, volumes, config_substitutions))
+                        if (!_generate_volumes(*new_model_object, *geometry, volumes, config_substitutions, false))
                             return false;
                     }
                 }
@@ -757,7 +1001,7 @@ namespace Slic3r {
                 return false;
             }
             ModelObject* model_object = m_model->objects[object.second];
-            IdToGeometryMap::const_iterator obj_geometry = m_geometries.find(object.first);
+            IdToGeometryMap::iterator obj_geometry = m_geometries.find(object.first);
             if (obj_geometry == m_geometries.end()) {
                 add_error("Unable to find object geometry");
                 return false;
@@ -813,7 +1057,7 @@ namespace Slic3r {
                 volumes_ptr = &volumes;
             }
 
-            if (!_generate_volumes(*model_object, obj_geometry->second, *volumes_ptr, config_substitutions))
+            if (!_generate_volumes(*model_object, obj_geometry->second, *volumes_ptr, config_substitutions, true))
                 return false;
         }
 
@@ -839,9 +1083,9 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Importer::_extract_model_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat)
+    bool _3MF_Importer::_extract_model_from_archive(const std::string& name, std::string& data)
     {
-        if (stat.m_uncomp_size == 0) {
+        if (data.empty()) {
             add_error("Found invalid size");
             return false;
         }
@@ -858,31 +1102,21 @@ namespace Slic3r {
         XML_SetElementHandler(m_xml_parser, _3MF_Importer::_handle_start_model_xml_element, _3MF_Importer::_handle_end_model_xml_element);
         XML_SetCharacterDataHandler(m_xml_parser, _3MF_Importer::_handle_model_xml_characters);
 
-        struct CallbackData
-        {
-            XML_Parser& parser;
-            _3MF_Importer& importer;
-            const mz_zip_archive_file_stat& stat;
-
-            CallbackData(XML_Parser& parser, _3MF_Importer& importer, const mz_zip_archive_file_stat& stat) : parser(parser), importer(importer), stat(stat) {}
-        };
-
-        CallbackData data(m_xml_parser, *this, stat);
-
-        mz_bool res = 0;
+        // The meshes are parsed in parallel first, expat then only processes the rest of the model.
+        _parse_meshes(data);
 
         try
         {
-            res = mz_zip_reader_extract_file_to_callback(&archive, stat.m_filename, [](void* pOpaque, mz_uint64 file_ofs, const void* pBuf, size_t n)->size_t {
-                CallbackData* data = (CallbackData*)pOpaque;
-                if (!XML_Parse(data->parser, (const char*)pBuf, (int)n, (file_ofs + n == data->stat.m_uncomp_size) ? 1 : 0) || data->importer.parse_error()) {
+            // Feed expat in blocks, as it takes the length as int.
+            static constexpr size_t block_size = 64 * 1024 * 1024;
+            for (size_t pos = 0; pos < data.size(); pos += block_size) {
+                size_t n = std::min(block_size, data.size() - pos);
+                if (!XML_Parse(m_xml_parser, data.data() + pos, (int)n, (pos + n == data.size()) ? 1 : 0) || parse_error()) {
                     char error_buf[1024];
-                    ::sprintf(error_buf, "Error (%s) while parsing '%s' at line %d", data->importer.parse_error_message(), data->stat.m_filename, (int)XML_GetCurrentLineNumber(data->parser));
+                    ::sprintf(error_buf, "Error (%s) while parsing '%s' at line %d", parse_error_message(), name.c_str(), (int)XML_GetCurrentLineNumber(m_xml_parser));
                     throw Slic3r::FileIOError(error_buf);
                 }
-
-                return n;
-                }, &data, 0);
+            }
         }
         catch (const version_error& e)
         {
@@ -891,30 +1125,171 @@ namespace Slic3r {
         }
         catch (std::exception& e)
         {
+            m_parsed_meshes.clear();
             add_error(e.what());
             return false;
         }
 
-        if (res == 0) {
-            add_error("Error while extracting model data from zip archive");
-            return false;
+        m_parsed_meshes.clear();
+        return true;
+    }
+
+    void _3MF_Importer::_parse_meshes(std::string& data)
+    {
+        // <mesh> element without attributes, split into the content of its <vertices> and <triangles>.
+        struct Mesh
+        {
+            // Range of the whole element in data.
+            size_t           begin;
+            size_t           end;
+            std::string_view vertices;
+            std::string_view triangles;
+            bool             valid { true };
+        };
+        // Block of <vertex> or <triangle> elements of a mesh.
+        struct Chunk
+        {
+            Chunk(size_t mesh, const char *begin, const char *end, bool triangles) :
+                mesh(mesh), begin(begin), end(end), triangles(triangles) {}
+
+            size_t             mesh;
+            const char        *begin;
+            const char        *end;
+            bool               triangles;
+            bool               valid { false };
+            size_t             offset { 0 };
+            std::vector<Vec3f> vertices;
+            std::vector<Vec3i> indices;
+            TrianglesPainting  custom_supports;
+            TrianglesPainting  custom_seam;
+            TrianglesPainting  mmu_segmentation;
+        };
+
+        m_parsed_meshes.clear();
+
+        const std::string_view text(data);
+        const char            *text_end = data.data() + data.size();
+        std::vector<Mesh>      meshes;
+        for (size_t pos = text.find("<mesh"); pos != std::string_view::npos; pos = text.find("<mesh", pos + 1)) {
+            MeshXmlParser parser { data.data() + pos + 5, text_end };
+            parser.skip_spaces();
+            if (parser.p == text_end || *parser.p != '>')
+                // Either a different element or a mesh with attributes.
+                continue;
+            ++ parser.p;
+            size_t content_end = text.find("</mesh", parser.p - data.data());
+            if (content_end == std::string_view::npos)
+                break;
+            MeshXmlParser end_tag { data.data() + content_end, text_end };
+            Mesh          mesh;
+            parser.end = end_tag.p;
+            if (parser.mesh(mesh.vertices, mesh.triangles) && end_tag.end_tag(MESH_TAG)) {
+                mesh.begin = pos;
+                mesh.end   = end_tag.p - data.data();
+                meshes.emplace_back(mesh);
+            }
+            pos = content_end;
         }
+        if (meshes.empty())
+            return;
 
-        return true;
+        // Split the meshes into blocks starting with an element.
+        std::vector<Chunk> chunks;
+        for (size_t i = 0; i < meshes.size(); ++ i)
+            for (bool triangles : { false, true }) {
+                std::string_view content = triangles ? meshes[i].triangles : meshes[i].vertices;
+                const char      *end     = content.data() + content.size();
+                for (const char *begin = content.data(); begin != end;) {
+                    const char *chunk_end = size_t(end - begin) > MESH_XML_CHUNK_SIZE ? std::find(begin + MESH_XML_CHUNK_SIZE, end, '<') : end;
+                    chunks.emplace_back(i, begin, chunk_end, triangles);
+                    begin = chunk_end;
+                }
+            }
+
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&chunks](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                Chunk        &chunk = chunks[i];
+                MeshXmlParser parser { chunk.begin, chunk.end };
+                // A <vertex> element takes about 50 bytes, a <triangle> element about the same.
+                if (chunk.triangles) {
+                    chunk.indices.reserve((chunk.end - chunk.begin) / 48);
+                    chunk.valid = parser.triangles(chunk.indices, chunk.custom_supports, chunk.custom_seam, chunk.mmu_segmentation);
+                } else {
+                    chunk.vertices.reserve((chunk.end - chunk.begin) / 48);
+                    chunk.valid = parser.vertices(chunk.vertices);
+                }
+            }
+        });
+
+        // Merge the blocks into the geometries, the meshes containing anything else than the plain
+        // vertices and triangles are left to expat.
+        auto merge_painting = [](TrianglesPainting &dst, TrianglesPainting &src, size_t offset) {
+            for (std::pair<unsigned int, std::string> &triangle : src)
+                dst.emplace_back(triangle.first + (unsigned int)offset, std::move(triangle.second));
+        };
+        m_parsed_meshes.assign(meshes.size(), Geometry());
+        for (Chunk &chunk : chunks) {
+            Mesh &mesh = meshes[chunk.mesh];
+            mesh.valid &= chunk.valid;
+            if (mesh.valid) {
+                Geometry &geometry = m_parsed_meshes[chunk.mesh];
+                if (chunk.triangles) {
+                    chunk.offset = geometry.triangles.size();
+                    merge_painting(geometry.custom_supports, chunk.custom_supports, chunk.offset);
+                    merge_painting(geometry.custom_seam, chunk.custom_seam, chunk.offset);
+                    merge_painting(geometry.mmu_segmentation, chunk.mmu_segmentation, chunk.offset);
+                    geometry.triangles.resize(chunk.offset + chunk.indices.size());
+                } else {
+                    chunk.offset = geometry.vertices.size();
+                    geometry.vertices.resize(chunk.offset + chunk.vertices.size());
+                }
+            }
+        }
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [this, &chunks, &meshes](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                if (Chunk &chunk = chunks[i]; meshes[chunk.mesh].valid) {
+                    Geometry &geometry = m_parsed_meshes[chunk.mesh];
+                    if (chunk.triangles)
+                        std::copy(chunk.indices.begin(), chunk.indices.end(), geometry.triangles.begin() + chunk.offset);
+                    else
+                        std::copy(chunk.vertices.begin(), chunk.vertices.end(), geometry.vertices.begin() + chunk.offset);
+                }
+        });
+        chunks.clear();
+
+        // Replace the parsed meshes by empty elements referencing them. The line ends are kept for expat to report the right line numbers.
+        // The skeleton is compacted in place, as it is never longer than the text it was made of: the peak memory is the inflated .model
+        // plus the parsed geometries, not another copy of the .model. A mesh too short to hold its replacement is left to expat.
+        char  *dst  = data.data();
+        size_t last = 0;
+        // The kept text may overlap its destination.
+        auto keep = [&data, &dst](size_t begin, size_t end) { memmove(dst, data.data() + begin, end - begin); dst += end - begin; };
+        for (size_t i = 0; i < meshes.size(); ++ i) {
+            const Mesh &mesh = meshes[i];
+            std::string tag;
+            if (mesh.valid) {
+                tag  = std::string("<mesh ") + PARSED_MESH_ATTR + "=\"" + std::to_string(i) + "\">";
+                tag.append(size_t(std::count(data.begin() + mesh.begin, data.begin() + mesh.end, '\n')), '\n');
+                tag += "</mesh>";
+            }
+            if (! mesh.valid || size_t(dst - data.data()) + (mesh.begin - last) + tag.size() > mesh.end) {
+                m_parsed_meshes[i] = Geometry();
+                continue;
+            }
+            keep(last, mesh.begin);
+            dst = std::copy(tag.begin(), tag.end(), dst);
+            last = mesh.end;
+        }
+        keep(last, data.size());
+        data.resize(dst - data.data());
     }
 
     void _3MF_Importer::_extract_print_config_from_archive(
-        mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, 
+        const std::string& buffer,
         DynamicPrintConfig& config, ConfigSubstitutionContext& config_substitutions, 
         const std::string& archive_filename)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer((size_t)stat.m_uncomp_size, 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading config data to buffer");
-                return;
-            }
+        if (! buffer.empty()) {
             //FIXME Loading a "will be one day a legacy format" of configuration in a form of a G-code comment.
             // Each config line is prefixed with a semicolon (G-code comment), that is ugly.
 
@@ -926,15 +1301,9 @@ namespace Slic3r {
         }
     }
 
-    void _3MF_Importer::_extract_layer_heights_profile_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat)
+    void _3MF_Importer::_extract_layer_heights_profile_config_from_archive(std::string& buffer)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer((size_t)stat.m_uncomp_size, 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading layer heights profile data to buffer");
-                return;
-            }
+        if (! buffer.empty()) {
 
             if (buffer.back() == '\n')
                 buffer.pop_back();
@@ -988,15 +1357,9 @@ namespace Slic3r {
         }
     }
 
-    void _3MF_Importer::_extract_layer_config_ranges_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, ConfigSubstitutionContext& config_substitutions)
+    void _3MF_Importer::_extract_layer_config_ranges_from_archive(const std::string& buffer, ConfigSubstitutionContext& config_substitutions)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer((size_t)stat.m_uncomp_size, 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading layer config ranges data to buffer");
-                return;
-            }
+        if (! buffer.empty()) {
 
             std::istringstream iss(buffer); // wrap returned xml to istringstream
             pt::ptree objects_tree;
@@ -1045,15 +1408,9 @@ namespace Slic3r {
         }
     }
 
-    void _3MF_Importer::_extract_sla_support_points_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat)
+    void _3MF_Importer::_extract_sla_support_points_from_archive(std::string& buffer)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer((size_t)stat.m_uncomp_size, 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading sla support points data to buffer");
-                return;
-            }
+        if (! buffer.empty()) {
 
             if (buffer.back() == '\n')
                 buffer.pop_back();
@@ -1127,16 +1484,9 @@ namespace Slic3r {
         }
     }
     
-    void _3MF_Importer::_extract_sla_drain_holes_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat)
+    void _3MF_Importer::_extract_sla_drain_holes_from_archive(std::string& buffer)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer(size_t(stat.m_uncomp_size), 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading sla support points data to buffer");
-                return;
-            }
-            
+        if (! buffer.empty()) {
             if (buffer.back() == '\n')
                 buffer.pop_back();
             
@@ -1212,9 +1562,9 @@ namespace Slic3r {
         }
     }
 
-    bool _3MF_Importer::_extract_model_config_from_archive(mz_zip_archive& archive, const mz_zip_archive_file_stat& stat, Model& model)
+    bool _3MF_Importer::_extract_model_config_from_archive(const std::string& buffer, Model& model)
     {
-        if (stat.m_uncomp_size == 0) {
+        if (buffer.empty()) {
             add_error("Found invalid size");
             return false;
         }
@@ -1230,19 +1580,7 @@ namespace Slic3r {
         XML_SetUserData(m_xml_parser, (void*)this);
         XML_SetElementHandler(m_xml_parser, _3MF_Importer::_handle_start_config_xml_element, _3MF_Importer::_handle_end_config_xml_element);
 
-        void* parser_buffer = XML_GetBuffer(m_xml_parser, (int)stat.m_uncomp_size);
-        if (parser_buffer == nullptr) {
-            add_error("Unable to create buffer");
-            return false;
-        }
-
-        mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, parser_buffer, (size_t)stat.m_uncomp_size, 0);
-        if (res == 0) {
-            add_error("Error while reading config data to buffer");
-            return false;
-        }
-
-        if (!XML_ParseBuffer(m_xml_parser, (int)stat.m_uncomp_size, 1)) {
+        if (!XML_Parse(m_xml_parser, buffer.data(), (int)buffer.size(), 1)) {
             char error_buf[1024];
             ::sprintf(error_buf, "Error (%s) while parsing xml file at line %d", XML_ErrorString(XML_GetErrorCode(m_xml_parser)), (int)XML_GetCurrentLineNumber(m_xml_parser));
             add_error(error_buf);
@@ -1252,15 +1590,9 @@ namespace Slic3r {
         return true;
     }
 
-    void _3MF_Importer::_extract_custom_gcode_per_print_z_from_archive(::mz_zip_archive &archive, const mz_zip_archive_file_stat &stat)
+    void _3MF_Importer::_extract_custom_gcode_per_print_z_from_archive(const std::string& buffer)
     {
-        if (stat.m_uncomp_size > 0) {
-            std::string buffer((size_t)stat.m_uncomp_size, 0);
-            mz_bool res = mz_zip_reader_extract_file_to_mem(&archive, stat.m_filename, (void*)buffer.data(), (size_t)stat.m_uncomp_size, 0);
-            if (res == 0) {
-                add_error("Error while reading custom Gcodes per height data to buffer");
-                return;
-            }
+        if (! buffer.empty()) {
 
             std::istringstream iss(buffer); // wrap returned xml to istringstream
             pt::ptree main_tree;
@@ -1556,6 +1888,19 @@ namespace Slic3r {
     {
         // reset current geometry
         m_curr_object.geometry.reset();
+
+        // take over the geometry parsed by _parse_meshes()
+        if (const char* text = get_attribute_value_charptr(attributes, num_attributes, PARSED_MESH_ATTR); text != nullptr) {
+            size_t idx = (size_t)::atoi(text);
+            if (idx >= m_parsed_meshes.size()) {
+                add_error("Found invalid mesh");
+                return false;
+            }
+            m_curr_object.geometry = std::move(m_parsed_meshes[idx]);
+            if (m_unit_factor != 1.0f)
+                for (Vec3f& vertex : m_curr_object.geometry.vertices)
+                    vertex *= m_unit_factor;
+        }
         return true;
     }
 
@@ -1624,9 +1969,15 @@ namespace Slic3r {
             get_attribute_value_int(attributes, num_attributes, V2_ATTR),
             get_attribute_value_int(attributes, num_attributes, V3_ATTR));
 
-        m_curr_object.geometry.custom_supports.push_back(get_attribute_value_string(attributes, num_attributes, CUSTOM_SUPPORTS_ATTR));
-        m_curr_object.geometry.custom_seam.push_back(get_attribute_value_string(attributes, num_attributes, CUSTOM_SEAM_ATTR));
-        m_curr_object.geometry.mmu_segmentation.push_back(get_attribute_value_string(attributes, num_attributes, MMU_SEGMENTATION_ATTR));
+        // stores the painting of the painted triangles only
+        unsigned int idx = (unsigned int)m_curr_object.geometry.triangles.size() - 1;
+        auto add_painting = [attributes, num_attributes, idx](const char* attribute_key, TrianglesPainting& painting) {
+            if (const char* text = get_attribute_value_charptr(attributes, num_attributes, attribute_key); text != nullptr && *text != 0)
+                painting.emplace_back(idx, text);
+        };
+        add_painting(CUSTOM_SUPPORTS_ATTR, m_curr_object.geometry.custom_supports);
+        add_painting(CUSTOM_SEAM_ATTR, m_curr_object.geometry.custom_seam);
+        add_painting(MMU_SEGMENTATION_ATTR, m_curr_object.geometry.mmu_segmentation);
         return true;
     }
 
@@ -1934,7 +2285,7 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Importer::_generate_volumes(ModelObject& object, const Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions)
+    bool _3MF_Importer::_generate_volumes(ModelObject& object, Geometry& geometry, const ObjectMetadata::VolumeMetadataList& volumes, ConfigSubstitutionContext& config_substitutions, bool last_use)
     {
         if (!object.volumes.empty()) {
             add_error("Found invalid volumes count");
@@ -1961,9 +2312,13 @@ namespace Slic3r {
                 }
             }
 
-            // splits volume out of imported geometry
+            // splits volume out of imported geometry, taking over the buffers if the volume is made of all of it
+            const bool whole_geometry = last_use && volumes.size() == 1 && volume_data.first_triangle_id == 0 && volume_data.last_triangle_id + 1 == geo_tri_count;
             indexed_triangle_set its;
-            its.indices.assign(geometry.triangles.begin() + volume_data.first_triangle_id, geometry.triangles.begin() + volume_data.last_triangle_id + 1);
+            if (whole_geometry)
+                its.indices = std::move(geometry.triangles);
+            else
+                its.indices.assign(geometry.triangles.begin() + volume_data.first_triangle_id, geometry.triangles.begin() + volume_data.last_triangle_id + 1);
             const size_t triangles_count = its.indices.size();
             if (triangles_count == 0) {
                 add_error("An empty triangle mesh found");
@@ -1983,12 +2338,16 @@ namespace Slic3r {
                         max_id = std::max(max_id, tri_id);
                     }
                 }
-                its.vertices.assign(geometry.vertices.begin() + min_id, geometry.vertices.begin() + max_id + 1);
+                if (whole_geometry && min_id == 0 && max_id + 1 == int(geometry.vertices.size()))
+                    its.vertices = std::move(geometry.vertices);
+                else
+                    its.vertices.assign(geometry.vertices.begin() + min_id, geometry.vertices.begin() + max_id + 1);
 
                 // rebase indices to the current vertices list
-                for (Vec3i& face : its.indices)
-                    for (int& tri_id : face)
-                        tri_id -= min_id;
+                if (min_id != 0)
+                    for (Vec3i& face : its.indices)
+                        for (int& tri_id : face)
+                            tri_id -= min_id;
             }
 
             if (m_prusaslicer_generator_version && 
@@ -2022,18 +2381,15 @@ namespace Slic3r {
             volume->supported_facets.reserve(triangles_count);
             volume->seam_facets.reserve(triangles_count);
             volume->mmu_segmentation_facets.reserve(triangles_count);
-            for (size_t i=0; i<triangles_count; ++i) {
-                size_t index = volume_data.first_triangle_id + i;
-                assert(index < geometry.custom_supports.size());
-                assert(index < geometry.custom_seam.size());
-                assert(index < geometry.mmu_segmentation.size());
-                if (! geometry.custom_supports[index].empty())
-                    volume->supported_facets.set_triangle_from_string(i, geometry.custom_supports[index]);
-                if (! geometry.custom_seam[index].empty())
-                    volume->seam_facets.set_triangle_from_string(i, geometry.custom_seam[index]);
-                if (! geometry.mmu_segmentation[index].empty())
-                    volume->mmu_segmentation_facets.set_triangle_from_string(i, geometry.mmu_segmentation[index]);
-            }
+            auto set_painting = [&volume_data](const TrianglesPainting& painting, FacetsAnnotation& facets) {
+                auto it = std::lower_bound(painting.begin(), painting.end(), volume_data.first_triangle_id,
+                    [](const std::pair<unsigned int, std::string>& triangle, unsigned int id) { return triangle.first < id; });
+                for (; it != painting.end() && it->first <= volume_data.last_triangle_id; ++ it)
+                    facets.set_triangle_from_string(int(it->first - volume_data.first_triangle_id), it->second);
+            };
+            set_painting(geometry.custom_supports, volume->supported_facets);
+            set_painting(geometry.custom_seam, volume->seam_facets);
+            set_painting(geometry.mmu_segmentation, volume->mmu_segmentation_facets);
             volume->supported_facets.shrink_to_fit();
             volume->seam_facets.shrink_to_fit();
             volume->mmu_segmentation_facets.shrink_to_fit();
@@ -2113,6 +2469,47 @@ namespace Slic3r {
             importer->_handle_end_config_xml_element(name);
     }
 
+    // Writes the text of a .model file made of blocks, which are produced by tasks running in parallel.
+    // A batch of blocks is generated at a time and written to the deflater in order, bounding the memory used.
+    class ModelTextWriter
+    {
+    public:
+        typedef std::function<void(std::string&)> Generator;
+
+        explicit ModelTextWriter(MZ_ParallelDeflate& context)
+            : m_context(context), m_batch_size(4 * std::max(1u, std::thread::hardware_concurrency())) {}
+
+        bool add(std::string text) {
+            m_blocks.push_back({ Generator(), std::move(text) });
+            return m_blocks.size() < m_batch_size || this->flush();
+        }
+        bool add(Generator generator) {
+            m_blocks.push_back({ std::move(generator), std::string() });
+            return m_blocks.size() < m_batch_size || this->flush();
+        }
+        bool flush() {
+            tbb::parallel_for(size_t(0), m_blocks.size(), [this](size_t idx) {
+                if (Block& block = m_blocks[idx]; block.generator)
+                    block.generator(block.text);
+            });
+            for (const Block& block : m_blocks)
+                if (! block.text.empty() && ! m_context.write(block.text.data(), block.text.size()))
+                    return false;
+            m_blocks.clear();
+            return true;
+        }
+
+    private:
+        struct Block {
+            Generator   generator;
+            std::string text;
+        };
+
+        MZ_ParallelDeflate& m_context;
+        size_t              m_batch_size;
+        std::vector<Block>  m_blocks;
+    };
+
     class _3MF_Exporter : public _3MF_Base
     {
         struct BuildItem
@@ -2171,8 +2568,8 @@ namespace Slic3r {
         bool _add_thumbnail_file_to_archive(mz_zip_archive& archive, const ThumbnailData& thumbnail_data);
         bool _add_relationships_file_to_archive(mz_zip_archive& archive);
         bool _add_model_file_to_archive(const std::string& filename, mz_zip_archive& archive, const Model& model, IdToObjectDataMap& objects_data);
-        bool _add_object_to_model_stream(mz_zip_writer_staged_context &context, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets);
-        bool _add_mesh_to_object_stream(mz_zip_writer_staged_context &context, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
+        bool _add_object_to_model_stream(ModelTextWriter &writer, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets);
+        bool _add_mesh_to_object_stream(ModelTextWriter &writer, ModelObject& object, VolumeToOffsetsMap& volumes_offsets);
         bool _add_build_to_model_stream(std::stringstream& stream, const BuildItemsList& build_items);
         bool _add_layer_height_profile_file_to_archive(mz_zip_archive& archive, Model& model);
         bool _add_layer_config_ranges_file_to_archive(mz_zip_archive& archive, Model& model);
@@ -2379,16 +2776,18 @@ namespace Slic3r {
 
     bool _3MF_Exporter::_add_model_file_to_archive(const std::string& filename, mz_zip_archive& archive, const Model& model, IdToObjectDataMap& objects_data)
     {
-        mz_zip_writer_staged_context context;
-        if (!mz_zip_writer_add_staged_open(&archive, &context, MODEL_FILE.c_str(), 
+        // The model file is by far the largest entry, deflate it on all cores.
+        MZ_ParallelDeflate::Params deflate_params;
+        deflate_params.level = MZ_DEFAULT_LEVEL;
+        MZ_ParallelDeflate context(archive, deflate_params);
+        if (!context.open(MODEL_FILE.c_str(), 
             m_zip64 ? 
                 // Maximum expected and allowed 3MF file size is 16GiB.
                 // This switches the ZIP file to a 64bit mode, which adds a tiny bit of overhead to file records.
                 (uint64_t(1) << 30) * 16 : 
                 // Maximum expected 3MF file size is 4GB-1. This is a workaround for interoperability with Windows 10 3D model fixing API, see
                 // GH issue #6193.
-                (uint64_t(1) << 32) - 1,
-            nullptr, nullptr, 0, MZ_DEFAULT_COMPRESSION, nullptr, 0, nullptr, 0)) {
+                (uint64_t(1) << 32) - 1)) {
             add_error("Unable to add model file to archive");
             return false;
         }
@@ -2424,12 +2823,15 @@ namespace Slic3r {
             stream << " <" << METADATA_TAG << " name=\"Application\">" << SLIC3R_APP_KEY << "-" << SLIC3R_VERSION << "</" << METADATA_TAG << ">\n";
             stream << " <" << RESOURCES_TAG << ">\n";
             std::string buf = stream.str();
-            if (! buf.empty() && ! mz_zip_writer_add_staged_data(&context, buf.data(), buf.size())) {
+            if (! buf.empty() && ! context.write(buf.data(), buf.size())) {
                 add_error("Unable to add model file to archive");
                 return false;
             }
         }
 
+        // The meshes of all the objects are serialized in parallel.
+        ModelTextWriter writer(context);
+
         // Instance transformations, indexed by the 3MF object ID (which is a linear serialization of all instances of all ModelObjects).
         BuildItemsList build_items;
 
@@ -2447,12 +2849,15 @@ namespace Slic3r {
             // Store geometry of all ModelVolumes contained in a single ModelObject into a single 3MF indexed triangle set object.
             // object_it->second.volumes_offsets will contain the offsets of the ModelVolumes in that single indexed triangle set.
             // object_id will be increased to point to the 1st instance of the next ModelObject.
-            if (!_add_object_to_model_stream(context, object_id, *obj, build_items, object_it->second.volumes_offsets)) {
+            if (!_add_object_to_model_stream(writer, object_id, *obj, build_items, object_it->second.volumes_offsets)) {
                 add_error("Unable to add object to archive");
-                mz_zip_writer_add_staged_finish(&context);
                 return false;
             }
         }
+        if (! writer.flush()) {
+            add_error("Unable to add object to archive");
+            return false;
+        }
 
         {
             std::stringstream stream;
@@ -2462,7 +2867,6 @@ namespace Slic3r {
             // Store the transformations of all the ModelInstances of all ModelObjects, indexed in a linear fashion.
             if (!_add_build_to_model_stream(stream, build_items)) {
                 add_error("Unable to add build to archive");
-                mz_zip_writer_add_staged_finish(&context);
                 return false;
             }
 
@@ -2470,8 +2874,8 @@ namespace Slic3r {
            
             std::string buf = stream.str();
 
-            if ((! buf.empty() && ! mz_zip_writer_add_staged_data(&context, buf.data(), buf.size())) ||
-                ! mz_zip_writer_add_staged_finish(&context)) {
+            if ((! buf.empty() && ! context.write(buf.data(), buf.size())) ||
+                ! context.finish()) {
                 add_error("Unable to add model file to archive");
                 return false;
             }
@@ -2480,7 +2884,7 @@ namespace Slic3r {
         return true;
     }
 
-    bool _3MF_Exporter::_add_object_to_model_stream(mz_zip_writer_staged_context &context, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets)
+    bool _3MF_Exporter::_add_object_to_model_stream(ModelTextWriter &writer, unsigned int& object_id, ModelObject& object, BuildItemsList& build_items, VolumeToOffsetsMap& volumes_offsets)
     {
         std::stringstream stream;
         reset_stream(stream);
@@ -2496,8 +2900,8 @@ namespace Slic3r {
             if (id == 0) {
                 std::string buf = stream.str();
                 reset_stream(stream);
-                if ((! buf.empty() && ! mz_zip_writer_add_staged_data(&context, buf.data(), buf.size())) ||
-                    ! _add_mesh_to_object_stream(context, object, volumes_offsets)) {
+                if ((! buf.empty() && ! writer.add(std::move(buf))) ||
+                    ! _add_mesh_to_object_stream(writer, object, volumes_offsets)) {
                     add_error("Unable to add mesh to archive");
                     return false;
                 }
@@ -2520,7 +2924,7 @@ namespace Slic3r {
 
         object_id += id;
         std::string buf = stream.str();
-        return buf.empty() || mz_zip_writer_add_staged_data(&context, buf.data(), buf.size());
+        return buf.empty() || writer.add(std::move(buf));
     }
 
 #if EXPORT_3MF_USE_SPIRIT_KARMA_FP
@@ -2543,7 +2947,7 @@ namespace Slic3r {
     using coordinate_type_scientific = boost::spirit::karma::real_generator<float, coordinate_policy_scientific<float>>;
 #endif // EXPORT_3MF_USE_SPIRIT_KARMA_FP
 
-    bool _3MF_Exporter::_add_mesh_to_object_stream(mz_zip_writer_staged_context &context, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
+    bool _3MF_Exporter::_add_mesh_to_object_stream(ModelTextWriter &writer, ModelObject& object, VolumeToOffsetsMap& volumes_offsets)
     {
         std::string output_buffer;
         output_buffer += "   <";
@@ -2552,19 +2956,16 @@ namespace Slic3r {
         output_buffer += VERTICES_TAG;
         output_buffer += ">\n";
 
-        auto flush = [this, &output_buffer, &context](bool force = false) {
-            if ((force && ! output_buffer.empty()) || output_buffer.size() >= 65536 * 16) {
-                if (! mz_zip_writer_add_staged_data(&context, output_buffer.data(), output_buffer.size())) {
-                    add_error("Error during writing or compression");
-                    return false;
-                }
-                output_buffer.clear();
+        auto flush = [this, &output_buffer, &writer]() {
+            if (! output_buffer.empty() && ! writer.add(std::move(output_buffer))) {
+                add_error("Error during writing or compression");
+                return false;
             }
+            output_buffer.clear();
             return true;
         };
 
         auto format_coordinate = [](float f, char *buf) -> char* {
-            assert(is_decimal_separator_point());
 #if EXPORT_3MF_USE_SPIRIT_KARMA_FP
             // Slightly faster than sprintf("%.9g"), but there is an issue with the karma floating point formatter,
             // https://github.com/boostorg/spirit/pull/586
@@ -2587,13 +2988,16 @@ namespace Slic3r {
             }
             // Return pointer to the end.
             return ptr;
+#elif defined(__cpp_lib_to_chars)
+            // Round-trippable float, shortest possible, independent of the locale.
+            return std::to_chars(buf, buf + 32, f).ptr;
 #else
+            assert(is_decimal_separator_point());
             // Round-trippable float, shortest possible.
             return buf + sprintf(buf, "%.9g", f);
 #endif
         };
 
-        char buf[256];
         unsigned int vertices_count = 0;
         for (ModelVolume* volume : object.volumes) {
             if (volume == nullptr)
@@ -2609,22 +3013,33 @@ namespace Slic3r {
 
             vertices_count += (int)its.vertices.size();
 
-            const Transform3d& matrix = volume->get_matrix();
-
-            for (size_t i = 0; i < its.vertices.size(); ++i) {
-                Vec3f v = (matrix * its.vertices[i].cast<double>()).cast<float>();
-                char *ptr = buf;
-                boost::spirit::karma::generate(ptr, boost::spirit::lit("     <") << VERTEX_TAG << " x=\"");
-                ptr = format_coordinate(v.x(), ptr);
-                boost::spirit::karma::generate(ptr, "\" y=\"");
-                ptr = format_coordinate(v.y(), ptr);
-                boost::spirit::karma::generate(ptr, "\" z=\"");
-                ptr = format_coordinate(v.z(), ptr);
-                boost::spirit::karma::generate(ptr, "\"/>\n");
-                *ptr = '\0';
-                output_buffer += buf;
-                if (! flush())
+            if (! flush())
+                return false;
+            for (size_t begin = 0; begin < its.vertices.size(); begin += MESH_XML_BLOCK_ELEMENTS) {
+                size_t end = std::min(begin + MESH_XML_BLOCK_ELEMENTS, its.vertices.size());
+                if (! writer.add([&its, matrix = volume->get_matrix(), begin, end, format_coordinate](std::string &out) {
+#if ! EXPORT_3MF_USE_SPIRIT_KARMA_FP && ! defined(__cpp_lib_to_chars)
+                        // sprintf() follows the locale of the worker thread.
+                        CNumericLocalesSetter locales_setter;
+#endif
+                        char buf[256];
+                        out.reserve((end - begin) * 64);
+                        for (size_t i = begin; i < end; ++i) {
+                            Vec3f v = (matrix * its.vertices[i].cast<double>()).cast<float>();
+                            char *ptr = buf;
+                            boost::spirit::karma::generate(ptr, boost::spirit::lit("     <") << VERTEX_TAG << " x=\"");
+                            ptr = format_coordinate(v.x(), ptr);
+                            boost::spirit::karma::generate(ptr, "\" y=\"");
+                            ptr = format_coordinate(v.y(), ptr);
+                            boost::spirit::karma::generate(ptr, "\" z=\"");
+                            ptr = format_coordinate(v.z(), ptr);
+                            boost::spirit::karma::generate(ptr, "\"/>\n");
+                            out.append(buf, ptr);
+                        }
+                    })) {
+                    add_error("Error during writing or compression");
                     return false;
+                }
             }
         }
 
@@ -2650,52 +3065,60 @@ namespace Slic3r {
             triangles_count += (int)its.indices.size();
             volume_it->second.last_triangle_id = triangles_count - 1;
 
-            for (int i = 0; i < int(its.indices.size()); ++ i) {
-                {
-                    const Vec3i &idx = its.indices[i];
-                    char *ptr = buf;
-                    boost::spirit::karma::generate(ptr, boost::spirit::lit("     <") << TRIANGLE_TAG <<
-                        " v1=\"" << boost::spirit::int_ <<
-                        "\" v2=\"" << boost::spirit::int_ <<
-                        "\" v3=\"" << boost::spirit::int_ << "\"",
-                        idx[is_left_handed ? 2 : 0] + volume_it->second.first_vertex_id,
-                        idx[1] + volume_it->second.first_vertex_id,
-                        idx[is_left_handed ? 0 : 2] + volume_it->second.first_vertex_id);
-                    *ptr = '\0';
-                    output_buffer += buf;
-                }
-
-                std::string custom_supports_data_string = volume->supported_facets.get_triangle_as_string(i);
-                if (! custom_supports_data_string.empty()) {
-                    output_buffer += " ";
-                    output_buffer += CUSTOM_SUPPORTS_ATTR;
-                    output_buffer += "=\"";
-                    output_buffer += custom_supports_data_string;
-                    output_buffer += "\"";
-                }
+            if (! flush())
+                return false;
+            for (size_t begin = 0; begin < its.indices.size(); begin += MESH_XML_BLOCK_ELEMENTS) {
+                size_t end = std::min(begin + MESH_XML_BLOCK_ELEMENTS, its.indices.size());
+                if (! writer.add([volume, &its, is_left_handed, first_vertex_id = volume_it->second.first_vertex_id, begin, end](std::string &out) {
+                        char buf[256];
+                        out.reserve((end - begin) * 48);
+                        for (int i = int(begin); i < int(end); ++ i) {
+                            {
+                                const Vec3i &idx = its.indices[i];
+                                char *ptr = buf;
+                                boost::spirit::karma::generate(ptr, boost::spirit::lit("     <") << TRIANGLE_TAG <<
+                                    " v1=\"" << boost::spirit::int_ <<
+                                    "\" v2=\"" << boost::spirit::int_ <<
+                                    "\" v3=\"" << boost::spirit::int_ << "\"",
+                                    idx[is_left_handed ? 2 : 0] + first_vertex_id,
+                                    idx[1] + first_vertex_id,
+                                    idx[is_left_handed ? 0 : 2] + first_vertex_id);
+                                out.append(buf, ptr);
+                            }
 
-                std::string custom_seam_data_string = volume->seam_facets.get_triangle_as_string(i);
-                if (! custom_seam_data_string.empty()) {
-                    output_buffer += " ";
-                    output_buffer += CUSTOM_SEAM_ATTR;
-                    output_buffer += "=\"";
-                    output_buffer += custom_seam_data_string;
-                    output_buffer += "\"";
-                }
+                            std::string custom_supports_data_string = volume->supported_facets.get_triangle_as_string(i);
+                            if (! custom_supports_data_string.empty()) {
+                                out += " ";
+                                out += CUSTOM_SUPPORTS_ATTR;
+                                out += "=\"";
+                                out += custom_supports_data_string;
+                                out += "\"";
+                            }
 
-                std::string mmu_painting_data_string = volume->mmu_segmentation_facets.get_triangle_as_string(i);
-                if (! mmu_painting_data_string.empty()) {
-                    output_buffer += " ";
-                    output_buffer += MMU_SEGMENTATION_ATTR;
-                    output_buffer += "=\"";
-                    output_buffer += mmu_painting_data_string;
-                    output_buffer += "\"";
-                }
+                            std::string custom_seam_data_string = volume->seam_facets.get_triangle_as_string(i);
+                            if (! custom_seam_data_string.empty()) {
+                                out += " ";
+                                out += CUSTOM_SEAM_ATTR;
+                                out += "=\"";
+                                out += custom_seam_data_string;
+                                out += "\"";
+                            }
 
-                output_buffer += "/>\n";
+                            std::string mmu_painting_data_string = volume->mmu_segmentation_facets.get_triangle_as_string(i);
+                            if (! mmu_painting_data_string.empty()) {
+                                out += " ";
+                                out += MMU_SEGMENTATION_ATTR;
+                                out += "=\"";
+                                out += mmu_painting_data_string;
+                                out += "\"";
+                            }
 
-                if (! flush())
+                            out += "/>\n";
+                        }
+                    })) {
+                    add_error("Error during writing or compression");
                     return false;
+                }
             }
         }
 
@@ -2705,8 +3128,7 @@ namespace Slic3r {
         output_buffer += MESH_TAG;
         output_buffer += ">\n";
 
-        // Force flush.
-        return flush(true);
+        return flush();
     }
 
     bool _3MF_Exporter::_add_build_to_model_stream(std::stringstream& stream, const BuildItemsList& build_items)
@@ -0,0 +1,153 @@
+#include "../libslic3r.h"
+#include "../TriangleMesh.hpp"
+
+#include "MeshCache.hpp"
+#include "../CacheFile.hpp"
+
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace Slic3r {
+
+namespace {
+
+std::string g_mesh_cache_dir;
+uint64_t    g_mesh_cache_max_size = MESH_CACHE_DEFAULT_MAX_SIZE;
+
+const char     MESH_CACHE_MAGIC[8] = { 'X', 'D', 'M', 'E', 'S', 'H', 'C', '\0' };
+
+// Followed by the vertices and the indices of the mesh.
+struct MeshCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t number_of_facets;
+    uint64_t number_of_vertices;
+    // Size and digest of the source file, the file name of the cache is derived from the digest.
+    uint64_t source_size;
+    unsigned char source_digest[32];
+    float    min[3];
+    float    max[3];
+    float    size[3];
+    float    volume;
+    int32_t  number_of_parts;
+    int32_t  open_edges;
+    int32_t  edges_fixed;
+    int32_t  degenerate_facets;
+    int32_t  facets_removed;
+    int32_t  facets_reversed;
+    int32_t  backwards_edges;
+    int32_t  padding;
+};
+
+} // namespace
+
+void set_mesh_cache_dir(const std::string &dir, uint64_t max_size)
+{
+    g_mesh_cache_dir      = dir;
+    g_mesh_cache_max_size = max_size;
+}
+
+const std::string& mesh_cache_dir()
+{
+    return g_mesh_cache_dir;
+}
+
+bool load_mesh_cache(const char *path, TriangleMesh &mesh, MeshCacheKey &key)
+{
+    key = MeshCacheKey();
+    // The source is hashed just once, the key is reused by store_mesh_cache() on a miss.
+    if (g_mesh_cache_dir.empty() || ! cache_digest_file(path, key.source_digest, key.source_size))
+        return false;
+    key.path = (boost::filesystem::path(g_mesh_cache_dir) / (key.source_digest.hex() + ".mesh")).string();
+    boost::system::error_code ec;
+    if (! boost::filesystem::exists(key.path, ec))
+        return false;
+
+    try {
+        boost::iostreams::mapped_file_source file(key.path);
+        MeshCacheHeader header;
+        if (file.size() < sizeof(header))
+            return false;
+        memcpy(&header, file.data(), sizeof(header));
+        if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 || header.version != MESH_CACHE_VERSION ||
+            header.source_size != key.source_size || memcmp(header.source_digest, key.source_digest.bytes.data(), key.source_digest.bytes.size()) != 0 ||
+            file.size() != sizeof(header) + header.number_of_vertices * sizeof(stl_vertex) + uint64_t(header.number_of_facets) * sizeof(stl_triangle_vertex_indices))
+            return false;
+
+        indexed_triangle_set its;
+        its.vertices.resize(header.number_of_vertices);
+        its.indices.resize(header.number_of_facets);
+        const char *data = file.data() + sizeof(header);
+        memcpy((void*)its.vertices.data(), data, its.vertices.size() * sizeof(stl_vertex));
+        data += its.vertices.size() * sizeof(stl_vertex);
+        memcpy((void*)its.indices.data(), data, its.indices.size() * sizeof(stl_triangle_vertex_indices));
+        for (const stl_triangle_vertex_indices &face : its.indices)
+            for (int i = 0; i < 3; ++ i)
+                if (face(i) < 0 || face(i) >= int(its.vertices.size()))
+                    return false;
+
+        TriangleMeshStats stats;
+        stats.number_of_facets  = header.number_of_facets;
+        stats.min               = stl_vertex(header.min[0], header.min[1], header.min[2]);
+        stats.max               = stl_vertex(header.max[0], header.max[1], header.max[2]);
+        stats.size              = stl_vertex(header.size[0], header.size[1], header.size[2]);
+        stats.volume            = header.volume;
+        stats.number_of_parts   = header.number_of_parts;
+        stats.open_edges        = header.open_edges;
+        stats.repaired_errors.edges_fixed       = header.edges_fixed;
+        stats.repaired_errors.degenerate_facets = header.degenerate_facets;
+        stats.repaired_errors.facets_removed    = header.facets_removed;
+        stats.repaired_errors.facets_reversed   = header.facets_reversed;
+        stats.repaired_errors.backwards_edges   = header.backwards_edges;
+        mesh = TriangleMesh(std::move(its), stats);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(warning) << "Cannot read the mesh cache " << key.path << ": " << ex.what();
+        return false;
+    }
+
+    touch_cache_file(key.path);
+    BOOST_LOG_TRIVIAL(info) << "Loaded the mesh of " << path << " from " << key.path;
+    return true;
+}
+
+void store_mesh_cache(const MeshCacheKey &key, const TriangleMesh &mesh)
+{
+    if (key.path.empty())
+        return;
+
+    const TriangleMeshStats &stats = mesh.stats();
+    MeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version            = MESH_CACHE_VERSION;
+    header.number_of_facets   = uint32_t(mesh.its.indices.size());
+    header.number_of_vertices = mesh.its.vertices.size();
+    header.source_size        = key.source_size;
+    memcpy(header.source_digest, key.source_digest.bytes.data(), key.source_digest.bytes.size());
+    for (int i = 0; i < 3; ++ i) {
+        header.min[i]  = stats.min[i];
+        header.max[i]  = stats.max[i];
+        header.size[i] = stats.size[i];
+    }
+    header.volume             = stats.volume;
+    header.number_of_parts    = stats.number_of_parts;
+    header.open_edges         = stats.open_edges;
+    header.edges_fixed        = stats.repaired_errors.edges_fixed;
+    header.degenerate_facets  = stats.repaired_errors.degenerate_facets;
+    header.facets_removed     = stats.repaired_errors.facets_removed;
+    header.facets_reversed    = stats.repaired_errors.facets_reversed;
+    header.backwards_edges    = stats.repaired_errors.backwards_edges;
+
+    bool written = write_cache_file(key.path, [&header, &mesh](std::ostream &out) {
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(mesh.its.vertices.data()), mesh.its.vertices.size() * sizeof(stl_vertex));
+        out.write(reinterpret_cast<const char*>(mesh.its.indices.data()), mesh.its.indices.size() * sizeof(stl_triangle_vertex_indices));
+    });
+    if (written)
+        evict_cache_files(boost::filesystem::path(key.path).parent_path().string(), ".mesh", g_mesh_cache_max_size);
+}
+
+}; // namespace Slic3r
@@ -0,0 +1,43 @@
+#ifndef slic3r_Format_MeshCache_hpp_
+#define slic3r_Format_MeshCache_hpp_
+
+#include <cstdint>
+#include <string>
+
+#include "../CacheFile.hpp"
+
+namespace Slic3r {
+
+class TriangleMesh;
+
+// Version of the cache files, stored after their 8 byte magic. Files of another version are not loaded.
+// To be increased whenever the layout of the cache file or the repair applied to the loaded meshes changes.
+constexpr uint32_t MESH_CACHE_VERSION = 2;
+
+// Default bound of the total size of the cache files, the least recently used ones are removed above it.
+constexpr uint64_t MESH_CACHE_DEFAULT_MAX_SIZE = uint64_t(2) << 30;
+
+// Cache of the repaired meshes loaded from the STL and OBJ files, stored in a directory as one binary file
+// per source file content, named by the SHA-256 digest of the content. The cache is disabled while the directory is empty, which is the default.
+void set_mesh_cache_dir(const std::string &dir, uint64_t max_size = MESH_CACHE_DEFAULT_MAX_SIZE);
+const std::string& mesh_cache_dir();
+
+// Cache file of a source file, filled in by load_mesh_cache() and passed to store_mesh_cache() on a miss,
+// so that the source file is hashed just once.
+struct MeshCacheKey
+{
+    // Empty if the cache is disabled or the source file cannot be read.
+    std::string path;
+    uint64_t    source_size { 0 };
+    CacheDigest source_digest;
+};
+
+// Loads the mesh and its statistics cached for a file of the same content as the file at path.
+// Returns false if the cache is disabled, there is no such mesh cached or the cached file is invalid.
+extern bool load_mesh_cache(const char *path, TriangleMesh &mesh, MeshCacheKey &key);
+// Stores the mesh loaded from the source file of key, if the cache is enabled, then bounds the size of the cache.
+extern void store_mesh_cache(const MeshCacheKey &key, const TriangleMesh &mesh);
+
+}; // namespace Slic3r
+
+#endif /* slic3r_Format_MeshCache_hpp_ */
@@ -2,13 +2,22 @@
 #include "../Model.hpp"
 #include "../TriangleMesh.hpp"
 
+#include "MeshCache.hpp"
 #include "OBJ.hpp"
-#include "objparser.hpp"
 
+#include <limits>
 #include <string>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+#include <fast_float/fast_float.h>
+
 #ifdef _WIN32
 #define DIR_SEPARATOR '\\'
 #else
@@ -17,76 +26,252 @@
 
 namespace Slic3r {
 
-bool load_obj(const char *path, TriangleMesh *meshptr)
-{
-    if (meshptr == nullptr)
-        return false;
-    
-    // Parse the OBJ file.
-    ObjParser::ObjData data;
-    if (! ObjParser::objparse(path, data)) {
-        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path;
-        return false;
+namespace {
+
+// Size of a block of an OBJ file parsed by a single task.
+constexpr size_t OBJ_CHUNK_SIZE = 4 * 1024 * 1024;
+
+// Vertices and triangulated faces of a block of an OBJ file, referencing the vertices by their global indices.
+struct ObjChunk {
+    enum class Error {
+        None,
+        TooManyVertices,
+        TooFewVertices,
+    };
+
+    std::vector<Vec3f>                        vertices;
+    std::vector<stl_triangle_vertex_indices>  indices;
+    // Flat positions into indices of the relative (negative) references, stored relative to the start of this chunk.
+    std::vector<size_t>                       relative;
+    Error                                     error { Error::None };
+};
+
+// Parses the "v" and "f" lines of an OBJ file, ignoring all the other commands.
+// Similar to ObjParser::obj_parseline(), though it does not copy the lines and it parses the numbers with fast_float.
+struct ObjMeshParser {
+    const char *p;
+    const char *end;
+
+    static bool is_space(char c) { return c == ' ' || c == '\t'; }
+    static bool is_eol(char c) { return c == '\r' || c == '\n'; }
+
+    void skip_spaces() { while (p != end && is_space(*p)) ++ p; }
+    void skip_line() {
+        while (p != end && ! is_eol(*p)) ++ p;
+        while (p != end && is_eol(*p)) ++ p;
     }
-    
-    // Count the faces and verify, that all faces are triangular.
-    size_t num_faces = 0;
-    size_t num_quads = 0;
-    for (size_t i = 0; i < data.vertices.size(); ++ i) {
-        // Find the end of face.
-        size_t j = i;
-        for (; j < data.vertices.size() && data.vertices[j].coordIdx != -1; ++ j) ;
-        if (size_t num_face_vertices = j - i; num_face_vertices > 0) {
-            if (num_face_vertices > 4) {
-                // Non-triangular and non-quad faces are not supported as of now.
-                BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains polygons with more than 4 vertices.";
+    bool at_token_end() const { return p == end || is_space(*p) || is_eol(*p); }
+
+    bool number(float &out) {
+        // fast_float does not accept the plus sign, strtod() did.
+        if (p != end && *p == '+')
+            ++ p;
+        auto [ptr, ec] = fast_float::from_chars(p, end, out);
+        if (ec != std::errc())
+            return false;
+        p = ptr;
+        return true;
+    }
+    bool integer(int &out) {
+        bool negative = false;
+        if (p != end && (*p == '+' || *p == '-'))
+            negative = *p ++ == '-';
+        if (p == end || *p < '0' || *p > '9')
+            return false;
+        int64_t v = 0;
+        for (; p != end && *p >= '0' && *p <= '9'; ++ p)
+            if ((v = v * 10 + (*p - '0')) > std::numeric_limits<int>::max())
                 return false;
-            } else if (num_face_vertices < 3) {
-                // Non-triangular and non-quad faces are not supported as of now.
-                BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains polygons with less than 2 vertices.";
+        out = int(negative ? - v : v);
+        return true;
+    }
+
+    // v x y z [w], anything following the z coordinate is ignored (Meshlab stores the vertex colors there).
+    void vertex(ObjChunk &chunk) {
+        Vec3f v;
+        for (int i = 0; i < 3; ++ i) {
+            this->skip_spaces();
+            if (! this->number(v(i)) || (i < 2 && ! this->at_token_end()))
+                return;
+        }
+        chunk.vertices.emplace_back(v);
+    }
+
+    // f v1[/vt1[/vn1]] v2... with 3 or 4 vertices, a quad is split into two triangles.
+    // Returns false on an invalid polygon, a malformed line is ignored the same way obj_parseline() ignores it.
+    bool face(ObjChunk &chunk) {
+        int  idx[5];
+        bool rel[5];
+        int  cnt = 0;
+        for (this->skip_spaces(); p != end && ! is_eol(*p); this->skip_spaces()) {
+            int i, unused;
+            if (! this->integer(i))
+                return true;
+            if (p != end && *p == '/') {
+                // Texture coordinate index may be missing after a 1st slash, but then the normal index has to be present.
+                if (++ p != end && *p != '/' && ! this->integer(unused))
+                    return true;
+                if (p != end && *p == '/' && (++ p, ! this->integer(unused)))
+                    return true;
+            }
+            if (! this->at_token_end())
+                return true;
+            if (cnt == 4) {
+                chunk.error = ObjChunk::Error::TooManyVertices;
                 return false;
             }
-            if (num_face_vertices == 4)
-                ++ num_quads;
-            ++ num_faces;
-            i = j;
+            // Relative indices are resolved against the vertices of this chunk parsed so far,
+            // vertices of the preceding chunks are accounted for when merging.
+            rel[cnt] = i < 0;
+            idx[cnt ++] = i < 0 ? int(chunk.vertices.size()) + i : i - 1;
         }
+        if (cnt == 0)
+            return true;
+        if (cnt < 3) {
+            chunk.error = ObjChunk::Error::TooFewVertices;
+            return false;
+        }
+        auto emplace = [&chunk, &idx, &rel](int a, int b, int c) {
+            size_t pos = chunk.indices.size() * 3;
+            chunk.indices.emplace_back(idx[a], idx[b], idx[c]);
+            for (int i : { a, b, c })
+                if (rel[i])
+                    chunk.relative.emplace_back(pos ++);
+                else
+                    ++ pos;
+        };
+        // Insert one or two faces (triangulate a quad).
+        emplace(0, 1, 2);
+        if (cnt == 4)
+            emplace(0, 2, 3);
+        return true;
     }
-    
-    // Convert ObjData into indexed triangle set.
-    indexed_triangle_set its;
-    size_t num_vertices = data.coordinates.size() / 4;
-    its.vertices.reserve(num_vertices);
-    its.indices.reserve(num_faces + num_quads);
-    for (size_t i = 0; i < num_vertices; ++ i) {
-        size_t j = i << 2;
-        its.vertices.emplace_back(data.coordinates[j], data.coordinates[j + 1], data.coordinates[j + 2]);
-    }
-    int indices[4];
-    for (size_t i = 0; i < data.vertices.size();)
-        if (data.vertices[i].coordIdx == -1)
-            ++ i;
-        else {
-            int cnt = 0;
-            while (i < data.vertices.size())
-                if (const ObjParser::ObjVertex &vertex = data.vertices[i ++]; vertex.coordIdx == -1) {
-                    break;
-                } else {
-                    assert(cnt < 4);
-                    if (vertex.coordIdx < 0 || vertex.coordIdx >= int(its.vertices.size())) {
-                        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains invalid vertex index.";
-                        return false;
-                    }
-                    indices[cnt ++] = vertex.coordIdx;
+
+    void parse(ObjChunk &chunk) {
+        while (p != end) {
+            // Ignore whitespaces at the beginning of the line.
+            this->skip_spaces();
+            if (p + 1 < end && is_space(p[1])) {
+                if (*p == 'v') {
+                    ++ p;
+                    this->vertex(chunk);
+                } else if (*p == 'f') {
+                    ++ p;
+                    if (! this->face(chunk))
+                        return;
                 }
-            if (cnt) {
-                assert(cnt == 3 || cnt == 4);
-                // Insert one or two faces (triangulate a quad).
-                its.indices.emplace_back(indices[0], indices[1], indices[2]);
-                if (cnt == 4)
-                    its.indices.emplace_back(indices[0], indices[2], indices[3]);
             }
+            this->skip_line();
         }
+    }
+};
+
+} // namespace
+
+// The file is memory mapped, split into blocks at line boundaries and the blocks are parsed in parallel.
+bool load_obj(const char *path, indexed_triangle_set &its, size_t block_size)
+{
+    if (block_size == 0)
+        block_size = OBJ_CHUNK_SIZE;
+
+    boost::system::error_code ec;
+    boost::uintmax_t size = boost::filesystem::file_size(boost::filesystem::path(path), ec);
+    if (ec) {
+        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path;
+        return false;
+    }
+    if (size == 0)
+        return true;
+
+    boost::iostreams::mapped_file_source file;
+    try {
+        file.open(path);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ": " << ex.what();
+        return false;
+    }
+    const char *data = file.data();
+    size = file.size();
+
+    // Split the file into blocks ending with a line end.
+    std::vector<const char*> blocks { data };
+    for (const char *p = data + block_size; p < data + size; p = blocks.back() + block_size) {
+        while (p != data + size && *p != '\n' && *p != '\r')
+            ++ p;
+        if (p == data + size)
+            break;
+        blocks.emplace_back(p);
+    }
+    blocks.emplace_back(data + size);
+
+    std::vector<ObjChunk> chunks(blocks.size() - 1);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size(), 1), [&blocks, &chunks](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            // A vertex line takes about 30 bytes, a face line referencing large indices about twice as much.
+            size_t len = blocks[i + 1] - blocks[i];
+            chunks[i].vertices.reserve(len / 64);
+            chunks[i].indices.reserve(len / 64);
+            ObjMeshParser{ blocks[i], blocks[i + 1] }.parse(chunks[i]);
+        }
+    });
+
+    // Report the first invalid polygon in the file.
+    for (const ObjChunk &chunk : chunks)
+        if (chunk.error == ObjChunk::Error::TooManyVertices) {
+            // Non-triangular and non-quad faces are not supported as of now.
+            BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains polygons with more than 4 vertices.";
+            return false;
+        } else if (chunk.error == ObjChunk::Error::TooFewVertices) {
+            // Non-triangular and non-quad faces are not supported as of now.
+            BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains polygons with less than 2 vertices.";
+            return false;
+        }
+
+    // Merge the blocks into the indexed triangle set.
+    std::vector<size_t> vertices_offset(chunks.size() + 1, 0);
+    std::vector<size_t> indices_offset(chunks.size() + 1, 0);
+    for (size_t i = 0; i < chunks.size(); ++ i) {
+        vertices_offset[i + 1] = vertices_offset[i] + chunks[i].vertices.size();
+        indices_offset[i + 1]  = indices_offset[i] + chunks[i].indices.size();
+    }
+    if (vertices_offset.back() > size_t(std::numeric_limits<int>::max())) {
+        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains too many vertices.";
+        return false;
+    }
+    its.vertices.resize(vertices_offset.back());
+    its.indices.resize(indices_offset.back());
+    const int num_vertices = int(its.vertices.size());
+    bool valid = tbb::parallel_reduce(tbb::blocked_range<size_t>(0, chunks.size(), 1), true,
+        [&chunks, &vertices_offset, &indices_offset, &its, num_vertices](const tbb::blocked_range<size_t> &range, bool valid) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                ObjChunk &chunk = chunks[i];
+                std::copy(chunk.vertices.begin(), chunk.vertices.end(), its.vertices.begin() + vertices_offset[i]);
+                for (size_t pos : chunk.relative)
+                    chunk.indices[pos / 3](pos % 3) += int(vertices_offset[i]);
+                for (const stl_triangle_vertex_indices &face : chunk.indices)
+                    if ((face.array() < 0).any() || (face.array() >= num_vertices).any())
+                        valid = false;
+                std::copy(chunk.indices.begin(), chunk.indices.end(), its.indices.begin() + indices_offset[i]);
+                chunk = ObjChunk();
+            }
+            return valid;
+        },
+        [](bool a, bool b) { return a && b; });
+    if (! valid) {
+        BOOST_LOG_TRIVIAL(error) << "load_obj: failed to parse " << path << ". The file contains invalid vertex index.";
+        return false;
+    }
+    return true;
+}
+
+bool load_obj(const char *path, TriangleMesh *meshptr)
+{
+    if (meshptr == nullptr)
+        return false;
+    
+    indexed_triangle_set its;
+    if (! load_obj(path, its))
+        return false;
 
     *meshptr = TriangleMesh(std::move(its));
     if (meshptr->empty()) {
@@ -101,8 +286,13 @@ bool load_obj(const char *path, TriangleMesh *meshptr)
 bool load_obj(const char *path, Model *model, const char *object_name_in)
 {
     TriangleMesh mesh;
-    
-    bool ret = load_obj(path, &mesh);
+    MeshCacheKey cache_key;
+    bool ret = load_mesh_cache(path, mesh, cache_key);
+    if (! ret) {
+        ret = load_obj(path, &mesh);
+        if (ret)
+            store_mesh_cache(cache_key, mesh);
+    }
     
     if (ret) {
         std::string  object_name;
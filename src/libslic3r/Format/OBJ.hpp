@@ -1,6 +1,10 @@
 #ifndef slic3r_Format_OBJ_hpp_
 #define slic3r_Format_OBJ_hpp_
 
+#include <cstddef>
+
+struct indexed_triangle_set;
+
 namespace Slic3r {
 
 class TriangleMesh;
@@ -10,6 +14,9 @@ class ModelObject;
 // Load an OBJ file into a provided model.
 extern bool load_obj(const char *path, TriangleMesh *mesh);
 extern bool load_obj(const char *path, Model *model, const char *object_name = nullptr);
+// Load the vertices and faces of an OBJ file without any repair, quads are split into triangles.
+// The file is parsed in parallel blocks of block_size bytes, zero for the default block size.
+extern bool load_obj(const char *path, indexed_triangle_set &its, size_t block_size = 0);
 
 extern bool store_obj(const char *path, TriangleMesh *mesh);
 extern bool store_obj(const char *path, ModelObject *model);
@@ -2,13 +2,20 @@
 #include "occt_wrapper/OCCTWrapper.hpp"
 
 #include "libslic3r/Model.hpp"
+#include "libslic3r/Thread.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Utils.hpp"
 
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <boost/dll/runtime_symbol_info.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <string>
 #include <functional>
 
@@ -23,7 +30,7 @@
 namespace Slic3r {
 
 #if __APPLE__
-extern "C" bool load_step_internal(const char *path, OCCTResult* res);
+extern "C" bool load_step_internal(const char *path, OCCTResult* res, const OCCTParams *params);
 #endif
 
 LoadStepFn get_load_step_fn()
@@ -76,16 +83,215 @@ LoadStepFn get_load_step_fn()
     return load_step_fn;
 }
 
-bool load_step(const char *path, Model *model /*BBS:, ImportStepProgressFn proFn*/)
+namespace {
+
+// Cached tessellation of a STEP file, see load_step_cache() and store_step_cache().
+const char     STEP_CACHE_MAGIC[8]  = { 'X', 'D', 'S', 'T', 'E', 'P', 'C', '\0' };
+
+template<typename T> void write_pod(std::ostream &out, const T &value) { out.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+template<typename T> bool read_pod(std::istream &in, T &value) { return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T))); }
+
+void write_string(std::ostream &out, const std::string &str)
 {
-    OCCTResult occt_object;
+    write_pod(out, uint32_t(str.size()));
+    out.write(str.data(), str.size());
+}
+
+bool read_string(std::istream &in, std::string &str)
+{
+    uint32_t size;
+    if (! read_pod(in, size))
+        return false;
+    str.resize(size);
+    return bool(in.read(str.data(), size));
+}
+
+template<typename T> void write_vector(std::ostream &out, const std::vector<T> &data)
+{
+    write_pod(out, uint64_t(data.size()));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+}
+
+template<typename T> bool read_vector(std::istream &in, std::vector<T> &data)
+{
+    uint64_t size;
+    if (! read_pod(in, size))
+        return false;
+    data.resize(size);
+    return bool(in.read(reinterpret_cast<char*>(data.data()), size * sizeof(T)));
+}
 
-    LoadStepFn load_step_fn = get_load_step_fn();
+// Tessellates the file on a background thread, reporting the progress of the tessellation threads
+// on the calling thread, where the cancellation is requested as well.
+bool load_step_with_progress(LoadStepFn load_step_fn, const char *path, OCCTResult &occt_result, const LoadStepParams &params)
+{
+    struct State {
+        std::mutex              mutex;
+        std::condition_variable cv;
+        bool                    done { false };
+        std::atomic<int>        load_stage { LOAD_STEP_STAGE_READ_FILE };
+        std::atomic<int>        current { 0 };
+        std::atomic<int>        total { 1 };
+        std::atomic<bool>       cancel { false };
+    } state;
 
-    if (!load_step_fn)
+    OCCTParams occt_params;
+    occt_params.linear_deflection = params.linear_deflection;
+    occt_params.angle_deflection  = params.angle_deflection;
+    occt_params.progress_data     = &state;
+    occt_params.progress_fn       = [](void *data, int load_stage, int current, int total) {
+        State &state = *static_cast<State*>(data);
+        state.load_stage = load_stage;
+        state.current    = current;
+        state.total      = total;
+        return state.cancel.load();
+    };
+
+    bool result = false;
+    boost::thread thread = create_thread([&]() {
+        result = load_step_fn(path, &occt_result, &occt_params);
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.done = true;
+        state.cv.notify_all();
+    });
+    try {
+        for (;;) {
+            bool cancel = false;
+            params.progress_fn(state.load_stage, state.current, state.total, cancel);
+            if (cancel)
+                state.cancel = true;
+            std::unique_lock<std::mutex> lock(state.mutex);
+            if (state.cv.wait_for(lock, std::chrono::milliseconds(100), [&state]() { return state.done; }))
+                break;
+        }
+    } catch (...) {
+        state.cancel = true;
+        thread.join();
+        throw;
+    }
+    thread.join();
+    return result;
+}
+
+} // namespace
+
+bool load_step_cache(const char *path, const LoadStepParams &params, OCCTResult &occt_result, StepCacheKey &key)
+{
+    key = StepCacheKey();
+    if (data_dir().empty() || ! cache_digest_file(path, key.source_digest, key.source_size))
+        return false;
+    key.linear_deflection = params.linear_deflection;
+    key.angle_deflection  = params.angle_deflection;
+    // The file name is derived from the digest of the source and from the tessellation tolerances.
+    std::string name = std::string(key.source_digest.bytes.begin(), key.source_digest.bytes.end());
+    name.append(reinterpret_cast<const char*>(&key.linear_deflection), sizeof(double));
+    name.append(reinterpret_cast<const char*>(&key.angle_deflection), sizeof(double));
+    key.path = (boost::filesystem::path(data_dir()) / "cache" / "step" / (cache_digest(name).hex() + ".step")).string();
+    boost::system::error_code ec;
+    if (! boost::filesystem::exists(key.path, ec))
         return false;
 
-    load_step_fn(path, &occt_object);
+    boost::filesystem::ifstream in(key.path, std::ios::binary);
+    char        magic[sizeof(STEP_CACHE_MAGIC)];
+    uint32_t    version;
+    uint64_t    source_size;
+    CacheDigest source_digest;
+    double      linear_deflection, angle_deflection;
+    uint32_t    num_volumes;
+    if (! in.read(magic, sizeof(magic)) || memcmp(magic, STEP_CACHE_MAGIC, sizeof(magic)) != 0 ||
+        ! read_pod(in, version) || version != STEP_CACHE_VERSION ||
+        ! read_pod(in, source_size) || source_size != key.source_size ||
+        ! read_pod(in, source_digest.bytes) || source_digest != key.source_digest ||
+        ! read_pod(in, linear_deflection) || linear_deflection != key.linear_deflection ||
+        ! read_pod(in, angle_deflection) || angle_deflection != key.angle_deflection ||
+        ! read_pod(in, num_volumes))
+        return false;
+    occt_result.volumes.assign(num_volumes, OCCTVolume());
+    for (OCCTVolume &volume : occt_result.volumes)
+        if (! read_string(in, volume.volume_name) || ! read_vector(in, volume.vertices) || ! read_vector(in, volume.indices))
+            return false;
+    for (const OCCTVolume &volume : occt_result.volumes)
+        for (const std::array<int, 3> &triangle : volume.indices)
+            for (int idx : triangle)
+                if (idx < 0 || idx >= int(volume.vertices.size()))
+                    return false;
+    if (occt_result.volumes.empty())
+        return false;
+    in.close();
+    touch_cache_file(key.path);
+    return true;
+}
+
+void store_step_cache(const StepCacheKey &key, const OCCTResult &occt_result, uint64_t max_cache_size)
+{
+    if (key.path.empty())
+        return;
+    bool written = write_cache_file(key.path, [&key, &occt_result](std::ostream &out) {
+        out.write(STEP_CACHE_MAGIC, sizeof(STEP_CACHE_MAGIC));
+        write_pod(out, STEP_CACHE_VERSION);
+        write_pod(out, key.source_size);
+        write_pod(out, key.source_digest.bytes);
+        write_pod(out, key.linear_deflection);
+        write_pod(out, key.angle_deflection);
+        write_pod(out, uint32_t(occt_result.volumes.size()));
+        for (const OCCTVolume &volume : occt_result.volumes) {
+            write_string(out, volume.volume_name);
+            write_vector(out, volume.vertices);
+            write_vector(out, volume.indices);
+        }
+    });
+    if (written)
+        evict_cache_files(boost::filesystem::path(key.path).parent_path().string(), ".step", max_cache_size);
+}
+
+bool load_step(const char *path, Model *model, const LoadStepParams &params, bool *is_cancel)
+{
+    if (is_cancel)
+        *is_cancel = false;
+
+    if (! (params.linear_deflection > 0. && params.angle_deflection > 0.)) {
+        BOOST_LOG_TRIVIAL(error) << "Loading of " << path << " failed: invalid tessellation tolerances " << params.linear_deflection << ", " << params.angle_deflection;
+        return false;
+    }
+
+    OCCTResult occt_object;
+
+    StepCacheKey cache_key;
+    if (params.use_cache && load_step_cache(path, params, occt_object, cache_key)) {
+        BOOST_LOG_TRIVIAL(info) << "Loaded the tessellation of " << path << " from " << cache_key.path;
+        // The same content may be cached under another file name.
+        occt_object.object_name = boost::filesystem::path(path).filename().string();
+    } else {
+        occt_object = OCCTResult();
+
+        LoadStepFn load_step_fn = get_load_step_fn();
+
+        if (!load_step_fn)
+            return false;
+
+        bool result;
+        if (params.progress_fn) {
+            result = load_step_with_progress(load_step_fn, path, occt_object, params);
+        } else {
+            OCCTParams occt_params;
+            occt_params.linear_deflection = params.linear_deflection;
+            occt_params.angle_deflection  = params.angle_deflection;
+            result = load_step_fn(path, &occt_object, &occt_params);
+        }
+
+        if (occt_object.canceled) {
+            if (is_cancel)
+                *is_cancel = true;
+            return false;
+        }
+        if (! result) {
+            if (! occt_object.error_str.empty())
+                BOOST_LOG_TRIVIAL(error) << "Loading of " << path << " failed: " << occt_object.error_str;
+            return false;
+        }
+
+        store_step_cache(cache_key, occt_object, params.max_cache_size);
+    }
 
     assert(! occt_object.volumes.empty());
     
@@ -113,7 +319,7 @@ bool load_step(const char *path, Model *model /*BBS:, ImportStepProgressFn proFn
             its.indices.emplace_back(Vec3i(occt_object.volumes[i].indices[j][0],
                                            occt_object.volumes[i].indices[j][1],
                                            occt_object.volumes[i].indices[j][2]));
-        its_merge_vertices(its, true);
+        its_merge_vertices_par(its);
         TriangleMesh triangle_mesh(std::move(its));
         ModelVolume* new_volume = new_object->add_volume(std::move(triangle_mesh));
 
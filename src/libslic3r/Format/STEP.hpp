@@ -5,14 +5,54 @@
 #ifndef slic3r_Format_STEP_hpp_
 #define slic3r_Format_STEP_hpp_
 
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "occt_wrapper/OCCTWrapper.hpp"
+#include "../CacheFile.hpp"
+
 namespace Slic3r {
 
 class Model;
 
-//typedef std::function<void(int load_stage, int current, int total, bool& cancel)> ImportStepProgressFn;
+// Called on the thread calling load_step(), load_stage is one of OCCTLoadStage.
+// Setting cancel stops the import.
+typedef std::function<void(int load_stage, int current, int total, bool& cancel)> ImportStepProgressFn;
+
+struct LoadStepParams {
+    // Tessellation tolerances, the chordal deviation in millimeters and the angular deviation in radians.
+    double               linear_deflection { 0.005 };
+    double               angle_deflection  { 1. };
+    // Reuse the meshes tessellated from a file of the same content with the same tolerances,
+    // which are stored in the "cache/step" folder of the data directory.
+    bool                 use_cache         { true };
+    // Bound of the total size of the "cache/step" folder, the least recently used files are evicted first.
+    uint64_t             max_cache_size    { uint64_t(1) << 30 };
+    ImportStepProgressFn progress_fn;
+};
+
+// Version of the STEP tessellation cache format, cache files of other versions are ignored.
+constexpr uint32_t STEP_CACHE_VERSION = 2;
+
+// Cache file of a STEP file tessellated with the given tolerances and the source it is verified against.
+struct StepCacheKey {
+    std::string path;
+    uint64_t    source_size { 0 };
+    CacheDigest source_digest;
+    double      linear_deflection { 0 };
+    double      angle_deflection  { 0 };
+};
+
+// Loads the cached tessellation of the file at path. Fills in the key even on a cache miss,
+// so that the tessellation is stored by store_step_cache() without hashing the file again.
+// The key path is empty if the cache is not available, for example without a data directory.
+extern bool load_step_cache(const char *path, const LoadStepParams &params, OCCTResult &occt_result, StepCacheKey &key);
+extern void store_step_cache(const StepCacheKey &key, const OCCTResult &occt_result, uint64_t max_cache_size);
 
 // Load a step file into a provided model.
-extern bool load_step(const char *path_str, Model *model /*LMBBS:, ImportStepProgressFn proFn = nullptr*/);
+// If the import was canceled through params.progress_fn, is_cancel is set and false is returned.
+extern bool load_step(const char *path, Model *model, const LoadStepParams &params = LoadStepParams(), bool *is_cancel = nullptr);
 
 }; // namespace Slic3r
 
@@ -2,6 +2,7 @@
 #include "../Model.hpp"
 #include "../TriangleMesh.hpp"
 
+#include "MeshCache.hpp"
 #include "STL.hpp"
 
 #include <string>
@@ -17,13 +18,17 @@ namespace Slic3r {
 bool load_stl(const char *path, Model *model, const char *object_name_in)
 {
     TriangleMesh mesh;
-    if (! mesh.ReadSTLFile(path)) {
-//    die "Failed to open $file\n" if !-e $path;
-        return false;
-    }
-    if (mesh.empty()) {
-        // die "This STL file couldn't be read because it's empty.\n"
-        return false;
+    MeshCacheKey cache_key;
+    if (! load_mesh_cache(path, mesh, cache_key)) {
+        if (! mesh.ReadSTLFile(path)) {
+//        die "Failed to open $file\n" if !-e $path;
+            return false;
+        }
+        if (mesh.empty()) {
+            // die "This STL file couldn't be read because it's empty.\n"
+            return false;
+        }
+        store_mesh_cache(cache_key, mesh);
     }
 
     std::string object_name;
@@ -5,16 +5,11 @@ namespace Slic3r {
 namespace {
 std::string to_json(const ConfMap &m)
 {
-    ptree pt; // construct root obj.
-    stringstream ss;
-    // replace string numbers with numbers. better than translator solution imho.
-    std::regex reg("\\\"(-?[0-9]+\\.{0,1}[0-9]*)\\\"");
+    JsonWriter json;
+    // numeric values are written as numbers, the printers expect them so.
+    for (auto &param : m) json.add_number_or_string(param.first, param.second);
 
-    for (auto &param : m) pt.put(param.first, param.second);
-
-    json_parser::write_json(ss, pt);
-
-    return std::regex_replace(ss.str(), reg, "$1");
+    return std::move(json).str();
 }
 
 std::string get_cfg_value(const DynamicPrintConfig &cfg, const std::string &key, const std::string &default_val = "", const bool only_first_occurence = false, const char delimeter = ',')
@@ -34,37 +29,218 @@ std::string get_cfg_value(const DynamicPrintConfig &cfg, const std::string &key,
     return ret;
 }
 
-std::string generate_md5_checksum(const string file_path)
+// Incremental MD5, fed chunk by chunk while the G-code is being archived.
+class MD5Checksum {
+public:
+    MD5Checksum() { MD5_Init(&m_ctx); }
+
+    void update(const char *data, size_t len) { MD5_Update(&m_ctx, data, len); }
+
+    std::string hexdigest()
+    {
+        unsigned char result[MD5_DIGEST_LENGTH];
+        MD5_Final(result, &m_ctx);
+
+        stringstream md5string;
+        md5string << hex << setfill('0');
+        for (const auto &byte: result)
+            md5string << setw(2) << (int)byte;
+
+        return md5string.str();
+    }
+
+private:
+    MD5_CTX m_ctx;
+};
+
+// A model part mesh together with all its placements on the bed.
+struct ModelPart
 {
-    MD5_CTX md5Context;
-    MD5_Init(&md5Context);
-    char buffer[4096];
-    ifstream file(file_path.c_str(), ifstream::binary);
-
-    while (file.good()) {
-        file.read(buffer, sizeof(buffer));
-        MD5_Update(&md5Context, buffer, file.gcount());
+    const indexed_triangle_set *its;
+    std::vector<Transform3d>    trafos;
+};
+
+// Collect the model parts of all printed instances, centered to the bed center
+// as the printer shows the model, not the plate.
+std::vector<ModelPart> collect_model_parts(const Print &print)
+{
+    const Vec2d bed_center = BuildVolume(print.config().bed_shape.values, print.config().max_print_height).bed_center();
+    const Transform3d to_bed_center(Geometry::assemble_transform(Vec3d(-bed_center.x(), -bed_center.y(), 0.)));
+
+    std::vector<ModelPart> parts;
+    for (const PrintObject *object : print.objects())
+        for (const ModelVolume *volume : object->model_object()->volumes)
+            if (volume->is_model_part() && ! volume->mesh().empty()) {
+                ModelPart part { &volume->mesh().its, {} };
+                for (const PrintInstance &instance : object->instances())
+                    part.trafos.emplace_back(to_bed_center * instance.model_instance->get_matrix() * volume->get_matrix());
+                parts.emplace_back(std::move(part));
+            }
+    return parts;
+}
+
+// Adapts a producer appending the entry in pieces to Zipper's read callback.
+class ChunkedReader {
+public:
+    // Appends the next piece of data to the buffer, returns false at the end of data.
+    using Producer = std::function<bool(std::string&)>;
+
+    explicit ChunkedReader(Producer producer) : m_producer(std::move(producer)) {}
+
+    size_t operator()(char *buf, size_t n)
+    {
+        while (m_pos == m_buffer.size()) {
+            m_buffer.clear();
+            m_pos = 0;
+            if (! m_producer(m_buffer))
+                return 0;
+        }
+        n = std::min(n, m_buffer.size() - m_pos);
+        memcpy(buf, m_buffer.data() + m_pos, n);
+        m_pos += n;
+        return n;
     }
 
-    unsigned char result[MD5_DIGEST_LENGTH];
-    MD5_Final(result, &md5Context);
+private:
+    Producer    m_producer;
+    std::string m_buffer;
+    size_t      m_pos { 0 };
+};
+
+// Streams a binary STL of all the model parts into the archive, a batch of facets at a time.
+void write_model_stl(Zipper &zipper, const std::vector<ModelPart> &parts)
+{
+    static constexpr size_t header_size = 84;
+    static constexpr size_t facet_size  = 50;
+    static constexpr size_t batch_size  = 4096;
 
-    stringstream md5string;
-    md5string << hex << uppercase << setfill('0');
-    for (const auto &byte: result)
-        md5string << setw(2) << (int)byte;
+    size_t num_facets = 0;
+    for (const ModelPart &part : parts)
+        num_facets += part.its->indices.size() * part.trafos.size();
 
-    return to_lower_copy(md5string.str());
+    bool   header_written = false;
+    size_t ipart = 0, itrafo = 0, iface = 0;
+    ChunkedReader reader([&](std::string &out) {
+        if (! header_written) {
+            char header[header_size] = { 0 };
+            strncpy(header, "Zaxe binary STL", 80);
+            auto cnt = uint32_t(num_facets);
+            memcpy(header + 80, &cnt, 4);
+            out.append(header, header_size);
+            header_written = true;
+            return true;
+        }
+        while (ipart < parts.size() && out.size() < batch_size * facet_size) {
+            const ModelPart &part = parts[ipart];
+            if (itrafo == part.trafos.size()) {
+                ++ ipart;
+                itrafo = 0;
+                continue;
+            }
+            const indexed_triangle_set &its    = *part.its;
+            const Transform3f           trafo  = part.trafos[itrafo].cast<float>();
+            // Mirroring flips the orientation of the facets.
+            const bool                  mirror = trafo.linear().determinant() < 0;
+            const size_t                end    = std::min(its.indices.size(), iface + batch_size);
+            for (; iface < end; ++ iface) {
+                const stl_triangle_vertex_indices &f = its.indices[iface];
+                const Vec3f v[3] = { trafo * its.vertices[f(0)], trafo * its.vertices[f(mirror ? 2 : 1)], trafo * its.vertices[f(mirror ? 1 : 2)] };
+                const Vec3f n    = (v[1] - v[0]).cross(v[2] - v[0]).normalized();
+                char facet[facet_size] = { 0 };
+                memcpy(facet, n.data(), 12);
+                for (int i = 0; i < 3; ++ i)
+                    memcpy(facet + 12 * (i + 1), v[i].data(), 12);
+                out.append(facet, facet_size);
+            }
+            if (iface == its.indices.size()) {
+                ++ itrafo;
+                iface = 0;
+            }
+        }
+        return ! out.empty();
+    });
+    zipper.add_entry("model.stl", header_size + facet_size * num_facets, std::ref(reader));
 }
 
-ifstream::pos_type read_binary_into_buffer(const char* path, vector<char>& bytes)
+// Streams the model parts as a 3MF core model, each mesh stored once with a build item per instance.
+void write_model_indexed(Zipper &zipper, const std::vector<ModelPart> &parts)
 {
-    ifstream ifs(path, ios::in | ios::binary | ios::ate);
-    ifstream::pos_type fileSize = ifs.tellg(); // get the file size.
-    ifs.seekg(0, ios::beg); // seek to beginning.
-    bytes.resize(fileSize); // resize.
-    ifs.read(bytes.data(), fileSize); // read.
-    return fileSize;
+    assert(is_decimal_separator_point());
+    static constexpr size_t batch_size = 4096;
+    // Upper bounds of the XML lengths, 16 characters per float and 11 per index at most.
+    static constexpr size_t vertex_len   = 30 + 3 * 16;
+    static constexpr size_t triangle_len = 33 + 3 * 11;
+    static constexpr size_t item_len     = 64 + 12 * 16;
+    static constexpr size_t header_len   = 512;
+
+    size_t max_bytes = header_len;
+    for (const ModelPart &part : parts)
+        max_bytes += header_len + part.its->vertices.size() * vertex_len + part.its->indices.size() * triangle_len + part.trafos.size() * item_len;
+
+    enum Section { Header, ObjectBegin, Vertices, Triangles, ObjectEnd, Build, Done };
+    Section section = Header;
+    size_t  ipart = 0, ipos = 0;
+    ChunkedReader reader([&](std::string &out) {
+        char buf[512];
+        switch (section) {
+        case Header:
+            out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<model unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n"
+                   " <resources>\n";
+            section = parts.empty() ? Build : ObjectBegin;
+            break;
+        case ObjectBegin:
+            out += "  <object id=\"" + std::to_string(ipart + 1) + "\" type=\"model\">\n   <mesh>\n    <vertices>\n";
+            section = Vertices;
+            break;
+        case Vertices: {
+            const std::vector<Vec3f> &vertices = parts[ipart].its->vertices;
+            for (size_t end = std::min(vertices.size(), ipos + batch_size); ipos < end; ++ ipos) {
+                const Vec3f &v = vertices[ipos];
+                out.append(buf, size_t(snprintf(buf, sizeof(buf), "     <vertex x=\"%.9g\" y=\"%.9g\" z=\"%.9g\"/>\n", v.x(), v.y(), v.z())));
+            }
+            if (ipos == vertices.size()) {
+                out += "    </vertices>\n    <triangles>\n";
+                section = Triangles;
+                ipos = 0;
+            }
+            break;
+        }
+        case Triangles: {
+            const std::vector<stl_triangle_vertex_indices> &indices = parts[ipart].its->indices;
+            for (size_t end = std::min(indices.size(), ipos + batch_size); ipos < end; ++ ipos) {
+                const stl_triangle_vertex_indices &f = indices[ipos];
+                out.append(buf, size_t(snprintf(buf, sizeof(buf), "     <triangle v1=\"%d\" v2=\"%d\" v3=\"%d\"/>\n", f(0), f(1), f(2))));
+            }
+            if (ipos == indices.size()) {
+                section = ObjectEnd;
+                ipos = 0;
+            }
+            break;
+        }
+        case ObjectEnd:
+            out += "    </triangles>\n   </mesh>\n  </object>\n";
+            section = ++ ipart == parts.size() ? Build : ObjectBegin;
+            break;
+        case Build:
+            out += " </resources>\n <build>\n";
+            for (size_t i = 0; i < parts.size(); ++ i)
+                for (const Transform3d &t : parts[i].trafos) {
+                    // 3MF stores the transformation column by column, without the last row.
+                    const auto &m = t.matrix();
+                    out.append(buf, size_t(snprintf(buf, sizeof(buf),
+                        "  <item objectid=\"%d\" transform=\"%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\"/>\n", int(i + 1),
+                        m(0, 0), m(1, 0), m(2, 0), m(0, 1), m(1, 1), m(2, 1), m(0, 2), m(1, 2), m(2, 2), m(0, 3), m(1, 3), m(2, 3))));
+                }
+            out += " </build>\n</model>\n";
+            section = Done;
+            break;
+        case Done:
+            return false;
+        }
+        return true;
+    });
+    zipper.add_entry("3D/3dmodel.model", max_bytes, std::ref(reader));
 }
 
 static void write_thumbnail(Zipper &zipper, const ThumbnailData &data)
@@ -94,27 +270,30 @@ void ZaxeArchive::export_print(const string archive_path, ThumbnailsList thumbna
 {
     Zipper zipper{archive_path};
     boost::filesystem::path temp_path(temp_gcode_output_path);
-    vector<char> bytes;
-    std::string gcode;
 
     try {
+        // Stream the G-code into the archive and compute its checksum in the same pass,
+        // info.json is written afterwards as entry order does not matter to the zip reader.
+        ifstream gcode_file(temp_gcode_output_path, ifstream::binary);
+        if (! gcode_file)
+            throw Slic3r::ExportError("Cannot open G-code file " + temp_gcode_output_path);
+        MD5Checksum md5;
+        zipper.add_entry("data.zaxe_code", gcode_file, size_t(boost::filesystem::file_size(temp_path)),
+            [&md5](const char *data, size_t len) { md5.update(data, len); });
         m_infoconf = ConfMap{
             { "name", boost::filesystem::path(zipper.get_filename()).stem().string() },
-            { "checksum", generate_md5_checksum(temp_gcode_output_path)
+            { "checksum", md5.hexdigest()
         } };
         generate_info_file(m_infoconf, print); // generate info.json contents.
         zipper.add_entry("info.json");
         zipper << to_json(m_infoconf);
-        // add gcode
-        // load file into string again. FIXME maybe a better way to get the string beforehand.
-        boost::filesystem::load_string_file(temp_gcode_output_path, gcode);
-        zipper.add_entry("data.zaxe_code");
-        zipper << gcode;
         // add model stl
-        if (is_there(m_infoconf["model"], {"Z2", "Z3"})) { // export stl only if model is Z2 or Z3.
-            string model_path = (temp_path.parent_path() / "model.stl").string();
-            ifstream::pos_type fileSize = read_binary_into_buffer(model_path.c_str(), bytes);
-            zipper.add_entry("model.stl", bytes.data(), fileSize);
+        if (is_there(m_infoconf["model"], {"Z2", "Z3"})) { // export model only if model is Z2 or Z3.
+            std::vector<ModelPart> parts = collect_model_parts(print);
+            if (m_model_format == ModelFormat::Indexed)
+                write_model_indexed(zipper, parts);
+            else
+                write_model_stl(zipper, parts);
         }
         for (const ThumbnailData& data : thumbnails)
             if (data.is_valid()) write_thumbnail(zipper, data);
@@ -11,8 +11,11 @@
 #include <stdio.h>
 
 #include "libslic3r/Zipper.hpp"
+#include "libslic3r/JsonMessage.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/PrintConfig.hpp"
+#include "libslic3r/BuildVolume.hpp"
+#include "libslic3r/Model.hpp"
 
 #include <openssl/md5.h> // for md5 checksum.
 #include <fstream>
@@ -33,13 +36,24 @@ using ConfMap = std::map<std::string, std::string>;
 namespace Slic3r {
 class ZaxeArchive {
 public:
+    // How the printed geometry is embedded for the printers showing a 3D preview (Z2, Z3).
+    enum class ModelFormat {
+        // model.stl, binary STL with all instances baked in.
+        STL,
+        // 3D/3dmodel.model, 3MF core XML storing every object mesh once, indexed,
+        // with the instances referencing it by transformation.
+        Indexed,
+    };
+
     ZaxeArchive() = default;
     /// Actually perform the export.
     void export_print(const string archive_path, ThumbnailsList thumbnails, const Print &print, const string temp_gcode_output_path);
     std::string get_info(const std::string &key) const;
+    void set_model_format(ModelFormat format) { m_model_format = format; }
 protected:
     void generate_info_file(ConfMap &m, const Print &print);
     ConfMap m_infoconf;
+    ModelFormat m_model_format { ModelFormat::STL };
 };
 
 } // namespace Slic3r
@@ -141,7 +141,7 @@ Vec3f sample_power_cosine_hemisphere(const Vec2f &samples, float power) {
     return Vec3f(cos(term1) * term3, sin(term1) * term3, term2);
 }
 
-std::vector<float> raycast_visibility(const AABBTreeIndirect::Tree<3, float> &raycasting_tree,
+std::vector<float> raycast_visibility(const AABBTreeIndirect::WideTree<float> &raycasting_tree,
         const indexed_triangle_set &triangles,
         const TriangleSetSamples &samples,
         size_t negative_volumes_start_index) {
@@ -310,8 +310,8 @@ struct GlobalModelInfo {
 
     indexed_triangle_set enforcers;
     indexed_triangle_set blockers;
-    AABBTreeIndirect::Tree<3, float> enforcers_tree;
-    AABBTreeIndirect::Tree<3, float> blockers_tree;
+    AABBTreeIndirect::WideTree<float> enforcers_tree;
+    AABBTreeIndirect::WideTree<float> blockers_tree;
 
     bool is_enforced(const Vec3f &position, float radius) const {
         if (enforcers.empty()) {
@@ -704,7 +704,7 @@ void compute_global_occlusion(GlobalModelInfo &result, const PrintObject *po,
 
     BOOST_LOG_TRIVIAL(debug)
     << "SeamPlacer: build AABB tree: start";
-    auto raycasting_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(triangle_set.vertices,
+    auto raycasting_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(triangle_set.vertices,
             triangle_set.indices);
 
     throw_if_canceled();
@@ -738,9 +738,9 @@ void gather_enforcers_blockers(GlobalModelInfo &result, const PrintObject *po) {
         }
     }
 
-    result.enforcers_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(result.enforcers.vertices,
+    result.enforcers_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(result.enforcers.vertices,
             result.enforcers.indices);
-    result.blockers_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(result.blockers.vertices,
+    result.blockers_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(result.blockers.vertices,
             result.blockers.indices);
 
     BOOST_LOG_TRIVIAL(debug)
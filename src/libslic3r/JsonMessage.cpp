@@ -0,0 +1,366 @@
+#include "JsonMessage.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <limits>
+
+#include <boost/log/trivial.hpp>
+
+#include <fast_float/fast_float.h>
+
+namespace Slic3r {
+
+namespace {
+
+inline const char* skip_whitespace(const char *p, const char *end)
+{
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        ++ p;
+    return p;
+}
+
+// Returns a pointer to the closing quote of a string starting after the opening quote, nullptr on error.
+inline const char* skip_string(const char *p, const char *end)
+{
+    for (; p != end; ++ p) {
+        if (*p == '"')
+            return p;
+        if (*p == '\\' && ++ p == end)
+            break;
+    }
+    return nullptr;
+}
+
+// Skips a nested object or array starting at p, returns a pointer past its end, nullptr on error.
+const char* skip_nested(const char *p, const char *end)
+{
+    int depth = 0;
+    for (; p != end; ++ p) {
+        switch (*p) {
+        case '{': case '[': ++ depth; break;
+        case '}': case ']':
+            if (-- depth == 0)
+                return p + 1;
+            break;
+        case '"':
+            if ((p = skip_string(p + 1, end)) == nullptr)
+                return nullptr;
+            break;
+        default: break;
+        }
+    }
+    return nullptr;
+}
+
+void append_utf8(std::string &out, unsigned int cp)
+{
+    if (cp < 0x80)
+        out += char(cp);
+    else if (cp < 0x800) {
+        out += char(0xC0 | (cp >> 6));
+        out += char(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += char(0xE0 | (cp >> 12));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    } else {
+        out += char(0xF0 | (cp >> 18));
+        out += char(0x80 | ((cp >> 12) & 0x3F));
+        out += char(0x80 | ((cp >> 6) & 0x3F));
+        out += char(0x80 | (cp & 0x3F));
+    }
+}
+
+bool parse_hex4(const char *p, const char *end, unsigned int &cp)
+{
+    if (end - p < 4)
+        return false;
+    cp = 0;
+    for (int i = 0; i < 4; ++ i, ++ p) {
+        cp <<= 4;
+        if (*p >= '0' && *p <= '9')      cp |= unsigned(*p - '0');
+        else if (*p >= 'a' && *p <= 'f') cp |= unsigned(*p - 'a' + 10);
+        else if (*p >= 'A' && *p <= 'F') cp |= unsigned(*p - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+std::string unescape(std::string_view s)
+{
+    if (s.find('\\') == std::string_view::npos)
+        return std::string(s);
+
+    std::string out;
+    out.reserve(s.size());
+    for (const char *p = s.data(), *end = s.data() + s.size(); p != end; ++ p) {
+        if (*p != '\\' || p + 1 == end) {
+            out += *p;
+            continue;
+        }
+        switch (*(++ p)) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned int cp;
+            if (! parse_hex4(p + 1, end, cp))
+                break;
+            p += 4;
+            unsigned int lo;
+            // Surrogate pair.
+            if (cp >= 0xD800 && cp < 0xDC00 && end - p > 2 && p[1] == '\\' && p[2] == 'u' && parse_hex4(p + 3, end, lo) && lo >= 0xDC00 && lo < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                p += 6;
+            }
+            append_utf8(out, cp);
+            break;
+        }
+        // '"', '\\', '/'
+        default: out += *p; break;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+bool JsonReader::parse(std::string text)
+{
+    m_text = std::move(text);
+    m_values.clear();
+
+    const char *p   = m_text.data();
+    const char *end = p + m_text.size();
+    p = skip_whitespace(p, end);
+    if (p == end || *p != '{')
+        return false;
+    p = skip_whitespace(p + 1, end);
+    if (p != end && *p == '}')
+        return true;
+
+    for (;;) {
+        // Key.
+        if (p == end || *p != '"')
+            break;
+        const char *key_end = skip_string(p + 1, end);
+        if (key_end == nullptr)
+            break;
+        const char *key_begin = p + 1;
+        auto make_value = [this, key_begin, key_end](const char *begin, const char *end, Type type) {
+            const char *base = m_text.data();
+            return Value{ uint32_t(key_begin - base), uint32_t(key_end - key_begin), uint32_t(begin - base), uint32_t(end - begin), type };
+        };
+        p = skip_whitespace(key_end + 1, end);
+        if (p == end || *p != ':')
+            break;
+        p = skip_whitespace(p + 1, end);
+        if (p == end)
+            break;
+        // Value.
+        const char *value_begin = p;
+        Type        type;
+        if (*p == '"') {
+            const char *str_end = skip_string(p + 1, end);
+            if (str_end == nullptr)
+                break;
+            m_values.push_back(make_value(p + 1, str_end, Type::String));
+            p = str_end + 1;
+        } else {
+            if (*p == '{' || *p == '[') {
+                if ((p = skip_nested(p, end)) == nullptr)
+                    break;
+                type = Type::Raw;
+            } else {
+                while (p != end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+                    ++ p;
+                std::string_view v(value_begin, size_t(p - value_begin));
+                type = v == "true" || v == "false" ? Type::Bool : v == "null" ? Type::Null : Type::Number;
+            }
+            m_values.push_back(make_value(value_begin, p, type));
+        }
+        p = skip_whitespace(p, end);
+        if (p == end)
+            break;
+        if (*p == '}')
+            return true;
+        if (*p != ',')
+            break;
+        p = skip_whitespace(p + 1, end);
+    }
+
+    // Syntax error.
+    m_values.clear();
+    return false;
+}
+
+const JsonReader::Value* JsonReader::find(std::string_view key) const
+{
+    for (const Value &v : m_values)
+        if (std::string_view(m_text.data() + v.key_begin, v.key_len) == key)
+            return &v;
+    return nullptr;
+}
+
+std::string JsonReader::get_string(std::string_view key, const std::string &def) const
+{
+    const Value *v = this->find(key);
+    return v == nullptr || v->type == Type::Null ? def :
+           v->type == Type::String ? unescape(this->value(*v)) : std::string(this->value(*v));
+}
+
+double JsonReader::get_double(std::string_view key, double def) const
+{
+    const Value *v = this->find(key);
+    if (v == nullptr || (v->type != Type::Number && v->type != Type::String))
+        return def;
+    double out;
+    const std::string_view s     = this->value(*v);
+    const char            *begin = s.data();
+    const char            *end   = begin + s.size();
+    // fast_float does not accept the leading '+' nor whitespace.
+    while (begin != end && *begin == ' ')
+        ++ begin;
+    if (begin != end && *begin == '+')
+        ++ begin;
+    auto [ptr, ec] = fast_float::from_chars(begin, end, out);
+    return ec == std::errc() ? out : def;
+}
+
+int JsonReader::get_int(std::string_view key, int def) const
+{
+    double d = this->get_double(key, double(def));
+    // Casting NaN or a value out of the int range is undefined behavior.
+    if (! (d >= double(std::numeric_limits<int>::min()) && d <= double(std::numeric_limits<int>::max()))) {
+        BOOST_LOG_TRIVIAL(error) << "JsonReader: value of \"" << key << "\" is not a valid int: " << this->get_string(key);
+        return def;
+    }
+    return int(d);
+}
+
+bool JsonReader::get_bool(std::string_view key, bool def) const
+{
+    const Value *v = this->find(key);
+    if (v == nullptr)
+        return def;
+    auto iequals = [](std::string_view a, const char *b) {
+        if (a.size() != strlen(b))
+            return false;
+        for (size_t i = 0; i < a.size(); ++ i)
+            if (std::tolower((unsigned char)a[i]) != b[i])
+                return false;
+        return true;
+    };
+    if (iequals(this->value(*v), "true"))
+        return true;
+    if (iequals(this->value(*v), "false"))
+        return false;
+    return def;
+}
+
+void JsonWriter::key(std::string_view key)
+{
+    if (m_out.size() > 1)
+        m_out += ',';
+    this->quoted(key);
+    m_out += ':';
+}
+
+void JsonWriter::quoted(std::string_view value)
+{
+    m_out += '"';
+    for (char c : value) {
+        switch (c) {
+        case '"':  m_out += "\\\""; break;
+        case '\\': m_out += "\\\\"; break;
+        case '\b': m_out += "\\b"; break;
+        case '\f': m_out += "\\f"; break;
+        case '\n': m_out += "\\n"; break;
+        case '\r': m_out += "\\r"; break;
+        case '\t': m_out += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (unsigned int)c);
+                m_out += buf;
+            } else
+                m_out += c;
+        }
+    }
+    m_out += '"';
+}
+
+JsonWriter& JsonWriter::add(std::string_view key, std::string_view value)
+{
+    this->key(key);
+    this->quoted(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view key, double value)
+{
+    this->key(key);
+    char buf[32];
+    m_out.append(buf, size_t(snprintf(buf, sizeof(buf), "%.17g", value)));
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view key, int value)
+{
+    this->key(key);
+    m_out += std::to_string(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::add(std::string_view key, bool value)
+{
+    this->key(key);
+    m_out += value ? "true" : "false";
+    return *this;
+}
+
+JsonWriter& JsonWriter::add_number_or_string(std::string_view key, std::string_view value)
+{
+    return is_plain_number(value) ? this->add_raw(key, value) : this->add(key, value);
+}
+
+JsonWriter& JsonWriter::add_raw(std::string_view key, std::string_view json)
+{
+    this->key(key);
+    m_out += json;
+    return *this;
+}
+
+std::string JsonWriter::str() &&
+{
+    m_out += '}';
+    return std::move(m_out);
+}
+
+bool JsonWriter::is_plain_number(std::string_view value)
+{
+    // -?[0-9]+(\.[0-9]+)?, no leading zeros check, as the printers accept them.
+    const char *p   = value.data();
+    const char *end = p + value.size();
+    if (p != end && *p == '-')
+        ++ p;
+    const char *digits = p;
+    while (p != end && *p >= '0' && *p <= '9')
+        ++ p;
+    if (p == digits)
+        return false;
+    if (p != end && *p == '.') {
+        const char *fraction = ++ p;
+        while (p != end && *p >= '0' && *p <= '9')
+            ++ p;
+        if (p == fraction)
+            return false;
+    }
+    return p == end;
+}
+
+} // namespace Slic3r
@@ -0,0 +1,87 @@
+#ifndef slic3r_JsonMessage_hpp_
+#define slic3r_JsonMessage_hpp_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Slic3r {
+
+// Lightweight reader of flat JSON objects, as sent by the printers over the websocket
+// or by the UDP discovery broadcast. The message is tokenized once into views of the
+// source text, no tree is built and no per-key memory is allocated. Nested objects and
+// arrays are kept as raw JSON text. Values are converted on access, numbers and strings
+// are interchangeable as with boost::property_tree, which stores all values as strings.
+class JsonReader
+{
+public:
+    JsonReader() = default;
+    explicit JsonReader(std::string text) { this->parse(std::move(text)); }
+
+    // Returns false if the text is not a JSON object, the reader is empty then.
+    bool                parse(std::string text);
+    bool                empty() const { return m_values.empty(); }
+    bool                has(std::string_view key) const { return this->find(key) != nullptr; }
+
+    std::string         get_string(std::string_view key, const std::string &def = std::string()) const;
+    double              get_double(std::string_view key, double def = 0.) const;
+    float               get_float(std::string_view key, float def = 0.f) const { return float(this->get_double(key, def)); }
+    int                 get_int(std::string_view key, int def = 0) const;
+    // JSON true / false as well as the strings "true" / "false" in any case.
+    bool                get_bool(std::string_view key, bool def = false) const;
+
+    const std::string&  text() const { return m_text; }
+
+private:
+    enum class Type { String, Number, Bool, Null, Raw };
+    // Offsets into m_text, so that the reader may be copied and moved freely.
+    struct Value {
+        uint32_t         key_begin;
+        uint32_t         key_len;
+        // Without the quotes for strings, still escaped.
+        uint32_t         value_begin;
+        uint32_t         value_len;
+        Type             type;
+    };
+
+    const Value*        find(std::string_view key) const;
+    std::string_view    value(const Value &v) const { return std::string_view(m_text.data() + v.value_begin, v.value_len); }
+
+    std::string         m_text;
+    std::vector<Value>  m_values;
+};
+
+// Writer of flat JSON objects into a string, replacing boost::property_tree + regex.
+class JsonWriter
+{
+public:
+    JsonWriter() { m_out.reserve(256); m_out += '{'; }
+
+    JsonWriter&         add(std::string_view key, std::string_view value);
+    JsonWriter&         add(std::string_view key, const char *value) { return this->add(key, std::string_view(value)); }
+    JsonWriter&         add(std::string_view key, const std::string &value) { return this->add(key, std::string_view(value)); }
+    JsonWriter&         add(std::string_view key, double value);
+    JsonWriter&         add(std::string_view key, int value);
+    JsonWriter&         add(std::string_view key, bool value);
+    // Writes the value unquoted if it is a plain decimal number, quoted otherwise.
+    JsonWriter&         add_number_or_string(std::string_view key, std::string_view value);
+    // Appends a value, which is already valid JSON.
+    JsonWriter&         add_raw(std::string_view key, std::string_view json);
+
+    // Closes the object, the writer shall not be used anymore.
+    std::string         str() &&;
+    std::string         str() const & { return m_out + '}'; }
+
+    static bool         is_plain_number(std::string_view value);
+
+private:
+    void                key(std::string_view key);
+    void                quoted(std::string_view value);
+
+    std::string         m_out;
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_JsonMessage_hpp_
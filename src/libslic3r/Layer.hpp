@@ -184,6 +184,9 @@ private:
     size_t              m_id;
     PrintObject        *m_object;
     LayerRegionPtrs     m_regions;
+    // Hash of the regions and configuration this layer was sliced with, set by PrintObject::slice() once the layer is finished.
+    // Zero if the layer has not been sliced yet. When re-slicing, layers at the same Z with the same hash are reused.
+    size_t              m_slicing_hash { 0 };
 };
 
 class SupportLayer : public Layer 
@@ -1,6 +1,8 @@
 #ifndef MESHSPLITIMPL_HPP
 #define MESHSPLITIMPL_HPP
 
+#include <atomic>
+
 #include "TriangleMesh.hpp"
 #include "libnest2d/tools/benchmark.h"
 #include "Execution/ExecutionTBB.hpp"
@@ -89,6 +91,58 @@ private:
     size_t                       m_seed { 0 };
 };
 
+// For each face the lowest index of a face of its patch, by a concurrent union-find over the face neighbors.
+// A union always links the root of the higher index to the root of the lower index, thus the result
+// does not depend on the order the unions are executed in.
+template<class ExPolicy>
+std::vector<int> face_patch_roots(ExPolicy &&ex, const std::vector<Vec3i> &face_neighbors)
+{
+    std::vector<std::atomic<int>> parent(face_neighbors.size());
+    execution::for_each(ex, size_t(0), face_neighbors.size(), [&parent](size_t face_idx) {
+        parent[face_idx].store(int(face_idx), std::memory_order_relaxed);
+    }, 4096);
+
+    // Find with path halving.
+    auto find = [&parent](int idx) {
+        for (;;) {
+            int p = parent[idx].load(std::memory_order_relaxed);
+            if (p == idx)
+                return idx;
+            int gp = parent[p].load(std::memory_order_relaxed);
+            if (gp != p)
+                parent[idx].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+            idx = gp;
+        }
+    };
+
+    execution::for_each(ex, size_t(0), face_neighbors.size(), [&parent, &find, &face_neighbors](size_t face_idx) {
+        for (int neighbor_idx : face_neighbors[face_idx])
+            if (neighbor_idx > int(face_idx)) {
+                // Each pair of neighbors is united once, from the face of the lower index.
+                int a = int(face_idx);
+                int b = neighbor_idx;
+                for (;;) {
+                    a = find(a);
+                    b = find(b);
+                    if (a == b)
+                        break;
+                    if (a < b)
+                        std::swap(a, b);
+                    // Link the root of the higher index, retry if it is not a root anymore.
+                    int expected = a;
+                    if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                        break;
+                }
+            }
+    }, 4096);
+
+    std::vector<int> roots(face_neighbors.size());
+    execution::for_each(ex, size_t(0), face_neighbors.size(), [&roots, &find](size_t face_idx) {
+        roots[face_idx] = find(int(face_idx));
+    }, 4096);
+    return roots;
+}
+
 } // namespace meshsplit_detail
 
 // Funky wrapper for timinig of its_split() using various neighbor index creating methods, see sandboxes/its_neighbor_index/main.cpp
@@ -43,6 +43,7 @@ class ModelWipeTower;
 class Print;
 class SLAPrint;
 class TriangleSelector;
+struct LoadStepParams;
 
 namespace UndoRedo {
 	class StackImpl;
@@ -1076,10 +1077,11 @@ public:
     };
     using LoadAttributes = enum_bitmask<LoadAttribute>;
 
+    // Returns an empty Model if the import of a STEP file was canceled through step_params->progress_fn.
     static Model read_from_file(
         const std::string& input_file, 
         DynamicPrintConfig* config = nullptr, ConfigSubstitutionContext* config_substitutions = nullptr,
-        LoadAttributes options = LoadAttribute::AddDefaultInstances);
+        LoadAttributes options = LoadAttribute::AddDefaultInstances, const LoadStepParams* step_params = nullptr);
     static Model read_from_archive(
         const std::string& input_file, 
         DynamicPrintConfig* config, ConfigSubstitutionContext* config_substitutions,
@@ -5,16 +5,18 @@
 #include "Print.hpp"
 #include "Geometry/VoronoiVisualUtils.hpp"
 #include "MutablePolygon.hpp"
+#include "TriangleSelector.hpp"
 #include "format.hpp"
 
+#include <atomic>
 #include <utility>
 #include <cfloat>
+#include <memory>
 #include <unordered_set>
 
 #include <boost/log/trivial.hpp>
 #include <tbb/parallel_for.h>
-#include <mutex>
-#include <boost/thread/lock_guard.hpp>
+#include <tbb/task_arena.h>
 
 namespace Slic3r {
 struct ColoredLine {
@@ -83,7 +85,7 @@ struct PaintedLine
 
 struct PaintedLineVisitor
 {
-    PaintedLineVisitor(const EdgeGrid::Grid &grid, std::vector<PaintedLine> &painted_lines, std::mutex &painted_lines_mutex, size_t reserve) : grid(grid), painted_lines(painted_lines), painted_lines_mutex(painted_lines_mutex)
+    PaintedLineVisitor(const EdgeGrid::Grid &grid, std::vector<PaintedLine> &painted_lines, size_t reserve) : grid(grid), painted_lines(painted_lines)
     {
         painted_lines_set.reserve(reserve);
     }
@@ -125,10 +127,7 @@ struct PaintedLineVisitor
                             line_to_test_projected.reverse();
 
                         painted_lines_set.insert(*it_contour_and_segment);
-                        {
-                            boost::lock_guard<std::mutex> lock(painted_lines_mutex);
-                            painted_lines.push_back({it_contour_and_segment->first, it_contour_and_segment->second, line_to_test_projected, this->color});
-                        }
+                        painted_lines.push_back({it_contour_and_segment->first, it_contour_and_segment->second, line_to_test_projected, this->color});
                     }
                 }
             }
@@ -139,7 +138,6 @@ struct PaintedLineVisitor
 
     const EdgeGrid::Grid                                                                 &grid;
     std::vector<PaintedLine>                                                             &painted_lines;
-    std::mutex                                                                           &painted_lines_mutex;
     Line                                                                                  line_to_test;
     std::unordered_set<std::pair<size_t, size_t>, boost::hash<std::pair<size_t, size_t>>> painted_lines_set;
     int                                                                                   color             = -1;
@@ -878,9 +876,10 @@ static inline Line clip_finite_voronoi_edge(const Voronoi::VD::edge_type &edge,
     return {v0.cast<coord_t>(), v1.cast<coord_t>()};
 }
 
-static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<ColoredLine>> &color_poly)
+// vd is a scratch Voronoi diagram, reused between calls to keep its allocated memory.
+static MMU_Graph build_graph(size_t layer_idx, const std::vector<std::vector<ColoredLine>> &color_poly, Geometry::VoronoiDiagram &vd)
 {
-    Geometry::VoronoiDiagram vd;
+    vd.clear();
     std::vector<ColoredLine> lines_colored  = to_lines(color_poly);
     const Polygons           color_poly_tmp = colored_points_to_polygon(color_poly);
     const Points             points         = to_points(color_poly_tmp);
@@ -1299,9 +1298,10 @@ static bool is_volume_sinking(const indexed_triangle_set &its, const Transform3d
 //#define MMU_SEGMENTATION_DEBUG_TOP_BOTTOM
 
 // Returns MMU segmentation of top and bottom layers based on painting in MMU segmentation gizmo
-static inline std::vector<std::vector<ExPolygons>> mmu_segmentation_top_and_bottom_layers(const PrintObject             &print_object,
-                                                                                          const std::vector<ExPolygons> &input_expolygons,
-                                                                                          const std::function<void()>   &throw_on_cancel_callback)
+static inline std::vector<std::vector<ExPolygons>> mmu_segmentation_top_and_bottom_layers(const PrintObject                                    &print_object,
+                                                                                          const std::vector<std::unique_ptr<TriangleSelector>> &paintings,
+                                                                                          const std::vector<ExPolygons>                        &input_expolygons,
+                                                                                          const std::function<void()>                          &throw_on_cancel_callback)
 {
     const size_t num_extruders = print_object.print()->config().nozzle_diameter.size() + 1;
     const size_t num_layers    = input_expolygons.size();
@@ -1329,11 +1329,11 @@ static inline std::vector<std::vector<ExPolygons>> mmu_segmentation_top_and_bott
 #endif // NDEBUG
 
     if (max_top_layers > 0 || max_bottom_layers > 0) {
-        for (const ModelVolume *mv : print_object.model_object()->volumes)
-            if (mv->is_model_part()) {
-                const Transform3d volume_trafo = object_trafo * mv->get_matrix();
+        for (size_t volume_idx = 0; volume_idx < paintings.size(); ++ volume_idx)
+            if (const TriangleSelector *painting = paintings[volume_idx].get(); painting != nullptr) {
+                const Transform3d volume_trafo = object_trafo * print_object.model_object()->volumes[volume_idx]->get_matrix();
                 for (size_t extruder_idx = 0; extruder_idx < num_extruders; ++ extruder_idx) {
-                    const indexed_triangle_set painted = mv->mmu_segmentation_facets.get_facets_strict(*mv, EnforcerBlockerType(extruder_idx));
+                    const indexed_triangle_set painted = painting->get_facets_strict(EnforcerBlockerType(extruder_idx));
 #ifdef MMU_SEGMENTATION_DEBUG_TOP_BOTTOM
                     {
                         static int iRun = 0;
@@ -1676,15 +1676,223 @@ static bool has_layer_only_one_color(const std::vector<std::vector<ColoredLine>>
     return true;
 }
 
+// Painting of the model parts of an object, deserialized just once and shared by the projection of the painted facets
+// to the layers and by the segmentation of the top and bottom layers.
+// Indexed by the model volumes of the object, nullptr for the volumes that are not model parts.
+static std::vector<std::unique_ptr<TriangleSelector>> deserialize_mmu_paintings(const ModelObject &model_object)
+{
+    std::vector<std::unique_ptr<TriangleSelector>> paintings(model_object.volumes.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, model_object.volumes.size(), 1), [&model_object, &paintings](const tbb::blocked_range<size_t> &range) {
+        for (size_t volume_idx = range.begin(); volume_idx < range.end(); ++volume_idx)
+            if (const ModelVolume *mv = model_object.volumes[volume_idx]; mv->is_model_part()) {
+                paintings[volume_idx] = std::make_unique<TriangleSelector>(mv->mesh());
+                // Reset of TriangleSelector is done inside TriangleSelector's constructor, so we don't need it to perform it again in deserialize().
+                paintings[volume_idx]->deserialize(mv->mmu_segmentation_facets.get_data(), false);
+            }
+    });
+    return paintings;
+}
+
+// Painted facet transformed to the coordinates of the object, swept through the layers it spans.
+struct PaintedFacet
+{
+    // Vertices sorted by z-axis for simplification of projected_facet on slices.
+    std::array<Vec3f, 3> vertices;
+    int                  color;
+    // One past the last layer spanned by the facet.
+    int                  layer_end;
+};
+
+// Painted facets of all model parts and colors, bucket sorted by the first layer they span:
+// facets starting at layer i are facets[layer_facets_begin[i], layer_facets_begin[i + 1]).
+struct PaintedFacets
+{
+    std::vector<PaintedFacet> facets;
+    std::vector<size_t>       layer_facets_begin;
+};
+
+static PaintedFacets collect_painted_facets(const PrintObject                                    &print_object,
+                                            const std::vector<std::unique_ptr<TriangleSelector>> &paintings,
+                                            const size_t                                          num_extruders,
+                                            const std::function<void()>                          &throw_on_cancel_callback)
+{
+    const ConstLayerPtrsAdaptor layers     = print_object.layers();
+    const size_t                num_layers = layers.size();
+
+    // Painted facets of all model parts, one set of facets per model part and color.
+    std::vector<std::pair<Transform3f, indexed_triangle_set>> painted(paintings.size() * num_extruders);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, painted.size(), 1), [&print_object, &paintings, &num_extruders, &painted, &throw_on_cancel_callback](const tbb::blocked_range<size_t> &range) {
+        for (size_t idx = range.begin(); idx < range.end(); ++idx)
+            if (const TriangleSelector *painting = paintings[idx / num_extruders].get(); painting != nullptr) {
+                throw_on_cancel_callback();
+                const ModelVolume *mv = print_object.model_object()->volumes[idx / num_extruders];
+                painted[idx].first  = print_object.trafo().cast<float>() * mv->get_matrix().cast<float>();
+                painted[idx].second = painting->get_facets(EnforcerBlockerType(idx % num_extruders + 1));
+            }
+    });
+
+    std::vector<size_t> painted_begin(painted.size() + 1, 0);
+    for (size_t idx = 0; idx < painted.size(); ++idx)
+        painted_begin[idx + 1] = painted_begin[idx] + painted[idx].second.indices.size();
+
+    // Transform the painted facets and find the layers they span, that are the layers with slice_z between the lowest and the highest point of the facet.
+    // Horizontal facets span no layer, as there is no line to project on the layers.
+    std::vector<PaintedFacet> all_facets(painted_begin.back());
+    std::vector<int>          facet_layer_begin(all_facets.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, painted.size(), 1), [&layers, &painted, &painted_begin, &all_facets, &facet_layer_begin, &num_extruders](const tbb::blocked_range<size_t> &range) {
+        for (size_t idx = range.begin(); idx < range.end(); ++idx) {
+            const Transform3f          &tr            = painted[idx].first;
+            const indexed_triangle_set &custom_facets = painted[idx].second;
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, custom_facets.indices.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t facet_idx = range.begin(); facet_idx < range.end(); ++facet_idx) {
+                    PaintedFacet &facet = all_facets[painted_begin[idx] + facet_idx];
+                    for (int p_idx = 0; p_idx < 3; ++p_idx)
+                        facet.vertices[p_idx] = tr * custom_facets.vertices[custom_facets.indices[facet_idx](p_idx)];
+                    std::sort(facet.vertices.begin(), facet.vertices.end(), [](const Vec3f &p1, const Vec3f &p2) { return p1.z() < p2.z(); });
+                    facet.color = int(idx % num_extruders + 1);
+                    if (facet.vertices.front().z() == facet.vertices.back().z()) {
+                        facet_layer_begin[painted_begin[idx] + facet_idx] = 0;
+                        facet.layer_end                                   = 0;
+                    } else {
+                        auto first_layer = std::lower_bound(layers.begin(), layers.end(), facet.vertices.front().z(), [](const Layer *l1, float z) { return l1->slice_z < z; });
+                        auto last_layer  = std::upper_bound(first_layer, layers.end(), facet.vertices.back().z(), [](float z, const Layer *l1) { return z < l1->slice_z; });
+                        facet_layer_begin[painted_begin[idx] + facet_idx] = int(first_layer - layers.begin());
+                        facet.layer_end                                   = int(last_layer - layers.begin());
+                    }
+                }
+            }); // end of parallel_for
+        }
+    }); // end of parallel_for
+    painted.clear();
+    throw_on_cancel_callback();
+
+    PaintedFacets out;
+    out.layer_facets_begin.assign(num_layers + 1, 0);
+    for (size_t facet_idx = 0; facet_idx < all_facets.size(); ++facet_idx)
+        if (facet_layer_begin[facet_idx] < all_facets[facet_idx].layer_end)
+            ++out.layer_facets_begin[facet_layer_begin[facet_idx] + 1];
+    for (size_t layer_idx = 1; layer_idx <= num_layers; ++layer_idx)
+        out.layer_facets_begin[layer_idx] += out.layer_facets_begin[layer_idx - 1];
+    out.facets.assign(out.layer_facets_begin.back(), PaintedFacet());
+    std::vector<size_t> layer_facets_end(out.layer_facets_begin.begin(), out.layer_facets_begin.end() - 1);
+    for (size_t facet_idx = 0; facet_idx < all_facets.size(); ++facet_idx)
+        if (facet_layer_begin[facet_idx] < all_facets[facet_idx].layer_end)
+            out.facets[layer_facets_end[facet_layer_begin[facet_idx]]++] = all_facets[facet_idx];
+    return out;
+}
+
+// Project the painted facet to the layer, collect lines of the layer contours the projection is close to.
+static void project_painted_facet(const PaintedFacet &painted_facet, const Layer &layer, const Point &center_offset, const EdgeGrid::Grid &edge_grid, std::vector<PaintedLine> &painted_lines)
+{
+    const std::array<Vec3f, 3> &facet = painted_facet.vertices;
+    assert(facet[0].z() <= layer.slice_z && layer.slice_z <= facet[2].z());
+
+    // https://kandepet.com/3d-printing-slicing-3d-objects/
+    float t            = (float(layer.slice_z) - facet[0].z()) / (facet[2].z() - facet[0].z());
+    Vec3f line_start_f = facet[0] + t * (facet[2] - facet[0]);
+    Vec3f line_end_f;
+
+    if (facet[1].z() > layer.slice_z) {
+        // [P0, P2] and [P0, P1]
+        float t1   = (float(layer.slice_z) - facet[0].z()) / (facet[1].z() - facet[0].z());
+        line_end_f = facet[0] + t1 * (facet[1] - facet[0]);
+    } else {
+        // [P0, P2] and [P1, P2]
+        float t2   = (float(layer.slice_z) - facet[1].z()) / (facet[2].z() - facet[1].z());
+        line_end_f = facet[1] + t2 * (facet[2] - facet[1]);
+    }
+
+    Line line_to_test(Point(scale_(line_start_f.x()), scale_(line_start_f.y())),
+                      Point(scale_(line_end_f.x()), scale_(line_end_f.y())));
+    line_to_test.translate(-center_offset);
+
+    // BoundingBoxes for EdgeGrids are computed from printable regions. It is possible that the painted line (line_to_test) could
+    // be outside EdgeGrid's BoundingBox, for example, when the negative volume is used on the painted area (GH #7618).
+    // To ensure that the painted line is always inside EdgeGrid's BoundingBox, it is clipped by EdgeGrid's BoundingBox in cases
+    // when any of the endpoints of the line are outside the EdgeGrid's BoundingBox.
+    if (const BoundingBox &edge_grid_bbox = edge_grid.bbox(); !edge_grid_bbox.contains(line_to_test.a) || !edge_grid_bbox.contains(line_to_test.b)) {
+        // If the painted line (line_to_test) is entirely outside EdgeGrid's BoundingBox, skip this painted line.
+        if (!edge_grid_bbox.overlap(BoundingBox(Points{line_to_test.a, line_to_test.b})) ||
+            !line_to_test.clip_with_bbox(edge_grid_bbox))
+            return;
+    }
+
+    PaintedLineVisitor visitor(edge_grid, painted_lines, 16);
+    visitor.line_to_test = line_to_test;
+    visitor.color        = painted_facet.color;
+    edge_grid.visit_cells_intersecting_line(line_to_test.a, line_to_test.b, visitor);
+}
+
+static std::vector<ExPolygons> segment_layer(size_t                          layer_idx,
+                                             const EdgeGrid::Grid           &edge_grid,
+                                             const ExPolygons               &input_expolygons,
+                                             std::vector<PaintedLine>      &&painted_lines,
+                                             const size_t                    num_extruders,
+                                             Geometry::VoronoiDiagram       &vd)
+{
+#ifdef MMU_SEGMENTATION_DEBUG_PAINTED_LINES
+    {
+        static int iRun = 0;
+        export_painted_lines_to_svg(debug_out_path("mm-painted-lines-%d-%d.svg", layer_idx, iRun++), {painted_lines}, input_expolygons);
+    }
+#endif // MMU_SEGMENTATION_DEBUG_PAINTED_LINES
+
+    std::vector<std::vector<PaintedLine>> post_processed_painted_lines = post_process_painted_lines(edge_grid.contours(), std::move(painted_lines));
+
+#ifdef MMU_SEGMENTATION_DEBUG_PAINTED_LINES
+    {
+        static int iRun = 0;
+        export_painted_lines_to_svg(debug_out_path("mm-painted-lines-post-processed-%d-%d.svg", layer_idx, iRun++), post_processed_painted_lines, input_expolygons);
+    }
+#endif // MMU_SEGMENTATION_DEBUG_PAINTED_LINES
+
+    std::vector<std::vector<ColoredLine>> color_poly = colorize_contours(edge_grid.contours(), post_processed_painted_lines);
+
+#ifdef MMU_SEGMENTATION_DEBUG_COLORIZED_POLYGONS
+    {
+        static int iRun = 0;
+        export_colorized_polygons_to_svg(debug_out_path("mm-colorized_polygons-%d-%d.svg", layer_idx, iRun++), color_poly, input_expolygons);
+    }
+#endif // MMU_SEGMENTATION_DEBUG_COLORIZED_POLYGONS
+
+    assert(!color_poly.empty());
+    assert(!color_poly.front().empty());
+    std::vector<ExPolygons> segmented_regions;
+    if (has_layer_only_one_color(color_poly)) {
+        // If the whole layer is painted using the same color, it is not needed to construct a Voronoi diagram for the segmentation of this layer.
+        segmented_regions.assign(num_extruders + 1, ExPolygons());
+        segmented_regions[size_t(color_poly.front().front().color)] = input_expolygons;
+    } else {
+        MMU_Graph graph = build_graph(layer_idx, color_poly, vd);
+        remove_multiple_edges_in_vertices(graph, color_poly);
+        graph.remove_nodes_with_one_arc();
+
+#ifdef MMU_SEGMENTATION_DEBUG_GRAPH
+        {
+            static int iRun = 0;
+            export_graph_to_svg(debug_out_path("mm-graph-final-%d-%d.svg", layer_idx, iRun++), graph, input_expolygons);
+        }
+#endif // MMU_SEGMENTATION_DEBUG_GRAPH
+
+        segmented_regions = extract_colored_segments(graph, num_extruders);
+    }
+
+#ifdef MMU_SEGMENTATION_DEBUG_REGIONS
+    {
+        static int iRun = 0;
+        export_regions_to_svg(debug_out_path("mm-regions-sides-%d-%d.svg", layer_idx, iRun++), segmented_regions, input_expolygons);
+    }
+#endif // MMU_SEGMENTATION_DEBUG_REGIONS
+
+    return segmented_regions;
+}
+
 std::vector<std::vector<ExPolygons>> multi_material_segmentation_by_painting(const PrintObject &print_object, const std::function<void()> &throw_on_cancel_callback)
 {
     const size_t                          num_extruders = print_object.print()->config().nozzle_diameter.size();
     const size_t                          num_layers    = print_object.layers().size();
     std::vector<std::vector<ExPolygons>>  segmented_regions(num_layers);
     segmented_regions.assign(num_layers, std::vector<ExPolygons>(num_extruders + 1));
-    std::vector<std::vector<PaintedLine>> painted_lines(num_layers);
-    std::array<std::mutex, 64>            painted_lines_mutex;
-    std::vector<EdgeGrid::Grid>           edge_grids(num_layers);
     const ConstLayerPtrsAdaptor           layers = print_object.layers();
     std::vector<ExPolygons>               input_expolygons(num_layers);
 
@@ -1730,165 +1938,69 @@ std::vector<std::vector<ExPolygons>> multi_material_segmentation_by_painting(con
         layer_bboxes[layer_idx].merge(get_extents(input_expolygons[layer_idx]));
     }
 
-    for (size_t layer_idx = 0; layer_idx < num_layers; ++layer_idx) {
-        throw_on_cancel_callback();
-        BoundingBox bbox = layer_bboxes[layer_idx];
-        // Projected triangles could, in rare cases (as in GH issue #7299), belongs to polygons printed in the previous or the next layer.
-        // Let's merge the bounding box of the current layer with bounding boxes of the previous and the next layer to ensure that
-        // every projected triangle will be inside the resulting bounding box.
-        if (layer_idx > 1) bbox.merge(layer_bboxes[layer_idx - 1]);
-        if (layer_idx < num_layers - 1) bbox.merge(layer_bboxes[layer_idx + 1]);
-        // Projected triangles may slightly exceed the input polygons.
-        bbox.offset(20 * SCALED_EPSILON);
-        edge_grids[layer_idx].set_bbox(bbox);
-        edge_grids[layer_idx].create(input_expolygons[layer_idx], coord_t(scale_(10.)));
-    }
+    // Deserialize the painting of each model part just once for all colors, for both the sides and the top and bottom layers.
+    const std::vector<std::unique_ptr<TriangleSelector>> paintings = deserialize_mmu_paintings(*print_object.model_object());
+    throw_on_cancel_callback();
 
-    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - projection of painted triangles - begin";
-    for (const ModelVolume *mv : print_object.model_object()->volumes) {
-        tbb::parallel_for(tbb::blocked_range<size_t>(1, num_extruders + 1), [&mv, &print_object, &layers, &edge_grids, &painted_lines, &painted_lines_mutex, &input_expolygons, &throw_on_cancel_callback](const tbb::blocked_range<size_t> &range) {
-            for (size_t extruder_idx = range.begin(); extruder_idx < range.end(); ++extruder_idx) {
+    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - collecting of painted triangles - begin";
+    PaintedFacets painted_facets = collect_painted_facets(print_object, paintings, num_extruders, throw_on_cancel_callback);
+    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - collecting of painted triangles - end";
+
+    // Painted facets are swept through the layers, projecting the facets spanning a layer to its contours, which are then segmented.
+    // Ranges of layers are processed in parallel, a few per thread to balance the load. A range owns its layers, thus no locking is needed.
+    // Only the edge grid and the painted lines of the layer being segmented are held in memory by each thread.
+    const size_t max_ranges = 4 * size_t(tbb::this_task_arena::max_concurrency());
+    const size_t range_size = std::max<size_t>(1, (num_layers + max_ranges - 1) / max_ranges);
+    const size_t num_ranges = (num_layers + range_size - 1) / range_size;
+    // For each range, facets spanning the first layer of the range, which start at a layer of a preceding range.
+    std::vector<std::vector<size_t>> spanning(num_ranges);
+    for (size_t layer_idx = 0; layer_idx < num_layers; ++layer_idx)
+        for (size_t facet_idx = painted_facets.layer_facets_begin[layer_idx]; facet_idx < painted_facets.layer_facets_begin[layer_idx + 1]; ++facet_idx)
+            for (size_t range_idx = layer_idx / range_size + 1; range_idx < num_ranges && range_idx * range_size < size_t(painted_facets.facets[facet_idx].layer_end); ++range_idx)
+                spanning[range_idx].emplace_back(facet_idx);
+
+    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - projection of painted triangles and layers segmentation in parallel - begin";
+    std::atomic<size_t> num_painted_layers { 0 };
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_ranges, 1), [&](const tbb::blocked_range<size_t> &range) {
+        // Voronoi diagram reused by the layers processed by this task.
+        Geometry::VoronoiDiagram vd;
+        for (size_t range_idx = range.begin(); range_idx < range.end(); ++range_idx) {
+            std::vector<size_t> active = std::move(spanning[range_idx]);
+            for (size_t layer_idx = range_idx * range_size; layer_idx < std::min(num_layers, (range_idx + 1) * range_size); ++layer_idx) {
                 throw_on_cancel_callback();
-                const indexed_triangle_set custom_facets = mv->mmu_segmentation_facets.get_facets(*mv, EnforcerBlockerType(extruder_idx));
-                if (!mv->is_model_part() || custom_facets.indices.empty())
+                for (size_t facet_idx = painted_facets.layer_facets_begin[layer_idx]; facet_idx < painted_facets.layer_facets_begin[layer_idx + 1]; ++facet_idx)
+                    active.emplace_back(facet_idx);
+                // Remove the facets ending below this layer.
+                active.erase(std::remove_if(active.begin(), active.end(), [&painted_facets, layer_idx](size_t facet_idx) { return painted_facets.facets[facet_idx].layer_end <= int(layer_idx); }), active.end());
+                if (active.empty() || input_expolygons[layer_idx].empty())
                     continue;
 
-                const Transform3f tr = print_object.trafo().cast<float>() * mv->get_matrix().cast<float>();
-                tbb::parallel_for(tbb::blocked_range<size_t>(0, custom_facets.indices.size()), [&tr, &custom_facets, &print_object, &layers, &edge_grids, &input_expolygons, &painted_lines, &painted_lines_mutex, &extruder_idx](const tbb::blocked_range<size_t> &range) {
-                    for (size_t facet_idx = range.begin(); facet_idx < range.end(); ++facet_idx) {
-                        float min_z = std::numeric_limits<float>::max();
-                        float max_z = std::numeric_limits<float>::lowest();
-
-                        std::array<Vec3f, 3> facet;
-                        for (int p_idx = 0; p_idx < 3; ++p_idx) {
-                            facet[p_idx] = tr * custom_facets.vertices[custom_facets.indices[facet_idx](p_idx)];
-                            max_z        = std::max(max_z, facet[p_idx].z());
-                            min_z        = std::min(min_z, facet[p_idx].z());
-                        }
-
-                        // Sort the vertices by z-axis for simplification of projected_facet on slices
-                        std::sort(facet.begin(), facet.end(), [](const Vec3f &p1, const Vec3f &p2) { return p1.z() < p2.z(); });
-
-                        // Find lowest slice not below the triangle.
-                        auto first_layer = std::upper_bound(layers.begin(), layers.end(), float(min_z - EPSILON),
-                                                            [](float z, const Layer *l1) { return z < l1->slice_z; });
-                        auto last_layer  = std::upper_bound(layers.begin(), layers.end(), float(max_z + EPSILON),
-                                                           [](float z, const Layer *l1) { return z < l1->slice_z; });
-                        --last_layer;
-
-                        for (auto layer_it = first_layer; layer_it != (last_layer + 1); ++layer_it) {
-                            const Layer *layer     = *layer_it;
-                            size_t       layer_idx = layer_it - layers.begin();
-                            if (input_expolygons[layer_idx].empty() || facet[0].z() > layer->slice_z || layer->slice_z > facet[2].z())
-                                continue;
-
-                            // https://kandepet.com/3d-printing-slicing-3d-objects/
-                            float t            = (float(layer->slice_z) - facet[0].z()) / (facet[2].z() - facet[0].z());
-                            Vec3f line_start_f = facet[0] + t * (facet[2] - facet[0]);
-                            Vec3f line_end_f;
-
-                            if (facet[1].z() > layer->slice_z) {
-                                // [P0, P2] and [P0, P1]
-                                float t1   = (float(layer->slice_z) - facet[0].z()) / (facet[1].z() - facet[0].z());
-                                line_end_f = facet[0] + t1 * (facet[1] - facet[0]);
-                            } else {
-                                // [P0, P2] and [P1, P2]
-                                float t2   = (float(layer->slice_z) - facet[1].z()) / (facet[2].z() - facet[1].z());
-                                line_end_f = facet[1] + t2 * (facet[2] - facet[1]);
-                            }
-
-                            Line line_to_test(Point(scale_(line_start_f.x()), scale_(line_start_f.y())),
-                                              Point(scale_(line_end_f.x()), scale_(line_end_f.y())));
-                            line_to_test.translate(-print_object.center_offset());
-
-                            // BoundingBoxes for EdgeGrids are computed from printable regions. It is possible that the painted line (line_to_test) could
-                            // be outside EdgeGrid's BoundingBox, for example, when the negative volume is used on the painted area (GH #7618).
-                            // To ensure that the painted line is always inside EdgeGrid's BoundingBox, it is clipped by EdgeGrid's BoundingBox in cases
-                            // when any of the endpoints of the line are outside the EdgeGrid's BoundingBox.
-                            if (const BoundingBox &edge_grid_bbox = edge_grids[layer_idx].bbox(); !edge_grid_bbox.contains(line_to_test.a) || !edge_grid_bbox.contains(line_to_test.b)) {
-                                // If the painted line (line_to_test) is entirely outside EdgeGrid's BoundingBox, skip this painted line.
-                                if (!edge_grid_bbox.overlap(BoundingBox(Points{line_to_test.a, line_to_test.b})) ||
-                                    !line_to_test.clip_with_bbox(edge_grid_bbox))
-                                    continue;
-                            }
-
-                            size_t mutex_idx = layer_idx & 0x3F;
-                            assert(mutex_idx < painted_lines_mutex.size());
-
-                            PaintedLineVisitor visitor(edge_grids[layer_idx], painted_lines[layer_idx], painted_lines_mutex[mutex_idx], 16);
-                            visitor.line_to_test = line_to_test;
-                            visitor.color        = int(extruder_idx);
-                            edge_grids[layer_idx].visit_cells_intersecting_line(line_to_test.a, line_to_test.b, visitor);
-                        }
-                    }
-                }); // end of parallel_for
-            }
-        }); // end of parallel_for
-    }
-    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - projection of painted triangles - end";
-    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - painted layers count: "
-                             << std::count_if(painted_lines.begin(), painted_lines.end(), [](const std::vector<PaintedLine> &pl) { return !pl.empty(); });
-
-    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - layers segmentation in parallel - begin";
-    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_layers), [&edge_grids, &input_expolygons, &painted_lines, &segmented_regions, &num_extruders, &throw_on_cancel_callback](const tbb::blocked_range<size_t> &range) {
-        for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++layer_idx) {
-            throw_on_cancel_callback();
-            if (!painted_lines[layer_idx].empty()) {
-#ifdef MMU_SEGMENTATION_DEBUG_PAINTED_LINES
-                {
-                    static int iRun = 0;
-                    export_painted_lines_to_svg(debug_out_path("mm-painted-lines-%d-%d.svg", layer_idx, iRun++), {painted_lines[layer_idx]}, input_expolygons[layer_idx]);
-                }
-#endif // MMU_SEGMENTATION_DEBUG_PAINTED_LINES
-
-                std::vector<std::vector<PaintedLine>> post_processed_painted_lines = post_process_painted_lines(edge_grids[layer_idx].contours(), std::move(painted_lines[layer_idx]));
-
-#ifdef MMU_SEGMENTATION_DEBUG_PAINTED_LINES
-                {
-                    static int iRun = 0;
-                    export_painted_lines_to_svg(debug_out_path("mm-painted-lines-post-processed-%d-%d.svg", layer_idx, iRun++), post_processed_painted_lines, input_expolygons[layer_idx]);
-                }
-#endif // MMU_SEGMENTATION_DEBUG_PAINTED_LINES
-
-                std::vector<std::vector<ColoredLine>> color_poly = colorize_contours(edge_grids[layer_idx].contours(), post_processed_painted_lines);
-
-#ifdef MMU_SEGMENTATION_DEBUG_COLORIZED_POLYGONS
-                {
-                    static int iRun = 0;
-                    export_colorized_polygons_to_svg(debug_out_path("mm-colorized_polygons-%d-%d.svg", layer_idx, iRun++), color_poly, input_expolygons[layer_idx]);
-                }
-#endif // MMU_SEGMENTATION_DEBUG_COLORIZED_POLYGONS
-
-                assert(!color_poly.empty());
-                assert(!color_poly.front().empty());
-                if (has_layer_only_one_color(color_poly)) {
-                    // If the whole layer is painted using the same color, it is not needed to construct a Voronoi diagram for the segmentation of this layer.
-                    segmented_regions[layer_idx][size_t(color_poly.front().front().color)] = input_expolygons[layer_idx];
-                } else {
-                    MMU_Graph graph = build_graph(layer_idx, color_poly);
-                    remove_multiple_edges_in_vertices(graph, color_poly);
-                    graph.remove_nodes_with_one_arc();
-
-#ifdef MMU_SEGMENTATION_DEBUG_GRAPH
-                    {
-                        static int iRun = 0;
-                        export_graph_to_svg(debug_out_path("mm-graph-final-%d-%d.svg", layer_idx, iRun++), graph, input_expolygons[layer_idx]);
-                    }
-#endif // MMU_SEGMENTATION_DEBUG_GRAPH
-
-                    segmented_regions[layer_idx] = extract_colored_segments(graph, num_extruders);
+                BoundingBox bbox = layer_bboxes[layer_idx];
+                // Projected triangles could, in rare cases (as in GH issue #7299), belongs to polygons printed in the previous or the next layer.
+                // Let's merge the bounding box of the current layer with bounding boxes of the previous and the next layer to ensure that
+                // every projected triangle will be inside the resulting bounding box.
+                if (layer_idx > 1) bbox.merge(layer_bboxes[layer_idx - 1]);
+                if (layer_idx < num_layers - 1) bbox.merge(layer_bboxes[layer_idx + 1]);
+                // Projected triangles may slightly exceed the input polygons.
+                bbox.offset(20 * SCALED_EPSILON);
+                EdgeGrid::Grid edge_grid;
+                edge_grid.set_bbox(bbox);
+                edge_grid.create(input_expolygons[layer_idx], coord_t(scale_(10.)));
+
+                std::vector<PaintedLine> painted_lines;
+                for (size_t facet_idx : active)
+                    project_painted_facet(painted_facets.facets[facet_idx], *layers[layer_idx], print_object.center_offset(), edge_grid, painted_lines);
+
+                if (!painted_lines.empty()) {
+                    ++num_painted_layers;
+                    segmented_regions[layer_idx] = segment_layer(layer_idx, edge_grid, input_expolygons[layer_idx], std::move(painted_lines), num_extruders, vd);
                 }
-
-#ifdef MMU_SEGMENTATION_DEBUG_REGIONS
-                {
-                    static int iRun = 0;
-                    export_regions_to_svg(debug_out_path("mm-regions-sides-%d-%d.svg", layer_idx, iRun++), segmented_regions[layer_idx], input_expolygons[layer_idx]);
-                }
-#endif // MMU_SEGMENTATION_DEBUG_REGIONS
             }
         }
     }); // end of parallel_for
-    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - layers segmentation in parallel - end";
+    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - projection of painted triangles and layers segmentation in parallel - end";
+    BOOST_LOG_TRIVIAL(debug) << "MMU segmentation - painted layers count: " << num_painted_layers;
+    painted_facets = PaintedFacets();
     throw_on_cancel_callback();
 
     if (auto w = print_object.config().mmu_segmented_region_max_width; w > 0.f) {
@@ -1897,7 +2009,7 @@ std::vector<std::vector<ExPolygons>> multi_material_segmentation_by_painting(con
     }
 
     // The first index is extruder number (includes default extruder), and the second one is layer number
-    std::vector<std::vector<ExPolygons>> top_and_bottom_layers = mmu_segmentation_top_and_bottom_layers(print_object, input_expolygons, throw_on_cancel_callback);
+    std::vector<std::vector<ExPolygons>> top_and_bottom_layers = mmu_segmentation_top_and_bottom_layers(print_object, paintings, input_expolygons, throw_on_cancel_callback);
     throw_on_cancel_callback();
 
     std::vector<std::vector<ExPolygons>> segmented_regions_merged = merge_segmented_layers(segmented_regions, std::move(top_and_bottom_layers), num_extruders, throw_on_cancel_callback);
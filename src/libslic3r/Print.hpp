@@ -377,6 +377,8 @@ private:
     void ironing();
     void generate_support_material();
 
+    // Replace the newly created layers with the old layers sliced at the same Z with the same regions, delete the rest of the old layers.
+    size_t reuse_sliced_layers(LayerPtrs &&old_layers);
     void slice_volumes();
     // Has any support (not counting the raft).
     void detect_surfaces_type();
@@ -1156,8 +1156,9 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             model_object_status.print_object_regions = print_objects_range.begin()->print_object->m_shared_regions;
             model_object_status.print_object_regions->ref_cnt_inc();
         }
-        if (solid_or_modifier_differ || model_origin_translation_differ || layer_height_ranges_differ ||
-            ! model_object.layer_height_profile.timestamp_matches(model_object_new.layer_height_profile)) {
+        bool layer_height_profile_differ = ! model_object.layer_height_profile.timestamp_matches(model_object_new.layer_height_profile);
+        if (solid_or_modifier_differ || model_origin_translation_differ ||
+            ((layer_height_ranges_differ || layer_height_profile_differ) && model_object_status.print_object_regions == nullptr)) {
             // The very first step (the slicing step) is invalidated. One may freely remove all associated PrintObjects.
             model_object_status.print_object_regions_status = 
                 model_object_status.print_object_regions == nullptr || model_origin_translation_differ || layer_height_ranges_differ ?
@@ -1178,6 +1179,21 @@ Print::ApplyStatus Print::apply(const Model &model, DynamicPrintConfig new_full_
             model_object.assign_copy(model_object_new);
         } else {
             model_object_status.print_object_regions_status = ModelObjectStatus::PrintObjectRegionsStatus::Valid;
+            if (layer_height_ranges_differ || layer_height_profile_differ) {
+                // Only the distribution of layers or the layer ranges changed, the meshes are the same.
+                // Keep the PrintObjects with their layers, PrintObject::slice() will only slice the layers, which changed their Z
+                // or which were assigned different regions, and it will reuse the other layers.
+                for (const PrintObjectStatus &print_object_status : print_objects_range)
+                    update_apply_status(print_object_status.print_object->invalidate_step(posSlice));
+                if (layer_height_ranges_differ) {
+                    // Regions will be regenerated for the new layer ranges.
+                    model_object.layer_config_ranges = model_object_new.layer_config_ranges;
+                    model_object_status.print_object_regions->clear();
+                    model_object_status.print_object_regions_status = ModelObjectStatus::PrintObjectRegionsStatus::Invalid;
+                    print_regions_reshuffled = true;
+                }
+                model_object.layer_height_profile.assign(model_object_new.layer_height_profile);
+            }
             if (supports_differ || model_custom_supports_data_changed(model_object, model_object_new)) {
                 // First stop background processing before shuffling or deleting the ModelVolumes in the ModelObject's list.
                 if (supports_differ) {
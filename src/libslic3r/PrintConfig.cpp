@@ -126,6 +126,13 @@ static const t_config_enum_values s_keys_map_SlicingMode {
 };
 CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(SlicingMode)
 
+static const t_config_enum_values s_keys_map_SlicingEngine {
+    { "per_facet",      int(SlicingEngine::PerFacet) },
+    { "sweep",          int(SlicingEngine::Sweep) },
+    { "sweep_edges",    int(SlicingEngine::SweepEdges) }
+};
+CONFIG_OPTION_ENUM_DEFINE_STATIC_MAPS(SlicingEngine)
+
 static const t_config_enum_values s_keys_map_SupportMaterialPattern {
     { "rectilinear",        smpRectilinear },
     { "rectilinear-grid",   smpRectilinearGrid },
@@ -2518,6 +2525,22 @@ void PrintConfigDef::init_fff_params()
     def->mode = comAdvanced;
     def->set_default_value(new ConfigOptionEnum<SlicingMode>(SlicingMode::Regular));
 
+    def = this->add("slicing_engine", coEnum);
+    def->label = L("Slicing engine");
+    def->category = L("Advanced");
+    def->tooltip = L("Algorithm intersecting the model with the layers. All of them produce the same slices. "
+                     "\"Per facet\" looks up the layers of each facet. \"Sweep\" and \"Sweep edges\" sweep the facets through the layers, "
+                     "which is faster for tall models sliced into many layers, \"Sweep edges\" intersects each edge with a layer just once.");
+    def->enum_keys_map = &ConfigOptionEnum<SlicingEngine>::get_enum_values();
+    def->enum_values.push_back("per_facet");
+    def->enum_values.push_back("sweep");
+    def->enum_values.push_back("sweep_edges");
+    def->enum_labels.push_back(L("Per facet"));
+    def->enum_labels.push_back(L("Sweep"));
+    def->enum_labels.push_back(L("Sweep edges"));
+    def->mode = comExpert;
+    def->set_default_value(new ConfigOptionEnum<SlicingEngine>(SlicingEngine::PerFacet));
+
     def = this->add("support_material", coBool);
     def->label = L("Generate support material");
     def->category = L("Support material");
@@ -4406,6 +4429,22 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->cli = "slice|s";
     def->set_default_value(new ConfigOptionBool(false));
 
+    def = this->add("fleet", coBool);
+    def->label = L("Fleet daemon");
+    def->tooltip = L("Run headless: discover the printers on the network, keep them connected and serve their state "
+                     "and slice-and-send jobs as JSON over HTTP on localhost, see --fleet-port. Runs until interrupted.");
+    def->set_default_value(new ConfigOptionBool(false));
+
+    def = this->add("server", coBool);
+    def->label = L("Slicing server");
+    def->tooltip = L("Slice the jobs read from the standard input, one JSON object per line "
+                     "({\"id\": 1, \"input\": \"model.3mf\", \"config\": \"profile.ini\", \"output\": \"model.gcode\", \"zaxe\": false}), "
+                     "and write a JSON line with the result and timings of each. Without \"output\", the files of a job are written "
+                     "to a temporary directory, which is removed when the next job is read. Loaded configs and the last model stay in memory, "
+                     "slicing the same model again only reprocesses what its configuration changed, see --slice-cache for reusing "
+                     "the files of earlier jobs.");
+    def->set_default_value(new ConfigOptionBool(false));
+
     def = this->add("help", coBool);
     def->label = L("Help");
     def->tooltip = L("Show this help.");
@@ -4574,12 +4613,36 @@ CLIMiscConfigDef::CLIMiscConfigDef()
     def->label = L("Data directory");
     def->tooltip = L("Load and store settings at the given directory. This is useful for maintaining different profiles or including configurations from a network storage.");
 
+    def = this->add("mesh_cache", coString);
+    def->label = L("Mesh cache directory");
+    def->tooltip = L("Cache the repaired meshes of the loaded STL and OBJ files in the given directory, keyed by the file content. "
+                     "Loading a file of the same content again reads the cached mesh instead of parsing and repairing the file.");
+
+    def = this->add("zaxe_indexed_model", coBool);
+    def->label = L("Indexed Zaxe model");
+    def->tooltip = L("Embed the model into the Zaxe archives made by --server and --fleet as a 3MF model (3D/3dmodel.model) "
+                     "storing every mesh once with a transformation per instance, instead of a binary STL with all the instances.");
+    def->set_default_value(new ConfigOptionBool(false));
+
+    def = this->add("slice_cache", coString);
+    def->label = L("Slice cache directory");
+    def->tooltip = L("Store the files exported by --server and --fleet in the given directory, keyed by the content of the model "
+                     "and the full configuration. A job slicing the same model with the same configuration again copies the stored files "
+                     "instead of slicing. The least recently used files are removed when the directory grows over 4 GB.");
+
     def = this->add("loglevel", coInt);
     def->label = L("Logging level");
     def->tooltip = L("Sets logging sensitivity. 0:fatal, 1:error, 2:warning, 3:info, 4:debug, 5:trace\n"
                      "For example. loglevel=2 logs fatal, error and warning level messages.");
     def->min = 0;
 
+    def = this->add("fleet_port", coInt);
+    def->label = L("Fleet port");
+    def->tooltip = L("Port of the HTTP endpoint served by --fleet on localhost.");
+    def->min = 1;
+    def->max = 65535;
+    def->set_default_value(new ConfigOptionInt(9296));
+
 #if (defined(_MSC_VER) || defined(__MINGW32__)) && defined(SLIC3R_GUI)
     def = this->add("sw_renderer", coBool);
     def->label = L("Render with a software renderer");
@@ -5,6 +5,7 @@
 #include "Print.hpp"
 #include "ClipperUtils.hpp"
 
+#include <boost/functional/hash.hpp>
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
@@ -148,6 +149,12 @@ static std::vector<VolumeSlices> slice_volumes_inner(
     case SlicingMode::CloseHoles: params_base.mode = MeshSlicingParams::SlicingMode::Positive; break;
     }
 
+    switch (print_object_config.slicing_engine.value) {
+    case SlicingEngine::PerFacet:   params_base.engine = MeshSlicingParams::SlicingEngine::PerFacet; break;
+    case SlicingEngine::Sweep:      params_base.engine = MeshSlicingParams::SlicingEngine::Sweep; break;
+    case SlicingEngine::SweepEdges: params_base.engine = MeshSlicingParams::SlicingEngine::SweepEdges; break;
+    }
+
     params_base.mode_below     = params_base.mode;
 
     const size_t num_extruders = print_config.nozzle_diameter.size();
@@ -487,6 +494,84 @@ std::string fix_slicing_errors(LayerPtrs &layers, const std::function<void()> &t
         "however you might want to check the results or repair the input file and retry.\n";
 }
 
+// Hash of the object and print configuration the slices depend on.
+static size_t object_slicing_config_hash(const PrintObject &print_object)
+{
+    const PrintConfig &print_config = print_object.print()->config();
+    size_t seed = print_object.config().hash();
+    boost::hash_combine(seed, print_config.resolution.hash());
+    boost::hash_combine(seed, print_config.nozzle_diameter.hash());
+    boost::hash_combine(seed, print_object.shared_regions()->all_regions.size());
+    return seed;
+}
+
+// Hash of the volumes and regions of the layer range containing slice_z, combined with the configuration hash.
+// Layers sliced at the same Z with the same hash have the same slices.
+static size_t layer_slicing_hash(const PrintObjectRegions &print_object_regions, size_t config_hash, double slice_z)
+{
+    size_t seed = config_hash;
+    for (const PrintObjectRegions::VolumeRegion &volume_region : layer_range_first(print_object_regions.layer_ranges, slice_z)->volume_regions) {
+        boost::hash_combine(seed, volume_region.model_volume->id().id);
+        boost::hash_combine(seed, volume_region.parent);
+        boost::hash_combine(seed, volume_region.region ? volume_region.region->print_object_region_id() : -1);
+        boost::hash_combine(seed, volume_region.region ? volume_region.region->config_hash() : 0);
+    }
+    // Zero is reserved for layers, which were not sliced yet.
+    return seed == 0 ? 1 : seed;
+}
+
+// Replace the newly created layers with the layers of the previous slicing, which were sliced at the same Z with the same regions
+// and configuration, so that after editing the variable layer height profile or the layer ranges only the modified layers are sliced.
+// Not reused are the first layer due to the Elephant foot compensation, the layers repaired by fix_slicing_errors(),
+// which depend on their neighbors, and the layers of multi-material painted or spiral vase objects, which depend on the whole stack of layers.
+// Returns the number of reused layers.
+size_t PrintObject::reuse_sliced_layers(LayerPtrs &&old_layers)
+{
+    size_t num_reused = 0;
+    if (old_layers.size() > 1 && m_layers.size() > 1 && ! this->is_mm_painted() && ! m_print->config().spiral_vase) {
+        const size_t config_hash = object_slicing_config_hash(*this);
+        auto         it_old      = old_layers.begin() + 1;
+        for (size_t layer_idx = 1; layer_idx < m_layers.size(); ++ layer_idx) {
+            Layer *layer = m_layers[layer_idx];
+            for (; it_old != old_layers.end() && (*it_old)->print_z < layer->print_z - EPSILON; ++ it_old) ;
+            if (it_old == old_layers.end())
+                break;
+            Layer *old_layer = *it_old;
+            if (std::abs(old_layer->print_z - layer->print_z) < EPSILON && std::abs(old_layer->height - layer->height) < EPSILON &&
+                std::abs(old_layer->slice_z - layer->slice_z) < EPSILON && ! old_layer->slicing_errors && old_layer->m_slicing_hash != 0 &&
+                old_layer->m_slicing_hash == layer_slicing_hash(*m_shared_regions, config_hash, layer->slice_z)) {
+                // Drop the surface types assigned by the steps following the slicing.
+                old_layer->restore_untyped_slices();
+                // The old PrintRegions may have been released already, move the slices to LayerRegions of the current PrintRegions.
+                // Equal slicing hashes guarantee the same regions at the same indices.
+                LayerRegionPtrs old_regions = std::move(old_layer->m_regions);
+                old_layer->m_regions.clear();
+                old_layer->m_regions.reserve(m_shared_regions->all_regions.size());
+                for (const std::unique_ptr<PrintRegion> &pr : m_shared_regions->all_regions) {
+                    LayerRegion *layerm = new LayerRegion(old_layer, pr.get());
+                    if (size_t region_id = old_layer->m_regions.size(); region_id < old_regions.size())
+                        layerm->slices = std::move(old_regions[region_id]->slices);
+                    old_layer->m_regions.emplace_back(layerm);
+                }
+                for (LayerRegion *layerm : old_regions)
+                    delete layerm;
+                old_layer->set_id(layer->id());
+                // The new layer takes the place of the old one to be deleted.
+                std::swap(m_layers[layer_idx], *it_old);
+                ++ num_reused;
+            }
+        }
+        for (size_t i = 0; i < m_layers.size(); ++ i) {
+            m_layers[i]->lower_layer = i == 0 ? nullptr : m_layers[i - 1];
+            m_layers[i]->upper_layer = i + 1 == m_layers.size() ? nullptr : m_layers[i + 1];
+        }
+    }
+    for (Layer *layer : old_layers)
+        delete layer;
+    old_layers.clear();
+    return num_reused;
+}
+
 // Called by make_perimeters()
 // 1) Decides Z positions of the layers,
 // 2) Initializes layers and their regions
@@ -504,8 +589,11 @@ void PrintObject::slice()
     this->update_layer_height_profile(*this->model_object(), m_slicing_params, layer_height_profile);
     m_print->throw_if_canceled();
     m_typed_slices = false;
-    this->clear_layers();
+    // Layers of the previous slicing, which are still valid, are reused.
+    LayerPtrs old_layers = std::move(m_layers);
     m_layers = new_layers(this, generate_object_layers(m_slicing_params, layer_height_profile));
+    if (size_t num_reused = this->reuse_sliced_layers(std::move(old_layers)); num_reused > 0)
+        BOOST_LOG_TRIVIAL(info) << "Slicing objects - reusing " << num_reused << " of " << m_layers.size() << " layers";
     this->slice_volumes();
     m_print->throw_if_canceled();
     // Fix the model.
@@ -515,9 +603,10 @@ void PrintObject::slice()
     if (! warning.empty())
         BOOST_LOG_TRIVIAL(info) << warning;
     // Update bounding boxes, back up raw slices of complex models.
+    const size_t config_hash = object_slicing_config_hash(*this);
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
+        [this, config_hash](const tbb::blocked_range<size_t>& range) {
             for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
                 m_print->throw_if_canceled();
                 Layer &layer = *m_layers[layer_idx];
@@ -526,6 +615,8 @@ void PrintObject::slice()
                 for (const ExPolygon &expoly : layer.lslices)
                 	layer.lslices_bboxes.emplace_back(get_extents(expoly));
                 layer.backup_untyped_slices();
+                // The layer is finished, it may be reused by the next slicing.
+                layer.m_slicing_hash = layer_slicing_hash(*m_shared_regions, config_hash, layer.slice_z);
             }
         });
     if (m_layers.empty())
@@ -674,15 +765,26 @@ void PrintObject::slice_volumes()
     const Print *print                      = this->print();
     const auto   throw_on_cancel_callback   = std::function<void()>([print](){ print->throw_if_canceled(); });
 
+    // Layers reused from the previous slicing by reuse_sliced_layers() keep their slices, only the new layers are sliced.
+    auto layers_to_slice = [this]() {
+        LayerPtrs out;
+        out.reserve(m_layers.size());
+        for (Layer *layer : m_layers)
+            if (layer->m_slicing_hash == 0)
+                out.emplace_back(layer);
+        return out;
+    };
+    LayerPtrs layers = layers_to_slice();
+
     // Clear old LayerRegions, allocate for new PrintRegions.
-    for (Layer* layer : m_layers) {
+    for (Layer* layer : layers) {
         layer->m_regions.clear();
         layer->m_regions.reserve(m_shared_regions->all_regions.size());
         for (const std::unique_ptr<PrintRegion> &pr : m_shared_regions->all_regions)
             layer->m_regions.emplace_back(new LayerRegion(layer, pr.get()));
     }
 
-    std::vector<float>                   slice_zs      = zs_from_layers(m_layers);
+    std::vector<float>                   slice_zs      = zs_from_layers(layers);
     std::vector<std::vector<ExPolygons>> region_slices = slices_to_regions(this->model_object()->volumes, *m_shared_regions, slice_zs,
         slice_volumes_inner(
             print->config(), this->config(), this->trafo_centered(),
@@ -693,7 +795,7 @@ void PrintObject::slice_volumes()
     for (size_t region_id = 0; region_id < region_slices.size(); ++ region_id) {
         std::vector<ExPolygons> &by_layer = region_slices[region_id];
         for (size_t layer_id = 0; layer_id < by_layer.size(); ++ layer_id)
-            m_layers[layer_id]->regions()[region_id]->slices.append(std::move(by_layer[layer_id]), stInternal);
+            layers[layer_id]->regions()[region_id]->slices.append(std::move(by_layer[layer_id]), stInternal);
     }
     region_slices.clear();
     
@@ -707,6 +809,8 @@ void PrintObject::slice_volumes()
     }
     if (! m_layers.empty())
         m_layers.back()->upper_layer = nullptr;
+    // Some of the new layers may have been removed.
+    layers = layers_to_slice();
     m_print->throw_if_canceled();
 
     // Is any ModelVolume MMU painted?
@@ -741,13 +845,14 @@ void PrintObject::slice_volumes()
         // Uncompensated slices for the first layer in case the Elephant foot compensation is applied.
 	    ExPolygons  lslices_1st_layer;
 	    tbb::parallel_for(
-	        tbb::blocked_range<size_t>(0, m_layers.size()),
-			[this, xy_compensation_scaled, elephant_foot_compensation_scaled, &lslices_1st_layer](const tbb::blocked_range<size_t>& range) {
+	        tbb::blocked_range<size_t>(0, layers.size()),
+			[this, &layers, xy_compensation_scaled, elephant_foot_compensation_scaled, &lslices_1st_layer](const tbb::blocked_range<size_t>& range) {
 	            for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
 	                m_print->throw_if_canceled();
-	                Layer *layer = m_layers[layer_id];
+	                Layer *layer = layers[layer_id];
 	                // Apply size compensation and perform clipping of multi-part objects.
-	                float elfoot = (layer_id == 0) ? elephant_foot_compensation_scaled : 0.f;
+	                // The first layer is never reused.
+	                float elfoot = (layer == m_layers.front()) ? elephant_foot_compensation_scaled : 0.f;
 	                if (layer->m_regions.size() == 1) {
 	                    // Optimized version for a single region layer.
 	                    // Single region, growing or shrinking.
@@ -795,6 +900,7 @@ void PrintObject::slice_volumes()
 	            }
 	        });
 	    if (elephant_foot_compensation_scaled > 0.f && ! m_layers.empty()) {
+	    	assert(m_layers.front()->m_slicing_hash == 0);
 	    	// The Elephant foot has been compensated, therefore the 1st layer's lslices are shrank with the Elephant foot compensation value.
 	    	// Store the uncompensated value there.
 	    	assert(m_layers.front()->id() == 0);
@@ -1,8 +1,14 @@
 #include "QuadricEdgeCollapse.hpp"
 #include <tuple>
 #include <optional>
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 #include "MutablePriorityQueue.hpp"
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/task_arena.h>
 
 using namespace Slic3r;
 
@@ -83,6 +89,7 @@ namespace QuadricEdgeCollapse {
     struct VertexInfo {
         SymMat q; // sum quadric of surround triangles
         uint32_t start = 0, count = 0; // vertex neighbor triangles
+        bool fixed = false; // edges of the vertex are never collapsed
         VertexInfo() = default;
         bool is_deleted() const { return count == 0; }
     };
@@ -115,8 +122,14 @@ namespace QuadricEdgeCollapse {
     // calculate error for vertex and quadrics, triangle quadrics and triangle vertex give zero, only pozitive number
     double vertex_error(const SymMat &q, const Vec3d &vertex);
     SymMat create_quadric(const Triangle &t, const Vec3d& n, const Vertices &vertices);
+    // Optional inputs and outputs of collapse, used by collapse of mesh regions
+    struct CollapseData {
+        std::vector<bool>   fixed_vertices; // IN: edges of these vertices are never collapsed
+        std::vector<SymMat> quadrics;       // IN: vertex quadrics from previous collapse, OUT: quadrics of result vertices
+        std::vector<int>    vertex_map;     // OUT: result vertex index for each input vertex, -1 for removed
+    };
     std::tuple<TriangleInfos, VertexInfos, EdgeInfos, Errors> 
-    init(const indexed_triangle_set &its, ThrowOnCancel& throw_on_cancel, StatusFn& status_fn);
+    init(const indexed_triangle_set &its, const CollapseData *data, ThrowOnCancel& throw_on_cancel, StatusFn& status_fn);
     std::optional<uint32_t> find_triangle_index1(uint32_t vi, const VertexInfo& v_info,
         uint32_t ti, const EdgeInfos& e_infos, const Indices& indices);
     void reorder_edges(EdgeInfos &e_infos, const VertexInfo &v_info, uint32_t ti0, uint32_t ti1);
@@ -133,7 +146,16 @@ namespace QuadricEdgeCollapse {
     void change_neighbors(EdgeInfos &e_infos, VertexInfos &v_infos, uint32_t ti0, uint32_t ti1,
                           uint32_t vi0, uint32_t vi1, uint32_t vi_top0,
                           const Triangle &t1, CopyEdgeInfos& infos, EdgeInfos &e_infos1);
-    void compact(const VertexInfos &v_infos, const TriangleInfos &t_infos, const EdgeInfos &e_infos, indexed_triangle_set &its);
+    // vertex_map (optional) is filled with the new vertex indices, -1 for the removed vertices
+    void compact(const VertexInfos &v_infos, const TriangleInfos &t_infos, const EdgeInfos &e_infos, indexed_triangle_set &its,
+                 std::vector<int> *vertex_map = nullptr);
+    // Collapse edges until triangle_count or maximal_error is reached.
+    // Return error of the last collapsed edge.
+    float collapse(indexed_triangle_set &its, uint32_t triangle_count, float maximal_error,
+                   CollapseData *data, ThrowOnCancel &throw_on_cancel, StatusFn &status_fn);
+    // Split triangles into 2^depth spatially compact regions of the same size,
+    // return triangle indices ordered by region and the region starts in it.
+    std::pair<std::vector<uint32_t>, std::vector<uint32_t>> partition(const indexed_triangle_set &its, int depth);
 
 #ifdef EXPENSIVE_DEBUG_CHECKS
     void store_surround(const char *obj_filename, size_t triangle_index, int depth, const indexed_triangle_set &its,
@@ -153,6 +175,9 @@ namespace QuadricEdgeCollapse {
     const int status_set_offsets = 10;
     const int status_calc_errors = 30;
     const int status_create_refs = 10;
+    // parallel collapse
+    const size_t min_region_triangle_count = 50000;
+    const int status_regions_size = 80; // in percents, rest is for stitching of regions
     } // namespace QuadricEdgeCollapse
 
 using namespace QuadricEdgeCollapse;
@@ -171,6 +196,194 @@ void Slic3r::its_quadric_edge_collapse(
     if (throw_on_cancel == nullptr) throw_on_cancel = []() {};
     if (status_fn == nullptr) status_fn = [](int) {};
 
+    float last_collapsed_error = collapse(its, triangle_count, maximal_error, nullptr, throw_on_cancel, status_fn);
+    if (max_error != nullptr) *max_error = last_collapsed_error;
+}
+
+void Slic3r::its_quadric_edge_collapse_par(
+    indexed_triangle_set &    its,
+    uint32_t                  triangle_count,
+    float *                   max_error,
+    std::function<void(void)> throw_on_cancel,
+    std::function<void(int)>  status_fn)
+{
+    // check input
+    if (triangle_count >= its.indices.size()) return;
+    float maximal_error = (max_error == nullptr)? std::numeric_limits<float>::max() : *max_error;
+    if (maximal_error <= 0.f) return;
+    if (throw_on_cancel == nullptr) throw_on_cancel = []() {};
+    if (status_fn == nullptr) status_fn = [](int) {};
+
+    // More regions than threads to balance the load, but each big enough to be worth of own collapse.
+    int    depth       = 0;
+    size_t max_regions = 4 * size_t(tbb::this_task_arena::max_concurrency());
+    while ((size_t(2) << depth) <= max_regions &&
+           (its.indices.size() >> (depth + 1)) >= min_region_triangle_count)
+        ++depth;
+    if (depth == 0) {
+        // small mesh
+        float last_collapsed_error = collapse(its, triangle_count, maximal_error, nullptr, throw_on_cancel, status_fn);
+        if (max_error != nullptr) *max_error = last_collapsed_error;
+        return;
+    }
+
+    std::vector<uint32_t> order, region_starts;
+    std::tie(order, region_starts) = partition(its, depth);
+    size_t region_count = region_starts.size() - 1;
+    throw_on_cancel();
+
+    // Vertices of triangles from more regions stay on place (fixed) until stitching of regions.
+    const int boundary = -2;
+    std::vector<std::atomic<int>> vertex_region(its.vertices.size());
+    std::vector<int>              local_index(its.vertices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.vertices.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t vi = range.begin(); vi < range.end(); ++vi) {
+            vertex_region[vi].store(-1, std::memory_order_relaxed);
+            local_index[vi] = -1;
+        }
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, region_count, 1), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t r = range.begin(); r < range.end(); ++r)
+            for (uint32_t i = region_starts[r]; i < region_starts[r + 1]; ++i)
+                for (int j = 0; j < 3; ++j) {
+                    int vi     = its.indices[order[i]][j];
+                    int region = -1;
+                    if (!vertex_region[vi].compare_exchange_strong(region, int(r)) && region != int(r) && region != boundary)
+                        vertex_region[vi].store(boundary);
+                }
+    });
+    throw_on_cancel();
+
+    // Progress of collapse of regions weighted by their triangle counts, reported only when it grows.
+    std::vector<std::atomic<int>> region_status(region_count);
+    for (std::atomic<int> &status : region_status) status.store(0);
+    std::mutex status_mutex;
+    int        last_status = 0;
+    auto report_status = [&](int status) {
+        std::lock_guard<std::mutex> lk(status_mutex);
+        if (status <= last_status) return;
+        last_status = status;
+        status_fn(status);
+    };
+    auto report_region_status = [&](size_t r, int percent) {
+        region_status[r].store(percent, std::memory_order_relaxed);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < region_count; ++i)
+            sum += uint64_t(region_status[i].load(std::memory_order_relaxed)) * (region_starts[i + 1] - region_starts[i]);
+        report_status(static_cast<int>(sum * status_regions_size / (100 * its.indices.size())));
+    };
+
+    struct Region {
+        indexed_triangle_set its;
+        CollapseData         data;
+        // global index of fixed vertex for each vertex of collapsed region, -1 for the others
+        std::vector<int>     global_index;
+        float                last_collapsed_error = 0.f;
+    };
+    std::vector<Region> regions(region_count);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, region_count, 1), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t r = range.begin(); r < range.end(); ++r) {
+            Region &region = regions[r];
+            // local vertex indices of inner vertices are stored in shared local_index, each one is used by this region only
+            std::unordered_map<int, int> boundary_local_index;
+            std::vector<int>             global_index;
+            region.its.indices.reserve(region_starts[r + 1] - region_starts[r]);
+            for (uint32_t i = region_starts[r]; i < region_starts[r + 1]; ++i) {
+                stl_triangle_vertex_indices t;
+                for (int j = 0; j < 3; ++j) {
+                    int vi = its.indices[order[i]][j];
+                    if (vertex_region[vi].load(std::memory_order_relaxed) == boundary) {
+                        auto it = boundary_local_index.emplace(vi, int(global_index.size())).first;
+                        if (it->second == int(global_index.size())) {
+                            global_index.emplace_back(vi);
+                            region.data.fixed_vertices.emplace_back(true);
+                        }
+                        t[j] = it->second;
+                    } else {
+                        if (local_index[vi] < 0) {
+                            local_index[vi] = int(global_index.size());
+                            global_index.emplace_back(vi);
+                            region.data.fixed_vertices.emplace_back(false);
+                        }
+                        t[j] = local_index[vi];
+                    }
+                }
+                region.its.indices.emplace_back(t);
+            }
+            region.its.vertices.reserve(global_index.size());
+            for (int vi : global_index)
+                region.its.vertices.emplace_back(its.vertices[vi]);
+
+            uint32_t region_triangle_count = uint32_t(uint64_t(region.its.indices.size()) * triangle_count / its.indices.size());
+            StatusFn region_status_fn = [&report_region_status, r](int percent) { report_region_status(r, percent); };
+            region.last_collapsed_error = collapse(region.its, region_triangle_count, maximal_error, &region.data,
+                                                   throw_on_cancel, region_status_fn);
+
+            region.global_index.assign(region.its.vertices.size(), -1);
+            for (size_t vi = 0; vi < global_index.size(); ++vi)
+                if (int vi_new = region.data.vertex_map[vi]; vi_new >= 0 && region.data.fixed_vertices[vi])
+                    region.global_index[vi_new] = global_index[vi];
+        }
+    });
+    throw_on_cancel();
+
+    // Merge regions, fixed vertices shared by regions sum up their quadrics from each region.
+    indexed_triangle_set merged;
+    CollapseData         merged_data;
+    float                last_collapsed_error = 0.f;
+    {
+        size_t vertex_count = 0, merged_triangle_count = 0;
+        for (const Region &region : regions) {
+            vertex_count += region.its.vertices.size();
+            merged_triangle_count += region.its.indices.size();
+        }
+        merged.vertices.reserve(vertex_count);
+        merged.indices.reserve(merged_triangle_count);
+        merged_data.quadrics.reserve(vertex_count);
+        // reuse for merged index of the fixed vertices
+        std::fill(local_index.begin(), local_index.end(), -1);
+        std::vector<int> merged_index;
+        for (Region &region : regions) {
+            merged_index.assign(region.its.vertices.size(), -1);
+            for (size_t vi = 0; vi < region.its.vertices.size(); ++vi) {
+                int gi = region.global_index[vi];
+                if (gi >= 0 && local_index[gi] >= 0) {
+                    merged_index[vi] = local_index[gi];
+                    merged_data.quadrics[local_index[gi]] += region.data.quadrics[vi];
+                    continue;
+                }
+                merged_index[vi] = int(merged.vertices.size());
+                if (gi >= 0) local_index[gi] = merged_index[vi];
+                merged.vertices.emplace_back(region.its.vertices[vi]);
+                merged_data.quadrics.emplace_back(region.data.quadrics[vi]);
+            }
+            for (const stl_triangle_vertex_indices &t : region.its.indices)
+                merged.indices.emplace_back(merged_index[t[0]], merged_index[t[1]], merged_index[t[2]]);
+            last_collapsed_error = std::max(last_collapsed_error, region.last_collapsed_error);
+            region = Region();
+        }
+    }
+    report_status(status_regions_size);
+
+    // Stitch regions: collapse edges of the fixed vertices and the rest up to the wanted triangle count.
+    if (merged.indices.size() > triangle_count) {
+        StatusFn stitch_status_fn = [&](int percent) {
+            report_status(status_regions_size + percent * (100 - status_regions_size) / 100);
+        };
+        last_collapsed_error = std::max(last_collapsed_error,
+            collapse(merged, triangle_count, maximal_error, &merged_data, throw_on_cancel, stitch_status_fn));
+    }
+    its = std::move(merged);
+    if (max_error != nullptr) *max_error = last_collapsed_error;
+}
+
+float QuadricEdgeCollapse::collapse(indexed_triangle_set &   its,
+                                    uint32_t                 triangle_count,
+                                    float                    maximal_error,
+                                    CollapseData *           data,
+                                    ThrowOnCancel &          throw_on_cancel,
+                                    StatusFn &               status_fn)
+{
     StatusFn init_status_fn = [&](int percent) {
         float n_percent = percent * status_init_size / 100.f;
         status_fn(static_cast<int>(std::round(n_percent)));
@@ -180,7 +393,7 @@ void Slic3r::its_quadric_edge_collapse(
     VertexInfos   v_infos;
     EdgeInfos     e_infos;
     Errors        errors;
-    std::tie(t_infos, v_infos, e_infos, errors) = init(its, throw_on_cancel, init_status_fn);
+    std::tie(t_infos, v_infos, e_infos, errors) = init(its, data, throw_on_cancel, init_status_fn);
     throw_on_cancel();
     status_fn(status_init_size);
 
@@ -342,8 +555,57 @@ void Slic3r::its_quadric_edge_collapse(
     }
 
     // compact triangle
-    compact(v_infos, t_infos, e_infos, its);
-    if (max_error != nullptr) *max_error = last_collapsed_error;
+    if (data == nullptr) {
+        compact(v_infos, t_infos, e_infos, its);
+        return last_collapsed_error;
+    }
+    compact(v_infos, t_infos, e_infos, its, &data->vertex_map);
+    data->quadrics.resize(its.vertices.size());
+    for (size_t vi = 0; vi < v_infos.size(); ++vi)
+        if (int vi_new = data->vertex_map[vi]; vi_new >= 0)
+            data->quadrics[vi_new] = v_infos[vi].q;
+    return last_collapsed_error;
+}
+
+std::pair<std::vector<uint32_t>, std::vector<uint32_t>>
+QuadricEdgeCollapse::partition(const indexed_triangle_set &its, int depth)
+{
+    std::vector<Vec3f> centroids(its.indices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()), [&](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++i) {
+            const Triangle &t = its.indices[i];
+            centroids[i] = (its.vertices[t[0]] + its.vertices[t[1]] + its.vertices[t[2]]) / 3.f;
+        }
+    });
+
+    std::vector<uint32_t> order(its.indices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<uint32_t> region_starts((size_t(1) << depth) + 1);
+    region_starts.back() = order.size();
+    // recursive split by median of centroids on the longest side of bounding box
+    std::function<void(uint32_t, uint32_t, int, size_t)> split =
+        [&](uint32_t begin, uint32_t end, int level, size_t region) {
+        if (level == depth) {
+            region_starts[region] = begin;
+            // keep order of triangles from its
+            std::sort(order.begin() + begin, order.begin() + end);
+            return;
+        }
+        Vec3f min = centroids[order[begin]], max = min;
+        for (uint32_t i = begin + 1; i < end; ++i) {
+            min = min.cwiseMin(centroids[order[i]]);
+            max = max.cwiseMax(centroids[order[i]]);
+        }
+        int axis;
+        (max - min).maxCoeff(&axis);
+        uint32_t mid = begin + (end - begin) / 2;
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                         [&centroids, axis](uint32_t t1, uint32_t t2) { return centroids[t1][axis] < centroids[t2][axis]; });
+        tbb::parallel_invoke([&]() { split(begin, mid, level + 1, 2 * region); },
+                             [&]() { split(mid, end, level + 1, 2 * region + 1); });
+    };
+    split(0, order.size(), 0, 0);
+    return {std::move(order), std::move(region_starts)};
 }
 
 Vec3d QuadricEdgeCollapse::create_normal(const Triangle &triangle,
@@ -438,13 +700,23 @@ SymMat QuadricEdgeCollapse::create_quadric(const Triangle &t,
 }
 
 std::tuple<TriangleInfos, VertexInfos, EdgeInfos, Errors> 
-QuadricEdgeCollapse::init(const indexed_triangle_set &its, ThrowOnCancel& throw_on_cancel, StatusFn& status_fn)
+QuadricEdgeCollapse::init(const indexed_triangle_set &its, const CollapseData *data, ThrowOnCancel& throw_on_cancel, StatusFn& status_fn)
 {
     int status_offset = 0;
     TriangleInfos t_infos(its.indices.size());
     VertexInfos   v_infos(its.vertices.size());
+    // quadrics accumulated by previous collapse are used instead of quadrics of triangles
+    const bool use_quadrics = data != nullptr && !data->quadrics.empty();
+    if (data != nullptr) {
+        assert(!use_quadrics || data->quadrics.size() == v_infos.size());
+        assert(data->fixed_vertices.empty() || data->fixed_vertices.size() == v_infos.size());
+        for (size_t i = 0; i < v_infos.size(); ++i) {
+            if (use_quadrics) v_infos[i].q = data->quadrics[i];
+            if (!data->fixed_vertices.empty()) v_infos[i].fixed = data->fixed_vertices[i];
+        }
+    }
     {
-        std::vector<SymMat> triangle_quadrics(its.indices.size());
+        std::vector<SymMat> triangle_quadrics(use_quadrics ? 0 : its.indices.size());
         // calculate normals
         tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size()),
         [&](const tbb::blocked_range<size_t> &range) {
@@ -453,7 +725,8 @@ QuadricEdgeCollapse::init(const indexed_triangle_set &its, ThrowOnCancel& throw_
                 TriangleInfo &  t_info = t_infos[i];
                 Vec3d           normal = create_normal(t, its.vertices);
                 t_info.n = normal.cast<float>();
-                triangle_quadrics[i] = create_quadric(t, normal, its.vertices);
+                if (!use_quadrics)
+                    triangle_quadrics[i] = create_quadric(t, normal, its.vertices);
                 if (i % 1000000 == 0) {
                     throw_on_cancel();
                     status_fn(status_offset + (i * status_normal_size) / its.indices.size());
@@ -465,10 +738,10 @@ QuadricEdgeCollapse::init(const indexed_triangle_set &its, ThrowOnCancel& throw_
         // sum quadrics
         for (size_t i = 0; i < its.indices.size(); i++) {
             const Triangle &t = its.indices[i];
-            const SymMat &  q = triangle_quadrics[i];
             for (size_t e = 0; e < 3; e++) {
                 VertexInfo &v_info = v_infos[t[e]];
-                v_info.q += q;
+                if (!use_quadrics)
+                    v_info.q += triangle_quadrics[i];
                 ++v_info.count; // triangle count
             }
             if (i % 1000000 == 0) {
@@ -707,6 +980,11 @@ Vec3d QuadricEdgeCollapse::calculate_3errors(const Triangle &   t,
         size_t   j2  = (j == 2) ? 0 : (j + 1);
         uint32_t vi0 = t[j];
         uint32_t vi1 = t[j2];
+        if (v_infos[vi0].fixed || v_infos[vi1].fixed) {
+            // never collapse
+            error[j] = std::numeric_limits<double>::max();
+            continue;
+        }
         SymMat   q(v_infos[vi0].q); // copy
         q += v_infos[vi1].q;
         error[j] = calculate_error(vi0, vi1, q, vertices);
@@ -836,12 +1114,15 @@ void QuadricEdgeCollapse::change_neighbors(EdgeInfos &     e_infos,
 void QuadricEdgeCollapse::compact(const VertexInfos &   v_infos,
                                   const TriangleInfos & t_infos,
                                   const EdgeInfos &     e_infos,
-                                  indexed_triangle_set &its)
+                                  indexed_triangle_set &its,
+                                  std::vector<int> *    vertex_map)
 {
+    if (vertex_map != nullptr) vertex_map->assign(v_infos.size(), -1);
     uint32_t vi_new = 0;
     for (uint32_t vi = 0; vi < v_infos.size(); ++vi) {
         const VertexInfo &v_info = v_infos[vi];
         if (v_info.is_deleted()) continue; // deleted
+        if (vertex_map != nullptr) (*vertex_map)[vi] = vi_new;
         uint32_t e_info_end = v_info.start + v_info.count;
         for (uint32_t ei = v_info.start; ei < e_info_end; ++ei) { 
             const EdgeInfo &e_info = e_infos[ei];
@@ -25,4 +25,28 @@ void its_quadric_edge_collapse(
     std::function<void(void)> throw_on_cancel = nullptr,
     std::function<void(int)>  statusfn        = nullptr);
 
+/// <summary>
+/// Simplify mesh by Quadric metric in parallel.
+/// Mesh is split into spatially compact regions collapsed concurrently with their shared
+/// vertices kept on place, the regions are stitched by a final collapse of the merged mesh.
+/// Quadrics are accumulated over both passes, so the error metric is the same as
+/// its_quadric_edge_collapse uses, only the order of collapses differs.
+/// Meshes too small to be split are simplified by its_quadric_edge_collapse.
+/// </summary>
+/// <param name="its">IN/OUT triangle mesh to be simplified.</param>
+/// <param name="triangle_count">Wanted triangle count.</param>
+/// <param name="max_error">Maximal Quadric for reduce.
+/// When nullptr then max float is used
+/// Output: Biggest used ErrorValue to collapse edge</param>
+/// <param name="throw_on_cancel">Could stop process of calculation,
+/// called from worker threads too.</param>
+/// <param name="statusfn">Give a feed back to user about progress. Values 1 - 100, never decrease.
+/// Called from worker threads too, but never concurrently.</param>
+void its_quadric_edge_collapse_par(
+    indexed_triangle_set &    its,
+    uint32_t                  triangle_count  = 0,
+    float *                   max_error       = nullptr,
+    std::function<void(void)> throw_on_cancel = nullptr,
+    std::function<void(int)>  statusfn        = nullptr);
+
 } // namespace Slic3r
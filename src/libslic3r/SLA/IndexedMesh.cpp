@@ -16,7 +16,7 @@ namespace sla {
 
 class IndexedMesh::AABBImpl {
 private:
-    AABBTreeIndirect::Tree3f m_tree;
+    AABBTreeIndirect::WideTree3f m_tree;
     double                   m_triangle_ray_epsilon;
 
 public:
@@ -29,7 +29,7 @@ public:
             if (l > 0)
                 m_triangle_ray_epsilon = 0.000001 * l * l;
         }
-        m_tree = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(
+        m_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(
             its.vertices, its.indices);
     }
 
@@ -205,6 +205,73 @@ IndexedMesh::query_ray_hits(const Vec3d &s, const Vec3d &dir) const
     return outs;
 }
 
+// Sorting key of a ray: the octant of its direction in the top bits, then the Morton code
+// of its source quantized to 20 bits per axis over the bounding box of all the sources.
+static uint64_t ray_coherence_key(const Vec3d &s, const Vec3d &dir, const BoundingBoxf3 &bbox)
+{
+    static constexpr uint64_t max_coord = (uint64_t(1) << 20) - 1;
+    const Vec3d size = bbox.size();
+    uint64_t key = (dir.x() < 0 ? 4 : 0) | (dir.y() < 0 ? 2 : 0) | (dir.z() < 0 ? 1 : 0);
+    uint64_t coords[3];
+    for (int i = 0; i < 3; ++ i)
+        coords[i] = size(i) > 0. ? std::min(max_coord, uint64_t((s(i) - bbox.min(i)) / size(i) * double(max_coord))) : 0;
+    for (int bit = 19; bit >= 0; -- bit)
+        for (int i = 0; i < 3; ++ i)
+            key = (key << 1) | ((coords[i] >> bit) & 1);
+    return key;
+}
+
+IndexedMesh::RayHits
+IndexedMesh::query_ray_hit(const std::vector<Vec3d> &sources,
+                           const std::vector<Vec3d> &dirs,
+                           std::function<void()>     throw_on_cancel) const
+{
+    assert(sources.size() == dirs.size());
+    RayHits out;
+    out.distances.assign(sources.size(), hit_result::infty());
+    out.face_ids.assign(sources.size(), -1);
+
+    // Rays are cast in blocks of this size, a worker thread synchronizes and checks for cancellation once per block.
+    static constexpr size_t block_size = 256;
+
+    // Order of casting the rays. Sorting pays off only if there are more rays than a single block.
+    std::vector<size_t> order(sources.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (sources.size() > block_size) {
+        BoundingBoxf3 bbox(sources);
+        std::vector<uint64_t> keys(sources.size());
+        ccr::for_each(size_t(0), sources.size(), [&](size_t idx) {
+            keys[idx] = ray_coherence_key(sources[idx], dirs[idx], bbox);
+        }, block_size);
+        std::sort(order.begin(), order.end(), [&keys](size_t l, size_t r) { return keys[l] < keys[r]; });
+    }
+
+    ccr::for_each(size_t(0), (order.size() + block_size - 1) / block_size,
+        [this, &sources, &dirs, &order, &out, &throw_on_cancel](size_t block_idx) {
+            throw_on_cancel();
+            for (size_t i = block_idx * block_size; i < std::min(order.size(), (block_idx + 1) * block_size); ++ i) {
+                const size_t idx = order[i];
+#ifdef SLIC3R_HOLE_RAYCASTER
+                if (! m_holes.empty()) {
+                    hit_result hit = query_ray_hit(sources[idx], dirs[idx]);
+                    out.distances[idx] = hit.distance();
+                    out.face_ids[idx]  = hit.face();
+                    continue;
+                }
+#endif
+                assert(is_approx(dirs[idx].norm(), 1.));
+                igl::Hit hit{-1, -1, 0.f, 0.f, std::numeric_limits<float>::infinity()};
+                m_aabb->intersect_ray(*m_tm, sources[idx], dirs[idx], hit);
+                if (!std::isinf(hit.t) && !std::isnan(hit.t)) {
+                    out.distances[idx] = double(hit.t);
+                    out.face_ids[idx]  = hit.id;
+                }
+            }
+        });
+
+    return out;
+}
+
 
 #ifdef SLIC3R_HOLE_RAYCASTER
 IndexedMesh::hit_result IndexedMesh::filter_hits(
@@ -1,6 +1,7 @@
 #ifndef SLA_INDEXEDMESH_H
 #define SLA_INDEXEDMESH_H
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -127,6 +128,28 @@ public:
     // Casts a ray on the mesh and returns all hits
     std::vector<hit_result> query_ray_hits(const Vec3d &s, const Vec3d &dir) const;
 
+    // Results of a batch of raycasts, one entry per ray.
+    struct RayHits {
+        // Distance from the source to the intersection, hit_result::infty() if the ray missed the mesh.
+        std::vector<double> distances;
+        // Index of the face hit, -1 if the ray missed the mesh.
+        std::vector<int>    face_ids;
+
+        size_t size() const { return distances.size(); }
+        bool   is_hit(size_t idx) const { return face_ids[idx] >= 0 && !std::isinf(distances[idx]); }
+    };
+
+    // Casting many rays on the mesh at once, one normalized direction per source.
+    // Returns the same hits as query_ray_hit() would for each ray. The rays are sorted by their
+    // direction and the location of their source, so that the neighboring rays traverse the same
+    // branches of the AABB tree, and cast in parallel.
+    // Worth it for the rays known up front by the thousand, the support point generator. The few rays
+    // cast per optimizer step by the support tree builder need the hit normals and a follow-up cast
+    // depending on the first hit, they use the single ray query_ray_hit().
+    RayHits query_ray_hit(const std::vector<Vec3d> &sources,
+                          const std::vector<Vec3d> &dirs,
+                          std::function<void()> throw_on_cancel = [](){}) const;
+
     double squared_distance(const Vec3d& p, int& i, Vec3d& c) const;
     inline double squared_distance(const Vec3d &p) const
     {
@@ -89,29 +89,27 @@ void SupportPointGenerator::project_onto_mesh(std::vector<sla::SupportPoint>& po
 {
     // The function  makes sure that all the points are really exactly placed on the mesh.
 
-    // Use a reasonable granularity to account for the worker thread synchronization cost.
-    static constexpr size_t gransize = 64;
-
-    ccr_par::for_each(size_t(0), points.size(), [this, &points](size_t idx)
-    {
-        if ((idx % 16) == 0)
-            // Don't call the following function too often as it flushes CPU write caches due to synchronization primitves.
-            m_throw_on_cancel();
-
-        Vec3f& p = points[idx].pos;
-        // Project the point upward and downward and choose the closer intersection with the mesh.
-        sla::IndexedMesh::hit_result hit_up   = m_emesh.query_ray_hit(p.cast<double>(), Vec3d(0., 0., 1.));
-        sla::IndexedMesh::hit_result hit_down = m_emesh.query_ray_hit(p.cast<double>(), Vec3d(0., 0., -1.));
-
-        bool up   = hit_up.is_hit();
-        bool down = hit_down.is_hit();
-
-        if (!up && !down)
-            return;
-
-        sla::IndexedMesh::hit_result& hit = (!down || (hit_up.distance() < hit_down.distance())) ? hit_up : hit_down;
-        p = p + (hit.distance() * hit.direction()).cast<float>();
-    }, gransize);
+    // Project the points upward and downward, all the rays are cast in a single batch.
+    std::vector<Vec3d> sources, dirs;
+    sources.reserve(2 * points.size());
+    dirs.reserve(2 * points.size());
+    for (const sla::SupportPoint &pt : points) {
+        sources.emplace_back(pt.pos.cast<double>());
+        dirs.emplace_back(0., 0., 1.);
+        sources.emplace_back(pt.pos.cast<double>());
+        dirs.emplace_back(0., 0., -1.);
+    }
+    sla::IndexedMesh::RayHits hits = m_emesh.query_ray_hit(sources, dirs, m_throw_on_cancel);
+
+    for (size_t idx = 0; idx < points.size(); ++ idx) {
+        // Choose the closer intersection with the mesh.
+        const size_t up   = 2 * idx;
+        const size_t down = up + 1;
+        if (!hits.is_hit(up) && !hits.is_hit(down))
+            continue;
+        const size_t hit = (!hits.is_hit(down) || (hits.distances[up] < hits.distances[down])) ? up : down;
+        points[idx].pos += (hits.distances[hit] * dirs[hit]).cast<float>();
+    }
 }
 
 static std::vector<SupportPointGenerator::MyLayer> make_layers(
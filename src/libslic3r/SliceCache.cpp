@@ -0,0 +1,169 @@
+#include "libslic3r.h"
+#include "SliceCache.hpp"
+#include "Model.hpp"
+#include "PrintConfig.hpp"
+
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/log/trivial.hpp>
+
+namespace Slic3r {
+
+namespace {
+
+const char SLICE_CACHE_MAGIC[8] = { 'X', 'D', 'S', 'L', 'I', 'C', 'E', '\0' };
+
+void hash_config(CacheHasher &hasher, const ConfigBase &config)
+{
+    // The keys are sorted, the serialized values do not depend on the locale.
+    t_config_option_keys keys = config.keys();
+    hasher.update_pod(uint64_t(keys.size()));
+    for (const t_config_option_key &opt_key : keys) {
+        hasher.update(opt_key);
+        hasher.update(config.opt_serialize(opt_key));
+    }
+}
+
+void hash_matrix(CacheHasher &hasher, const Transform3d &m)
+{
+    hasher.update(m.matrix().data(), m.matrix().size() * sizeof(double));
+}
+
+void hash_facets(CacheHasher &hasher, const FacetsAnnotation &facets)
+{
+    const auto &[triangles, bitstream] = facets.get_data();
+    hasher.update_pod(uint64_t(triangles.size()));
+    hasher.update(triangles.data(), triangles.size() * sizeof(std::pair<int, int>));
+    std::string bits(bitstream.size(), '0');
+    for (size_t i = 0; i < bitstream.size(); ++ i)
+        if (bitstream[i])
+            bits[i] = '1';
+    hasher.update(bits);
+}
+
+std::string slice_cache_path(const std::string &dir, const CacheDigest &key)
+{
+    return (boost::filesystem::path(dir) / (key.hex() + ".slice")).string();
+}
+
+template<typename T> bool read_pod(std::istream &in, T &value) { return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T))); }
+
+} // namespace
+
+CacheDigest slice_cache_key(const Model &model, const DynamicPrintConfig &config, const std::string &extra)
+{
+    CacheHasher hasher;
+    hasher.update_pod(SLICE_CACHE_VERSION);
+    hash_config(hasher, config);
+    hasher.update(extra);
+    hasher.update_pod(uint64_t(model.objects.size()));
+    for (const ModelObject *object : model.objects) {
+        // Names of the objects end up in the G-code, labeling the objects.
+        hasher.update(object->name);
+        hash_config(hasher, object->config.get());
+        hasher.update_pod(uint64_t(object->layer_config_ranges.size()));
+        for (const auto &[range, range_config] : object->layer_config_ranges) {
+            hasher.update_pod(range.first);
+            hasher.update_pod(range.second);
+            hash_config(hasher, range_config.get());
+        }
+        std::vector<coordf_t> layer_height_profile = object->layer_height_profile.get();
+        hasher.update_pod(uint64_t(layer_height_profile.size()));
+        hasher.update(layer_height_profile.data(), layer_height_profile.size() * sizeof(coordf_t));
+        hasher.update_pod(uint64_t(object->instances.size()));
+        for (const ModelInstance *instance : object->instances) {
+            hasher.update_pod(instance->printable);
+            hash_matrix(hasher, instance->get_matrix());
+        }
+        hasher.update_pod(uint64_t(object->volumes.size()));
+        for (const ModelVolume *volume : object->volumes) {
+            const indexed_triangle_set &its = volume->mesh().its;
+            hasher.update(volume->name);
+            hasher.update_pod(int(volume->type()));
+            hasher.update_pod(uint64_t(its.vertices.size()));
+            hasher.update(its.vertices.data(), its.vertices.size() * sizeof(stl_vertex));
+            hasher.update_pod(uint64_t(its.indices.size()));
+            hasher.update(its.indices.data(), its.indices.size() * sizeof(stl_triangle_vertex_indices));
+            hash_matrix(hasher, volume->get_matrix());
+            hash_config(hasher, volume->config.get());
+            hash_facets(hasher, volume->supported_facets);
+            hash_facets(hasher, volume->seam_facets);
+            hash_facets(hasher, volume->mmu_segmentation_facets);
+        }
+    }
+    return hasher.digest();
+}
+
+bool load_slice_cache(const std::string &dir, const CacheDigest &key, SlicedFiles &files)
+{
+    files.clear();
+    if (dir.empty())
+        return false;
+    std::string path = slice_cache_path(dir, key);
+    boost::system::error_code ec;
+    if (! boost::filesystem::exists(path, ec))
+        return false;
+
+    auto read_files = [&path, &key, &files]() {
+        boost::system::error_code ec;
+        uint64_t file_size = boost::filesystem::file_size(path, ec);
+        boost::filesystem::ifstream in(path, std::ios::binary);
+        char        magic[sizeof(SLICE_CACHE_MAGIC)];
+        uint32_t    version;
+        CacheDigest stored_key;
+        uint32_t    num_files;
+        if (ec || ! in.read(magic, sizeof(magic)) || memcmp(magic, SLICE_CACHE_MAGIC, sizeof(magic)) != 0 ||
+            ! read_pod(in, version) || version != SLICE_CACHE_VERSION ||
+            ! read_pod(in, stored_key.bytes) || stored_key != key ||
+            ! read_pod(in, num_files) || num_files > 16)
+            return false;
+        files.assign(num_files, {});
+        for (auto &[extension, content] : files) {
+            uint32_t extension_size;
+            uint64_t content_size;
+            if (! read_pod(in, extension_size) || extension_size > 16)
+                return false;
+            extension.resize(extension_size);
+            // The size is checked against the file size before allocating the content.
+            if (! in.read(extension.data(), extension_size) || ! read_pod(in, content_size) || content_size > file_size)
+                return false;
+            content.resize(content_size);
+            if (! in.read(content.data(), content_size))
+                return false;
+        }
+        return true;
+    };
+    if (! read_files()) {
+        files.clear();
+        return false;
+    }
+
+    touch_cache_file(path);
+    BOOST_LOG_TRIVIAL(info) << "Loaded the sliced files from " << path;
+    return true;
+}
+
+void store_slice_cache(const std::string &dir, const CacheDigest &key, const SlicedFiles &files, uint64_t max_size)
+{
+    if (dir.empty())
+        return;
+    bool written = write_cache_file(slice_cache_path(dir, key), [&key, &files](std::ostream &out) {
+        auto write_pod = [&out](const auto &value) { out.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        out.write(SLICE_CACHE_MAGIC, sizeof(SLICE_CACHE_MAGIC));
+        write_pod(SLICE_CACHE_VERSION);
+        write_pod(key.bytes);
+        write_pod(uint32_t(files.size()));
+        for (const auto &[extension, content] : files) {
+            write_pod(uint32_t(extension.size()));
+            out.write(extension.data(), extension.size());
+            write_pod(uint64_t(content.size()));
+            out.write(content.data(), content.size());
+        }
+    });
+    if (written)
+        evict_cache_files(dir, ".slice", max_size);
+}
+
+} // namespace Slic3r
@@ -0,0 +1,36 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include "CacheFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Slic3r {
+
+class DynamicPrintConfig;
+class Model;
+
+// Version of the slice cache format, cache files of other versions are ignored.
+constexpr uint32_t SLICE_CACHE_VERSION          = 1;
+constexpr uint64_t SLICE_CACHE_DEFAULT_MAX_SIZE = uint64_t(4) << 30;
+
+// Files exported by slicing a model, pairs of the file extension (".gcode", ".zaxe") and the file content.
+using SlicedFiles = std::vector<std::pair<std::string, std::string>>;
+
+// Digest of everything the exported files depend on: the content of the arranged model (meshes, transformations,
+// per object / volume / layer range configs, variable layer height, painted facets, names) and the full print config.
+// Extra is hashed as well, for example the name of an archive, which is stored inside the archive.
+CacheDigest slice_cache_key(const Model &model, const DynamicPrintConfig &config, const std::string &extra = std::string());
+
+// Loads the files stored for the key in dir. Returns false if none were stored
+// or if the cache file was written by another version or for another key.
+bool        load_slice_cache(const std::string &dir, const CacheDigest &key, SlicedFiles &files);
+// Stores the files for the key, then evicts the least recently used cache files of dir until they fit max_size.
+void        store_slice_cache(const std::string &dir, const CacheDigest &key, const SlicedFiles &files, uint64_t max_size = SLICE_CACHE_DEFAULT_MAX_SIZE);
+
+} // namespace Slic3r
+
+#endif // slic3r_SliceCache_hpp_
@@ -6,6 +6,8 @@
 #include "PrintConfig.hpp"
 #include "Model.hpp"
 
+#include <tbb/parallel_for.h>
+
 // #define SLIC3R_DEBUG
 
 // Make assert active if SLIC3R_DEBUG
@@ -224,6 +226,11 @@ std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slici
     as.prepare(object);
 
     // 2) Generate layers using the algorithm of @platsch 
+    return layer_height_profile_adaptive(slicing_params, as, quality_factor);
+}
+
+std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slicing_params, const SlicingAdaptive& as, float quality_factor)
+{
     std::vector<double> layer_height_profile;
     layer_height_profile.push_back(0.0);
     layer_height_profile.push_back(slicing_params.first_object_layer_height);
@@ -232,14 +239,12 @@ std::vector<double> layer_height_profile_adaptive(const SlicingParameters& slici
         layer_height_profile.push_back(slicing_params.first_object_layer_height);
     }
     double print_z = slicing_params.first_object_layer_height;
-    // last facet visited by the as.next_layer_height() function, where the facets are sorted by their increasing Z span.
-    size_t current_facet = 0;
     // loop until we have at least one layer and the max slice_z reaches the object height
     while (print_z + EPSILON < slicing_params.object_print_z_height()) {
         float height = slicing_params.max_layer_height;
         // Slic3r::debugf "\n Slice layer: %d\n", $id;
         // determine next layer height
-        float cusp_height = as.next_layer_height(float(print_z), quality_factor, current_facet);
+        float cusp_height = as.next_layer_height(float(print_z), quality_factor);
 
 #if 0
         // check for horizontal features and object size
@@ -337,15 +342,9 @@ std::vector<double> smooth_height_profile(const std::vector<double>& profile, co
         std::vector<double> kernel = gauss_kernel(radius);
         int two_radius = 2 * (int)radius;
 
-        std::vector<double> ret;
-        size_t size = profile.size();
-        ret.reserve(size);
-
         // leave first layer untouched
-        for (size_t i = 0; i < skip_count; ++i)
-        {
-            ret.push_back(profile[i]);
-        }
+        std::vector<double> ret = profile;
+        size_t size = profile.size();
 
         // smooth the rest of the profile by biasing a gaussian blur
         // the bias moves the smoothed profile closer to the min_layer_height
@@ -353,33 +352,35 @@ std::vector<double> smooth_height_profile(const std::vector<double>& profile, co
         double inv_delta_h = (delta_h != 0.0) ? 1.0 / delta_h : 1.0;
 
         double max_dz_band = (double)radius * slicing_params.layer_height;
-        for (size_t i = skip_count; i < size; i += 2)
-        {
-            double zi = profile[i];
-            double hi = profile[i + 1];
-            ret.push_back(zi);
-            ret.push_back(0.0);
-            double& height = ret.back();
-            int begin = std::max((int)i - two_radius, (int)skip_count);
-            int end = std::min((int)i + two_radius, (int)size - 2);
-            double weight_total = 0.0;
-            for (int j = begin; j <= end; j += 2)
+        // the layers are smoothed independently of each other, reading the input profile only
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, (size - skip_count) / 2), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = skip_count + 2 * range.begin(); i < skip_count + 2 * range.end(); i += 2)
             {
-                int kernel_id = radius + (j - (int)i) / 2;
-                double dz = std::abs(zi - profile[j]);
-                if (dz * slicing_params.layer_height <= max_dz_band)
+                double zi = profile[i];
+                double hi = profile[i + 1];
+                double height = 0.0;
+                int begin = std::max((int)i - two_radius, (int)skip_count);
+                int end = std::min((int)i + two_radius, (int)size - 2);
+                double weight_total = 0.0;
+                for (int j = begin; j <= end; j += 2)
                 {
-                    double dh = std::abs(slicing_params.max_layer_height - profile[j + 1]);
-                    double weight = kernel[kernel_id] * sqrt(dh * inv_delta_h);
-                    height += weight * profile[j + 1];
-                    weight_total += weight;
+                    int kernel_id = radius + (j - (int)i) / 2;
+                    double dz = std::abs(zi - profile[j]);
+                    if (dz * slicing_params.layer_height <= max_dz_band)
+                    {
+                        double dh = std::abs(slicing_params.max_layer_height - profile[j + 1]);
+                        double weight = kernel[kernel_id] * sqrt(dh * inv_delta_h);
+                        height += weight * profile[j + 1];
+                        weight_total += weight;
+                    }
                 }
-            }
 
-            height = std::clamp(weight_total == 0 ? hi : height / weight_total, slicing_params.min_layer_height, slicing_params.max_layer_height);
-            if (smoothing_params.keep_min)
-                height = std::min(height, hi);
-        }
+                height = std::clamp(weight_total == 0 ? hi : height / weight_total, slicing_params.min_layer_height, slicing_params.max_layer_height);
+                if (smoothing_params.keep_min)
+                    height = std::min(height, hi);
+                ret[i + 1] = height;
+            }
+        });
 
         return ret;
     };
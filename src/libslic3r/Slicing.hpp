@@ -19,6 +19,7 @@ class PrintConfig;
 class PrintObjectConfig;
 class ModelConfig;
 class ModelObject;
+class SlicingAdaptive;
 class DynamicPrintConfig;
 
 // Parameters to guide object slicing and support generation.
@@ -137,6 +138,12 @@ extern std::vector<double> layer_height_profile_adaptive(
     const SlicingParameters& slicing_params,
     const ModelObject& object, float quality_factor);
 
+// Same as above, reusing the faces of an object collected and indexed by SlicingAdaptive::prepare(),
+// to recalculate the profile for another quality factor quickly.
+extern std::vector<double> layer_height_profile_adaptive(
+    const SlicingParameters& slicing_params,
+    const SlicingAdaptive& slicing_adaptive, float quality_factor);
+
 struct HeightProfileSmoothingParams
 {
     unsigned int radius;
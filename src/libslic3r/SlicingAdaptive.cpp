@@ -6,6 +6,9 @@
 #include <boost/log/trivial.hpp>
 #include <cfloat>
 
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
 // Based on the work of Florens Waserfall (@platch on github)
 // and his paper
 // Florens Wasserfall, Norman Hendrich, Jianwei Zhang:
@@ -70,6 +73,32 @@ static inline float layer_height_from_slope(const SlicingAdaptive::FaceZ &face,
 void SlicingAdaptive::clear()
 {
 	m_faces.clear();
+	m_faces_height.clear();
+	m_faces_height_block_min.clear();
+	m_spanning_z.clear();
+	m_spanning_height.clear();
+	m_volumes.clear();
+	m_trafos.clear();
+}
+
+// Volumes and transformations of the model parts of an object, from which SlicingAdaptive::prepare() collects the faces.
+static void object_volumes_and_trafos(const ModelObject &object, std::vector<ObjectID> &volumes, std::vector<Transform3d> &trafos)
+{
+	for (const ModelVolume *v : object.volumes)
+		if (v->is_model_part()) {
+			volumes.emplace_back(v->id());
+			trafos.emplace_back(v->get_matrix());
+		}
+	trafos.emplace_back(object.instances.front()->get_matrix());
+}
+
+bool SlicingAdaptive::prepared_for(const ModelObject &object) const
+{
+	std::vector<ObjectID>    volumes;
+	std::vector<Transform3d> trafos;
+	object_volumes_and_trafos(object, volumes, trafos);
+	return volumes == m_volumes && trafos.size() == m_trafos.size() &&
+		std::equal(trafos.begin(), trafos.end(), m_trafos.begin(), [](const Transform3d &t1, const Transform3d &t2) { return t1.matrix() == t2.matrix(); });
 }
 
 void SlicingAdaptive::prepare(const ModelObject &object)
@@ -79,28 +108,88 @@ void SlicingAdaptive::prepare(const ModelObject &object)
     TriangleMesh		 mesh			= object.raw_mesh();
     const ModelInstance &first_instance = *object.instances.front();
     mesh.transform(first_instance.get_matrix(), first_instance.is_left_handed());
+    object_volumes_and_trafos(object, m_volumes, m_trafos);
 
     // 1) Collect faces from mesh.
-    m_faces.reserve(mesh.facets_count());
-	for (stl_triangle_vertex_indices face : mesh.its.indices) {
-		stl_vertex vertex[3] = { mesh.its.vertices[face[0]], mesh.its.vertices[face[1]], mesh.its.vertices[face[2]] };
-		stl_vertex n         = face_normal_normalized(vertex);
-		std::pair<float, float> face_z_span {
-			std::min(std::min(vertex[0].z(), vertex[1].z()), vertex[2].z()),
-			std::max(std::max(vertex[0].z(), vertex[1].z()), vertex[2].z())
-		};
-		m_faces.emplace_back(FaceZ({ face_z_span, std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) }));
-    }
+    m_faces.assign(mesh.facets_count(), FaceZ());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_faces.size()), [&mesh, this](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            const stl_triangle_vertex_indices &face = mesh.its.indices[i];
+			stl_vertex vertex[3] = { mesh.its.vertices[face[0]], mesh.its.vertices[face[1]], mesh.its.vertices[face[2]] };
+			stl_vertex n         = face_normal_normalized(vertex);
+			std::pair<float, float> face_z_span {
+				std::min(std::min(vertex[0].z(), vertex[1].z()), vertex[2].z()),
+				std::max(std::max(vertex[0].z(), vertex[1].z()), vertex[2].z())
+			};
+			m_faces[i] = FaceZ({ face_z_span, std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) });
+        }
+    });
 
 	// 2) Sort faces lexicographically by their Z span.
-	std::sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
+	tbb::parallel_sort(m_faces.begin(), m_faces.end(), [](const FaceZ &f1, const FaceZ &f2) { return f1.z_span < f2.z_span; });
+
+	// 3) Layer heights allowed by the faces for a unit surface deviation and their minima over blocks of faces.
+	m_faces_height.assign(m_faces.size(), 0.f);
+	m_faces_height_block_min.assign((m_faces.size() + FACES_BLOCK - 1) / FACES_BLOCK, 0.f);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_faces_height_block_min.size()), [this](const tbb::blocked_range<size_t> &range) {
+        for (size_t iblock = range.begin(); iblock < range.end(); ++ iblock) {
+        	float block_min = FLT_MAX;
+        	for (size_t i = iblock * FACES_BLOCK; i < std::min((iblock + 1) * FACES_BLOCK, m_faces.size()); ++ i) {
+        		m_faces_height[i] = layer_height_from_slope(m_faces[i], 1.f);
+        		block_min = std::min(block_min, m_faces_height[i]);
+        	}
+        	m_faces_height_block_min[iblock] = block_min;
+        }
+    });
+
+	// 4) Minimum layer height over the faces spanning a print_z as a step function of print_z.
+	// A face spans print_z if it starts below print_z and it ends at least EPSILON above print_z,
+	// faces touching print_z from below are skipped as they could otherwise cause small cusp values.
+	auto face_top = [this](size_t iface) { return double(m_faces[iface].z_span.second) - EPSILON; };
+	// Boundaries of the cells (zs[i], zs[i + 1]], over which the set of spanning faces does not change.
+	std::vector<double> zs;
+	{
+		std::vector<double> bottoms, tops;
+		for (size_t i = 0; i < m_faces.size(); ++ i)
+			if (double(m_faces[i].z_span.first) < face_top(i)) {
+				bottoms.emplace_back(m_faces[i].z_span.first);
+				tops.emplace_back(face_top(i));
+			}
+		tbb::parallel_sort(tops.begin(), tops.end());
+		zs.assign(bottoms.size() + tops.size(), 0.);
+		std::merge(bottoms.begin(), bottoms.end(), tops.begin(), tops.end(), zs.begin());
+		zs.erase(std::unique(zs.begin(), zs.end()), zs.end());
+	}
+	// Sweep the cells bottom up, keeping the faces spanning the current cell in a heap ordered by their layer height.
+	// Faces ending below the current cell are removed lazily once they get to the top of the heap.
+	auto higher = [this](size_t iface1, size_t iface2) { return m_faces_height[iface1] > m_faces_height[iface2]; };
+	std::vector<size_t> spanning;
+	size_t              iface = 0;
+	for (size_t icell = 0; icell + 1 < zs.size(); ++ icell) {
+		for (; iface < m_faces.size() && double(m_faces[iface].z_span.first) <= zs[icell]; ++ iface)
+			if (double(m_faces[iface].z_span.first) < face_top(iface)) {
+				spanning.emplace_back(iface);
+				std::push_heap(spanning.begin(), spanning.end(), higher);
+			}
+		while (! spanning.empty() && face_top(spanning.front()) <= zs[icell]) {
+			std::pop_heap(spanning.begin(), spanning.end(), higher);
+			spanning.pop_back();
+		}
+		float height = spanning.empty() ? FLT_MAX : m_faces_height[spanning.front()];
+		if (m_spanning_height.empty() || m_spanning_height.back() != height) {
+			if (m_spanning_z.empty())
+				m_spanning_z.emplace_back(zs[icell]);
+			m_spanning_z.emplace_back(zs[icell + 1]);
+			m_spanning_height.emplace_back(height);
+		} else
+			// Merge the neighbor cells of the same layer height.
+			m_spanning_z.back() = zs[icell + 1];
+	}
 }
 
-// current_facet is in/out parameter, rememebers the index of the last face of m_faces visited, 
-// where this function will start from.
 // print_z - the top print surface of the previous layer.
 // returns height of the next layer.
-float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor, size_t &current_facet)
+float SlicingAdaptive::next_layer_height(const float print_z, float quality_factor) const
 {
 	float  height = (float)m_slicing_params.max_layer_height;
 
@@ -123,48 +212,36 @@ float SlicingAdaptive::next_layer_height(const float print_z, float quality_fact
 	    	lerp(delta_max, delta_mid, 2. * (1. - quality_factor));
 	}
 	
-	// find all facets intersecting the slice-layer
-	size_t ordered_id = current_facet;
-	{
-		bool first_hit = false;
-		for (; ordered_id < m_faces.size(); ++ ordered_id) {
-	        const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
-	        // facet's minimum is higher than slice_z -> end loop
-			if (zspan.first >= print_z)
-				break;
-			// facet's maximum is higher than slice_z -> store the first event for next cusp_height call to begin at this point
-			if (zspan.second > print_z) {
-				// first event?
-				if (! first_hit) {
-					first_hit = true;
-					current_facet = ordered_id;
-	            }
-				// skip touching facets which could otherwise cause small cusp values
-				if (zspan.second < print_z + EPSILON)
-					continue;
-				// compute cusp-height for this facet and store minimum of all heights
-				height = std::min(height, layer_height_from_slope(m_faces[ordered_id], max_surface_deviation));
-	        }
-		}
-	}
+	// find the minimum cusp-height of all facets intersecting the slice-layer
+	if (auto it = std::lower_bound(m_spanning_z.begin(), m_spanning_z.end(), double(print_z)); it != m_spanning_z.begin() && it != m_spanning_z.end())
+		height = std::min(height, max_surface_deviation * m_spanning_height[it - m_spanning_z.begin() - 1]);
 
 	// lower height limit due to printer capabilities
 	height = std::max(height, float(m_slicing_params.min_layer_height));
 
 	// check for sloped facets inside the determined layer and correct height if necessary
 	if (height > float(m_slicing_params.min_layer_height)) {
-		for (; ordered_id < m_faces.size(); ++ ordered_id) {
+		size_t ordered_id = std::lower_bound(m_faces.begin(), m_faces.end(), print_z, [](const FaceZ &face, float z) { return face.z_span.first < z; }) - m_faces.begin();
+		while (ordered_id < m_faces.size()) {
             const std::pair<float, float> &zspan = m_faces[ordered_id].z_span;
             // facet's minimum is higher than slice_z + height -> end loop
 			if (zspan.first >= print_z + height)
 				break;
 
+			if (ordered_id % FACES_BLOCK == 0 && max_surface_deviation * m_faces_height_block_min[ordered_id / FACES_BLOCK] >= height) {
+				// No facet of this block reduces the layer height, neither by its slope nor by its distance from print_z.
+				ordered_id += FACES_BLOCK;
+				continue;
+			}
+
 			// skip touching facets which could otherwise cause small cusp values
-			if (zspan.second < print_z + EPSILON)
+			if (zspan.second < print_z + EPSILON) {
+				++ ordered_id;
 				continue;
+			}
 
 			// Compute cusp-height for this facet and check against height.
-            float reduced_height = layer_height_from_slope(m_faces[ordered_id], max_surface_deviation);
+            float reduced_height = max_surface_deviation * m_faces_height[ordered_id];
 
 			float z_diff = zspan.first - print_z;
 			if (reduced_height < z_diff) {
@@ -183,6 +260,7 @@ float SlicingAdaptive::next_layer_height(const float print_z, float quality_fact
 #endif /* ADAPTIVE_LAYER_HEIGHT_DEBUG */
 				height = reduced_height;
 			}
+			++ ordered_id;
 		}
 		// lower height limit due to printer capabilities again
 		height = std::max(height, float(m_slicing_params.min_layer_height));
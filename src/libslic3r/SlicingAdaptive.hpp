@@ -4,6 +4,8 @@
 #define slic3r_SlicingAdaptive_hpp_
 
 #include "Slicing.hpp"
+#include "Point.hpp"
+#include "ObjectID.hpp"
 #include "admesh/stl.h"
 
 namespace Slic3r
@@ -16,11 +18,16 @@ class SlicingAdaptive
 public:
     void  clear();
     void  set_slicing_parameters(SlicingParameters params) { m_slicing_params = params; }
+    // Collect the faces of the object and index them by Z. The index does not depend on the quality,
+    // thus a prepared SlicingAdaptive may be reused to calculate layer heights for many quality values.
     void  prepare(const ModelObject &object);
+    // Was this SlicingAdaptive prepared for the current volumes and transformations of the object?
+    // A volume keeps its ObjectID until its mesh is replaced, see ModelVolume::set_new_unique_id().
+    bool  prepared_for(const ModelObject &object) const;
     // Return next layer height starting from the last print_z, using a quality measure
     // (quality in range from 0 to 1, 0 - highest quality at low layer heights, 1 - lowest print quality at high layer heights).
     // The layer height curve shall be centered roughly around the default profile's layer height for quality 0.5.
-	float next_layer_height(const float print_z, float quality, size_t &current_facet);
+	float next_layer_height(const float print_z, float quality) const;
     float horizontal_facet_distance(float z);
 
 	struct FaceZ {
@@ -34,7 +41,22 @@ public:
 protected:
 	SlicingParameters 		m_slicing_params;
 
+	// Sorted lexicographically by their Z span.
 	std::vector<FaceZ>		m_faces;
+	// Layer height allowed by each face of m_faces for a unit surface deviation.
+	// The layer height allowed by a face is linear in the surface deviation.
+	std::vector<float>		m_faces_height;
+	// Minimum of m_faces_height over blocks of FACES_BLOCK faces, to skip blocks of faces not limiting the layer height.
+	std::vector<float>		m_faces_height_block_min;
+	static constexpr size_t FACES_BLOCK = 64;
+	// Minimum of m_faces_height over the faces spanning print_z, as a step function of print_z:
+	// m_spanning_height[i] applies to print_z in (m_spanning_z[i], m_spanning_z[i + 1]].
+	std::vector<double>		m_spanning_z;
+	std::vector<float>		m_spanning_height;
+
+	// Volumes and transformations the faces were collected from, see prepared_for().
+	std::vector<ObjectID>	m_volumes;
+	std::vector<Transform3d> m_trafos;
 };
 
 }; // namespace Slic3r
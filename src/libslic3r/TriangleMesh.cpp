@@ -20,12 +20,20 @@
 #include <vector>
 #include <utility>
 #include <algorithm>
+#include <atomic>
 #include <type_traits>
+#include <unordered_map>
 
 #include <boost/log/trivial.hpp>
 #include <boost/nowide/cstdio.hpp>
 #include <boost/predef/other/endian.h>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_scan.h>
+#include <tbb/parallel_sort.h>
+
 #include <Eigen/Core>
 #include <Eigen/Dense>
 
@@ -47,8 +55,8 @@ static void fill_initial_stats(const indexed_triangle_set &its, TriangleMeshStat
     out.volume              = its_volume(its);
     update_bounding_box(its, out);
 
-    const std::vector<Vec3i> face_neighbors = its_face_neighbors(its);
-    out.number_of_parts = its_number_of_patches(its, face_neighbors);
+    const std::vector<Vec3i> face_neighbors = its_face_neighbors_par(its);
+    out.number_of_parts = its_number_of_patches_par(its, face_neighbors);
     out.open_edges      = its_num_open_edges(face_neighbors);
 }
 
@@ -177,11 +185,92 @@ static void trianglemesh_repair_on_import(stl_file &stl)
     BOOST_LOG_TRIVIAL(debug) << "TriangleMesh::repair() finished";
 }
 
+// Each edge shared by exactly two faces, oriented consistently, no degenerate faces and finite vertices only:
+// There is nothing for the admesh repair to do.
+static bool its_is_oriented_closed_manifold_par(const indexed_triangle_set &its)
+{
+    auto all = [](bool a, bool b) { return a && b; };
+    if (! tbb::parallel_reduce(tbb::blocked_range<size_t>(0, its.vertices.size(), 16384), true,
+            [&its](const tbb::blocked_range<size_t> &range, bool valid) {
+                for (size_t i = range.begin(); i < range.end() && valid; ++ i)
+                    valid = its.vertices[i].allFinite();
+                return valid;
+            }, all))
+        return false;
+
+    // Directed edges of all faces, the starting vertex index in the upper 32 bits.
+    std::vector<uint64_t> edges(3 * its.indices.size());
+    if (! tbb::parallel_reduce(tbb::blocked_range<size_t>(0, its.indices.size(), 16384), true,
+            [&its, &edges](const tbb::blocked_range<size_t> &range, bool valid) {
+                for (size_t i = range.begin(); i < range.end(); ++ i) {
+                    const stl_triangle_vertex_indices &face = its.indices[i];
+                    if (face(0) == face(1) || face(1) == face(2) || face(2) == face(0))
+                        valid = false;
+                    for (int j = 0; j < 3; ++ j)
+                        edges[3 * i + j] = (uint64_t(uint32_t(face(j))) << 32) | uint32_t(face(j == 2 ? 0 : j + 1));
+                }
+                return valid;
+            }, all))
+        return false;
+    tbb::parallel_sort(edges.begin(), edges.end());
+    // Each directed edge is unique and its opposite edge exists.
+    return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, edges.size(), 16384), true,
+        [&edges](const tbb::blocked_range<size_t> &range, bool valid) {
+            for (size_t i = range.begin(); i < range.end() && valid; ++ i) {
+                uint64_t edge = edges[i];
+                valid = (i + 1 == edges.size() || edges[i + 1] != edge) && std::binary_search(edges.begin(), edges.end(), (edge << 32) | (edge >> 32));
+            }
+            return valid;
+        }, all);
+}
+
+// admesh orients each patch by the normal stored with its first facet. If no stored normal points against
+// the facet winding, the patches keep the orientation they were loaded with.
+static bool stl_normals_match_winding_par(const stl_file &stl)
+{
+    return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, stl.stats.number_of_facets, 16384), true,
+        [&stl](const tbb::blocked_range<size_t> &range, bool valid) {
+            for (size_t i = range.begin(); i < range.end() && valid; ++ i) {
+                const stl_facet &facet = stl.facet_start[i];
+                valid = facet.normal.dot((facet.vertex[1] - facet.vertex[0]).cross(facet.vertex[2] - facet.vertex[0])) >= 0.f;
+            }
+            return valid;
+        },
+        [](bool a, bool b) { return a && b; });
+}
+
 bool TriangleMesh::ReadSTLFile(const char* input_file, bool repair)
 { 
     stl_file stl;
     if (! stl_open(&stl, input_file))
         return false;
+
+    if (repair && stl.stats.number_of_facets > 0) {
+        // Fast path for the common case of a clean mesh: Weld the vertices in parallel and skip the admesh repair
+        // if there is nothing to repair. The result is the same as of the admesh repair, up to the vertex order.
+        indexed_triangle_set its;
+        stl_weld_shared_vertices(&stl, its);
+        if (stl_normals_match_winding_par(stl) && its_is_oriented_closed_manifold_par(its)) {
+            m_stats.clear();
+            m_stats.number_of_facets = stl.stats.number_of_facets;
+            m_stats.min              = stl.stats.min;
+            m_stats.max              = stl.stats.max;
+            m_stats.size             = stl.stats.size;
+            m_stats.volume           = its_volume(its);
+            if (m_stats.volume < 0.f) {
+                // As stl_calculate_volume(), flip all facets if the volume is negative.
+                for (stl_triangle_vertex_indices &face : its.indices)
+                    std::swap(face(0), face(1));
+                m_stats.volume = - m_stats.volume;
+                m_stats.repaired_errors.facets_reversed = int(its.indices.size());
+            }
+            m_stats.number_of_parts  = int(its_number_of_patches_par(its, its_face_neighbors_par(its)));
+            this->its = std::move(its);
+            return true;
+        }
+        BOOST_LOG_TRIVIAL(debug) << "TriangleMesh::ReadSTLFile: " << input_file << " needs to be repaired";
+    }
+
     if (repair)
         trianglemesh_repair_on_import(stl);
 
@@ -380,17 +469,17 @@ bool TriangleMesh::is_splittable() const
 
 std::vector<TriangleMesh> TriangleMesh::split() const
 {
-    std::vector<indexed_triangle_set> itss = its_split(this->its);
-    std::vector<TriangleMesh> out;
-    out.reserve(itss.size());
-    for (indexed_triangle_set &m : itss) {
-        // The TriangleMesh constructor shall fill in the mesh statistics including volume.
-        out.emplace_back(std::move(m));
-        if (TriangleMesh &triangle_mesh = out.back(); triangle_mesh.volume() < 0)
-            // Some source mesh parts may be incorrectly oriented. Correct them.
-            triangle_mesh.flip_triangles();
-
-    }
+    std::vector<indexed_triangle_set> itss = its_split_par(this->its);
+    std::vector<TriangleMesh> out(itss.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, itss.size()), [&itss, &out](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            // The TriangleMesh constructor shall fill in the mesh statistics including volume.
+            out[i] = TriangleMesh(std::move(itss[i]));
+            if (out[i].volume() < 0)
+                // Some source mesh parts may be incorrectly oriented. Correct them.
+                out[i].flip_triangles();
+        }
+    });
     return out;
 }
 
@@ -775,6 +864,124 @@ int its_compactify_vertices(indexed_triangle_set &its, bool shrink_to_fit)
     return removed;
 }
 
+// Maps the elements for which keep(idx) holds to their indices after removal of the other elements,
+// which are mapped to -1. Returns the number of the elements kept.
+template<typename KeepFn>
+static int compaction_map_par(size_t num_elements, KeepFn keep, std::vector<int> &new_idx)
+{
+    new_idx.assign(num_elements, -1);
+    return tbb::parallel_scan(tbb::blocked_range<size_t>(0, num_elements, 8192), 0,
+        [&keep, &new_idx](const tbb::blocked_range<size_t> &range, int num_kept, bool is_final_scan) {
+            for (size_t idx = range.begin(); idx < range.end(); ++ idx)
+                if (keep(idx)) {
+                    if (is_final_scan)
+                        new_idx[idx] = num_kept;
+                    ++ num_kept;
+                }
+            return num_kept;
+        },
+        std::plus<int>());
+}
+
+// Scatters the kept elements of data to their new indices.
+template<typename T>
+static std::vector<T> compact_par(const std::vector<T> &data, const std::vector<int> &new_idx, int num_kept)
+{
+    std::vector<T> out(num_kept);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, data.size(), 8192), [&data, &new_idx, &out](const tbb::blocked_range<size_t> &range) {
+        for (size_t idx = range.begin(); idx < range.end(); ++ idx)
+            if (new_idx[idx] >= 0)
+                out[new_idx[idx]] = data[idx];
+    });
+    return out;
+}
+
+static void remap_face_indices_par(std::vector<stl_triangle_vertex_indices> &indices, const std::vector<int> &map_vertices)
+{
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, indices.size(), 8192), [&indices, &map_vertices](const tbb::blocked_range<size_t> &range) {
+        for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx)
+            for (int i = 0; i < 3; ++ i)
+                indices[face_idx](i) = map_vertices[indices[face_idx](i)];
+    });
+}
+
+int its_merge_vertices_par(indexed_triangle_set &its)
+{
+    // 1) Sort indices to vertices lexicographically by coordinates AND vertex index, as its_merge_vertices() does.
+    std::vector<int> sorted(its.vertices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, sorted.size(), 8192), [&sorted](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            sorted[i] = int(i);
+    });
+    tbb::parallel_sort(sorted.begin(), sorted.end(), [&its](int il, int ir) {
+        const Vec3f &l = its.vertices[il];
+        const Vec3f &r = its.vertices[ir];
+        // Sort lexicographically by coordinates AND vertex index.
+        return l.x() < r.x() || (l.x() == r.x() && (l.y() < r.y() || (l.y() == r.y() && (l.z() < r.z() || (l.z() == r.z() && il < ir)))));
+    });
+
+    // 2) Map duplicate vertices to the one with the lowest vertex index, which is the first one of its run in sorted.
+    std::vector<int> map_vertices(its.vertices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, sorted.size(), 8192), [&its, &sorted, &map_vertices](const tbb::blocked_range<size_t> &range) {
+        // Find the start of the run of duplicates the range starts in.
+        size_t first = range.begin();
+        while (first > 0 && its.vertices[sorted[first - 1]] == its.vertices[sorted[range.begin()]])
+            -- first;
+        for (size_t i = range.begin(); i < range.end(); ++ i) {
+            if (i > first && its.vertices[sorted[i]] != its.vertices[sorted[i - 1]])
+                first = i;
+            map_vertices[sorted[i]] = sorted[first];
+        }
+    });
+
+    // 3) Shrink its.vertices, remap the face indices to the new vertex indices.
+    std::vector<int> new_idx;
+    int k = compaction_map_par(its.vertices.size(), [&map_vertices](size_t idx) { return map_vertices[idx] == int(idx); }, new_idx);
+    int num_erased = int(its.vertices.size()) - k;
+    if (num_erased) {
+        its.vertices = compact_par(its.vertices, new_idx, k);
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, map_vertices.size(), 8192), [&map_vertices, &new_idx](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                map_vertices[i] = new_idx[map_vertices[i]];
+        });
+        remap_face_indices_par(its.indices, map_vertices);
+    }
+
+    return num_erased;
+}
+
+int its_remove_degenerate_faces_par(indexed_triangle_set &its)
+{
+    std::vector<int> new_idx;
+    int k = compaction_map_par(its.indices.size(), [&its](size_t idx) {
+        const stl_triangle_vertex_indices &face = its.indices[idx];
+        return face(0) != face(1) && face(0) != face(2) && face(1) != face(2);
+    }, new_idx);
+    int removed = int(its.indices.size()) - k;
+    if (removed)
+        its.indices = compact_par(its.indices, new_idx, k);
+    return removed;
+}
+
+int its_compactify_vertices_par(indexed_triangle_set &its)
+{
+    // Mark referenced vertices.
+    std::vector<std::atomic<char>> referenced(its.vertices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size(), 8192), [&its, &referenced](const tbb::blocked_range<size_t> &range) {
+        for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx)
+            for (int i = 0; i < 3; ++ i)
+                referenced[its.indices[face_idx](i)].store(1, std::memory_order_relaxed);
+    });
+    std::vector<int> new_idx;
+    int last = compaction_map_par(its.vertices.size(), [&referenced](size_t idx) { return referenced[idx].load(std::memory_order_relaxed) != 0; }, new_idx);
+    int removed = int(its.vertices.size()) - last;
+    if (removed) {
+        its.vertices = compact_par(its.vertices, new_idx, last);
+        remap_face_indices_par(its.indices, new_idx);
+    }
+    return removed;
+}
+
 bool its_store_triangle(const indexed_triangle_set &its,
                         const char *                obj_filename,
                         size_t                      triangle_index)
@@ -1226,6 +1433,97 @@ size_t its_number_of_patches(const indexed_triangle_set &its, const std::vector<
     return its_number_of_patches<>(ItsNeighborsWrapper{ its, face_neighbors });
 }
 
+std::vector<indexed_triangle_set> its_split_par(const indexed_triangle_set &its)
+{
+    return its_split_par(its, its_face_neighbors_par(its));
+}
+
+std::vector<indexed_triangle_set> its_split_par(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors)
+{
+    assert(face_neighbors.size() == its.indices.size());
+    const std::vector<int> roots = meshsplit_detail::face_patch_roots(ex_tbb, face_neighbors);
+
+    // Number the parts by their lowest face index, which is the order its_split() produces them in.
+    std::vector<int> root_to_part;
+    const int num_parts = compaction_map_par(roots.size(), [&roots](size_t idx) { return roots[idx] == int(idx); }, root_to_part);
+
+    // Bucket the faces by part, keeping their order.
+    std::vector<int> part_start(num_parts + 1, 0);
+    for (int root : roots)
+        ++ part_start[root_to_part[root] + 1];
+    for (int part_id = 0; part_id < num_parts; ++ part_id)
+        part_start[part_id + 1] += part_start[part_id];
+    std::vector<int> part_faces(roots.size());
+    {
+        std::vector<int> cursor(part_start.begin(), part_start.end() - 1);
+        for (size_t face_idx = 0; face_idx < roots.size(); ++ face_idx)
+            part_faces[cursor[root_to_part[roots[face_idx]]] ++] = int(face_idx);
+    }
+
+    // A vertex is owned by the lowest part referencing it. Only parts touching at a vertex share vertices,
+    // the other parts track the shared vertices in a map of their own.
+    std::vector<std::atomic<int>> vertex_part(its.vertices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, vertex_part.size(), 8192), [num_parts, &vertex_part](const tbb::blocked_range<size_t> &range) {
+        for (size_t i = range.begin(); i < range.end(); ++ i)
+            vertex_part[i].store(num_parts, std::memory_order_relaxed);
+    });
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, its.indices.size(), 8192), [&its, &roots, &root_to_part, &vertex_part](const tbb::blocked_range<size_t> &range) {
+        for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+            const int part_id = root_to_part[roots[face_idx]];
+            for (int i = 0; i < 3; ++ i) {
+                std::atomic<int> &owner = vertex_part[its.indices[face_idx](i)];
+                for (int current = owner.load(std::memory_order_relaxed); part_id < current && ! owner.compare_exchange_weak(current, part_id, std::memory_order_relaxed); ) ;
+            }
+        }
+    });
+
+    std::vector<int> vertex_image(its.vertices.size(), -1);
+    std::vector<indexed_triangle_set> out(num_parts);
+    tbb::parallel_for(tbb::blocked_range<int>(0, num_parts), [&its, &part_start, &part_faces, &vertex_part, &vertex_image, &out](const tbb::blocked_range<int> &range) {
+        for (int part_id = range.begin(); part_id < range.end(); ++ part_id) {
+            indexed_triangle_set          &mesh = out[part_id];
+            std::unordered_map<int, int>   shared_vertex_image;
+            mesh.indices.reserve(part_start[part_id + 1] - part_start[part_id]);
+            for (int i = part_start[part_id]; i < part_start[part_id + 1]; ++ i) {
+                const stl_triangle_vertex_indices &face = its.indices[part_faces[i]];
+                stl_triangle_vertex_indices        new_face;
+                for (int v = 0; v < 3; ++ v) {
+                    const int vi    = face(v);
+                    int      &image = vertex_part[vi].load(std::memory_order_relaxed) == part_id ?
+                        vertex_image[vi] : shared_vertex_image.emplace(vi, -1).first->second;
+                    if (image == -1) {
+                        image = int(mesh.vertices.size());
+                        mesh.vertices.emplace_back(its.vertices[vi]);
+                    }
+                    new_face(v) = image;
+                }
+                mesh.indices.emplace_back(new_face);
+            }
+        }
+    });
+
+    return out;
+}
+
+size_t its_number_of_patches_par(const indexed_triangle_set &its)
+{
+    return its_number_of_patches_par(its, its_face_neighbors_par(its));
+}
+
+size_t its_number_of_patches_par(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors)
+{
+    assert(face_neighbors.size() == its.indices.size());
+    const std::vector<int> roots = meshsplit_detail::face_patch_roots(ex_tbb, face_neighbors);
+    return tbb::parallel_reduce(tbb::blocked_range<size_t>(0, roots.size(), 8192), size_t(0),
+        [&roots](const tbb::blocked_range<size_t> &range, size_t num_patches) {
+            for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx)
+                if (roots[face_idx] == int(face_idx))
+                    ++ num_patches;
+            return num_patches;
+        },
+        std::plus<size_t>());
+}
+
 // Same as its_number_of_patches(its) > 1, but faster.
 bool its_is_splittable(const indexed_triangle_set &its)
 {
@@ -92,6 +92,8 @@ public:
     TriangleMesh(std::vector<Vec3f> &&vertices, const std::vector<Vec3i> &&faces);
     explicit TriangleMesh(const indexed_triangle_set &M);
     explicit TriangleMesh(indexed_triangle_set &&M, const RepairedMeshErrors& repaired_errors = RepairedMeshErrors());
+    // Mesh with the statistics known already, for example loaded from the mesh cache.
+    TriangleMesh(indexed_triangle_set &&M, const TriangleMeshStats &stats) : its(std::move(M)), m_stats(stats) {}
     void clear() { this->its.clear(); this->m_stats.clear(); }
     bool ReadSTLFile(const char* input_file, bool repair = true);
     bool write_ascii(const char* output_file);
@@ -209,16 +211,28 @@ int its_remove_degenerate_faces(indexed_triangle_set &its, bool shrink_to_fit =
 // Remove vertices, which none of the faces references. Return number of freed vertices.
 int its_compactify_vertices(indexed_triangle_set &its, bool shrink_to_fit = true);
 
+// Parallel variants of the three functions above, producing the same result.
+// The vectors shrunk by them are always reallocated.
+int its_merge_vertices_par(indexed_triangle_set &its);
+int its_remove_degenerate_faces_par(indexed_triangle_set &its);
+int its_compactify_vertices_par(indexed_triangle_set &its);
+
 // store part of index triangle set
 bool its_store_triangle(const indexed_triangle_set &its, const char *obj_filename, size_t triangle_index);
 bool its_store_triangles(const indexed_triangle_set &its, const char *obj_filename, const std::vector<size_t>& triangles);
 
 std::vector<indexed_triangle_set> its_split(const indexed_triangle_set &its);
 std::vector<indexed_triangle_set> its_split(const indexed_triangle_set &its, std::vector<Vec3i> &face_neighbors);
+// Parallel variant of its_split(), producing the parts in the same order. The faces of a part
+// keep their order in its, the vertices of a part are ordered by their first use.
+std::vector<indexed_triangle_set> its_split_par(const indexed_triangle_set &its);
+std::vector<indexed_triangle_set> its_split_par(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors);
 
 // Number of disconnected patches (faces are connected if they share an edge, shared edge defined with 2 shared vertex indices).
 size_t its_number_of_patches(const indexed_triangle_set &its);
 size_t its_number_of_patches(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors);
+size_t its_number_of_patches_par(const indexed_triangle_set &its);
+size_t its_number_of_patches_par(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors);
 // Same as its_number_of_patches(its) > 1, but faster.
 bool its_is_splittable(const indexed_triangle_set &its);
 bool its_is_splittable(const indexed_triangle_set &its, const std::vector<Vec3i> &face_neighbors);
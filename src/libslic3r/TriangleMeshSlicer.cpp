@@ -15,6 +15,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
 
 #ifndef NDEBUG
 //    #define EXPENSIVE_DEBUG_CHECKS
@@ -362,6 +363,244 @@ static inline std::vector<IntersectionLines> slice_make_lines(
     return lines;
 }
 
+// Facet swept through the layers by slice_make_lines_sweep(). Vertices of the facets are copied for cache locality of the sweep,
+// which visits a facet once per layer it spans.
+struct SweepFacet {
+    stl_vertex  vertices[3];
+    int         face_idx;
+    int         idx_vertex_lowest;
+    // One past the last layer spanned.
+    int         layer_end;
+};
+
+// Intersection of a facet edge with a slicing plane, the plane crossing the edge strictly between its end points.
+// Calculated the same way as by slice_facet(), thus both facets sharing the edge produce the same point.
+static inline Point edge_plane_intersection(float slice_z, const SweepFacet &facet, const stl_triangle_vertex_indices &indices, int edge)
+{
+    const stl_vertex *a    = facet.vertices + edge;
+    const stl_vertex *b    = facet.vertices + (edge + 1) % 3;
+    // Sort the edge to give a consistent answer.
+    if (indices[edge] > indices[(edge + 1) % 3])
+        std::swap(a, b);
+    double t = (double(slice_z) - double(b->z())) / (double(a->z()) - double(b->z()));
+    assert(t > 0. && t < 1.);
+    return { coord_t(floor(double(b->x()) + (double(a->x()) - double(b->x())) * t + 0.5)),
+             coord_t(floor(double(b->y()) + (double(a->y()) - double(b->y())) * t + 0.5)) };
+}
+
+// Slice the facets active at a layer. Facets crossing the layer in a general position are chained into loops directly
+// by walking from a facet to its neighbor over their shared edge, the intersection point of each edge is calculated just once.
+// Lines of facets touching the layer with a vertex or an edge and of chains, which could not be closed (open or flipped facets),
+// are returned in lines to be chained by make_loops().
+static void slice_layer_walk_edges(
+    float                                            slice_z,
+    const std::vector<SweepFacet>                   &facets,
+    const std::vector<size_t>                       &active,
+    const std::vector<stl_triangle_vertex_indices>  &indices,
+    const std::vector<Vec3i>                        &face_edge_ids,
+    Polygons                                        &loops,
+    IntersectionLines                               &lines)
+{
+    // Facet crossing the layer in a general position.
+    struct Crossing {
+        const SweepFacet *facet;
+        // Edge of the facet, where the plane is crossed downwards (the line starts) resp. upwards (the line ends).
+        int               edge_a;
+        int               edge_b;
+        // Unique identifier of edge_a.
+        int               edge_a_id;
+        bool              visited;
+    };
+    std::vector<Crossing> crossings;
+    crossings.reserve(active.size());
+    for (size_t facet_idx : active) {
+        const SweepFacet &facet    = facets[facet_idx];
+        const Vec3i      &edge_ids = face_edge_ids[facet.face_idx];
+        int edge_a = -1;
+        int edge_b = -1;
+        if (facet.vertices[0].z() != slice_z && facet.vertices[1].z() != slice_z && facet.vertices[2].z() != slice_z)
+            // Going around the facet, the plane is crossed downwards at the start of the intersection line and upwards at its end.
+            for (int j = 0; j < 3; ++ j) {
+                bool below      = facet.vertices[j].z() < slice_z;
+                bool next_below = facet.vertices[(j + 1) % 3].z() < slice_z;
+                if (below && ! next_below)
+                    edge_b = j;
+                else if (! below && next_below)
+                    edge_a = j;
+            }
+        if (edge_a != -1 && edge_b != -1 && edge_ids(edge_a) != -1 && edge_ids(edge_b) != -1)
+            crossings.push_back({ &facet, edge_a, edge_b, edge_ids(edge_a), false });
+        else {
+            IntersectionLine il;
+            if (slice_facet(slice_z, facet.vertices, indices[facet.face_idx], edge_ids, facet.idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
+                assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+                lines.emplace_back(il);
+            }
+        }
+    }
+
+    // An edge is shared by two facets only, thus there is at most a single facet starting at an edge.
+    std::sort(crossings.begin(), crossings.end(), [](const Crossing &l, const Crossing &r) { return l.edge_a_id < r.edge_a_id; });
+    auto find_unvisited = [&crossings](int edge_id) -> Crossing* {
+        auto it = std::lower_bound(crossings.begin(), crossings.end(), edge_id, [](const Crossing &c, int edge_id) { return c.edge_a_id < edge_id; });
+        return it != crossings.end() && it->edge_a_id == edge_id && ! it->visited ? &(*it) : nullptr;
+    };
+
+    std::vector<Crossing*> chain;
+    for (Crossing &seed : crossings)
+        if (! seed.visited) {
+            seed.visited = true;
+            chain.assign(1, &seed);
+            Points pts { edge_plane_intersection(slice_z, *seed.facet, indices[seed.facet->face_idx], seed.edge_a) };
+            bool   closed = false;
+            for (;;) {
+                const Crossing &last    = *chain.back();
+                const int       edge_id = face_edge_ids[last.facet->face_idx](last.edge_b);
+                if (edge_id == seed.edge_a_id) {
+                    closed = true;
+                    break;
+                }
+                // The end point of this line is the start point of the next line.
+                pts.emplace_back(edge_plane_intersection(slice_z, *last.facet, indices[last.facet->face_idx], last.edge_b));
+                Crossing *next = find_unvisited(edge_id);
+                if (next == nullptr)
+                    break;
+                next->visited = true;
+                chain.emplace_back(next);
+            }
+            if (closed)
+                loops.emplace_back(std::move(pts));
+            else {
+                // Let make_loops() chain the lines with the lines of the other facets.
+                assert(pts.size() == chain.size() + 1);
+                for (size_t i = 0; i < chain.size(); ++ i) {
+                    const Vec3i      &edge_ids = face_edge_ids[chain[i]->facet->face_idx];
+                    IntersectionLine &il       = lines.emplace_back();
+                    il.a         = pts[i];
+                    il.b         = pts[i + 1];
+                    il.edge_a_id = edge_ids(chain[i]->edge_a);
+                    il.edge_b_id = edge_ids(chain[i]->edge_b);
+                }
+            }
+        }
+}
+
+// Alternative to slice_make_lines() for many layers: The facets are bucket sorted by the first layer they span and swept
+// through the layers, maintaining a list of facets spanning the current layer. The layers are split into ranges swept
+// in parallel, each range writes into its own layers only, thus no locking is needed. The vertices are expected
+// to be transformed and scaled in XY already, zs are expected to be sorted.
+template<typename ThrowOnCancel>
+static inline std::vector<IntersectionLines> slice_make_lines_sweep(
+    const std::vector<stl_vertex>                   &vertices,
+    const std::vector<stl_triangle_vertex_indices>  &indices,
+    const std::vector<Vec3i>                        &face_edge_ids,
+    const std::vector<float>                        &zs,
+    // If not null, facets crossing a layer in a general position are chained into loops by slice_layer_walk_edges().
+    std::vector<Polygons>                           *loops,
+    const ThrowOnCancel                              throw_on_cancel_fn)
+{
+    assert(std::is_sorted(zs.begin(), zs.end()));
+    std::vector<IntersectionLines> lines(zs.size(), IntersectionLines());
+    if (loops)
+        loops->assign(zs.size(), Polygons());
+
+    // Range of layers spanned by each facet, the same layers slice_facet_at_zs() slices the facet with.
+    // Horizontal facets and facets between two layers span no layer.
+    std::vector<std::pair<int, int>> facet_layers(indices.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, indices.size()), [&vertices, &indices, &zs, &facet_layers](const tbb::blocked_range<size_t> &range) {
+        for (size_t face_idx = range.begin(); face_idx < range.end(); ++ face_idx) {
+            const Vec3i &face  = indices[face_idx];
+            const float  min_z = fminf(vertices[face(0)].z(), fminf(vertices[face(1)].z(), vertices[face(2)].z()));
+            const float  max_z = fmaxf(vertices[face(0)].z(), fmaxf(vertices[face(1)].z(), vertices[face(2)].z()));
+            if (min_z == max_z)
+                facet_layers[face_idx] = { 0, 0 };
+            else {
+                auto min_layer = std::lower_bound(zs.begin(), zs.end(), min_z);
+                auto max_layer = std::upper_bound(min_layer, zs.end(), max_z);
+                facet_layers[face_idx] = { int(min_layer - zs.begin()), int(max_layer - zs.begin()) };
+            }
+        }
+    });
+
+    // Facets bucket sorted by their first layer, facets starting at layer i are facets[layer_facets_begin[i], layer_facets_begin[i + 1]).
+    std::vector<SweepFacet> facets;
+    std::vector<size_t>     layer_facets_begin(zs.size() + 1, 0);
+    {
+        for (const std::pair<int, int> &layers : facet_layers)
+            if (layers.first < layers.second)
+                ++ layer_facets_begin[layers.first + 1];
+        for (size_t i = 1; i < layer_facets_begin.size(); ++ i)
+            layer_facets_begin[i] += layer_facets_begin[i - 1];
+        std::vector<int>    sorted(layer_facets_begin.back());
+        std::vector<size_t> layer_facets_end(layer_facets_begin.begin(), layer_facets_begin.end() - 1);
+        for (size_t face_idx = 0; face_idx < indices.size(); ++ face_idx)
+            if (const std::pair<int, int> &layers = facet_layers[face_idx]; layers.first < layers.second)
+                sorted[layer_facets_end[layers.first] ++] = int(face_idx);
+        facets.assign(sorted.size(), SweepFacet());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, sorted.size()), [&vertices, &indices, &facet_layers, &sorted, &facets](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                SweepFacet  &facet = facets[i];
+                const Vec3i &face  = indices[sorted[i]];
+                for (int j = 0; j < 3; ++ j)
+                    facet.vertices[j] = vertices[face(j)];
+                const float min_z = fminf(facet.vertices[0].z(), fminf(facet.vertices[1].z(), facet.vertices[2].z()));
+                facet.face_idx          = sorted[i];
+                facet.idx_vertex_lowest = (facet.vertices[1].z() == min_z) ? 1 : ((facet.vertices[2].z() == min_z) ? 2 : 0);
+                facet.layer_end         = facet_layers[sorted[i]].second;
+            }
+        });
+    }
+
+    throw_on_cancel_fn();
+
+    // Split the layers into ranges, a few per thread to balance the load.
+    const size_t max_ranges = 4 * size_t(tbb::this_task_arena::max_concurrency());
+    const size_t range_size = std::max<size_t>(1, (zs.size() + max_ranges - 1) / max_ranges);
+    const size_t num_ranges = (zs.size() + range_size - 1) / range_size;
+    // For each range, facets spanning the first layer of the range, which start at a layer of a preceding range.
+    std::vector<std::vector<size_t>> spanning(num_ranges);
+    for (size_t i = 0; i < facets.size(); ++ i)
+        for (size_t range_idx = size_t(facet_layers[facets[i].face_idx].first) / range_size + 1;
+             range_idx < num_ranges && range_idx * range_size < size_t(facets[i].layer_end); ++ range_idx)
+            spanning[range_idx].emplace_back(i);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, num_ranges, 1),
+        [&indices, &face_edge_ids, &zs, loops, &lines, &facets, &layer_facets_begin, &spanning, range_size, throw_on_cancel_fn](const tbb::blocked_range<size_t> &range) {
+            for (size_t range_idx = range.begin(); range_idx < range.end(); ++ range_idx) {
+                std::vector<size_t> active = std::move(spanning[range_idx]);
+                for (size_t layer_idx = range_idx * range_size; layer_idx < std::min(zs.size(), (range_idx + 1) * range_size); ++ layer_idx) {
+                    throw_on_cancel_fn();
+                    for (size_t i = layer_facets_begin[layer_idx]; i < layer_facets_begin[layer_idx + 1]; ++ i)
+                        active.emplace_back(i);
+                    IntersectionLines &layer_lines = lines[layer_idx];
+                    if (loops) {
+                        active.erase(std::remove_if(active.begin(), active.end(), [&facets, layer_idx](size_t i) { return facets[i].layer_end <= int(layer_idx); }), active.end());
+                        slice_layer_walk_edges(zs[layer_idx], facets, active, indices, face_edge_ids, (*loops)[layer_idx], layer_lines);
+                        continue;
+                    }
+                    // The number of active facets bounds the number of lines, thus the layer is allocated just once.
+                    layer_lines.reserve(active.size());
+                    for (size_t i = 0; i < active.size();) {
+                        const SweepFacet &facet = facets[active[i]];
+                        if (facet.layer_end <= int(layer_idx)) {
+                            // The facet ends below this layer, remove it from the active list.
+                            active[i] = active.back();
+                            active.pop_back();
+                            continue;
+                        }
+                        IntersectionLine il;
+                        if (slice_facet(zs[layer_idx], facet.vertices, indices[facet.face_idx], face_edge_ids[facet.face_idx], facet.idx_vertex_lowest, false, il) == FacetSliceType::Slicing) {
+                            assert(il.edge_type != IntersectionLine::FacetEdgeType::Horizontal);
+                            layer_lines.emplace_back(il);
+                        }
+                        ++ i;
+                    }
+                }
+            }
+        });
+    return lines;
+}
+
 template<typename TransformVertex, typename FaceFilter>
 static inline IntersectionLines slice_make_lines(
     const std::vector<stl_vertex>                   &mesh_vertices,
@@ -1316,19 +1555,23 @@ static std::vector<Polygons> make_loops(
     // Lines will have their flags modified.
     std::vector<IntersectionLines> &lines, 
     const MeshSlicingParams        &params, 
-    ThrowOnCancel                   throw_on_cancel)
+    ThrowOnCancel                   throw_on_cancel,
+    // Loops already closed by slice_layer_walk_edges(), the lines are chained and added to them. May be null.
+    std::vector<Polygons>          *closed_loops = nullptr)
 {
     std::vector<Polygons> layers;
     layers.resize(lines.size());
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, lines.size()),
-        [&lines, &layers, &params, throw_on_cancel](const tbb::blocked_range<size_t> &range) {
+        [&lines, &layers, &params, throw_on_cancel, closed_loops](const tbb::blocked_range<size_t> &range) {
             for (size_t line_idx = range.begin(); line_idx < range.end(); ++ line_idx) {
                 if ((line_idx & 0x0ffff) == 0)
                     throw_on_cancel();
 
                 Polygons &polygons = layers[line_idx];
                 polygons = make_loops(lines[line_idx]);
+                if (closed_loops)
+                    append(polygons, std::move((*closed_loops)[line_idx]));
 
                 auto this_mode = line_idx < params.slicing_mode_normal_below_layer ? params.mode_below : params.mode;
                 if (! polygons.empty()) {
@@ -1702,6 +1945,8 @@ std::vector<Polygons> slice_mesh(
     BOOST_LOG_TRIVIAL(debug) << "slice_mesh to polygons";
        
     std::vector<IntersectionLines> lines;
+    // Loops closed while slicing by MeshSlicingParams::SlicingEngine::SweepEdges.
+    std::vector<Polygons>          closed_loops;
 
     {
         //FIXME facets_edges is likely not needed and quite costly to calculate.
@@ -1720,6 +1965,9 @@ std::vector<Polygons> slice_mesh(
                 Transform3f tf = make_trafo_for_slicing(params.trafo);
                 lines = slice_make_lines(mesh.vertices, [tf](const Vec3f &p) { return tf * p; }, mesh.indices, face_edge_ids, zs, throw_on_cancel);
             }
+        } else if (params.engine != MeshSlicingParams::SlicingEngine::PerFacet) {
+            lines = slice_make_lines_sweep(transform_mesh_vertices_for_slicing(mesh, params.trafo), mesh.indices, face_edge_ids, zs,
+                params.engine == MeshSlicingParams::SlicingEngine::SweepEdges ? &closed_loops : nullptr, throw_on_cancel);
         } else {
             // Copy and scale vertices in XY, don't scale in Z. Possibly apply the transformation.
             lines = slice_make_lines(
@@ -1730,7 +1978,7 @@ std::vector<Polygons> slice_mesh(
 
     throw_on_cancel();
 
-    std::vector<Polygons> layers = make_loops(lines, params, throw_on_cancel);
+    std::vector<Polygons> layers = make_loops(lines, params, throw_on_cancel, closed_loops.empty() ? nullptr : &closed_loops);
 
 #ifdef SLIC3R_DEBUG
     {
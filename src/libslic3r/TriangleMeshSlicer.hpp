@@ -25,6 +25,18 @@ struct MeshSlicingParams
         PositiveLargestContour,
     };
 
+    enum class SlicingEngine : uint32_t {
+        // Each facet finds the layers it spans by a binary search, the intersection lines are collected per layer under a lock.
+        PerFacet,
+        // Facets sorted by their lowest Z are swept through the layers, keeping the set of facets active at the current layer.
+        // Ranges of layers are swept in parallel without locking. Faster for tall meshes sliced into many layers.
+        Sweep,
+        // Sweep, where the facets crossing a layer are chained into loops by walking over their shared edges, calculating
+        // the intersection of each edge with the layer just once. Facets touching a layer with a vertex are chained by the generic
+        // chaining of intersection lines, as with the other engines.
+        SweepEdges,
+    };
+
     SlicingMode   mode { SlicingMode::Regular };
     // For vase mode: below this layer a different slicing mode will be used to produce a single contour.
     // 0 = ignore.
@@ -33,6 +45,9 @@ struct MeshSlicingParams
     SlicingMode   mode_below { SlicingMode::Regular };
     // Transforming faces during the slicing.
     Transform3d   trafo { Transform3d::Identity() };
+    // All engines produce the same slices, the sweeps are only used when slicing with more than a single plane.
+    // Selected for the print objects by PrintObjectConfig::slicing_engine.
+    SlicingEngine engine { SlicingEngine::PerFacet };
 };
 
 struct MeshSlicingParamsEx : public MeshSlicingParams
@@ -1,4 +1,7 @@
 #include <exception>
+#include <algorithm>
+#include <ctime>
+#include <vector>
 
 #include "Exception.hpp"
 #include "Zipper.hpp"
@@ -37,13 +40,55 @@ public:
     {
         return arch.m_zip_mode != MZ_ZIP_MODE_WRITING_HAS_BEEN_FINALIZED;
     }
+
+    static mz_uint to_mz_level(e_compression compression)
+    {
+        switch (compression) {
+        case NO_COMPRESSION: return MZ_NO_COMPRESSION;
+        case FAST_COMPRESSION: return MZ_BEST_SPEED;
+        case TIGHT_COMPRESSION: return MZ_BEST_COMPRESSION;
+        }
+        return MZ_NO_COMPRESSION;
+    }
+
+    bool use_parallel(e_compression compression, size_t threshold, size_t bytes) const
+    {
+        return compression != NO_COMPRESSION && threshold > 0 && bytes >= threshold;
+    }
+
+    // Write an entry through MZ_ParallelDeflate, the data is produced by 'fill',
+    // which receives the writer to push the data into.
+    void add_parallel(const std::string &name, e_compression compression, size_t bytes,
+                      const std::function<bool(MZ_ParallelDeflate&)> &fill)
+    {
+        MZ_ParallelDeflate::Params params;
+        params.level = to_mz_level(compression);
+        MZ_ParallelDeflate writer(arch, params);
+        // Zip64 is switched on by the staged writer for entries over 4GB.
+        if (!writer.open(name.c_str(), std::max<mz_uint64>(bytes, 4)) ||
+            !fill(writer) || !writer.finish())
+            blow_up();
+    }
 };
 
+namespace {
+
+using ReadFn = std::function<size_t(char*, size_t)>;
+
+// miniz reads the source strictly sequentially, file_ofs is only informative.
+size_t read_func(void *opaque, mz_uint64 /* file_ofs */, void *buf, size_t n)
+{
+    return (*static_cast<const ReadFn*>(opaque))(static_cast<char*>(buf), n);
+}
+
+} // namespace
+
 Zipper::Zipper(const std::string &zipfname, e_compression compression)
 {
     m_impl.reset(new Impl());
 
     m_compression = compression;
+    m_parallel_threshold = DEFAULT_PARALLEL_THRESHOLD;
     m_impl->m_zipname = zipfname;
 
     memset(&m_impl->arch, 0, sizeof(m_impl->arch));
@@ -74,13 +119,15 @@ Zipper::Zipper(Zipper &&m):
     m_impl(std::move(m.m_impl)),
     m_data(std::move(m.m_data)),
     m_entry(std::move(m.m_entry)),
-    m_compression(m.m_compression) {}
+    m_compression(m.m_compression),
+    m_parallel_threshold(m.m_parallel_threshold) {}
 
 Zipper &Zipper::operator=(Zipper &&m) {
     m_impl = std::move(m.m_impl);
     m_data = std::move(m.m_data);
     m_entry = std::move(m.m_entry);
     m_compression = m.m_compression;
+    m_parallel_threshold = m.m_parallel_threshold;
     return *this;
 }
 
@@ -97,15 +144,66 @@ void Zipper::add_entry(const std::string &name, const void *data, size_t l)
     if(!m_impl->is_alive()) return;
 
     finish_entry();
-    mz_uint cmpr = MZ_NO_COMPRESSION;
-    switch (m_compression) {
-    case NO_COMPRESSION: cmpr = MZ_NO_COMPRESSION; break;
-    case FAST_COMPRESSION: cmpr = MZ_BEST_SPEED; break;
-    case TIGHT_COMPRESSION: cmpr = MZ_BEST_COMPRESSION; break;
+
+    if(m_impl->use_parallel(m_compression, m_parallel_threshold, l)) {
+        m_impl->add_parallel(name, m_compression, l, [data, l](MZ_ParallelDeflate &writer) {
+            return writer.write(data, l);
+        });
+    } else {
+        mz_uint cmpr = Impl::to_mz_level(m_compression);
+
+        if(!mz_zip_writer_add_mem(&m_impl->arch, name.c_str(), data, l, cmpr))
+            m_impl->blow_up();
     }
 
-    if(!mz_zip_writer_add_mem(&m_impl->arch, name.c_str(), data, l, cmpr))
-        m_impl->blow_up();
+    m_entry.clear();
+    m_data.clear();
+}
+
+void Zipper::add_entry(const std::string &name, std::istream &stream, size_t bytes,
+                       const std::function<void(const char*, size_t)> &on_chunk)
+{
+    size_t remaining = bytes;
+    add_entry(name, bytes, [&stream, &remaining, &on_chunk](char *buf, size_t n) {
+        n = std::min(n, remaining);
+        if (n == 0)
+            return size_t(0);
+
+        stream.read(buf, std::streamsize(n));
+        auto rd = size_t(stream.gcount());
+        remaining -= rd;
+        if (rd > 0 && on_chunk)
+            on_chunk(buf, rd);
+
+        return rd;
+    });
+}
+
+void Zipper::add_entry(const std::string &name, size_t max_bytes,
+                       const std::function<size_t(char*, size_t)> &read)
+{
+    if(!m_impl->is_alive()) return;
+
+    finish_entry();
+
+    if(m_impl->use_parallel(m_compression, m_parallel_threshold, max_bytes)) {
+        m_impl->add_parallel(name, m_compression, max_bytes, [&read](MZ_ParallelDeflate &writer) {
+            std::vector<char> buf(MZ_ZIP_MAX_IO_BUF_SIZE);
+            for (size_t rd; (rd = read(buf.data(), buf.size())) > 0;)
+                if (!writer.write(buf.data(), rd))
+                    return false;
+            return true;
+        });
+    } else {
+        mz_uint cmpr = Impl::to_mz_level(m_compression);
+
+        MZ_TIME_T now = time(nullptr);
+        if(!mz_zip_writer_add_read_buf_callback(&m_impl->arch, name.c_str(),
+                                                read_func, const_cast<ReadFn*>(&read), max_bytes,
+                                                &now, nullptr, 0, cmpr,
+                                                nullptr, 0, nullptr, 0))
+            m_impl->blow_up();
+    }
 
     m_entry.clear();
     m_data.clear();
@@ -116,18 +214,18 @@ void Zipper::finish_entry()
     if(!m_impl->is_alive()) return;
 
     if(!m_data.empty() && !m_entry.empty()) {
-        mz_uint compression = MZ_NO_COMPRESSION;
-
-        switch (m_compression) {
-        case NO_COMPRESSION: compression = MZ_NO_COMPRESSION; break;
-        case FAST_COMPRESSION: compression = MZ_BEST_SPEED; break;
-        case TIGHT_COMPRESSION: compression = MZ_BEST_COMPRESSION; break;
+        if(m_impl->use_parallel(m_compression, m_parallel_threshold, m_data.size())) {
+            m_impl->add_parallel(m_entry, m_compression, m_data.size(), [this](MZ_ParallelDeflate &writer) {
+                return writer.write(m_data.data(), m_data.size());
+            });
+        } else {
+            mz_uint compression = Impl::to_mz_level(m_compression);
+
+            if(!mz_zip_writer_add_mem(&m_impl->arch, m_entry.c_str(),
+                                      m_data.c_str(),
+                                      m_data.size(),
+                                      compression)) m_impl->blow_up();
         }
-
-        if(!mz_zip_writer_add_mem(&m_impl->arch, m_entry.c_str(),
-                                  m_data.c_str(),
-                                  m_data.size(),
-                                  compression)) m_impl->blow_up();
     }
 
     m_data.clear();
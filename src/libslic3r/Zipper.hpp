@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <string>
 #include <memory>
+#include <istream>
+#include <functional>
 
 namespace Slic3r {
 
@@ -23,6 +25,7 @@ private:
     std::string m_data;
     std::string m_entry;
     e_compression m_compression;
+    size_t m_parallel_threshold;
 
 public:
 
@@ -42,6 +45,11 @@ public:
     Zipper(Zipper &&m);
     Zipper& operator=(Zipper &&m);
 
+    /// Entries of at least this many bytes are deflated in independent chunks
+    /// on all cores (see MZ_ParallelDeflate). Zero disables parallel deflate.
+    void set_parallel_threshold(size_t bytes) { m_parallel_threshold = bytes; }
+    static constexpr size_t DEFAULT_PARALLEL_THRESHOLD = 4 << 20;
+
     /// Adding an entry means a file inside the new archive. Name param is the
     /// name of the new file. To create directories, append a forward slash.
     /// The previous entry is finished (see finish_entry)
@@ -51,6 +59,24 @@ public:
     /// This method throws exactly like finish_entry() does.
     void add_entry(const std::string& name, const void* data, size_t bytes);
 
+    /// Add a new file entry whose contents are pulled from the given stream
+    /// in fixed size chunks, so the source never has to be loaded into memory
+    /// as a whole. Exactly 'bytes' bytes are read. If on_chunk is set, it is
+    /// called with every chunk in order before it gets compressed, which
+    /// allows computing checksums of the data in the same pass.
+    /// This method throws exactly like finish_entry() does.
+    void add_entry(const std::string& name, std::istream &stream, size_t bytes,
+                   const std::function<void(const char*, size_t)> &on_chunk = {});
+
+    /// Add a new file entry generated on the fly. The read callback fills
+    /// the given buffer with at most the given number of bytes and returns
+    /// the number of bytes written, zero at the end of the data. The entry
+    /// must not be longer than max_bytes, which also decides about the
+    /// parallel deflate and zip64 extensions.
+    /// This method throws exactly like finish_entry() does.
+    void add_entry(const std::string& name, size_t max_bytes,
+                   const std::function<size_t(char*, size_t)> &read);
+
     // Writing data to the archive works like with standard streams. The target
     // within the zip file is the entry created with the add_entry method.
 
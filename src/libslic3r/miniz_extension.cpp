@@ -1,7 +1,11 @@
 #include <exception>
+#include <algorithm>
+#include <thread>
 
 #include "miniz_extension.hpp"
 
+#include <tbb/parallel_for.h>
+
 #if defined(_MSC_VER) || defined(__MINGW64__)
 #include "boost/nowide/cstdio.hpp"
 #endif
@@ -76,6 +80,162 @@ bool open_zip_writer(mz_zip_archive *zip, const std::string &fname)
 bool close_zip_reader(mz_zip_archive *zip) { return close_zip(zip, true); }
 bool close_zip_writer(mz_zip_archive *zip) { return close_zip(zip, false); }
 
+namespace {
+mz_uint32 gf2_matrix_times(const mz_uint32 *mat, mz_uint32 vec)
+{
+    mz_uint32 sum = 0;
+    for (; vec; vec >>= 1, ++ mat)
+        if (vec & 1)
+            sum ^= *mat;
+    return sum;
+}
+
+void gf2_matrix_square(mz_uint32 *square, const mz_uint32 *mat)
+{
+    for (int n = 0; n < 32; ++ n)
+        square[n] = gf2_matrix_times(mat, mat[n]);
+}
+}
+
+mz_uint32 mz_crc32_combine(mz_uint32 crc1, mz_uint32 crc2, mz_uint64 len2)
+{
+    if (len2 == 0)
+        return crc1;
+
+    // Operator for one zero bit in odd, the CRC-32 polynomial first.
+    mz_uint32 even[32], odd[32];
+    odd[0] = 0xedb88320u;
+    for (mz_uint32 n = 1, row = 1; n < 32; ++ n, row <<= 1)
+        odd[n] = row;
+    // Operators for two and four zero bits.
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+    // Apply len2 zero bytes to crc1, the first square puts the operator for one zero byte into even.
+    do {
+        gf2_matrix_square(even, odd);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(even, crc1);
+        len2 >>= 1;
+        if (len2 == 0)
+            break;
+        gf2_matrix_square(odd, even);
+        if (len2 & 1)
+            crc1 = gf2_matrix_times(odd, crc1);
+        len2 >>= 1;
+    } while (len2 != 0);
+
+    return crc1 ^ crc2;
+}
+
+MZ_ParallelDeflate::MZ_ParallelDeflate(mz_zip_archive &zip, const Params &params)
+    : m_zip(zip), m_params(params)
+{
+    memset(&m_context, 0, sizeof(m_context));
+    m_params.chunk_size = std::max<size_t>(m_params.chunk_size, 4096);
+    if (m_params.batch_size == 0)
+        m_params.batch_size = 2 * std::max(1u, std::thread::hardware_concurrency());
+}
+
+MZ_ParallelDeflate::~MZ_ParallelDeflate()
+{
+    // Release the compressor of an entry, which was not finished due to an error.
+    if (m_context.pCompressor != nullptr)
+        m_zip.m_pFree(m_zip.m_pAlloc_opaque, m_context.pCompressor);
+}
+
+bool MZ_ParallelDeflate::open(const char *archive_name, mz_uint64 max_size)
+{
+    m_pending.clear();
+    m_chunks.clear();
+    m_open = mz_zip_writer_add_staged_open(&m_zip, &m_context, archive_name, max_size,
+        nullptr, nullptr, 0, m_params.level, nullptr, 0, nullptr, 0);
+    return m_open;
+}
+
+bool MZ_ParallelDeflate::write(const void *data, size_t n)
+{
+    if (! m_open)
+        return false;
+
+    auto *src = static_cast<const char*>(data);
+    while (n > 0) {
+        size_t len = std::min(n, m_params.chunk_size - m_pending.size());
+        m_pending.append(src, len);
+        src += len;
+        n   -= len;
+        if (m_pending.size() == m_params.chunk_size) {
+            m_chunks.emplace_back();
+            m_chunks.back().input.swap(m_pending);
+            m_pending.reserve(m_params.chunk_size);
+            if (m_chunks.size() >= m_params.batch_size && ! flush_chunks())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool MZ_ParallelDeflate::finish()
+{
+    if (! m_open)
+        return false;
+
+    if (! m_pending.empty()) {
+        m_chunks.emplace_back();
+        m_chunks.back().input.swap(m_pending);
+    }
+
+    // The staged compressor did not see any data, it only emits the final empty block.
+    m_open = false;
+    return flush_chunks() && mz_zip_writer_add_staged_finish(&m_context);
+}
+
+bool MZ_ParallelDeflate::flush_chunks()
+{
+    const int flags = int(tdefl_create_comp_flags_from_zip_params(int(m_params.level), -15, MZ_DEFAULT_STRATEGY));
+
+    tbb::parallel_for(size_t(0), m_chunks.size(), [this, flags](size_t idx) {
+        Chunk &chunk = m_chunks[idx];
+        chunk.size = chunk.input.size();
+        chunk.crc = mz_uint32(mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const mz_uint8*>(chunk.input.data()), chunk.input.size()));
+        chunk.output.reserve(chunk.input.size() / 2);
+        auto put_buf = [](const void *buf, int len, void *user) -> mz_bool {
+            static_cast<std::string*>(user)->append(static_cast<const char*>(buf), size_t(len));
+            return MZ_TRUE;
+        };
+        std::unique_ptr<tdefl_compressor> comp(new tdefl_compressor);
+        // Sync flush leaves the stream byte aligned without the final block flag.
+        chunk.ok = tdefl_init(comp.get(), put_buf, &chunk.output, flags) == TDEFL_STATUS_OKAY &&
+                   tdefl_compress_buffer(comp.get(), chunk.input.data(), chunk.input.size(), TDEFL_SYNC_FLUSH) == TDEFL_STATUS_OKAY;
+        std::string().swap(chunk.input);
+    });
+
+    // Append the compressed chunks in order, bypassing the compressor of the staged context.
+    mz_zip_writer_add_state &state = m_context.add_state;
+    for (Chunk &chunk : m_chunks) {
+        if (! chunk.ok) {
+            m_zip.m_last_error = MZ_ZIP_COMPRESSION_FAILED;
+            return false;
+        }
+        if (m_context.file_ofs + chunk.size > m_context.max_size) {
+            // Report the size limit distinctly, not as a read error as miniz does.
+            m_zip.m_last_error = MZ_ZIP_FILE_TOO_LARGE;
+            return false;
+        }
+        if (m_zip.m_pWrite(m_zip.m_pIO_opaque, state.m_cur_archive_file_ofs, chunk.output.data(), chunk.output.size()) != chunk.output.size()) {
+            m_zip.m_last_error = MZ_ZIP_FILE_WRITE_FAILED;
+            return false;
+        }
+        state.m_cur_archive_file_ofs += chunk.output.size();
+        state.m_comp_size            += chunk.output.size();
+        m_context.uncomp_crc32        = mz_crc32_combine(m_context.uncomp_crc32, chunk.crc, chunk.size);
+        m_context.file_ofs           += chunk.size;
+    }
+
+    m_chunks.clear();
+    return true;
+}
+
 MZ_Archive::MZ_Archive()
 {
     mz_zip_zero_struct(&arch);
@@ -2,6 +2,7 @@
 #define MINIZ_EXTENSION_HPP
 
 #include <string>
+#include <vector>
 #include <miniz.h>
 
 namespace Slic3r {
@@ -11,6 +12,10 @@ bool open_zip_writer(mz_zip_archive *zip, const std::string &fname_utf8);
 bool close_zip_reader(mz_zip_archive *zip);
 bool close_zip_writer(mz_zip_archive *zip);
 
+// CRC-32 of the concatenation of two buffers given their CRCs and the length
+// of the second buffer (same algorithm as zlib's crc32_combine()).
+mz_uint32 mz_crc32_combine(mz_uint32 crc1, mz_uint32 crc2, mz_uint64 len2);
+
 class MZ_Archive {
 public:
     mz_zip_archive arch;
@@ -30,6 +35,58 @@ public:
     }
 };
 
+// Writes a single archive entry piecewise like mz_zip_writer_add_staged_*(),
+// but the data is cut into chunks that are deflated independently on the TBB
+// pool (pigz style). Each chunk ends with a sync flush, so the compressed
+// chunks concatenate into one valid deflate stream, which is terminated by
+// mz_zip_writer_add_staged_finish(). Compression ratio is slightly worse than
+// with a single compressor, as back references never cross chunk boundaries.
+class MZ_ParallelDeflate {
+public:
+    struct Params {
+        // Uncompressed bytes per independently deflated chunk.
+        size_t  chunk_size = 1 << 20;
+        // Compression level 1 (fastest) to 10 (uber), 0 is not allowed.
+        mz_uint level      = MZ_BEST_SPEED;
+        // Number of chunks buffered before they are compressed and flushed,
+        // zero means twice the number of hardware threads.
+        size_t  batch_size = 0;
+    };
+
+    explicit MZ_ParallelDeflate(mz_zip_archive &zip) : MZ_ParallelDeflate(zip, Params{}) {}
+    MZ_ParallelDeflate(mz_zip_archive &zip, const Params &params);
+    ~MZ_ParallelDeflate();
+
+    MZ_ParallelDeflate(const MZ_ParallelDeflate&) = delete;
+    MZ_ParallelDeflate& operator=(const MZ_ParallelDeflate&) = delete;
+
+    // Same meaning of max_size as with mz_zip_writer_add_staged_open().
+    // Writing more than max_size bytes fails with MZ_ZIP_FILE_TOO_LARGE.
+    // The name has to stay valid until finish() returns.
+    bool open(const char *archive_name, mz_uint64 max_size);
+    bool write(const void *data, size_t n);
+    // Flushes the remaining data and finalizes the entry.
+    bool finish();
+
+private:
+    struct Chunk {
+        std::string input;
+        std::string output;
+        size_t      size = 0;
+        mz_uint32   crc = MZ_CRC32_INIT;
+        bool        ok  = false;
+    };
+
+    bool flush_chunks();
+
+    mz_zip_archive               &m_zip;
+    Params                        m_params;
+    mz_zip_writer_staged_context  m_context;
+    bool                          m_open = false;
+    std::string                   m_pending;
+    std::vector<Chunk>            m_chunks;
+};
+
 } // namespace Slic3r
 
 #endif // MINIZ_EXTENSION_HPP
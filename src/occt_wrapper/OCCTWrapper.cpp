@@ -2,7 +2,9 @@
 
 #include "occtwrapper_export.h"
 
+#include <atomic>
 #include <cassert>
+#include <mutex>
 
 #ifdef _WIN32
 #define DIR_SEPARATOR '\\'
@@ -21,13 +23,7 @@
 #include "BRepBuilderAPI_Transform.hxx"
 #include "TopExp_Explorer.hxx"
 #include "BRep_Tool.hxx"
-
-const double STEP_TRANS_CHORD_ERROR = 0.005;
-const double STEP_TRANS_ANGLE_RES = 1;
-
-// const int LOAD_STEP_STAGE_READ_FILE          = 0;
-// const int LOAD_STEP_STAGE_GET_SOLID          = 1;
-// const int LOAD_STEP_STAGE_GET_MESH           = 2;
+#include "OSD_Parallel.hxx"
 
 namespace Slic3r {
 
@@ -77,16 +73,83 @@ static void getNamedSolids(const TopLoc_Location& location, const Handle(XCAFDoc
     }
 }
 
-extern "C" OCCTWRAPPER_EXPORT bool load_step_internal(const char *path, OCCTResult* res /*BBS:, ImportStepProgressFn proFn*/)
+// Serializes the progress reports of the tessellation threads, remembers a cancellation.
+class LoadStepProgress
+{
+public:
+    explicit LoadStepProgress(const OCCTParams &params) : m_params(params) {}
+
+    // Returns true if the import was canceled.
+    bool report(int load_stage, int current, int total) {
+        if (m_canceled)
+            return true;
+        if (m_params.progress_fn) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (! m_canceled && m_params.progress_fn(m_params.progress_data, load_stage, current, total))
+                m_canceled = true;
+        }
+        return m_canceled;
+    }
+    bool canceled() const { return m_canceled; }
+
+private:
+    const OCCTParams &m_params;
+    std::mutex        m_mutex;
+    std::atomic<bool> m_canceled { false };
+};
+
+static void tessellate_solid(const NamedSolid &named_solid, const OCCTParams &params, OCCTVolume &volume)
+{
+    auto& vertices = volume.vertices;
+    auto& indices  = volume.indices;
+
+    BRepMesh_IncrementalMesh mesh(named_solid.solid, params.linear_deflection, false, params.angle_deflection, true);
+
+    for (TopExp_Explorer anExpSF(named_solid.solid, TopAbs_FACE); anExpSF.More(); anExpSF.Next()) {
+        const int aNodeOffset = int(vertices.size());
+        const TopoDS_Shape& aFace = anExpSF.Current();
+        TopLoc_Location aLoc;
+        Handle(Poly_Triangulation) aTriangulation = BRep_Tool::Triangulation(TopoDS::Face(aFace), aLoc);
+        if (aTriangulation.IsNull())
+            continue;
+
+        // First copy vertices (will create duplicates).
+        gp_Trsf aTrsf = aLoc.Transformation();
+        for (Standard_Integer aNodeIter = 1; aNodeIter <= aTriangulation->NbNodes(); ++aNodeIter) {
+            gp_Pnt aPnt = aTriangulation->Node(aNodeIter);
+            aPnt.Transform(aTrsf);
+            vertices.push_back({float(aPnt.X()), float(aPnt.Y()), float(aPnt.Z())});
+        }
+        // Now the indices.
+        const TopAbs_Orientation anOrientation = anExpSF.Current().Orientation();
+        for (Standard_Integer aTriIter = 1; aTriIter <= aTriangulation->NbTriangles(); ++aTriIter) {
+            Poly_Triangle aTri = aTriangulation->Triangle(aTriIter);
+
+            Standard_Integer anId[3];
+            aTri.Get(anId[0], anId[1], anId[2]);
+            if (anOrientation == TopAbs_REVERSED)
+                std::swap(anId[1], anId[2]);
+
+            // Account for the vertices we already have from previous faces.
+            // anId is 1-based index !
+            indices.push_back({anId[0] - 1 + aNodeOffset,
+                               anId[1] - 1 + aNodeOffset,
+                               anId[2] - 1 + aNodeOffset});
+        }
+    }
+
+    volume.volume_name = named_solid.name;
+}
+
+extern "C" OCCTWRAPPER_EXPORT bool load_step_internal(const char *path, OCCTResult* res, const OCCTParams *params_ptr)
 {
 try {
-    //bool cb_cancel = false;
-    //if (proFn) {
-    //    proFn(LOAD_STEP_STAGE_READ_FILE, 0, 1, cb_cancel);
-    //    if (cb_cancel)
-    //        return false;
-    //}
-    
+    const OCCTParams params = params_ptr ? *params_ptr : OCCTParams();
+    LoadStepProgress progress(params);
+    if (progress.report(LOAD_STEP_STAGE_READ_FILE, 0, 1)) {
+        res->canceled = true;
+        return false;
+    }
 
     std::vector<NamedSolid> namedSolids;
     Handle(TDocStd_Document) document;
@@ -107,83 +170,44 @@ try {
 
     Standard_Integer topShapeLength = topLevelShapes.Length() + 1;
     for (Standard_Integer iLabel = 1; iLabel < topShapeLength; ++iLabel) {
-        //if (proFn) {
-        //    proFn(LOAD_STEP_STAGE_GET_SOLID, iLabel, topShapeLength, cb_cancel);
-        //    if (cb_cancel) {
-        //        shapeTool.reset(nullptr);
-        //        application->Close(document);
-        //        return false;
-        //    }
-        //}
+        if (progress.report(LOAD_STEP_STAGE_GET_SOLID, iLabel, topShapeLength)) {
+            shapeTool.reset(nullptr);
+            application->Close(document);
+            res->canceled = true;
+            return false;
+        }
         getNamedSolids(TopLoc_Location{}, shapeTool, topLevelShapes.Value(iLabel), namedSolids);
     }
 
-    
-
     // Now the object name. Set it to filename without suffix.
     // This will later be changed if only one volume is loaded.
     const char *last_slash = strrchr(path, DIR_SEPARATOR);
     std::string obj_name((last_slash == nullptr) ? path : last_slash + 1);
     res->object_name = obj_name;
 
-    for (size_t i = 0; i < namedSolids.size(); ++i) {
-        //BBS:if (proFn) {
-        //    proFn(LOAD_STEP_STAGE_GET_MESH, i, namedSolids.size(), cb_cancel);
-        //    if (cb_cancel) {
-        //        model->delete_object(new_object);
-        //        shapeTool.reset(nullptr);
-        //        application->Close(document);
-        //        return false;
-        //    }
-        //}
-
-        res->volumes.emplace_back();
-        auto& vertices = res->volumes.back().vertices;
-        auto& indices  = res->volumes.back().indices;
-
-        BRepMesh_IncrementalMesh mesh(namedSolids[i].solid, STEP_TRANS_CHORD_ERROR, false, STEP_TRANS_ANGLE_RES, true);
-
-        for (TopExp_Explorer anExpSF(namedSolids[i].solid, TopAbs_FACE); anExpSF.More(); anExpSF.Next()) {
-            const int aNodeOffset = int(vertices.size());
-            const TopoDS_Shape& aFace = anExpSF.Current();
-            TopLoc_Location aLoc;
-            Handle(Poly_Triangulation) aTriangulation = BRep_Tool::Triangulation(TopoDS::Face(aFace), aLoc);
-            if (aTriangulation.IsNull())
-                continue;
-
-            // First copy vertices (will create duplicates).
-            gp_Trsf aTrsf = aLoc.Transformation();
-            for (Standard_Integer aNodeIter = 1; aNodeIter <= aTriangulation->NbNodes(); ++aNodeIter) {
-                gp_Pnt aPnt = aTriangulation->Node(aNodeIter);
-                aPnt.Transform(aTrsf);
-                vertices.push_back({float(aPnt.X()), float(aPnt.Y()), float(aPnt.Z())});
-            }
-            // Now the indices.
-            const TopAbs_Orientation anOrientation = anExpSF.Current().Orientation();
-            for (Standard_Integer aTriIter = 1; aTriIter <= aTriangulation->NbTriangles(); ++aTriIter) {
-                Poly_Triangle aTri = aTriangulation->Triangle(aTriIter);
-
-                Standard_Integer anId[3];
-                aTri.Get(anId[0], anId[1], anId[2]);
-                if (anOrientation == TopAbs_REVERSED)
-                    std::swap(anId[1], anId[2]);
-
-                // Account for the vertices we already have from previous faces.
-                // anId is 1-based index !
-                indices.push_back({anId[0] - 1 + aNodeOffset,
-                                   anId[1] - 1 + aNodeOffset,
-                                   anId[2] - 1 + aNodeOffset});
-            }
-        }
+    // The solids are independent copies of the document shapes, they are tessellated in parallel.
+    // BRepMesh_IncrementalMesh is parallel over the faces of a solid as well.
+    std::vector<OCCTVolume> volumes(namedSolids.size());
+    std::atomic<int>        num_done { 0 };
+    progress.report(LOAD_STEP_STAGE_GET_MESH, 0, int(namedSolids.size()));
+    OSD_Parallel::For(0, int(namedSolids.size()), [&](int i) {
+        if (progress.canceled())
+            return;
+        tessellate_solid(namedSolids[i], params, volumes[i]);
+        progress.report(LOAD_STEP_STAGE_GET_MESH, ++ num_done, int(namedSolids.size()));
+    });
 
-        res->volumes.back().volume_name = namedSolids[i].name;
+    shapeTool.reset(nullptr);
+    application->Close(document);
 
-        if (vertices.empty())
-            res->volumes.pop_back();        
+    if (progress.canceled()) {
+        res->canceled = true;
+        return false;
     }
 
-    shapeTool.reset(nullptr);
-    application->Close(document);
+    for (OCCTVolume &volume : volumes)
+        if (! volume.vertices.empty())
+            res->volumes.emplace_back(std::move(volume));
 
     if (res->volumes.empty())
         return false;
@@ -18,9 +18,27 @@ struct OCCTResult {
     std::string error_str;
     std::string object_name;
     std::vector<OCCTVolume> volumes;
+    bool        canceled { false };
 };
 
-using LoadStepFn = bool (*)(const char *path, OCCTResult* occt_result);
+enum OCCTLoadStage : int {
+    LOAD_STEP_STAGE_READ_FILE = 0,
+    LOAD_STEP_STAGE_GET_SOLID = 1,
+    LOAD_STEP_STAGE_GET_MESH  = 2
+};
+
+// Reports current of total done in the load stage. Called from the tessellation threads,
+// but never concurrently. Returns true to cancel the import.
+using OCCTProgressFn = bool (*)(void *user_data, int load_stage, int current, int total);
+
+struct OCCTParams {
+    double          linear_deflection { 0.005 };
+    double          angle_deflection  { 1. };
+    OCCTProgressFn  progress_fn       { nullptr };
+    void           *progress_data     { nullptr };
+};
+
+using LoadStepFn = bool (*)(const char *path, OCCTResult* occt_result, const OCCTParams *params);
 
 }; // namespace Slic3r
 
@@ -18,6 +18,7 @@
 // Print now includes tbb, and tbb includes Windows. This breaks compilation of wxWidgets if included before wx.
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/AppConfig.hpp"
 #include "libslic3r/Utils.hpp"
 #include "libslic3r/GCode/PostProcessor.hpp"
 #include "libslic3r/Format/SL1.hpp"
@@ -446,6 +447,9 @@ bool BackgroundSlicingProcess::start()
 	if (! this->idle())
 		throw Slic3r::RuntimeError("Cannot start a background task, the worker thread is not idle.");
 	m_state = STATE_STARTED;
+	// Read on the UI thread, the archive is exported by the worker thread.
+	m_zaxe_archive.set_model_format(GUI::wxGetApp().app_config->get("zaxe_indexed_model") == "1" ?
+		ZaxeArchive::ModelFormat::Indexed : ZaxeArchive::ModelFormat::STL);
 	m_print->set_cancel_callback([this](){ this->stop_internal(); });
 	lck.unlock();
 	m_condition.notify_one();
@@ -751,8 +755,6 @@ void BackgroundSlicingProcess::prepare_zaxe_file()
 	m_zaxe_archive_path = zip_path.string();
 	std::string model = GUI::wxGetApp().preset_bundle->printers.get_selected_preset().name;
 	if (is_there(model, {"Z1", "Z2", "Z3"})) {
-		if (is_there(model, {"Z2", "Z3"})) // export stl if model is Z2 or Z3.
-			GUI::wxGetApp().mainframe->m_plater->export_stl(false, false, true);
 		// Generate thumbnails. Get the sizes from config.
 		ThumbnailsList thumbnails = this->render_thumbnails(ThumbnailsParams{current_print()->full_print_config().option<ConfigOptionPoints>("thumbnails")->values, true, true, false, true});
 		m_zaxe_archive.export_print(m_zaxe_archive_path, thumbnails, *m_fff_print, m_temp_output_path); // output path for gcode itself and checksum.
@@ -13,6 +13,7 @@ namespace GUI {
 Device::Device(NetworkMachine* nm, wxWindow* parent) :
     wxPanel(parent, wxID_ANY, wxDefaultPosition, wxSize(parent->GetSize().GetWidth(), DEVICE_HEIGHT)),
     nm(nm),
+    m_state(nm->snapshot()),
     m_mainSizer(new wxBoxSizer(wxVERTICAL)), // vertical sizer (device sizer - horizontal line (seperator).
     m_deviceSizer(new wxBoxSizer(wxHORIZONTAL)), // horizontal sizer (avatar | right pane).)
     m_expansionSizer(new wxBoxSizer(wxVERTICAL)), // vertical sizer (filament | printing time etc.)
@@ -20,13 +21,13 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
     m_progressBar(new CustomProgressBar(this, wxID_ANY, wxSize(-1, 5))),
     m_txtStatus(new wxStaticText(this, wxID_ANY, "", wxDefaultPosition, wxSize(-1, 18), wxTE_LEFT)),
     m_txtProgress(new wxStaticText(this, wxID_ANY, "", wxDefaultPosition, wxSize(-1, 18), wxTE_RIGHT)),
-    m_txtDeviceName(new wxStaticText(this, wxID_ANY, nm->name, wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
-    m_txtDeviceMaterial(new wxStaticText(this, wxID_ANY, _L("Material: ") + NetworkMachineManager::MaterialName(nm->attr->material), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
-    m_txtDeviceNozzleDiameter(new wxStaticText(this, wxID_ANY, _L("Nozzle: ") + (nm->attr->isLite ? "-" : nm->attr->nozzle + "mm"), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
+    m_txtDeviceName(new wxStaticText(this, wxID_ANY, m_state.name, wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
+    m_txtDeviceMaterial(new wxStaticText(this, wxID_ANY, _L("Material: ") + NetworkMachineManager::MaterialName(m_state.attr.material), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
+    m_txtDeviceNozzleDiameter(new wxStaticText(this, wxID_ANY, _L("Nozzle: ") + (m_state.attr.isLite ? "-" : m_state.attr.nozzle + "mm"), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
     m_txtDeviceIP(new wxStaticText(this, wxID_ANY, _L("IP Address: ") + nm->ip, wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
     m_txtBedOccupiedMessage(new wxStaticText(this, wxID_ANY, _L("Please take your print!"), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
-    m_txtFileTime(new wxStaticText(this, wxID_ANY, _L("Elapsed / Estimated time: ") + get_time_hms(std::to_string(nm->attr->startTime)) + " / " + nm->attr->estimatedTime, wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
-    m_txtFileName(new wxStaticText(this, wxID_ANY, _L("File: ") + nm->attr->printingFile.substr(0, DEVICE_FILENAME_MAX_NUM_CHARS), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
+    m_txtFileTime(new wxStaticText(this, wxID_ANY, _L("Elapsed / Estimated time: ") + get_time_hms(std::to_string(m_state.attr.startTime)) + " / " + m_state.attr.estimatedTime, wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
+    m_txtFileName(new wxStaticText(this, wxID_ANY, _L("File: ") + m_state.attr.printingFile.substr(0, DEVICE_FILENAME_MAX_NUM_CHARS), wxDefaultPosition, wxSize(-1, 20), wxTE_LEFT)),
     m_btnPrintNow(new wxButton(this, wxID_ANY, _L("Print Now!"))),
     m_avatar(new RoundedPanel(this, wxID_ANY, "", wxSize(60, 60), wxColour(169, 169, 169), wxColour("WHITE"))),
     m_bitPreheatActive(new wxBitmap()),
@@ -69,8 +70,12 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
     m_timer->Bind(wxEVT_TIMER, [this](wxTimerEvent &evt) { this->onTimer(evt); });
 
     nm->setUploadProgressCallback([this](int progress) {
-        if (progress <= 0 || progress >= 100) this->updateStates();
-        this->updateProgress();
+        // Called on the network threads, the pending calls go away with this panel.
+        this->CallAfter([this, progress]() {
+            this->refreshState();
+            if (progress <= 0 || progress >= 100) this->updateStates();
+            this->updateProgress();
+        });
     });
     // End of actions
     // action buttons end.
@@ -84,7 +89,7 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
 
     // Device model start... (left pane).
     // UI modifications to model text. Upper case then plus => +
-    string dM = to_upper_copy(nm->attr->deviceModel);
+    string dM = to_upper_copy(m_state.attr.deviceModel);
     boost::replace_all(dM, "PLUS", "+");
 #ifdef _WIN32
     boldFont.SetPointSize(14);
@@ -148,25 +153,25 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
     m_rightSizer->Add(m_btnPrintNow, 0, wxTOP, -12);
     m_btnPrintNow->Bind(wxEVT_BUTTON, [this](const wxCommandEvent &evt) {
         this->m_btnPrintNow->Enable(false);
-        BOOST_LOG_TRIVIAL(info) << "Print now pressed on " << this->nm->name;
+        // The machine may have reported a change not shown yet.
+        this->refreshState();
+        BOOST_LOG_TRIVIAL(info) << "Print now pressed on " << m_state.name;
         const ZaxeArchive& archive = wxGetApp().plater()->get_zaxe_archive();
 
-        string dM = to_upper_copy(this->nm->attr->deviceModel);
+        string dM = to_upper_copy(m_state.attr.deviceModel);
         boost::replace_all(dM, "PLUS", "+");
         if (GUI::wxGetApp().preset_bundle->printers.get_selected_preset().name.find(dM) == std::string::npos) {
             wxMessageBox(L("Device model does NOT match. Please reslice with the correct model."), _L("Wrong device model"), wxICON_ERROR);
-        } else if (!this->nm->attr->isLite && this->nm->attr->material.compare(archive.get_info("material")) != 0) {
+        } else if (!m_state.attr.isLite && m_state.attr.material.compare(archive.get_info("material")) != 0) {
             wxMessageBox(L("Materials don't match with this device. Please reslice with the correct material."), _L("Wrong material type"), wxICON_ERROR);
-        } else if (!this->nm->attr->isLite && this->nm->attr->nozzle.compare(archive.get_info("nozzle_diameter")) != 0) {
+        } else if (!m_state.attr.isLite && m_state.attr.nozzle.compare(archive.get_info("nozzle_diameter")) != 0) {
             wxMessageBox(L("Currently installed nozzle on device doesn't match with this slice. Please reslice with the correct nozzle."), _L("Wrong nozzle type"), wxICON_ERROR);
         } else {
-            std::thread t([&]() {
-                if (this->nm->attr->isLite) {
-                    this->nm->upload(wxGetApp().plater()->get_gcode_path().c_str(),
-                                     translate_chars(wxGetApp().plater()->get_filename().ToStdString()).c_str());
-                } else this->nm->upload(wxGetApp().plater()->get_zaxe_code_path().c_str());
-            });
-            t.detach(); // crusial. otherwise blocks main thread.
+            // upload() returns right away, the transfer runs on the shared network context.
+            if (m_state.attr.isLite) {
+                this->nm->upload(wxGetApp().plater()->get_gcode_path().c_str(),
+                                 translate_chars(wxGetApp().plater()->get_filename().ToStdString()).c_str());
+            } else this->nm->upload(wxGetApp().plater()->get_zaxe_code_path().c_str());
         }
         this->m_btnPrintNow->Enable(true);
     });
@@ -176,9 +181,9 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
             SetMinSize(wxSize(GetParent()->GetSize().GetWidth(), DEVICE_HEIGHT));
             m_expansionSizer->ShowItems(false);
         } else {
-            SetMinSize(wxSize(GetParent()->GetSize().GetWidth(), DEVICE_HEIGHT +  (this->nm->states->printing ? 100 : 60)));
+            SetMinSize(wxSize(GetParent()->GetSize().GetWidth(), DEVICE_HEIGHT +  (m_state.states.printing ? 100 : 60)));
             m_expansionSizer->ShowItems(true);
-            if (!this->nm->states->printing) {
+            if (!m_state.states.printing) {
                 // hide m_txtFileName and duration and their bottom borders.
                 for (int i = 0; i < 4; i++)
                     m_expansionSizer->Hide((size_t)i);
@@ -215,6 +220,11 @@ Device::Device(NetworkMachine* nm, wxWindow* parent) :
     m_mainSizer->Layout();
 }
 
+void Device::refreshState()
+{
+    m_state = nm->snapshot();
+}
+
 void Device::avatarReady()
 {
     if (this->nm == nullptr) return;
@@ -224,49 +234,49 @@ void Device::avatarReady()
 void Device::updateStatus()
 {
     wxString statusTxt = "";
-    if (nm->states->bedOccupied) {
+    if (m_state.states.bedOccupied) {
         statusTxt = _L("Bed is occupied...");
-    } else if (nm->states->heating) {
+    } else if (m_state.states.heating) {
         statusTxt = _L("Heating...");
         m_progressBar->SetColour(DEVICE_COLOR_DANGER);
-    } else if (nm->states->printing) {
+    } else if (m_state.states.printing) {
         statusTxt = _L("Printing...");
         m_progressBar->SetColour(DEVICE_COLOR_ZAXE_BLUE);
         if (!m_timer->IsRunning())
             m_timer->Start(1000);
-    } else if (nm->states->uploading) {
+    } else if (m_state.states.uploading) {
         statusTxt = _L("Uploading...");
         m_progressBar->SetColour(DEVICE_COLOR_UPLOADING);
-    } else if (nm->states->paused) {
+    } else if (m_state.states.paused) {
         statusTxt = _L("Paused...");
         m_progressBar->SetColour(DEVICE_COLOR_ZAXE_BLUE);
-    } else if (nm->states->calibrating) {
+    } else if (m_state.states.calibrating) {
         statusTxt = _L("Calibrating...");
         m_progressBar->SetColour(DEVICE_COLOR_ORANGE);
     }
     m_txtStatus->SetLabel(statusTxt);
 
-    if (nm->attr->hasSnapshot) { // if has snapshot and need to show the avatar start downloading...
-        if(nm->states->heating || nm->states->printing || nm->states->calibrating || nm->states->bedOccupied) {
+    if (m_state.attr.hasSnapshot) { // if has snapshot and need to show the avatar start downloading...
+        if(m_state.states.heating || m_state.states.printing || m_state.states.calibrating || m_state.states.bedOccupied) {
             nm->downloadAvatar(); // this fires EVT_MACHINE_AVATAR_READY when it's ready.
         } else m_avatar->Clear(); // clear the last image.
     }
 
-    if (!nm->states->printing && m_timer->IsRunning()) // stop when done.
+    if (!m_state.states.printing && m_timer->IsRunning()) // stop when done.
         m_timer->Stop();
 
-    m_btnPreheat->SetBitmapLabel(*(nm->states->preheat
+    m_btnPreheat->SetBitmapLabel(*(m_state.states.preheat
                                     ? m_bitPreheatActive
                                     : m_bitPreheatDeactive));
 }
 
 void Device::updateStates()
 {
-    if (nm->states->printing ||
-        nm->states->heating ||
-        nm->states->calibrating ||
-        nm->states->paused ||
-        nm->states->uploading) {
+    if (m_state.states.printing ||
+        m_state.states.heating ||
+        m_state.states.calibrating ||
+        m_state.states.paused ||
+        m_state.states.uploading) {
         m_progressBar->Show();
         m_txtProgress->Show();
         m_btnSayHi->Hide();
@@ -275,17 +285,17 @@ void Device::updateStates()
         m_btnResume->Hide();
         m_btnPause->Hide();
         m_txtBedOccupiedMessage->Hide();
-        if (nm->states->printing) {
-            if (nm->states->paused) {
+        if (m_state.states.printing) {
+            if (m_state.states.paused) {
                 m_btnResume->Show();
                 m_btnPause->Hide();
-            } else if (!nm->states->heating) {
+            } else if (!m_state.states.heating) {
                 m_btnResume->Hide();
                 m_btnPause->Show();
             }
             m_btnCancel->Show();
         }
-        if (!nm->states->uploading) {
+        if (!m_state.states.uploading) {
             m_btnCancel->Show();
         }
         updateProgress();
@@ -295,7 +305,7 @@ void Device::updateStates()
         m_btnCancel->Hide();
         m_progressBar->Hide();
         m_txtProgress->Hide();
-        if (nm->states->bedOccupied) {
+        if (m_state.states.bedOccupied) {
             m_txtBedOccupiedMessage->Show();
             m_btnPrintNow->Hide();
             m_btnSayHi->Hide();
@@ -308,7 +318,7 @@ void Device::updateStates()
         }
     }
 
-    if (nm->states->printing) {
+    if (m_state.states.printing) {
         if (m_isExpanded) {
             // show m_txtFileName and duration and their bottom borders.
             for (int i = 0; i < 4; i++)
@@ -321,7 +331,7 @@ void Device::updateStates()
     }
 
     if (m_isExpanded) {
-        SetMinSize(wxSize(GetParent()->GetSize().GetWidth(), DEVICE_HEIGHT +  (this->nm->states->printing ? 100 : 60)));
+        SetMinSize(wxSize(GetParent()->GetSize().GetWidth(), DEVICE_HEIGHT +  (m_state.states.printing ? 100 : 60)));
         m_expansionSizer->Layout();
         GetParent()->Layout();
         GetParent()->FitInside();
@@ -333,8 +343,8 @@ void Device::updateStates()
 
 void Device::updateProgress()
 {
-    m_progressBar->SetValue(nm->progress);
-    m_txtProgress->SetLabel("%" + std::to_string(nm->progress));
+    m_progressBar->SetValue(m_state.progress);
+    m_txtProgress->SetLabel("%" + std::to_string(m_state.progress));
     m_mainSizer->Layout();
     GetParent()->Refresh(); // crusial otherwise doesn't show upload progress...
 }
@@ -346,7 +356,7 @@ void Device::setName(const string &name)
 
 void Device::setFileStart()
 {
-    m_txtFileName->SetLabel(nm->attr->printingFile.substr(0, DEVICE_FILENAME_MAX_NUM_CHARS));
+    m_txtFileName->SetLabel(m_state.attr.printingFile.substr(0, DEVICE_FILENAME_MAX_NUM_CHARS));
     m_pausedSeconds = 0; // reset
 }
 
@@ -371,10 +381,10 @@ void Device::onTimer(wxTimerEvent& event)
     m_txtFileTime->SetLabel(_L("Elapsed / Estimated time: ") +
         get_time_hms(
             wxDateTime::Now().GetTicks() -
-            this->nm->attr->startTime -
+            m_state.attr.startTime -
             // make it look paused by incrementing and subtracting from the counter.
-            (nm->states->paused ? m_pausedSeconds++ : m_pausedSeconds))
-        + " / " + nm->attr->estimatedTime);
+            (m_state.states.paused ? m_pausedSeconds++ : m_pausedSeconds))
+        + " / " + m_state.attr.estimatedTime);
 }
 
 void Device::confirm(function<void()> cb)
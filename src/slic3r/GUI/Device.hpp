@@ -58,6 +58,8 @@ public:
     wxString name;
     NetworkMachine* nm; // network machine.
 
+    // Copies the state of nm under its lock, the other methods show the last copy.
+    void refreshState();
     void setName(const string &name);
     void setFileStart();
     void updateStates();
@@ -69,6 +71,7 @@ public:
 
     void onTimer(wxTimerEvent& event);
 private:
+    MachineSnapshot m_state; // written by the network threads, so shown from a copy.
     wxTimer* m_timer; // elapsed timer.
     void confirm(std::function<void()> cb);
     wxSizer* m_mainSizer; // vertical sizer (device sizer - horizontal line (seperator).
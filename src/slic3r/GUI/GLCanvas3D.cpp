@@ -14,6 +14,7 @@
 #include "libslic3r/Technologies.hpp"
 #include "libslic3r/Tesselate.hpp"
 #include "libslic3r/PresetBundle.hpp"
+#include "libslic3r/SlicingAdaptive.hpp"
 #include "slic3r/GUI/3DBed.hpp"
 #include "slic3r/GUI/3DScene.hpp"
 #include "slic3r/GUI/BackgroundSlicingProcess.hpp"
@@ -150,6 +151,7 @@ GLCanvas3D::LayersEditing::~LayersEditing()
         m_z_texture_id = 0;
     }
     delete m_slicing_parameters;
+    delete m_slicing_adaptive;
 }
 
 const float GLCanvas3D::LayersEditing::THICKNESS_BAR_WIDTH = 70.0f;
@@ -187,6 +189,8 @@ void GLCanvas3D::LayersEditing::select_object(const Model &model, int object_id)
         m_layer_height_profile_modified = false;
         delete m_slicing_parameters;
         m_slicing_parameters   = nullptr;
+        delete m_slicing_adaptive;
+        m_slicing_adaptive     = nullptr;
         m_layers_texture.valid = false;
         this->last_object_id   = object_id;
         m_model_object         = model_object_new;
@@ -507,7 +511,13 @@ void GLCanvas3D::LayersEditing::reset_layer_height_profile(GLCanvas3D& canvas)
 void GLCanvas3D::LayersEditing::adaptive_layer_height_profile(GLCanvas3D& canvas, float quality_factor)
 {
     this->update_slicing_parameters();
-    m_layer_height_profile = layer_height_profile_adaptive(*m_slicing_parameters, *m_model_object, quality_factor);
+    if (m_slicing_adaptive == nullptr || ! m_slicing_adaptive->prepared_for(*m_model_object)) {
+        delete m_slicing_adaptive;
+        m_slicing_adaptive = new SlicingAdaptive();
+        m_slicing_adaptive->prepare(*m_model_object);
+    }
+    m_slicing_adaptive->set_slicing_parameters(*m_slicing_parameters);
+    m_layer_height_profile = layer_height_profile_adaptive(*m_slicing_parameters, *m_slicing_adaptive, quality_factor);
     const_cast<ModelObject*>(m_model_object)->layer_height_profile.set(m_layer_height_profile);
     m_layers_texture.valid = false;
     canvas.post_event(SimpleEvent(EVT_GLCANVAS_SCHEDULE_BACKGROUND_PROCESS));
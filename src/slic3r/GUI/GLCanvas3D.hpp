@@ -208,6 +208,9 @@ class GLCanvas3D
         float                       m_object_max_z{ 0.0f };
         // Owned by LayersEditing.
         SlicingParameters           *m_slicing_parameters{ nullptr };
+        // Owned by LayersEditing. Faces of m_model_object indexed for the adaptive layer height calculation,
+        // reused while the quality factor is being tuned.
+        SlicingAdaptive             *m_slicing_adaptive{ nullptr };
         std::vector<double>         m_layer_height_profile;
         bool                        m_layer_height_profile_modified{ false };
 
@@ -22,6 +22,7 @@ NetworkMachineManager::NetworkMachineManager(wxWindow* parent) :
 
     // start listenting for devices here on the network.
     m_broadcastReceiver->Bind(EVT_BROADCAST_RECEIVED, &NetworkMachineManager::onBroadcastReceived, this);
+    m_frameTimer.Bind(wxEVT_TIMER, &NetworkMachineManager::onFrame, this);
 }
 
 void NetworkMachineManager::enablePrintNowButton(bool enable)
@@ -36,21 +37,19 @@ void NetworkMachineManager::enablePrintNowButton(bool enable)
 
 void NetworkMachineManager::onBroadcastReceived(wxCommandEvent &event)
 {
-    std::stringstream jsonStream;
-    jsonStream.str(std::string(event.GetString().utf8_str().data())); // wxString to std::string
-
-    boost::property_tree::ptree pt; // construct root obj.
-    boost::property_tree::read_json(jsonStream, pt);
+    JsonReader json(std::string(event.GetString().utf8_str().data())); // wxString to std::string
 
     try {
+        if (!json.has("ip") || !json.has("port") || !json.has("id"))
+            throw Slic3r::RuntimeError("missing ip, port or id");
         auto machine  = this->m_networkMContainer->addMachine(
-            pt.get<std::string>("ip"),
-            pt.get<int>("port"),
-            pt.get<std::string>("id"));
+            json.get_string("ip"),
+            json.get_int("port"),
+            json.get_string("id"));
         if (machine != nullptr) {
             this->m_networkMContainer->Bind(EVT_MACHINE_OPEN, &NetworkMachineManager::onMachineOpen, this);
             this->m_networkMContainer->Bind(EVT_MACHINE_CLOSE, &NetworkMachineManager::onMachineClose, this);
-            this->m_networkMContainer->Bind(EVT_MACHINE_NEW_MESSAGE, &NetworkMachineManager::onMachineMessage, this);
+            this->m_networkMContainer->Bind(EVT_MACHINE_UPDATES_PENDING, &NetworkMachineManager::onMachineUpdatesPending, this);
             this->m_networkMContainer->Bind(EVT_MACHINE_AVATAR_READY, &NetworkMachineManager::onMachineAvatarReady, this);
         }
     } catch(std::exception ex) {
@@ -62,7 +61,8 @@ void NetworkMachineManager::onMachineOpen(MachineEvent &event)
 {
     // Now we can add this to UI.
     if (!event.nm || m_deviceMap.find(event.nm->ip) != m_deviceMap.end()) return;
-    BOOST_LOG_TRIVIAL(info) << boost::format("NetworkMachineManager - Connected to machine: [%1% - %2%].") % event.nm->name % event.nm->ip;
+    BOOST_LOG_TRIVIAL(info) << boost::format("NetworkMachineManager - Connected to machine: [%1% - %2%].") % event.nm->snapshot().name % event.nm->ip;
+    event.nm->takePendingUpdates(); // the new device shows the current state already.
     shared_ptr<Device> d = make_shared<Device>(event.nm, this);
     d->enablePrintNowButton(m_printNowButtonEnabled);
     m_deviceMap[event.nm->ip] = d;
@@ -75,29 +75,71 @@ void NetworkMachineManager::onMachineOpen(MachineEvent &event)
 void NetworkMachineManager::onMachineClose(MachineEvent &event)
 {
     if (!event.nm) return;
-    if (m_deviceMap.erase(event.nm->ip) == 0) return; // couldn't delete so don't continue...
-    BOOST_LOG_TRIVIAL(info) << boost::format("NetworkMachineManager - Closing machine: [%1% - %2%].") % event.nm->name % event.nm->ip;
+    auto it = m_deviceMap.find(event.nm->ip);
+    if (it == m_deviceMap.end()) return; // couldn't delete so don't continue...
+    if (it->second != nullptr) {
+        // keep the counters of the machine.
+        MachineUpdateStats stats = event.nm->updateStats();
+        m_closedMachineStats.posted  += stats.posted;
+        m_closedMachineStats.merged  += stats.merged;
+        m_closedMachineStats.dropped += stats.dropped;
+    }
+    m_deviceMap.erase(it);
+    BOOST_LOG_TRIVIAL(info) << boost::format("NetworkMachineManager - Closing machine: [%1% - %2%].") % event.nm->snapshot().name % event.nm->ip;
     this->m_networkMContainer->removeMachine(event.nm->ip);
     m_scrolledSizer->Layout();
     FitInside();
     Refresh();
 }
 
-void NetworkMachineManager::onMachineMessage(MachineNewMessageEvent &event)
+void NetworkMachineManager::onMachineUpdatesPending(MachineEvent &event)
+{
+    // The machine may be gone already, so only compare the pointer. Updates of machines not
+    // shown yet are taken by onMachineOpen().
+    auto it = std::find_if(m_deviceMap.begin(), m_deviceMap.end(),
+        [&event](const auto &it) { return it.second != nullptr && it.second->nm == event.nm; });
+    if (it == m_deviceMap.end()) return;
+    if (m_frameTimer.IsRunning()) return; // will be applied with the current frame.
+    // Apply right away if the last frame was long enough ago, otherwise wait for the rest of the frame.
+    long elapsed = (wxGetLocalTimeMillis() - m_lastFrame).ToLong();
+    m_frameTimer.StartOnce(std::max(1L, FRAME_INTERVAL_MS - elapsed));
+}
+
+void NetworkMachineManager::onFrame(wxTimerEvent &event)
+{
+    m_lastFrame = wxGetLocalTimeMillis();
+    for (auto& it : m_deviceMap)
+        if (it.second != nullptr)
+            applyUpdates(*it.second);
+}
+
+void NetworkMachineManager::applyUpdates(Device &device)
+{
+    uint32_t updates = device.nm->takePendingUpdates();
+    if (updates == 0)
+        return;
+    device.refreshState();
+    if (updates & MachineUpdate::States)
+        device.updateStates();
+    if (updates & MachineUpdate::Progress)
+        device.updateProgress();
+    if (updates & MachineUpdate::Name)
+        device.setName(device.nm->snapshot().name);
+    if (updates & MachineUpdate::FileStart)
+        device.setFileStart();
+}
+
+MachineUpdateStats NetworkMachineManager::updateStats() const
 {
-    if (!event.nm || m_deviceMap[event.nm->ip] == nullptr) return;
-    if (event.event == "states_update") {
-        m_deviceMap[event.nm->ip]->updateStates();
-    } else if (event.event == "print_progress" ||
-               event.event == "temperature_progress" ||
-               event.event == "calibration_progress") {
-        event.nm->progress = event.pt.get<float>("progress", 0);
-        m_deviceMap[event.nm->ip]->updateProgress();
-    } else if (event.event == "new_name") {
-        m_deviceMap[event.nm->ip]->setName(event.nm->name);
-    } else if (event.event == "start_print") {
-        m_deviceMap[event.nm->ip]->setFileStart();
+    MachineUpdateStats stats = m_closedMachineStats;
+    for (auto& it : m_deviceMap) {
+        if (it.second == nullptr) continue;
+        MachineUpdateStats s = it.second->nm->updateStats();
+        stats.posted  += s.posted;
+        stats.merged  += s.merged;
+        stats.dropped += s.dropped;
     }
+    return stats;
 }
 
 void NetworkMachineManager::onMachineAvatarReady(wxCommandEvent &event)
@@ -110,6 +152,9 @@ void NetworkMachineManager::onMachineAvatarReady(wxCommandEvent &event)
 
 NetworkMachineManager::~NetworkMachineManager()
 {
+    m_frameTimer.Stop();
+    MachineUpdateStats stats = updateStats();
+    BOOST_LOG_TRIVIAL(debug) << boost::format("NetworkMachineManager - machine updates posted: %1%, merged: %2%, dropped: %3%.") % stats.posted % stats.merged % stats.dropped;
     m_deviceMap.clear(); // since the map holds shared_ptrs clear is enough
     delete m_broadcastReceiver;
     delete m_networkMContainer;
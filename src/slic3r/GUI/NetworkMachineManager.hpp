@@ -4,6 +4,8 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
+#include <wx/time.h>
+#include <wx/timer.h>
 
 #include "../Utils/BroadcastReceiver.hpp"
 #include "../Utils/NetworkMachine.hpp"
@@ -22,6 +24,8 @@ public:
     virtual ~NetworkMachineManager(); // avoid leakage on possible children.
 
     void enablePrintNowButton(bool enable);
+    // Update counters summed over all the machines shown so far.
+    MachineUpdateStats updateStats() const;
 
     static inline std::map<string, string> materialMap = {
         { "zaxe_abs", "Zaxe ABS" },
@@ -39,18 +43,25 @@ public:
     };
 
 private:
+    static constexpr int FRAME_INTERVAL_MS = 100; // pending machine updates are applied at most this often.
+
     // slots
     void onBroadcastReceived(wxCommandEvent &event);
     void onMachineOpen(MachineEvent &event);
     void onMachineClose(MachineEvent &event);
-    void onMachineMessage(MachineNewMessageEvent &event);
+    void onMachineUpdatesPending(MachineEvent &event);
     void onMachineAvatarReady(wxCommandEvent &event);
+    void onFrame(wxTimerEvent &event); // applies the updates pending on all the machines.
+    void applyUpdates(Device &device);
 
     BroadcastReceiver* m_broadcastReceiver;
     NetworkMachineContainer* m_networkMContainer;
 
     // UI
     wxSizer* m_scrolledSizer;
+    wxTimer m_frameTimer; // one shot, started by the first pending update of a frame.
+    wxLongLong m_lastFrame = 0; // ms.
+    MachineUpdateStats m_closedMachineStats; // counters of the machines already closed.
 
     boost::unordered_map<std::string, shared_ptr<Device>> m_deviceMap;
 
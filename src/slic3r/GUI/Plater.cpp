@@ -37,7 +37,9 @@
 #include "libslic3r/Format/STL.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
+#include "libslic3r/Format/STEP.hpp"
 #include "libslic3r/GCode/ThumbnailData.hpp"
+#include "libslic3r/LocalesUtils.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/SLA/Hollowing.hpp"
 #include "libslic3r/SLA/SupportPoint.hpp"
@@ -1832,7 +1834,7 @@ struct Plater::priv
     std::vector<size_t> load_model_objects(const ModelObjectPtrs& model_objects, bool allow_negative_z = false);
 
     fs::path get_export_file_path(GUI::FileType file_type);
-    wxString get_export_file(GUI::FileType file_type, bool zaxe_file_temp_export = false);
+    wxString get_export_file(GUI::FileType file_type);
 
     const Selection& get_selection() const;
     Selection& get_selection();
@@ -2413,10 +2415,10 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
     // appear at all. Therefore, we create the dialog on stack on Win and macOS, and on heap on Linux, which
     // is the only system that needed the workarounds in the first place.
 #ifdef __linux__
-    auto progress_dlg = new wxProgressDialog(loading, "", 100, find_toplevel_parent(q), wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+    auto progress_dlg = new wxProgressDialog(loading, "", 100, find_toplevel_parent(q), wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT);
     Slic3r::ScopeGuard([&progress_dlg](){ if (progress_dlg) progress_dlg->Destroy(); progress_dlg = nullptr; });
 #else
-    wxProgressDialog progress_dlg_stack(loading, "", 100, find_toplevel_parent(q), wxPD_APP_MODAL | wxPD_AUTO_HIDE);
+    wxProgressDialog progress_dlg_stack(loading, "", 100, find_toplevel_parent(q), wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT);
     wxProgressDialog* progress_dlg = &progress_dlg_stack;    
 #endif
     
@@ -2441,7 +2443,9 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
 #endif // _WIN32
         const auto filename = path.filename();
         if (progress_dlg) {
-            progress_dlg->Update(static_cast<int>(100.0f * static_cast<float>(i) / static_cast<float>(input_files.size())), _L("Loading file") + ": " + from_path(filename));
+            if (! progress_dlg->Update(static_cast<int>(100.0f * static_cast<float>(i) / static_cast<float>(input_files.size())), _L("Loading file") + ": " + from_path(filename)))
+                // Loading canceled, keep the files loaded so far.
+                break;
             progress_dlg->Fit();
         }
 
@@ -2566,7 +2570,19 @@ std::vector<size_t> Plater::priv::load_files(const std::vector<fs::path>& input_
                 }
             }
             else {
-                model = Slic3r::Model::read_from_file(path.string(), nullptr, nullptr, only_if(load_config, Model::LoadAttribute::CheckVersion));
+                LoadStepParams step_params;
+                step_params.linear_deflection = string_to_double_decimal_point(wxGetApp().app_config->get("step_linear_deflection"));
+                step_params.angle_deflection  = string_to_double_decimal_point(wxGetApp().app_config->get("step_angle_deflection"));
+                if (progress_dlg)
+                    step_params.progress_fn = [progress_dlg, &filename](int load_stage, int current, int total, bool &cancel) {
+                        wxString message = load_stage == LOAD_STEP_STAGE_GET_MESH ? _L("Tessellating solids") : _L("Loading file");
+                        int      value   = load_stage == LOAD_STEP_STAGE_READ_FILE ? 0 : std::clamp(100 * current / std::max(total, 1), 0, 99);
+                        cancel = ! progress_dlg->Update(value, message + ": " + from_path(filename));
+                    };
+                model = Slic3r::Model::read_from_file(path.string(), nullptr, nullptr, only_if(load_config, Model::LoadAttribute::CheckVersion), &step_params);
+                if (model.objects.empty())
+                    // Import of a STEP file canceled.
+                    continue;
                 for (auto obj : model.objects)
                     if (obj->name.empty())
                         obj->name = fs::path(obj->input_file).filename().string();
@@ -2879,7 +2895,7 @@ fs::path Plater::priv::get_export_file_path(GUI::FileType file_type)
     return output_file;
 }
 
-wxString Plater::priv::get_export_file(GUI::FileType file_type, bool zaxe_file_temp_export)
+wxString Plater::priv::get_export_file(GUI::FileType file_type)
 {
     wxString wildcard;
     switch (file_type) {
@@ -2928,12 +2944,6 @@ wxString Plater::priv::get_export_file(GUI::FileType file_type, bool zaxe_file_t
         default: break;
     }
 
-    if (zaxe_file_temp_export) {
-        boost::filesystem::path temp_model_path(wxStandardPaths::Get().GetTempDir().utf8_str().data());
-        temp_model_path /= "model.stl";
-        return temp_model_path.string();
-    }
-
     std::string out_dir = (boost::filesystem::path(output_file).parent_path()).string();
 
     wxFileDialog dlg(q, dlg_title,
@@ -5853,11 +5863,11 @@ void Plater::export_gcode(bool prefer_removable)
 	}
 }
 
-void Plater::export_stl(bool extended, bool selection_only, bool zaxe_file_temp_export)
+void Plater::export_stl(bool extended, bool selection_only)
 {
     if (p->model.objects.empty()) { return; }
 
-    wxString path = p->get_export_file(FT_STL, zaxe_file_temp_export);
+    wxString path = p->get_export_file(FT_STL);
     if (path.empty()) { return; }
     const std::string path_u8 = into_u8(path);
 
@@ -5911,10 +5921,6 @@ void Plater::export_stl(bool extended, bool selection_only, bool zaxe_file_temp_
             for (const ModelObject* o : p->model.objects) {
                 mesh.merge(mesh_to_export(*o, -1));
             }
-            if (zaxe_file_temp_export) // center to model not the plate if within Zaxe file.
-                mesh.translate(
-                    Vec3f{static_cast<float>(-p->bed.build_volume().bed_center()[0]),
-                          static_cast<float>(-p->bed.build_volume().bed_center()[1]), 0});
         }
     }
     else {
@@ -224,7 +224,7 @@ public:
     const ZaxeArchive& get_zaxe_archive() const;
 
     void export_gcode(bool prefer_removable);
-    void export_stl(bool extended = false, bool selection_only = false, bool zaxe_file_temp_export = false);
+    void export_stl(bool extended = false, bool selection_only = false);
     void export_amf();
     bool export_3mf(const boost::filesystem::path& output_path = boost::filesystem::path());
     void reload_from_disk();
@@ -152,6 +152,14 @@ void PreferencesDialog::build(size_t selected_tab)
 		option = Option(def, "export_sources_full_pathnames");
 		m_optgroup_general->append_single_option_line(option);
 
+		def.label = L("Embed an indexed 3MF model into Zaxe files");
+		def.type = coBool;
+		def.tooltip = L("If enabled, the Zaxe files for Z2 and Z3 printers embed the model as a 3MF model storing every mesh once, "
+		                "with a transformation per instance. If disabled, the model is embedded as a binary STL with all the instances.");
+		def.set_default_value(new ConfigOptionBool(app_config->get("zaxe_indexed_model") == "1"));
+		option = Option(def, "zaxe_indexed_model");
+		m_optgroup_general->append_single_option_line(option);
+
 #ifdef _WIN32
 		// Please keep in sync with ConfigWizard
 		def.label = L("Associate .3mf files to XDesktop");
@@ -1663,6 +1663,7 @@ void TabPrint::build()
         optgroup = page->new_optgroup(L("Slicing"));
         optgroup->append_single_option_line("slice_closing_radius");
         optgroup->append_single_option_line("slicing_mode");
+        optgroup->append_single_option_line("slicing_engine");
         optgroup->append_single_option_line("resolution");
         optgroup->append_single_option_line("gcode_resolution");
         optgroup->append_single_option_line("xy_size_compensation");
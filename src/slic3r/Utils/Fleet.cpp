@@ -0,0 +1,427 @@
+#include "Fleet.hpp"
+
+#include <csignal>
+#include <sstream>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "libslic3r/JsonMessage.hpp"
+#include "libslic3r/Utils.hpp"
+
+namespace Slic3r {
+
+using boost::asio::ip::tcp;
+using boost::asio::ip::udp;
+
+// A connection to the JSON API, answers the requests one after the other.
+class FleetHttpSession : public std::enable_shared_from_this<FleetHttpSession>
+{
+public:
+    FleetHttpSession(tcp::socket &&socket, Fleet &fleet) : m_stream(std::move(socket)), m_fleet(fleet) {}
+
+    void run()
+    {
+        net::dispatch(m_stream.get_executor(), beast::bind_front_handler(&FleetHttpSession::read, shared_from_this()));
+    }
+
+private:
+    void read()
+    {
+        m_request = {};
+        m_stream.expires_after(std::chrono::seconds(30));
+        http::async_read(m_stream, m_buffer, m_request, beast::bind_front_handler(&FleetHttpSession::onRead, shared_from_this()));
+    }
+
+    void onRead(beast::error_code ec, size_t /* bytesTransferred */)
+    {
+        if (ec == http::error::end_of_stream) return close();
+        if (ec) return;
+
+        unsigned status = 200;
+        std::string body = m_fleet.handleRequest(std::string(m_request.method_string()), std::string(m_request.target()), m_request.body(), status);
+        m_response = {};
+        m_response.version(m_request.version());
+        m_response.result(status);
+        m_response.set(http::field::server, "XDesktop fleet");
+        m_response.set(http::field::content_type, "application/json");
+        m_response.keep_alive(m_request.keep_alive());
+        m_response.body() = std::move(body);
+        m_response.prepare_payload();
+        http::async_write(m_stream, m_response, beast::bind_front_handler(&FleetHttpSession::onWrite, shared_from_this()));
+    }
+
+    void onWrite(beast::error_code ec, size_t /* bytesTransferred */)
+    {
+        if (ec) return;
+        if (! m_response.keep_alive()) return close();
+        read();
+    }
+
+    void close()
+    {
+        beast::error_code ec;
+        m_stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+    }
+
+    beast::tcp_stream                  m_stream;
+    beast::flat_buffer                 m_buffer;
+    http::request<http::string_body>   m_request;
+    http::response<http::string_body>  m_response;
+    Fleet                             &m_fleet;
+};
+
+static std::string json_error(const std::string &message)
+{
+    return JsonWriter().add("error", message).str();
+}
+
+static std::string json_array(const std::vector<std::string> &objects)
+{
+    std::string out = "[";
+    for (const std::string &object : objects) {
+        if (out.size() > 1)
+            out += ',';
+        out += object;
+    }
+    return out + "]";
+}
+
+Fleet::Fleet(const Params &params, slicer_t slicer) :
+    m_slicer(std::move(slicer)),
+    m_container(std::make_unique<NetworkMachineContainer>([this](wxEventType type, NetworkMachine *nm) { this->onMachineEvent(type, nm); }))
+{
+    net::io_context &ioc = m_container->context().io_context();
+
+    // Discovery, the machines broadcast {"ip": .., "port": .., "id": ..} periodically.
+    udp::endpoint broadcast(udp::v4(), params.broadcast_port);
+    m_udp = std::make_unique<udp::socket>(ioc);
+    m_udp->open(broadcast.protocol());
+    m_udp->set_option(net::socket_base::reuse_address(true));
+    m_udp->bind(broadcast);
+
+    tcp::endpoint endpoint(net::ip::make_address(params.http_address), params.http_port);
+    m_acceptor = std::make_unique<tcp::acceptor>(ioc);
+    m_acceptor->open(endpoint.protocol());
+    m_acceptor->set_option(net::socket_base::reuse_address(true));
+    m_acceptor->bind(endpoint);
+    m_acceptor->listen();
+    m_httpPort = m_acceptor->local_endpoint().port();
+
+    m_signals = std::make_unique<net::signal_set>(ioc, SIGINT, SIGTERM);
+    m_signals->async_wait([this](const boost::system::error_code &ec, int) { if (! ec) this->stop(); });
+
+    m_jobThread = std::thread(&Fleet::jobLoop, this);
+    this->receiveBroadcast();
+    this->accept();
+    BOOST_LOG_TRIVIAL(info) << boost::format("Fleet - Listening for machines on UDP port [%1%], serving on http://%2%:%3%.")
+        % params.broadcast_port % params.http_address % m_httpPort;
+}
+
+Fleet::~Fleet()
+{
+    this->stop();
+    if (m_jobThread.joinable())
+        m_jobThread.join();
+    // No handler runs after this, the sockets may be released from this thread.
+    m_container->context().stop();
+    m_signals.reset();
+    m_acceptor.reset();
+    m_udp.reset();
+    // Finishes the uploads still in flight, their callbacks still find the jobs.
+    m_container.reset();
+}
+
+void Fleet::run()
+{
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait(lock, [this]() { return m_stopped; });
+}
+
+void Fleet::stop()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_stopped = true;
+    m_cv.notify_all();
+}
+
+void Fleet::onMachineEvent(wxEventType type, NetworkMachine *nm)
+{
+    if (type == EVT_MACHINE_OPEN) {
+        BOOST_LOG_TRIVIAL(info) << boost::format("Fleet - Connected to machine: [%1% - %2%].") % nm->name % nm->ip;
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_openMachines.insert(nm->ip);
+    } else if (type == EVT_MACHINE_CLOSE) {
+        BOOST_LOG_TRIVIAL(info) << boost::format("Fleet - Closing machine: [%1% - %2%].") % nm->name % nm->ip;
+        string ip = nm->ip;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_openMachines.erase(ip);
+        }
+        // Forget it, so that its next broadcast connects it again.
+        m_container->removeMachine(ip);
+    } else if (type == EVT_MACHINE_UPDATES_PENDING) {
+        // Nothing to repaint, just keep the progress current.
+        nm->takePendingUpdates();
+    }
+}
+
+void Fleet::receiveBroadcast()
+{
+    m_udp->async_receive_from(net::buffer(m_udpBuffer), m_udpSender, [this](const boost::system::error_code &ec, size_t n) {
+        if (ec == net::error::operation_aborted) return;
+        if (! ec) {
+            JsonReader json(std::string(m_udpBuffer.data(), n));
+            if (json.has("ip") && json.has("port") && json.has("id"))
+                m_container->addMachine(json.get_string("ip"), json.get_int("port"), json.get_string("id"));
+            else
+                BOOST_LOG_TRIVIAL(warning) << "Fleet - Cannot parse broadcast message json.";
+        }
+        this->receiveBroadcast();
+    });
+}
+
+void Fleet::accept()
+{
+    // Each connection gets its own strand.
+    m_acceptor->async_accept(net::make_strand(m_container->context().io_context()), [this](const boost::system::error_code &ec, tcp::socket socket) {
+        if (ec == net::error::operation_aborted) return;
+        if (ec)
+            BOOST_LOG_TRIVIAL(warning) << "Fleet - Cannot accept connection: " << ec.message();
+        else
+            std::make_shared<FleetHttpSession>(std::move(socket), *this)->run();
+        this->accept();
+    });
+}
+
+std::string Fleet::handleRequest(const std::string &method, const std::string &target, const std::string &body, unsigned &status)
+{
+    status = 200;
+    if (method == "GET" && target == "/machines")
+        return this->machinesJson();
+    if (method == "GET" && target == "/jobs") {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        std::vector<std::string> jobs;
+        for (const Job &job : m_jobs)
+            jobs.emplace_back(this->jobJson(job));
+        return JsonWriter().add_raw("jobs", json_array(jobs)).str();
+    }
+    if (method == "GET" && boost::starts_with(target, "/jobs/")) {
+        int id = std::atoi(target.c_str() + 6);
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (id > 0 && id <= int(m_jobs.size()))
+            return this->jobJson(m_jobs[id - 1]);
+        status = 404;
+        return json_error("No such job.");
+    }
+    if (method == "POST" && target == "/jobs")
+        return this->postJob(body, status);
+    status = 404;
+    return json_error("Unknown request " + method + " " + target);
+}
+
+std::string Fleet::machinesJson()
+{
+    std::vector<shared_ptr<NetworkMachine>> machines;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        for (const std::string &ip : m_openMachines)
+            if (shared_ptr<NetworkMachine> nm = m_container->getMachine(ip); nm != nullptr)
+                machines.emplace_back(std::move(nm));
+    }
+
+    std::vector<std::string> objects;
+    objects.reserve(machines.size());
+    for (const shared_ptr<NetworkMachine> &nm : machines) {
+        // The network threads keep updating the machine, read a consistent copy.
+        const MachineSnapshot    snap   = nm->snapshot();
+        const MachineAttributes &attr   = snap.attr;
+        const MachineStates     &states = snap.states;
+        objects.emplace_back(JsonWriter()
+            .add("ip", nm->ip)
+            .add("name", snap.name)
+            .add("model", attr.deviceModel)
+            .add("lite", attr.isLite)
+            .add("material", attr.material)
+            .add("nozzle", attr.nozzle)
+            .add("printing", states.printing)
+            .add("paused", states.paused)
+            .add("heating", states.heating)
+            .add("preheat", states.preheat)
+            .add("calibrating", states.calibrating)
+            .add("updating", states.updating)
+            .add("bed_occupied", states.bedOccupied)
+            .add("usb_present", states.usbPresent)
+            .add("uploading", states.uploading)
+            .add("progress", snap.progress)
+            .add("printing_file", attr.printingFile)
+            .add("elapsed_time", double(attr.elapsedTime))
+            .add("estimated_time", attr.estimatedTime)
+            .str());
+    }
+    return JsonWriter().add_raw("machines", json_array(objects)).str();
+}
+
+std::string Fleet::jobJson(const Job &job) const
+{
+    std::vector<std::string> machines;
+    for (const JobMachine &m : job.machines)
+        machines.emplace_back(JsonWriter().add("ip", m.ip).add("state", m.state).add("progress", m.progress).str());
+    JsonWriter out;
+    out.add("id", job.id)
+       .add("input", job.input)
+       .add("state", job.state);
+    if (! job.error.empty())
+        out.add("error", job.error);
+    if (! job.result.gcode_path.empty())
+        out.add("gcode", job.result.gcode_path);
+    if (! job.result.zaxe_path.empty())
+        out.add("zaxe", job.result.zaxe_path);
+    out.add_raw("machines", json_array(machines));
+    return std::move(out).str();
+}
+
+std::string Fleet::postJob(const std::string &body, unsigned &status)
+{
+    Job job;
+    try {
+        boost::property_tree::ptree pt;
+        std::istringstream is(body);
+        boost::property_tree::read_json(is, pt);
+        job.input  = pt.get<std::string>("input", "");
+        job.config = pt.get<std::string>("config", "");
+        if (auto machines = pt.get_child_optional("machines"); machines)
+            for (const auto &m : *machines)
+                job.machines.push_back({ m.second.get_value<std::string>() });
+    } catch (const std::exception &ex) {
+        status = 400;
+        return json_error(std::string("Cannot parse the job: ") + ex.what());
+    }
+    if (job.input.empty() || job.machines.empty()) {
+        status = 400;
+        return json_error("A job needs an \"input\" file and a list of \"machines\".");
+    }
+
+    std::lock_guard<std::mutex> lock(m_mtx);
+    job.id = ++ m_lastJobId;
+    m_jobs.emplace_back(std::move(job));
+    m_jobQueue.push_back(m_jobs.back().id);
+    m_cv.notify_all();
+    status = 202;
+    return this->jobJson(m_jobs.back());
+}
+
+void Fleet::jobLoop()
+{
+    for (;;) {
+        int id;
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [this]() { return m_stopped || ! m_jobQueue.empty(); });
+            if (m_stopped) return;
+            id = m_jobQueue.front();
+            m_jobQueue.pop_front();
+        }
+        this->runJob(id);
+    }
+}
+
+void Fleet::runJob(int id)
+{
+    std::string              input, config;
+    std::vector<std::string> ips;
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        Job &job  = m_jobs[id - 1];
+        job.state = "slicing";
+        input     = job.input;
+        config    = job.config;
+        for (const JobMachine &m : job.machines)
+            ips.emplace_back(m.ip);
+    }
+
+    // The Lite machines print the G-code, the others take a .zaxe archive.
+    std::vector<std::string> lite, zaxe;
+    for (const std::string &ip : ips) {
+        shared_ptr<NetworkMachine> nm = m_container->getMachine(ip);
+        (nm != nullptr && nm->snapshot().attr.isLite ? lite : zaxe).emplace_back(ip);
+    }
+
+    SliceResult result;
+    std::string error;
+    try {
+        error = m_slicer(input, config, ! zaxe.empty(), result);
+    } catch (const std::exception &ex) {
+        error = ex.what();
+    }
+
+    // Shared by the upload callbacks, the sliced files are removed once the last of them is released,
+    // that is once all the machines of the job are done.
+    std::shared_ptr<ScopeGuard> remove_files;
+    if (! result.temp_dir.empty())
+        remove_files = std::make_shared<ScopeGuard>([this, id, dir = result.temp_dir]() {
+            boost::system::error_code ec;
+            boost::filesystem::remove_all(dir, ec);
+            if (ec)
+                BOOST_LOG_TRIVIAL(warning) << boost::format("Fleet - Cannot remove the files of job %1% in %2%: %3%") % id % dir % ec.message();
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_jobs[id - 1].result = SliceResult();
+        });
+
+    // Called from the curl thread, or right away for the machines which can't be sent to.
+    auto machine_done = [this, id, remove_files](const std::string &ip, bool success) {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        Job &job = m_jobs[id - 1];
+        bool finished = true;
+        bool failed   = false;
+        for (JobMachine &m : job.machines) {
+            if (m.ip == ip && (m.state == "queued" || m.state == "uploading")) {
+                m.state = success ? "done" : "failed";
+                if (success)
+                    m.progress = 100;
+            }
+            finished &= m.state == "done" || m.state == "failed";
+            failed   |= m.state == "failed";
+        }
+        if (finished)
+            job.state = failed ? "failed" : "done";
+    };
+    auto machine_progress = [this, id](const std::string &ip, int percent) {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        for (JobMachine &m : m_jobs[id - 1].machines)
+            if (m.ip == ip) {
+                m.state    = "uploading";
+                m.progress = percent;
+            }
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        Job &job   = m_jobs[id - 1];
+        job.result = result;
+        job.error  = error;
+        job.state  = error.empty() ? "uploading" : "failed";
+    }
+    if (! error.empty()) {
+        BOOST_LOG_TRIVIAL(error) << boost::format("Fleet - Job %1% failed: %2%") % id % error;
+        for (const std::string &ip : ips)
+            machine_done(ip, false);
+        return;
+    }
+
+    auto send = [this, &machine_done, &machine_progress](const std::vector<std::string> &targets, const std::string &path) {
+        if (targets.empty()) return;
+        if (path.empty() || ! m_container->uploadBatch(targets, path, "", machine_progress, machine_done))
+            for (const std::string &ip : targets)
+                machine_done(ip, false);
+    };
+    send(lite, result.gcode_path);
+    send(zaxe, result.zaxe_path);
+}
+
+} // namespace Slic3r
@@ -0,0 +1,110 @@
+#ifndef slic3r_Fleet_hpp_
+#define slic3r_Fleet_hpp_
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ip/udp.hpp>
+#include <boost/asio/signal_set.hpp>
+
+#include "NetworkMachine.hpp"
+
+namespace Slic3r {
+
+// Headless counterpart of NetworkMachineManager for XDesktop --fleet. Discovers the machines
+// from their UDP broadcasts, keeps them connected without a wx event loop and serves the
+// fleet state and slice-and-send jobs as JSON over HTTP on the loopback interface:
+//   GET  /machines   state of the connected machines.
+//   GET  /jobs       state of all the jobs, GET /jobs/<id> of a single one.
+//   POST /jobs       {"input": "model.3mf", "config": "profile.ini", "machines": ["192.168.1.20", ...]}
+//                    slices the input ("config" is optional) and sends it to the machines.
+class Fleet
+{
+public:
+    struct SliceResult {
+        std::string gcode_path; // sent to the Lite / X3 machines.
+        std::string zaxe_path;  // sent to all the others.
+        std::string temp_dir;   // removed with the files once they were sent, may be empty.
+    };
+    // Called on the job thread. Slices the input with the given config file applied on top of
+    // the command line config. Returns an empty string on success, the error otherwise.
+    typedef std::function<std::string(const std::string &input, const std::string &config, bool make_zaxe, SliceResult &result)> slicer_t;
+
+    struct Params {
+        std::string    http_address   = "127.0.0.1";
+        unsigned short http_port      = 9296; // 0: any free port, see httpPort().
+        unsigned short broadcast_port = 9295; // the machines announce themselves there.
+    };
+
+    Fleet(const Params &params, slicer_t slicer);
+    ~Fleet();
+
+    Fleet(const Fleet&) = delete;
+    Fleet& operator=(const Fleet&) = delete;
+
+    unsigned short httpPort() const { return m_httpPort; }
+    // Blocks until stop() is called or SIGINT / SIGTERM is received.
+    void run();
+    void stop();
+
+    // Answers a request of the JSON API, sets the HTTP status.
+    std::string handleRequest(const std::string &method, const std::string &target, const std::string &body, unsigned &status);
+
+private:
+    struct JobMachine {
+        std::string ip;
+        std::string state { "queued" }; // queued, uploading, done, failed.
+        int         progress { 0 };
+    };
+    struct Job {
+        int                     id;
+        std::string             input;
+        std::string             config;
+        std::string             state { "queued" }; // queued, slicing, uploading, done, failed.
+        std::string             error;
+        SliceResult             result;
+        std::vector<JobMachine> machines;
+    };
+
+    void onMachineEvent(wxEventType type, NetworkMachine *nm);
+    void receiveBroadcast();
+    void accept();
+    void jobLoop();
+    void runJob(int id);
+    std::string machinesJson();
+    std::string jobJson(const Job &job) const; // m_mtx locked.
+    std::string postJob(const std::string &body, unsigned &status);
+
+    slicer_t                         m_slicer;
+    // Owns the io_context the sockets below live on. The sockets are released before it and
+    // it is released before the jobs, as the upload callbacks update them.
+    std::unique_ptr<NetworkMachineContainer>         m_container;
+    std::unique_ptr<boost::asio::ip::udp::socket>    m_udp;
+    boost::asio::ip::udp::endpoint                   m_udpSender;
+    std::array<char, 1024>                           m_udpBuffer;
+    std::unique_ptr<boost::asio::ip::tcp::acceptor>  m_acceptor;
+    std::unique_ptr<boost::asio::signal_set>         m_signals;
+    unsigned short                                   m_httpPort { 0 };
+
+    std::mutex                       m_mtx;
+    std::condition_variable          m_cv;
+    bool                             m_stopped { false };
+    std::set<std::string>            m_openMachines; // ips of the machines that said hello.
+    std::deque<Job>                  m_jobs;
+    std::deque<int>                  m_jobQueue;
+    int                              m_lastJobId { 0 };
+    std::thread                      m_jobThread;
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_Fleet_hpp_
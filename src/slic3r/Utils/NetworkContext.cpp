@@ -0,0 +1,170 @@
+#include "NetworkContext.hpp"
+
+#include <algorithm>
+
+#include <boost/log/trivial.hpp>
+
+#include "Http.hpp"
+
+namespace Slic3r {
+
+CurlMulti::CurlMulti()
+{
+    // curl_global_init() is done once for the whole application by Http.
+    Http::tls_global_init();
+    m_multi  = ::curl_multi_init();
+    m_thread = std::thread(&CurlMulti::run, this);
+}
+
+CurlMulti::~CurlMulti()
+{
+    m_stop = true;
+    ::curl_multi_wakeup(m_multi);
+    if (m_thread.joinable())
+        m_thread.join();
+    ::curl_multi_cleanup(m_multi);
+}
+
+void CurlMulti::add(CURL *easy, Completion on_done, std::chrono::milliseconds delay)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (! m_closed) {
+            m_pending.push_back({ easy, std::move(on_done), std::chrono::steady_clock::now() + delay });
+            ++ m_active_count;
+            easy = nullptr;
+        }
+    }
+    if (easy == nullptr) {
+        ::curl_multi_wakeup(m_multi);
+        return;
+    }
+    // Shut down already, nobody would call the completion later.
+    if (on_done)
+        on_done(easy, CURLE_ABORTED_BY_CALLBACK);
+    ::curl_easy_cleanup(easy);
+}
+
+void CurlMulti::run()
+{
+    auto finish = [this](Transfer &transfer, CURLcode result) {
+        ::curl_multi_remove_handle(m_multi, transfer.easy);
+        try {
+            if (transfer.on_done)
+                transfer.on_done(transfer.easy, result);
+        } catch (const std::exception &ex) {
+            BOOST_LOG_TRIVIAL(error) << "CurlMulti - transfer completion failed: " << ex.what();
+        }
+        ::curl_easy_cleanup(transfer.easy);
+        -- m_active_count;
+    };
+
+    while (! m_stop) {
+        std::vector<Transfer> added;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            added.swap(m_pending);
+        }
+        auto now = std::chrono::steady_clock::now();
+        for (auto it = m_delayed.begin(); it != m_delayed.end();)
+            if (it->start <= now) {
+                added.emplace_back(std::move(*it));
+                it = m_delayed.erase(it);
+            } else
+                ++ it;
+        for (Transfer &transfer : added) {
+            if (transfer.start > now) {
+                m_delayed.emplace_back(std::move(transfer));
+                continue;
+            }
+            if (CURLMcode mc = ::curl_multi_add_handle(m_multi, transfer.easy); mc != CURLM_OK) {
+                BOOST_LOG_TRIVIAL(error) << "CurlMulti - cannot add transfer: " << ::curl_multi_strerror(mc);
+                if (transfer.on_done)
+                    transfer.on_done(transfer.easy, CURLE_FAILED_INIT);
+                ::curl_easy_cleanup(transfer.easy);
+                -- m_active_count;
+            } else
+                m_running.emplace_back(std::move(transfer));
+        }
+
+        int still_running = 0;
+        ::curl_multi_perform(m_multi, &still_running);
+
+        int msgs_left = 0;
+        while (CURLMsg *msg = ::curl_multi_info_read(m_multi, &msgs_left)) {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            auto it = std::find_if(m_running.begin(), m_running.end(), [msg](const Transfer &t) { return t.easy == msg->easy_handle; });
+            if (it == m_running.end())
+                continue;
+            Transfer transfer = std::move(*it);
+            m_running.erase(it);
+            finish(transfer, msg->data.result);
+        }
+
+        // Wake up for the first delayed transfer due.
+        auto timeout = std::chrono::milliseconds(1000);
+        now = std::chrono::steady_clock::now();
+        for (const Transfer &transfer : m_delayed)
+            timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(transfer.start - now));
+        ::curl_multi_poll(m_multi, nullptr, 0, std::max(0, int(timeout.count())), nullptr);
+    }
+
+    // Shutting down: let the owners of the unfinished transfers release their state.
+    for (Transfer &transfer : m_running)
+        finish(transfer, CURLE_ABORTED_BY_CALLBACK);
+    m_running.clear();
+    // The completions above may have added retries, they are aborted together with the rest.
+    std::vector<Transfer> added = std::move(m_delayed);
+    m_delayed.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_closed = true;
+        for (Transfer &transfer : m_pending)
+            added.emplace_back(std::move(transfer));
+        m_pending.clear();
+    }
+    for (Transfer &transfer : added) {
+        if (transfer.on_done)
+            transfer.on_done(transfer.easy, CURLE_ABORTED_BY_CALLBACK);
+        ::curl_easy_cleanup(transfer.easy);
+        -- m_active_count;
+    }
+}
+
+NetworkContext::NetworkContext(unsigned int num_threads) :
+    m_work(boost::asio::make_work_guard(m_ioc))
+{
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    m_threads.reserve(num_threads);
+    for (unsigned int i = 0; i < num_threads; ++ i)
+        m_threads.emplace_back([this]() {
+            for (;;) {
+                try {
+                    m_ioc.run();
+                    break;
+                } catch (const std::exception &ex) {
+                    // A failing handler must not take the other sessions down with it.
+                    BOOST_LOG_TRIVIAL(error) << "NetworkContext - unhandled exception: " << ex.what();
+                }
+            }
+        });
+}
+
+NetworkContext::~NetworkContext()
+{
+    this->stop();
+}
+
+void NetworkContext::stop()
+{
+    m_work.reset();
+    m_ioc.stop();
+    for (std::thread &thread : m_threads)
+        if (thread.joinable())
+            thread.join();
+    m_threads.clear();
+}
+
+} // namespace Slic3r
@@ -0,0 +1,92 @@
+#ifndef slic3r_NetworkContext_hpp_
+#define slic3r_NetworkContext_hpp_
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
+
+#include <curl/curl.h>
+
+namespace Slic3r {
+
+// Drives every libcurl easy handle of the NetworkMachines (avatar downloads, FTP uploads)
+// from a single thread through one curl multi handle, instead of a thread and a
+// curl_global_init()/curl_global_cleanup() pair per transfer.
+class CurlMulti
+{
+public:
+    // Called on the curl thread once the transfer is done. The easy handle is still valid
+    // inside the callback (e.g. for curl_easy_getinfo()) and is cleaned up right after.
+    typedef std::function<void(CURL *easy, CURLcode result)> Completion;
+
+    CurlMulti();
+    ~CurlMulti();
+
+    CurlMulti(const CurlMulti&) = delete;
+    CurlMulti& operator=(const CurlMulti&) = delete;
+
+    // Takes ownership of the easy handle. Anything the handle points to (buffers, streams)
+    // has to be kept alive by the completion callback. A delayed transfer (a retry) waits on
+    // the curl thread. The completion is called exactly once, with CURLE_ABORTED_BY_CALLBACK
+    // if the transfer hasn't finished by the shutdown, or right away if it's added after it.
+    void add(CURL *easy, Completion on_done, std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    // Number of transfers queued or in flight.
+    size_t active() const { return m_active_count; }
+
+private:
+    void run();
+
+    struct Transfer {
+        CURL                                 *easy;
+        Completion                            on_done;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    CURLM                *m_multi { nullptr };
+    std::thread           m_thread;
+    std::mutex            m_mtx;
+    std::vector<Transfer> m_pending; // added by other threads, picked up by run().
+    bool                  m_closed { false }; // guarded by m_mtx, run() takes no more transfers.
+    std::vector<Transfer> m_delayed; // owned by run(), waiting for their start.
+    std::vector<Transfer> m_running; // owned by run().
+    std::atomic<size_t>   m_active_count { 0 };
+    std::atomic<bool>     m_stop { false };
+};
+
+// Network context shared by all NetworkMachines: a single io_context multiplexing every
+// websocket session (each on its own strand) and run by a small thread pool, plus the
+// curl multi handle for file transfers. The number of OS threads no longer grows with
+// the number of printers on the network.
+class NetworkContext
+{
+public:
+    // num_threads == 0: one thread per hardware core.
+    explicit NetworkContext(unsigned int num_threads = 0);
+    ~NetworkContext();
+
+    NetworkContext(const NetworkContext&) = delete;
+    NetworkContext& operator=(const NetworkContext&) = delete;
+
+    boost::asio::io_context& io_context() { return m_ioc; }
+    CurlMulti&               curl()       { return m_curl; }
+    size_t                   num_threads() const { return m_threads.size(); }
+
+    // Stops the io_context and joins the pool. Called by the destructor.
+    void stop();
+
+private:
+    boost::asio::io_context                                                  m_ioc;
+    boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_work;
+    std::vector<std::thread>                                                 m_threads;
+    CurlMulti                                                                m_curl;
+};
+
+} // namespace Slic3r
+
+#endif // slic3r_NetworkContext_hpp_
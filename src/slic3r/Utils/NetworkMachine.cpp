@@ -2,19 +2,26 @@
 #include <libslic3r/Utils.hpp>
 #include "Http.hpp"
 
+#include <deque>
+#include <set>
+
+#include <boost/filesystem.hpp>
+
 namespace fs = boost::filesystem;
 
 namespace Slic3r {
 wxDEFINE_EVENT(EVT_MACHINE_OPEN, MachineEvent);
 wxDEFINE_EVENT(EVT_MACHINE_CLOSE, MachineEvent);
-wxDEFINE_EVENT(EVT_MACHINE_NEW_MESSAGE, MachineNewMessageEvent);
+wxDEFINE_EVENT(EVT_MACHINE_UPDATES_PENDING, MachineEvent);
 wxDEFINE_EVENT(EVT_MACHINE_AVATAR_READY, wxCommandEvent);
 
-NetworkMachine::NetworkMachine(string ip, int port, string name, wxEvtHandler* hndlr) :
+NetworkMachine::NetworkMachine(string ip, int port, string name, NetworkContext& ctx, wxEvtHandler* hndlr, event_listener_t listener) :
     ip(ip),
     port(port),
     name(name),
+    m_ctx(ctx),
     m_evtHandler(hndlr),
+    m_listener(std::move(listener)),
     attr(new MachineAttributes()),
     states(new MachineStates())
 {
@@ -22,15 +29,22 @@ NetworkMachine::NetworkMachine(string ip, int port, string name, wxEvtHandler* h
 
 void NetworkMachine::run()
 {
-    net::io_context ioc; // The io_context is required for websocket I/O
-    auto ws = make_shared<Websocket>(ip, port, ioc); // Run the websocket for this machine.
-    ws->addReadEventHandler(boost::bind(&NetworkMachine::onWSRead, this, _1));
-    ws->addConnectEventHandler(boost::bind(&NetworkMachine::onWSConnect, this));
-    ws->addErrorEventHandler(boost::bind(&NetworkMachine::onWSError, this, _1));
-    m_ws = ws.get();
+    // The websocket session lives on the shared io_context, its handlers only hold a weak
+    // reference to this machine so that removing the machine doesn't wait for the socket.
+    m_ws = make_shared<Websocket>(ip, port, m_ctx.io_context());
+    std::weak_ptr<NetworkMachine> weak = weak_from_this();
+    m_ws->addReadEventHandler([weak](string message) { if (auto self = weak.lock()) self->onWSRead(std::move(message)); });
+    m_ws->addConnectEventHandler([weak]() { if (auto self = weak.lock()) self->onWSConnect(); });
+    m_ws->addErrorEventHandler([weak](string message) { if (auto self = weak.lock()) self->onWSError(std::move(message)); });
     m_running = true;
-    ws->run();
-    ioc.run(); // Run the I/O service.
+    m_ws->run();
+}
+
+void NetworkMachine::shutdown()
+{
+    m_running = false;
+    if (m_ws)
+        m_ws->close();
 }
 
 void NetworkMachine::onWSConnect()
@@ -41,88 +55,156 @@ void NetworkMachine::onWSError(string message)
 {
     BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine - WS error: %1% on machine [%2% - %3%].") % message % name % ip;
     if (!m_running) return;
-    MachineEvent evt(EVT_MACHINE_CLOSE, this, wxID_ANY);
-    evt.SetEventObject(this->m_evtHandler);
-    wxPostEvent(this->m_evtHandler, evt);
+    postMachineEvent(EVT_MACHINE_CLOSE);
 }
 
 void NetworkMachine::onWSRead(string message)
 {
     //BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine onReadWS: %1%") % message;
-    if (!m_running) return;
+    if (!m_running) {
+        ++ m_updatesDropped;
+        return;
+    }
 
-    stringstream jsonStream;
-    jsonStream.str(message);
-    ptree pt; // construct root obj.
-    read_json(jsonStream, pt);
+    JsonReader json(std::move(message)); // parses the flat message without building a tree.
+    if (!json.has("event")) {
+        BOOST_LOG_TRIVIAL(warning) << "Cannot parse machine message json.";
+        ++ m_updatesDropped;
+        return;
+    }
 
     try {
-        auto event = pt.get<string>("event");
-        if (event == "ping" || event == "temperature_change") return; // ignore...
+        auto event = json.get_string("event");
+        if (event == "ping" || event == "temperature_change") { // ignore...
+            ++ m_updatesDropped;
+            return;
+        }
         //BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine event. [%1%:%2% - %3%]") % name % ip % event;
+        boost::unique_lock<boost::mutex> statelock(m_stateMtx); // released before the events are posted.
         if (event == "hello") {
-            //name = pt.get<string>("name", name); // already got this from broadcast receiver. might be good for static ip.
-            attr->deviceModel = to_lower_copy(pt.get<string>("device_model", "x1"));
-            attr->material = to_lower_copy(pt.get<string>("material", "zaxe_abs"));
-            attr->nozzle = pt.get<string>("nozzle", "0.4");
+            //name = json.get_string("name", name); // already got this from broadcast receiver. might be good for static ip.
+            attr->deviceModel = to_lower_copy(json.get_string("device_model", "x1"));
+            attr->material = to_lower_copy(json.get_string("material", "zaxe_abs"));
+            attr->nozzle = json.get_string("nozzle", "0.4");
             attr->hasSnapshot = is_there(attr->deviceModel, {"z1", "z2", "z3"});
             attr->isLite = is_there(attr->deviceModel, {"lite", "x3"});
-            attr->isHttp = pt.get<string>("protocol", "") == "http";
+            attr->isHttp = json.get_string("protocol", "") == "http";
             attr->isNoneTLS = is_there(attr->deviceModel, {"z2", "z3"}) || attr->isLite;
             // printing
-            attr->printingFile = pt.get<string>("filename", "");
-            attr->elapsedTime = pt.get<float>("elapsed_time", 0);
-            attr->estimatedTime = pt.get<string>("estimated_time", "");
+            attr->printingFile = json.get_string("filename", "");
+            attr->elapsedTime = json.get_float("elapsed_time", 0);
+            attr->estimatedTime = json.get_string("estimated_time", "");
             attr->startTime = wxDateTime::Now().GetTicks() - attr->elapsedTime;
             if (!attr->isLite) {
-                attr->hasPin = to_lower_copy(pt.get<string>("has_pin", "false")) == "true";
-                attr->hasNFCSpool = to_lower_copy(pt.get<string>("has_nfc_spool", "false")) == "true";
-                attr->filamentColor = to_lower_copy(pt.get<string>("filament_color", "unknown"));
+                attr->hasPin = to_lower_copy(json.get_string("has_pin", "false")) == "true";
+                attr->hasNFCSpool = to_lower_copy(json.get_string("has_nfc_spool", "false")) == "true";
+                attr->filamentColor = to_lower_copy(json.get_string("filament_color", "unknown"));
             }
         }
         if (event == "hello" || event == "states_update") {
             // states
-            states->updating       = states->ptreeStringtoBool(pt, "is_updating");
-            states->calibrating    = states->ptreeStringtoBool(pt, "is_calibrating");
-            states->bedOccupied    = states->ptreeStringtoBool(pt, "is_bed_occupied");
-            states->usbPresent     = states->ptreeStringtoBool(pt, "is_usb_present");
-            states->preheat        = states->ptreeStringtoBool(pt, "is_preheat");
-            states->printing       = states->ptreeStringtoBool(pt, "is_printing");
-            states->heating        = states->ptreeStringtoBool(pt, "is_heating");
-            states->paused         = states->ptreeStringtoBool(pt, "is_paused");
+            states->updating       = states->jsonStringToBool(json, "is_updating");
+            states->calibrating    = states->jsonStringToBool(json, "is_calibrating");
+            states->bedOccupied    = states->jsonStringToBool(json, "is_bed_occupied");
+            states->usbPresent     = states->jsonStringToBool(json, "is_usb_present");
+            states->preheat        = states->jsonStringToBool(json, "is_preheat");
+            states->printing       = states->jsonStringToBool(json, "is_printing");
+            states->heating        = states->jsonStringToBool(json, "is_heating");
+            states->paused         = states->jsonStringToBool(json, "is_paused");
         }
         if (event == "new_name")
-            name = pt.get<string>("name", "Zaxe");
+            name = json.get_string("name", "Zaxe");
         if (event == "material_change")
-            attr->material = to_lower_copy(pt.get<string>("material", "zaxe_abs"));
+            attr->material = to_lower_copy(json.get_string("material", "zaxe_abs"));
         if (event == "nozzle_change")
-            attr->nozzle = pt.get<string>("nozzle", "0.4");
+            attr->nozzle = json.get_string("nozzle", "0.4");
         if (event == "pin_change")
-            attr->hasPin = to_lower_copy(pt.get<string>("has_pin", "false")) == "true";
+            attr->hasPin = to_lower_copy(json.get_string("has_pin", "false")) == "true";
         if (event == "start_print") {
-            attr->printingFile = pt.get<string>("filename", "");
-            attr->elapsedTime = pt.get<float>("elapsed_time", 0);
+            attr->printingFile = json.get_string("filename", "");
+            attr->elapsedTime = json.get_float("elapsed_time", 0);
             attr->startTime = wxDateTime::Now().GetTicks() - attr->elapsedTime;
-            attr->estimatedTime = pt.get<string>("estimated_time", "");
+            attr->estimatedTime = json.get_string("estimated_time", "");
         }
         if (event == "spool_data_change") {
-            attr->hasNFCSpool = to_lower_copy(pt.get<string>("has_nfc_spool", "false")) == "true";
-            attr->filamentColor = to_lower_copy(pt.get<string>("filament_color", "unknown"));
+            attr->hasNFCSpool = to_lower_copy(json.get_string("has_nfc_spool", "false")) == "true";
+            attr->filamentColor = to_lower_copy(json.get_string("filament_color", "unknown"));
         }
+        statelock.unlock();
         if (event == "hello") { // gather up all the events up untill here.
-            MachineEvent evt(EVT_MACHINE_OPEN, this, wxID_ANY); // ? get window id here ?; // ? get window id here ?
-            evt.SetEventObject(this->m_evtHandler);
-            wxPostEvent(this->m_evtHandler, evt);
-        } else {
-            MachineNewMessageEvent evt(EVT_MACHINE_NEW_MESSAGE, event, pt, this, wxID_ANY); // ? get window id here ?
-            evt.SetEventObject(this->m_evtHandler);
-            wxPostEvent(this->m_evtHandler, evt);
-        }
+            postMachineEvent(EVT_MACHINE_OPEN);
+        } else if (event == "states_update") {
+            postUpdate(MachineUpdate::States);
+        } else if (event == "print_progress" ||
+                   event == "temperature_progress" ||
+                   event == "calibration_progress") {
+            m_reportedProgress = (int)json.get_float("progress", 0);
+            postUpdate(MachineUpdate::Progress);
+        } else if (event == "new_name") {
+            postUpdate(MachineUpdate::Name);
+        } else if (event == "start_print") {
+            postUpdate(MachineUpdate::FileStart);
+        } else
+            ++ m_updatesDropped; // nothing to show.
     } catch(...) {
         BOOST_LOG_TRIVIAL(warning) << "Cannot parse machine message json.";
+        ++ m_updatesDropped;
     }
 }
 
+void NetworkMachine::postUpdate(uint32_t update)
+{
+    ++ m_updatesPosted;
+    uint32_t pending = m_pendingUpdates.fetch_or(update);
+    if (pending & update)
+        ++ m_updatesMerged;
+    // The UI is only woken up once, it takes all the updates pending by then in one go.
+    if (pending == 0)
+        postMachineEvent(EVT_MACHINE_UPDATES_PENDING);
+}
+
+void NetworkMachine::postMachineEvent(wxEventType type)
+{
+    if (m_listener) {
+        m_listener(type, this);
+    } else if (m_evtHandler) {
+        MachineEvent evt(type, this, wxID_ANY); // ? get window id here ?
+        evt.SetEventObject(this->m_evtHandler);
+        wxPostEvent(this->m_evtHandler, evt);
+    }
+}
+
+uint32_t NetworkMachine::takePendingUpdates()
+{
+    uint32_t updates = m_pendingUpdates.exchange(0);
+    if (updates & MachineUpdate::Progress) {
+        boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+        progress = m_reportedProgress;
+    }
+    return updates;
+}
+
+MachineSnapshot NetworkMachine::snapshot() const
+{
+    boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+    return MachineSnapshot{ name, *attr, *states, progress };
+}
+
+bool NetworkMachine::isUploading() const
+{
+    boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+    return states->uploading;
+}
+
+MachineUpdateStats NetworkMachine::updateStats() const
+{
+    MachineUpdateStats stats;
+    stats.posted  = m_updatesPosted;
+    stats.merged  = m_updatesMerged;
+    stats.dropped = m_updatesDropped;
+    return stats;
+}
+
 void NetworkMachine::sayHi()
 {
     request("say_hi");
@@ -150,212 +232,298 @@ void NetworkMachine::togglePreheat()
 
 void NetworkMachine::request(const char* command)
 {
-    ptree pt; // construct root obj.
-    pt.put("request", command);
-    send(pt);
+    JsonWriter json;
+    json.add("request", command);
+    send(std::move(json).str());
 }
 
-void NetworkMachine::send(ptree pt)
+void NetworkMachine::send(const string &json)
 {
-    stringstream ss;
-    json_parser::write_json(ss, pt);
-    m_ws->send(ss.str());
+    if (m_ws)
+        m_ws->send(json);
 }
 
 NetworkMachine::~NetworkMachine()
 {
+    if (m_ws)
+        m_ws->close();
     delete attr;
     delete states;
-    //delete m_ws;
-    if (runnerThread.joinable())
-        runnerThread.join();
-    if (ftpThread.joinable())
-        ftpThread.join();
 }
 
-void NetworkMachine::downloadAvatar()
-{
-    if (!m_running) return;
-
-    ftpThread = boost::thread(&NetworkMachine::ftpRun, this);
-    ftpThread.detach();
-}
-
-struct response {
-    char *memory;
-    size_t size;
-};
-
 static size_t mem_cb(void *contents, size_t size, size_t nmemb, void *userp)
 {
     size_t realsize = size * nmemb;
-    struct response *mem = static_cast<response*>(userp);
-
-    void *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if(!ptr) { /* out of memory! */
-        BOOST_LOG_TRIVIAL(warning) << "Networkmachine - not enough memory (realloc returned NULL)";
+    try {
+        static_cast<std::string*>(userp)->append(static_cast<const char*>(contents), realsize);
+    } catch (const std::bad_alloc &) { /* out of memory! */
+        BOOST_LOG_TRIVIAL(warning) << "Networkmachine - not enough memory for the avatar";
         return 0;
     }
-
-    mem->memory = static_cast<char*>(ptr);
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-
     return realsize;
 }
 
-void NetworkMachine::ftpRun()
+void NetworkMachine::downloadAvatar()
 {
-    CURL *curl;
-    CURLcode res;
-#ifdef _WIN32
-    struct response chunk;
-#else
-    struct response chunk = { .memory = nullptr, .size = 0 };
-#endif
-
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
+    // Without a wx event handler there is nobody to show it.
+    if (!m_running || !m_evtHandler || m_avatarDownloading.exchange(true)) return; // previous one is still in flight.
 
-    if (!curl) return;
+    CURL *curl = ::curl_easy_init();
+    if (!curl) {
+        m_avatarDownloading = false;
+        return;
+    }
 
+    auto chunk = std::make_shared<std::string>();
     std::string url = "ftp://" + ip + ":" + std::to_string(m_ftpPort) + "/snapshot.png";
     ::curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
     ::curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, mem_cb);
-    ::curl_easy_setopt(curl, CURLOPT_WRITEDATA, static_cast<void*>(&chunk));
+    ::curl_easy_setopt(curl, CURLOPT_WRITEDATA, static_cast<void*>(chunk.get()));
     //::curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
-    res = curl_easy_perform(curl);
-    ::curl_easy_cleanup(curl);
 
-    if (CURLE_OK != res) {
-        BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine - Couldn't connect to machine [%1% - %2%] for downloading avatar.") % name % ip;
-        return;
-    }
+    // The completion runs on the curl thread and keeps both the buffer and this machine alive.
+    m_ctx.curl().add(curl, [self = shared_from_this(), chunk](CURL*, CURLcode res) {
+        self->m_avatarDownloading = false;
+        if (CURLE_OK != res) {
+            BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine - Couldn't connect to machine [%1% - %2%] for downloading avatar.") % self->name % self->ip;
+            return;
+        }
 
-    wxMemoryInputStream s (chunk.memory, chunk.size);
-    m_avatar = wxBitmap(wxImage(s, wxBITMAP_TYPE_PNG));
+        wxMemoryInputStream s (chunk->data(), chunk->size());
+        bool ok;
+        {
+            boost::lock_guard<boost::mutex> avatarlock(self->m_avatarMtx);
+            self->m_avatar = wxBitmap(wxImage(s, wxBITMAP_TYPE_PNG));
+            ok = self->m_avatar.IsOk();
+        }
 
-    if (this->m_running && m_avatar.IsOk()) {
-        wxCommandEvent evt(EVT_MACHINE_AVATAR_READY, wxID_ANY);
-        evt.SetString(this->ip);
-        evt.SetEventObject(this->m_evtHandler);
-        wxPostEvent(this->m_evtHandler, evt);
-    }
+        if (self->m_running && ok) {
+            wxCommandEvent evt(EVT_MACHINE_AVATAR_READY, wxID_ANY);
+            evt.SetString(self->ip);
+            evt.SetEventObject(self->m_evtHandler);
+            wxPostEvent(self->m_evtHandler, evt);
+        }
+    });
+}
 
-    curl_global_cleanup();
+UploadPayload::UploadPayload(const string &path) :
+    m_fileName(fs::path(path).filename().string())
+{
+    // Empty files can't be mapped, they are sent as an empty payload.
+    if (fs::file_size(fs::path(path)) > 0)
+        m_file.open(path);
 }
 
-size_t file_read_cb(char *buffer, size_t size, size_t nitems, void *userp)
+// A single upload of a payload to this machine, shared by all of its attempts.
+struct NetworkMachine::UploadTransfer
 {
-    auto stream = reinterpret_cast<fs::ifstream*>(userp);
+    NetworkMachine* nm; // kept alive by the completion callback.
+    string uploadAs;
+    progress_callback_t onProgress;
+    upload_done_callback_t onDone;
+    // Declared after the callbacks to be unmapped before them, they may remove the file.
+    shared_ptr<const UploadPayload> payload;
+    size_t cursor = 0; // next byte of the payload to be sent.
+    int attempt = 0;
+
+    // Returns false if the machine already shows this progress.
+    bool updateProgress(int percent)
+    {
+        boost::lock_guard<boost::mutex> statelock(nm->m_stateMtx);
+        if (nm->progress == percent)
+            return false;
+        nm->progress = percent;
+        return true;
+    }
+};
 
-    try {
-        stream->read(buffer, size * nitems);
-    } catch (const std::exception &) {
-        return CURL_READFUNC_ABORT;
+static const int UPLOAD_ATTEMPTS = 5;
+
+// Only failures of the link or of a busy machine are worth another attempt. Rejected
+// credentials, HTTP 4xx and local errors fail the same way again and are reported at once.
+static bool is_transient_upload_error(CURLcode res, long status)
+{
+    switch (res) {
+    case CURLE_OK:
+        return status >= 500 || status == 408 || status == 429;
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_CONNECT:
+    case CURLE_OPERATION_TIMEDOUT:
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_FTP_ACCEPT_TIMEOUT:
+    case CURLE_FTP_CANT_GET_HOST:
+        return true;
+    default:
+        return false;
     }
-    return stream->gcount();
 }
 
-int xfercb(void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+static size_t payload_read_cb(char *buffer, size_t size, size_t nitems, void *userp)
 {
-    if (ultotal <= 0.0) return 0;
+    auto transfer = static_cast<NetworkMachine::UploadTransfer*>(userp);
+    size_t len = std::min(size * nitems, transfer->payload->size() - transfer->cursor);
+    if (len > 0)
+        memcpy(buffer, transfer->payload->data() + transfer->cursor, len);
+    transfer->cursor += len;
+    return len;
+}
 
-    auto self = static_cast<NetworkMachine*>(userp);
+// Called by curl when resuming an FTP upload (and when rewinding a HTTP form).
+static int payload_seek_cb(void *userp, curl_off_t offset, int origin)
+{
+    auto transfer = static_cast<NetworkMachine::UploadTransfer*>(userp);
+    if (origin != SEEK_SET || offset < 0 || size_t(offset) > transfer->payload->size())
+        return CURL_SEEKFUNC_CANTSEEK;
+    transfer->cursor = size_t(offset);
+    return CURL_SEEKFUNC_OK;
+}
 
-    int progress = (int)(((double)ulnow / (double)ultotal) * 100);
-    if (progress != self->progress && self->m_uploadProgressCallback != nullptr) {
-        self->progress = progress;
-        self->m_uploadProgressCallback(self->progress);
+// Progress is taken from the payload cursor rather than from curl's counters,
+// which start from zero again on a resumed attempt.
+static int payload_xfer_cb(void *userp, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+    auto transfer = static_cast<NetworkMachine::UploadTransfer*>(userp);
+    if (transfer->payload->size() == 0) return 0;
+
+    int progress = (int)(((double)transfer->cursor / (double)transfer->payload->size()) * 100);
+    if (transfer->updateProgress(progress)) {
+        if (transfer->nm->m_uploadProgressCallback != nullptr)
+            transfer->nm->m_uploadProgressCallback(progress);
+        if (transfer->onProgress != nullptr)
+            transfer->onProgress(progress);
     }
     return 0;
 }
 
-void NetworkMachine::uploadHTTP(const char *filename, const char *uploadAs)
-{
-    std::string url = "http://" + ip + "/upload.cgi:" + std::to_string(m_httpPort);
-    states->uploading = true;
-    auto http = Http::post(std::move(url));
-    http.form_add_file("file", filename, uploadAs)
-        .on_complete([&](std::string body, unsigned status) {states->uploading = false;})
-        .on_error([&](std::string body, std::string error, unsigned status) {
-            states->uploading = false;
-            BOOST_LOG_TRIVIAL(error) << boost::format("%1%: Error uploading file: %2%, HTTP %3%, body: `%4%`") % name % error % status % body;
-        })
-        .on_progress([&](Http::Progress progress, bool &cancel) {
-            xfercb(static_cast<void *>(this), progress.dltotal, progress.dlnow, progress.ultotal, progress.ulnow);
-        })
-        .perform_sync();
-}
-
-void NetworkMachine::uploadFTP(const char *filename, const char *uploadAs)
-{
-    CURL *curl;
-    CURLcode res;
-
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-    curl = curl_easy_init();
-
-    if (!curl) return;
-    fs::path path = fs::path(filename);
-    boost::system::error_code ec;
-    boost::uintmax_t filesize = file_size(path, ec);
-    std::unique_ptr<fs::ifstream> putFile;
-
-    states->uploading = true;
-    progress = 0;
-    m_uploadProgressCallback(progress); // reset
-    if (!ec) {
-        putFile = std::make_unique<fs::ifstream>(path, ios_base::in | ios_base::binary);
-        ::curl_easy_setopt(curl, CURLOPT_READDATA, (void *) (putFile.get()));
-        ::curl_easy_setopt(curl, CURLOPT_INFILESIZE, filesize);
+void NetworkMachine::upload(const char *filename, const char *uploadAs)
+{
+    shared_ptr<const UploadPayload> payload;
+    try {
+        payload = make_shared<UploadPayload>(filename);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << boost::format("Networkmachine - Couldn't read file %1% for uploading to [%2% - %3%]: %4%") % filename % name % ip % ex.what();
+        return;
     }
+    upload(payload, uploadAs);
+}
 
-    std::string pFilename = *uploadAs ? uploadAs : path.filename().string();
-    char *encodedFilename = ::curl_easy_escape(curl, pFilename.c_str(), pFilename.length());
+void NetworkMachine::upload(shared_ptr<const UploadPayload> payload, const string &uploadAs, progress_callback_t onProgress, upload_done_callback_t onDone)
+{
+    auto transfer = make_shared<UploadTransfer>();
+    transfer->nm = this;
+    transfer->payload = std::move(payload);
+    transfer->uploadAs = uploadAs.empty() ? transfer->payload->fileName() : uploadAs;
+    transfer->onProgress = std::move(onProgress);
+    transfer->onDone = std::move(onDone);
+
+    {
+        boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+        states->uploading = true;
+        progress = 0;
+    }
+    if (m_uploadProgressCallback)
+        m_uploadProgressCallback(0); // reset
+    startUpload(transfer);
+}
 
-    std::string url = "ftp://" + ip + ":" + std::to_string(m_ftpPort) + "/" + std::string(encodedFilename);
-    ::curl_easy_setopt(curl, CURLOPT_USERNAME, "zaxe");
-    ::curl_easy_setopt(curl, CURLOPT_PASSWORD, "zaxe");
-    ::curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    ::curl_easy_setopt(curl, CURLOPT_READFUNCTION, file_read_cb);
-    ::curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
-    ::curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
-    ::curl_easy_setopt(curl, CURLOPT_VERBOSE, get_logging_level() >= 5);
-    ::curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, xfercb);
-    ::curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, static_cast<void *>(this));
+void NetworkMachine::startUpload(shared_ptr<UploadTransfer> transfer, std::chrono::milliseconds delay)
+{
+    CURL *curl = ::curl_easy_init();
+    if (!curl) return finishUpload(transfer, false);
+
+    ++ transfer->attempt;
+    transfer->cursor = 0;
+    curl_mime *form = nullptr;
+    bool isHttp, isNoneTLS;
+    {
+        // A hello received meanwhile may rewrite the attributes.
+        boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+        isHttp    = attr->isHttp;
+        isNoneTLS = attr->isNoneTLS;
+    }
 
-    if ( ! attr->isNoneTLS) {
-        ::curl_easy_setopt(curl, CURLOPT_USE_SSL, (long)CURLUSESSL_ALL);
-        ::curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-        ::curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    if (isHttp) {
+        // The machine takes a multipart form, a failed attempt starts over from the first byte.
+        std::string host = m_httpPort == 80 ? ip : ip + ":" + std::to_string(m_httpPort);
+        std::string url = "http://" + host + "/upload.cgi:" + std::to_string(m_httpPort);
+        form = ::curl_mime_init(curl);
+        curl_mimepart *part = ::curl_mime_addpart(form);
+        ::curl_mime_name(part, "file");
+        ::curl_mime_filename(part, transfer->uploadAs.c_str());
+        ::curl_mime_data_cb(part, (curl_off_t)transfer->payload->size(), payload_read_cb, payload_seek_cb, nullptr, transfer.get());
+        ::curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        ::curl_easy_setopt(curl, CURLOPT_MIMEPOST, form);
     } else {
-        ::curl_easy_setopt(curl, CURLOPT_FTP_USE_EPSV, 0L);
-    }
-    res = curl_easy_perform(curl);
-    ::curl_free(encodedFilename);
-    ::curl_easy_cleanup(curl);
-    putFile.reset();
-    states->uploading = false;
-    if (CURLE_OK != res) {
-        BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine - Couldn't connect to machine [%1% - %2%] for uploading print.") % name % ip;
-        return;
+        char *encodedFilename = ::curl_easy_escape(curl, transfer->uploadAs.c_str(), transfer->uploadAs.length());
+        std::string url = "ftp://" + ip + ":" + std::to_string(m_ftpPort) + "/" + std::string(encodedFilename);
+        ::curl_free(encodedFilename);
+        ::curl_easy_setopt(curl, CURLOPT_USERNAME, "zaxe");
+        ::curl_easy_setopt(curl, CURLOPT_PASSWORD, "zaxe");
+        ::curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        ::curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        ::curl_easy_setopt(curl, CURLOPT_READFUNCTION, payload_read_cb);
+        ::curl_easy_setopt(curl, CURLOPT_READDATA, static_cast<void *>(transfer.get()));
+        ::curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, payload_seek_cb);
+        ::curl_easy_setopt(curl, CURLOPT_SEEKDATA, static_cast<void *>(transfer.get()));
+        ::curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)transfer->payload->size());
+        // Retries ask the machine how much has arrived (SIZE) and append the rest.
+        if (transfer->attempt > 1)
+            ::curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)-1);
+
+        if ( ! isNoneTLS) {
+            ::curl_easy_setopt(curl, CURLOPT_USE_SSL, (long)CURLUSESSL_ALL);
+            ::curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            ::curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        } else {
+            ::curl_easy_setopt(curl, CURLOPT_FTP_USE_EPSV, 0L);
+        }
     }
-
-    curl_global_cleanup();
+    ::curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    ::curl_easy_setopt(curl, CURLOPT_VERBOSE, get_logging_level() >= 5);
+    ::curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, payload_xfer_cb);
+    ::curl_easy_setopt(curl, CURLOPT_XFERINFODATA, static_cast<void *>(transfer.get()));
+
+    m_ctx.curl().add(curl, [self = shared_from_this(), transfer, form, isHttp](CURL *curl, CURLcode res) {
+        long status = 0;
+        if (isHttp && CURLE_OK == res)
+            ::curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        if (form != nullptr)
+            ::curl_mime_free(form);
+        if (CURLE_OK == res && status < 400)
+            return self->finishUpload(transfer, true);
+
+        BOOST_LOG_TRIVIAL(warning) << boost::format("Networkmachine - Uploading print to machine [%1% - %2%] failed (attempt %3%/%4%): %5% %6%")
+            % self->name % self->ip % transfer->attempt % UPLOAD_ATTEMPTS % ::curl_easy_strerror(res) % (status > 0 ? "HTTP " + std::to_string(status) : "");
+        if (transfer->attempt >= UPLOAD_ATTEMPTS || ! self->m_running || ! is_transient_upload_error(res, status))
+            return self->finishUpload(transfer, false);
+
+        // Give the link a moment to come back before retrying. The retry waits on the curl
+        // thread rather than on the io_context, a timer there would never fire once the
+        // context is stopped and the upload would never be finished.
+        self->startUpload(transfer, std::chrono::seconds(2 * transfer->attempt));
+    }, delay);
 }
 
-void NetworkMachine::upload(const char *filename, const char *uploadAs)
+void NetworkMachine::finishUpload(shared_ptr<UploadTransfer> transfer, bool success)
 {
-    if (attr->isHttp) {
-        uploadHTTP(filename, uploadAs);
-    } else {
-        uploadFTP(filename, uploadAs);
+    {
+        boost::lock_guard<boost::mutex> statelock(m_stateMtx);
+        states->uploading = false;
+        progress = success ? 100 : 0;
     }
+    if (m_uploadProgressCallback)
+        m_uploadProgressCallback(success ? 100 : 0);
+    if (transfer->onDone)
+        transfer->onDone(success);
 }
 
-NetworkMachineContainer::NetworkMachineContainer() {}
+NetworkMachineContainer::NetworkMachineContainer(NetworkMachine::event_listener_t listener) :
+    m_listener(std::move(listener))
+{}
 
 NetworkMachineContainer::~NetworkMachineContainer() {
     boost::lock_guard<boost::mutex> maplock(m_mtx);
@@ -370,14 +538,22 @@ shared_ptr<NetworkMachine> NetworkMachineContainer::addMachine(string ip, int po
     // If we have it already with the same ip, - do nothing.
     if (m_machineMap.find(string(ip)) != m_machineMap.end()) return nullptr;
     BOOST_LOG_TRIVIAL(info) << boost::format("NetworkMachineContainer - Trying to connect machine: [%1% - %2%].") % name % ip;
-    auto nm = make_shared<NetworkMachine>(ip, port, name, this);
-    nm->runnerThread = boost::thread(&NetworkMachine::run, nm);
-    nm->runnerThread.detach();
+    auto nm = m_listener ?
+        make_shared<NetworkMachine>(ip, port, name, m_context, nullptr, m_listener) :
+        make_shared<NetworkMachine>(ip, port, name, m_context, this);
+    nm->run(); // asynchronous, the session is driven by the shared network context.
     m_machineMap[ip] = nm; // Hold this for the carousel.
 
     return nm;
 }
 
+shared_ptr<NetworkMachine> NetworkMachineContainer::getMachine(const string &ip)
+{
+    boost::lock_guard<boost::mutex> maplock(m_mtx);
+    auto it = m_machineMap.find(ip);
+    return it == m_machineMap.end() ? nullptr : it->second;
+}
+
 void NetworkMachineContainer::removeMachine(string ip)
 {
     boost::lock_guard<boost::mutex> maplock(m_mtx);
@@ -385,4 +561,72 @@ void NetworkMachineContainer::removeMachine(string ip)
     m_machineMap[ip]->shutdown();
     m_machineMap.erase(ip);
 }
+
+// Machines waiting for their turn in a batch upload. Every finished transfer starts the next one.
+struct BatchUpload
+{
+    string uploadAs;
+    NetworkMachineContainer::batch_progress_callback_t onProgress;
+    NetworkMachineContainer::batch_done_callback_t onDone;
+    boost::mutex mtx;
+    std::deque<shared_ptr<NetworkMachine>> queue;
+    // Declared last to be unmapped before the callbacks are released, they may remove the file.
+    shared_ptr<const UploadPayload> payload;
+};
+
+static void batch_upload_next(shared_ptr<BatchUpload> batch)
+{
+    shared_ptr<NetworkMachine> nm;
+    {
+        boost::lock_guard<boost::mutex> lock(batch->mtx);
+        if (batch->queue.empty()) return;
+        nm = batch->queue.front();
+        batch->queue.pop_front();
+    }
+    string ip = nm->ip;
+    nm->upload(batch->payload, batch->uploadAs,
+        [batch, ip](int percent) { if (batch->onProgress) batch->onProgress(ip, percent); },
+        [batch, ip](bool success) {
+            if (batch->onDone) batch->onDone(ip, success);
+            batch_upload_next(batch);
+        });
+}
+
+bool NetworkMachineContainer::uploadBatch(const vector<string> &ips, const string &filename, const string &uploadAs,
+                                          batch_progress_callback_t onProgress, batch_done_callback_t onDone, size_t maxConcurrent)
+{
+    auto batch = make_shared<BatchUpload>();
+    try {
+        batch->payload = make_shared<UploadPayload>(filename);
+    } catch (const std::exception &ex) {
+        BOOST_LOG_TRIVIAL(error) << boost::format("NetworkMachineContainer - Couldn't read file %1% for uploading: %2%") % filename % ex.what();
+        return false;
+    }
+    batch->uploadAs = uploadAs;
+    batch->onProgress = std::move(onProgress);
+    batch->onDone = std::move(onDone);
+
+    vector<string> missing;
+    {
+        boost::lock_guard<boost::mutex> maplock(m_mtx);
+        std::set<string> seen; // an ip listed twice is sent the file once.
+        for (const string &ip : ips) {
+            if (! seen.insert(ip).second)
+                continue;
+            auto it = m_machineMap.find(ip);
+            if (it == m_machineMap.end() || it->second->isUploading())
+                missing.emplace_back(ip);
+            else
+                batch->queue.emplace_back(it->second);
+        }
+    }
+    for (const string &ip : missing) {
+        BOOST_LOG_TRIVIAL(warning) << boost::format("NetworkMachineContainer - Machine [%1%] is gone or busy uploading, skipped from the batch upload.") % ip;
+        if (batch->onDone) batch->onDone(ip, false);
+    }
+
+    for (size_t i = std::min(std::max<size_t>(maxConcurrent, 1), batch->queue.size()); i > 0; -- i)
+        batch_upload_next(batch);
+    return true;
+}
 } // namespace Slic3r
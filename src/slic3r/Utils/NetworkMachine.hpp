@@ -2,8 +2,10 @@
 #define slic3r_NetworkMachine_hpp_
 
 #include "WebSocket.hpp"
+#include "NetworkContext.hpp"
 
 #include <algorithm> // std::min
+#include <atomic>
 
 #include <boost/unordered_map.hpp>
 #include <boost/thread.hpp>
@@ -11,8 +13,11 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/bind.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <curl/curl.h>
 
+#include "libslic3r/JsonMessage.hpp"
+
 using namespace std;
 using namespace boost::algorithm;
 using namespace boost::property_tree;
@@ -34,25 +39,28 @@ struct MachineEvent : public wxEvent
     virtual wxEvent *Clone() const { return new MachineEvent(*this); }
 };
 
-// custome new mesage event.
-struct MachineNewMessageEvent : public wxEvent
+// UI updates a machine has pending. Messages from the machine only set these bits, the UI
+// takes them at its own frame rate, so a burst of messages ends up in a single repaint.
+namespace MachineUpdate {
+enum : uint32_t {
+    States    = 1 << 0,
+    Progress  = 1 << 1,
+    Name      = 1 << 2,
+    FileStart = 1 << 3,
+};
+} // namespace MachineUpdate
+
+struct MachineUpdateStats
 {
-    ptree pt;
-    NetworkMachine* nm;
-    string event;
-    MachineNewMessageEvent(wxEventType eventType, string event, boost::property_tree::ptree pt, NetworkMachine* nm, int winid) :
-        wxEvent(winid, eventType),
-        event(event),
-        pt(pt),
-        nm(nm)
-        {}
-    virtual wxEvent *Clone() const { return new MachineNewMessageEvent(*this); }
+    size_t posted  = 0; // updates posted by the machine.
+    size_t merged  = 0; // updates merged into one still pending.
+    size_t dropped = 0; // messages ignored or updates thrown away.
 };
 
-// Machine events. Open, close and new message for the NetworkMachineContainer
+// Machine events. Open, close and pending updates for the NetworkMachineContainer
 wxDECLARE_EVENT(EVT_MACHINE_OPEN, MachineEvent);
 wxDECLARE_EVENT(EVT_MACHINE_CLOSE, MachineEvent);
-wxDECLARE_EVENT(EVT_MACHINE_NEW_MESSAGE, MachineNewMessageEvent);
+wxDECLARE_EVENT(EVT_MACHINE_UPDATES_PENDING, MachineEvent); // posted only when the first update becomes pending.
 wxDECLARE_EVENT(EVT_MACHINE_AVATAR_READY, wxCommandEvent);
 
 struct MachineStates { // states.
@@ -65,8 +73,8 @@ struct MachineStates { // states.
     bool printing;
     bool heating;
     bool paused;
-    inline bool ptreeStringtoBool(ptree pt, string prop) {
-        return pt.get<string>(prop, "False") == "True";
+    inline bool jsonStringToBool(const JsonReader &json, const char *prop) {
+        return json.get_string(prop, "False") == "True";
     }
 };
 
@@ -92,16 +100,44 @@ struct MachineAttributes // attributes.
     int firmwareVersion;
 };
 
-class NetworkMachine
+// Copy of what a machine reported, taken by NetworkMachine::snapshot().
+struct MachineSnapshot
+{
+    string name;
+    MachineAttributes attr;
+    MachineStates states;
+    int progress;
+};
+
+// File to be sent to one or more machines. It is mapped into memory once and every
+// transfer reads it through its own cursor.
+class UploadPayload
 {
 public:
-    NetworkMachine(string ip, int port, string name, wxEvtHandler* hndlr); // construct network machine.
+    explicit UploadPayload(const string &path); // throws if the file can't be mapped.
+
+    const char* data() const { return m_file.data(); }
+    size_t size() const { return m_file.is_open() ? m_file.size() : 0; }
+    const string& fileName() const { return m_fileName; }
+private:
+    boost::iostreams::mapped_file_source m_file;
+    string m_fileName;
+};
+
+class NetworkMachine : public std::enable_shared_from_this<NetworkMachine>
+{
+public:
+    // Receives the machine events instead of a wx event handler when there is no wx event
+    // loop (XDesktop --fleet). Called from the network threads.
+    typedef std::function<void(wxEventType type, NetworkMachine* nm)> event_listener_t;
+
+    NetworkMachine(string ip, int port, string name, NetworkContext& ctx, wxEvtHandler* hndlr, event_listener_t listener = nullptr); // construct network machine.
     ~NetworkMachine();
 
-    void run(); // start network machine by connecting to ws.
-    void ftpRun(); // start downloading avatar in another thread.
+    void run(); // start network machine by connecting to ws, returns immediately.
 
     typedef std::function<void(int percent)>  progress_callback_t;
+    typedef std::function<void(bool success)> upload_done_callback_t;
     progress_callback_t m_uploadProgressCallback;
 
     // Actions
@@ -110,12 +146,25 @@ public:
     void cancel();
     void pause();
     void resume();
-    void uploadHTTP(const char *filename, const char *uploadAs = "");
-    void uploadFTP(const char *filename, const char *uploadAs = "");
+    // Uploads return immediately, the transfer runs on the shared curl multi handle.
+    // Attempts failed on network errors are retried, FTP ones resume from what already arrived on the machine.
     void upload(const char *filename, const char *uploadAs = "");
-    void downloadAvatar();
-
-    void shutdown() { m_running = false; }
+    void upload(shared_ptr<const UploadPayload> payload, const string &uploadAs,
+                progress_callback_t onProgress = nullptr, upload_done_callback_t onDone = nullptr);
+    struct UploadTransfer; // state of an upload, shared by its attempts.
+    void downloadAvatar(); // queues the avatar download on the shared curl multi handle.
+
+    void shutdown(); // stops reporting events and closes the websocket.
+
+    // Takes the pending MachineUpdate bits, UI thread only. Applies the reported progress
+    // if there is a progress update among them.
+    uint32_t takePendingUpdates();
+    MachineUpdateStats updateStats() const;
+    // Name, attributes, states and progress copied under m_stateMtx, safe on any thread.
+    MachineSnapshot snapshot() const;
+    bool isUploading() const; // states->uploading read under m_stateMtx.
+    // Ports of the HTTP and FTP services of the machine, 80 and 9494 unless changed.
+    void setUploadPorts(unsigned short httpPort, unsigned short ftpPort) { m_httpPort = httpPort; m_ftpPort = ftpPort; }
 
     string id; // unique id of the machine.
     string name; // name of the machine.
@@ -126,8 +175,6 @@ public:
 
     MachineAttributes* attr; // attributes,
     MachineStates* states; // states,
-    boost::thread runnerThread;
-    boost::thread ftpThread;
     void setUploadProgressCallback(progress_callback_t cb) { m_uploadProgressCallback = cb; }
     wxBitmap& getAvatar() {
         boost::lock_guard<boost::mutex> avatarlock(m_avatarMtx);
@@ -147,24 +194,53 @@ private:
     void onWSRead(string message); // Websocket read message callback.
     void onWSError(string message); // Websocket error callback.
 
+    // queues an attempt on the curl multi handle, to be started after the delay.
+    void startUpload(shared_ptr<UploadTransfer> transfer, std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+    void finishUpload(shared_ptr<UploadTransfer> transfer, bool success);
+
+    void postUpdate(uint32_t update); // marks an update pending, thread safe.
+    void postMachineEvent(wxEventType type); // to the listener if there is one, to the event handler otherwise.
+
     void request(const char* command); // does a request with intended command on device.
-    void send(ptree pt); // sends ptree as json string to websocket (m_ws).
+    void send(const string &json); // sends json string to websocket (m_ws).
 
+    NetworkContext& m_ctx; // shared io_context & curl multi handle.
     wxEvtHandler* m_evtHandler; // parent event handler.
-    Websocket* m_ws; // websocket
+    event_listener_t m_listener; // replaces m_evtHandler when set.
+    shared_ptr<Websocket> m_ws; // websocket
     wxBitmap m_avatar; // avatar image via FTP.
     boost::mutex m_avatarMtx; // allows read operations on m_avatar without locking.
-    bool m_running;
+    mutable boost::mutex m_stateMtx; // guards name, *attr, *states and progress written by the network threads.
+    std::atomic<bool> m_avatarDownloading { false }; // one avatar download at a time.
+    std::atomic<bool> m_running { false };
+    std::atomic<uint32_t> m_pendingUpdates { 0 }; // MachineUpdate bits.
+    std::atomic<int> m_reportedProgress { 0 }; // latest progress sent by the machine.
+    std::atomic<size_t> m_updatesPosted { 0 };
+    std::atomic<size_t> m_updatesMerged { 0 };
+    std::atomic<size_t> m_updatesDropped { 0 };
 };
 
 class NetworkMachineContainer : public std::enable_shared_from_this<NetworkMachineContainer>, public wxEvtHandler
 {
 public:
-    NetworkMachineContainer();
+    // With a listener the machines report their events to it rather than to this wxEvtHandler.
+    NetworkMachineContainer(NetworkMachine::event_listener_t listener = nullptr);
     ~NetworkMachineContainer();
     shared_ptr<NetworkMachine> addMachine(string ip, int port, string name);
+    shared_ptr<NetworkMachine> getMachine(const string &ip);
     void removeMachine(string id);
+    NetworkContext& context() { return m_context; }
+
+    typedef std::function<void(const string &ip, int percent)> batch_progress_callback_t;
+    typedef std::function<void(const string &ip, bool success)> batch_done_callback_t;
+    // Sends the same file to all the given machines, at most maxConcurrent of them at a time.
+    // The file is mapped into memory once and shared by all the transfers. Returns false if
+    // the file can't be read, otherwise onDone is called once for each of the distinct ips.
+    bool uploadBatch(const vector<string> &ips, const string &filename, const string &uploadAs,
+                     batch_progress_callback_t onProgress, batch_done_callback_t onDone, size_t maxConcurrent = 4);
 private:
+    NetworkContext m_context; // shared by all the machines, outlives them.
+    NetworkMachine::event_listener_t m_listener;
     boost::mutex m_mtx; // allows read operations on m_machineMap without locking.
     boost::unordered_map<std::string, shared_ptr<NetworkMachine>> m_machineMap;
 };
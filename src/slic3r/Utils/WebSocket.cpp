@@ -1,71 +1,146 @@
 #include "WebSocket.hpp"
 #include <boost/signals2.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 
 namespace Slic3r {
 Websocket::Websocket(string host, int port, net::io_context& ioc) :
-    m_resolver(net::make_strand(ioc)),
-    m_ws(net::make_strand(ioc)),
+    m_strand(net::make_strand(ioc)),
+    m_resolver(m_strand),
+    m_ws(m_strand),
     m_host(host),
     m_port(port) { }
 
 void Websocket::run()
 {
-    try {
-        beast::error_code ec;
+    net::dispatch(m_strand, [self = shared_from_this()]() {
         // Look up the domain name
-        auto const results = m_resolver.resolve(m_host, std::to_string(m_port), ec);
-        if (ec) return onErrorSignal(ec.message());
-        // Make the connection on the IP address we get from a lookup
-        beast::get_lowest_layer(m_ws).connect(results, ec);
-        if (ec) return onErrorSignal(ec.message());
-        beast::get_lowest_layer(m_ws).expires_never();
-        // Set suggested timeout settings for the websocket
-        m_ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
-        m_ws.set_option(websocket::stream_base::decorator([](websocket::response_type& req)
-                    { req.set(http::field::user_agent,
-                            string(BOOST_BEAST_VERSION_STRING) +
-                            " websocket-xdesktop"); }));
-        m_ws.handshake(m_host, "/", ec); // Perform the websocket handshake
-        if (ec) return onErrorSignal(ec.message());
+        self->m_resolver.async_resolve(self->m_host, std::to_string(self->m_port),
+            beast::bind_front_handler(&Websocket::onResolve, self));
+    });
+}
 
-        onConnectSignal(); // signal connected.
+void Websocket::onResolve(beast::error_code ec, tcp::resolver::results_type results)
+{
+    if (ec) return fail(ec);
+    // Make the connection on the IP address we get from a lookup
+    beast::get_lowest_layer(m_ws).expires_after(std::chrono::seconds(30));
+    beast::get_lowest_layer(m_ws).async_connect(results, beast::bind_front_handler(&Websocket::onConnect, shared_from_this()));
+}
+
+void Websocket::onConnect(beast::error_code ec, tcp::resolver::results_type::endpoint_type)
+{
+    if (ec) return fail(ec);
+    // The websocket stream uses its own timeouts.
+    beast::get_lowest_layer(m_ws).expires_never();
+    // Set suggested timeout settings for the websocket
+    m_ws.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
+    m_ws.set_option(websocket::stream_base::decorator([](websocket::request_type& req)
+                { req.set(http::field::user_agent,
+                        string(BOOST_BEAST_VERSION_STRING) +
+                        " websocket-xdesktop"); }));
+    m_ws.async_handshake(m_host, "/", beast::bind_front_handler(&Websocket::onHandshake, shared_from_this())); // Perform the websocket handshake
+}
 
-        // set timeouts
-        m_ws.set_option(stream_base::timeout{
-            std::chrono::seconds(30), // handshake timeout
-            std::chrono::seconds(30), // idle timeout
-            true // internal ping
-        });
+void Websocket::onHandshake(beast::error_code ec)
+{
+    if (ec) return fail(ec);
+    m_connected = true;
 
-        // start reading...
-        m_ws.async_read(m_buffer, beast::bind_front_handler(&Websocket::onRead, shared_from_this()));
+    try {
+        onConnectSignal(); // signal connected.
     } catch (...) {
         onErrorSignal("Unknown websocket error.");
     }
+
+    // set timeouts
+    m_ws.set_option(stream_base::timeout{
+        std::chrono::seconds(30), // handshake timeout
+        std::chrono::seconds(30), // idle timeout
+        true // internal ping
+    });
+
+    // start reading...
+    m_ws.async_read(m_buffer, beast::bind_front_handler(&Websocket::onRead, shared_from_this()));
+    // flush the messages queued while connecting.
+    if (! m_writeQueue.empty())
+        doWrite();
 }
 
 void Websocket::onRead(beast::error_code ec, size_t bytesTransferred)
 {
+    if (ec) return fail(ec);
     try {
-        if (ec == websocket::error::closed) return;
-        if (ec) onErrorSignal(ec.message());
-        else {
-            auto message = beast::buffers_to_string(m_buffer.data());
-            m_buffer.consume(bytesTransferred); // remove the data that was read.
-            //BOOST_LOG_TRIVIAL(debug) << "Websocket - onMachineMessage: " << message;
-            onReadSignal(message);
-            m_ws.async_read(m_buffer, beast::bind_front_handler(&Websocket::onRead, shared_from_this()));
-        }
-    } catch(beast::error_code e) {
-        onErrorSignal(e.message());
+        auto message = beast::buffers_to_string(m_buffer.data());
+        m_buffer.consume(bytesTransferred); // remove the data that was read.
+        //BOOST_LOG_TRIVIAL(debug) << "Websocket - onMachineMessage: " << message;
+        onReadSignal(message);
     } catch (...) {
         onErrorSignal("Unknown websocket error.");
     }
+    m_ws.async_read(m_buffer, beast::bind_front_handler(&Websocket::onRead, shared_from_this()));
 }
 
 void Websocket::send(string message)
 {
-    m_ws.write(net::buffer(message));
+    net::post(m_strand, [self = shared_from_this(), message = std::move(message)]() mutable {
+        if (self->m_closing || self->m_failed) return; // would never be sent.
+        self->m_writeQueue.emplace_back(std::move(message));
+        // Only one async_write may be in flight, the rest waits in the queue.
+        if (self->m_connected && self->m_writeQueue.size() == 1)
+            self->doWrite();
+    });
+}
+
+void Websocket::doWrite()
+{
+    m_writing = true;
+    m_ws.async_write(net::buffer(m_writeQueue.front()), beast::bind_front_handler(&Websocket::onWrite, shared_from_this()));
+}
+
+void Websocket::onWrite(beast::error_code ec, size_t /* bytesTransferred */)
+{
+    m_writing = false;
+    if (ec) return fail(ec); // clears the queue, reports the error.
+    m_writeQueue.pop_front();
+    if (! m_closing && ! m_failed && ! m_writeQueue.empty())
+        doWrite();
+}
+
+void Websocket::close()
+{
+    net::post(m_strand, [self = shared_from_this()]() {
+        if (self->m_closing) return;
+        self->m_closing = true;
+        if (self->m_writing) {
+            // The front message is being written, its buffer has to live until onWrite(),
+            // async_close waits for that write. Drop only the messages queued behind it.
+            self->m_writeQueue.resize(1);
+        } else
+            self->m_writeQueue.clear();
+        if (self->m_connected) {
+            self->m_ws.async_close(websocket::close_code::normal, [self](beast::error_code) {});
+        } else {
+            // Still resolving or connecting.
+            self->m_resolver.cancel();
+            beast::get_lowest_layer(self->m_ws).cancel();
+        }
+    });
+}
+
+void Websocket::fail(beast::error_code ec)
+{
+    bool reported = m_failed; // the read and the write in flight may both fail.
+    m_connected = false;
+    m_failed = true;
+    // The session is over, drop what is still queued. A message still being written has
+    // to live until its onWrite().
+    m_writeQueue.resize(m_writing ? 1 : 0);
+    // Errors caused by closing the session ourselves are not reported.
+    if (reported || m_closing || ec == websocket::error::closed || ec == net::error::operation_aborted) return;
+    try {
+        onErrorSignal(ec.message());
+    } catch (...) {}
 }
 
 Websocket::~Websocket()
@@ -10,6 +10,8 @@
 #include <boost/chrono.hpp>
 #include <boost/thread/thread.hpp>
 
+#include <deque>
+
 namespace beast = boost::beast;         // from <boost/beast.hpp>
 namespace http = beast::http;           // from <boost/beast/http.hpp>
 namespace websocket = beast::websocket; // from <boost/beast/websocket.hpp>
@@ -21,15 +23,19 @@ using namespace std;
 using namespace beast::websocket;
 
 namespace Slic3r {
+// Asynchronous websocket client session. All the sessions share the io_context passed in
+// (see NetworkContext), each one is serialized on its own strand, so no thread is blocked
+// per connection. Signals are emitted from the io_context threads.
 class Websocket : public enable_shared_from_this<Websocket>
 {
 public:
     Websocket(string host, int port, net::io_context& ioc);
     ~Websocket();
 
-    void run(); // run this func in a thread.
+    void run(); // starts resolving & connecting, returns immediately.
 
-    void send(string message); // sends message to websocket.
+    void send(string message); // queues message to websocket, thread safe.
+    void close(); // closes the connection gracefully, thread safe.
 
     // signals
     typedef sig::signal<void ()> ConnectEvent;
@@ -48,11 +54,23 @@ public:
     ConnectEvent onConnectSignal;
     ErrorEvent onErrorSignal;
 private:
+    void onResolve(beast::error_code ec, tcp::resolver::results_type results);
+    void onConnect(beast::error_code ec, tcp::resolver::results_type::endpoint_type);
+    void onHandshake(beast::error_code ec);
     void onRead(beast::error_code ec, size_t bytesTransferred);
+    void doWrite();
+    void onWrite(beast::error_code ec, size_t bytesTransferred);
+    void fail(beast::error_code ec);
 
+    net::strand<net::io_context::executor_type> m_strand; // serializes all handlers of this session.
+    tcp::resolver m_resolver;
     websocket::stream<beast::tcp_stream> m_ws; // socket.
     beast::flat_buffer m_buffer; // buffer.
-    tcp::resolver m_resolver;
+    std::deque<string> m_writeQueue; // outgoing messages, front one is being written.
+    bool m_writing = false; // async_write of m_writeQueue.front() in flight.
+    bool m_connected = false;
+    bool m_closing = false;
+    bool m_failed = false; // a read, write or connect failed, nothing is sent anymore.
 
     string m_host;
     int m_port;
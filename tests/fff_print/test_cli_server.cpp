@@ -0,0 +1,56 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/process.hpp>
+
+#include "libslic3r/JsonMessage.hpp"
+
+using namespace Slic3r;
+namespace bp = boost::process;
+
+// Next result line of the server, the log lines are skipped.
+static std::string read_reply(bp::ipstream &out)
+{
+    std::string line;
+    while (std::getline(out, line))
+        if (! line.empty() && line.front() == '{')
+            return line;
+    return std::string();
+}
+
+SCENARIO("Slicing server keeps serving after a malformed job", "[CLI]") {
+    GIVEN("xdesktop --server") {
+        bp::opstream in;
+        bp::ipstream out;
+        bp::child    server(XDESKTOP_BINARY, "--server", bp::std_in < in, bp::std_out > out, bp::std_err > bp::null);
+        WHEN("a malformed job is followed by a valid one") {
+            in << "{\"id\": 1, \"input\": " << std::endl;
+            JsonReader malformed;
+            REQUIRE(malformed.parse(read_reply(out)));
+            in << JsonWriter().add("id", 2).add("input", std::string(TEST_DATA_DIR) + "/test_stl/ASCII/20mmbox-LF.stl").str() << std::endl;
+            JsonReader sliced;
+            REQUIRE(sliced.parse(read_reply(out)));
+            THEN("the malformed job is answered with an error") {
+                CHECK(malformed.get_string("status") == "error");
+                CHECK(! malformed.get_string("error").empty());
+                CHECK(! malformed.has("gcode"));
+            }
+            THEN("the valid job is sliced by the same process") {
+                CHECK(server.running());
+                CHECK(sliced.get_string("status") == "ok");
+                CHECK(sliced.get_int("id") == 2);
+                CHECK(! sliced.get_bool("cached"));
+                // Kept until the next job is read.
+                CHECK(boost::filesystem::file_size(sliced.get_string("gcode")) > 0);
+            }
+            in.pipe().close();
+            server.wait();
+            THEN("the server exits cleanly at the end of its input, removing the files of the last job") {
+                CHECK(server.exit_code() == 0);
+                CHECK(! boost::filesystem::exists(sliced.get_string("gcode")));
+            }
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/libslic3r.h"
+#include "libslic3r/Layer.hpp"
+#include "libslic3r/Model.hpp"
+#include "libslic3r/MultiMaterialSegmentation.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/TriangleSelector.hpp"
+
+using namespace Slic3r;
+
+SCENARIO("Multi-material segmentation of a painted cube", "[MMUSegmentation]") {
+    GIVEN("20mm cube, its +X side painted by the 2nd extruder, the other sides by the 1st extruder") {
+        Model        model;
+        ModelObject *object = model.add_object();
+        ModelVolume *volume = object->add_volume(make_cube(20., 20., 20.));
+        object->add_instance()->set_offset(Vec3d(100., 100., 0.));
+        object->ensure_on_bed();
+
+        const indexed_triangle_set &its = volume->mesh().its;
+        TriangleSelector            selector(volume->mesh());
+        for (int facet_idx = 0; facet_idx < int(its.indices.size()); ++ facet_idx)
+            selector.set_facet(facet_idx, its_face_normal(its, facet_idx).x() > 0.99f ? EnforcerBlockerType::Extruder2 : EnforcerBlockerType::Extruder1);
+        volume->mmu_segmentation_facets.set(selector);
+        REQUIRE(object->is_mm_painted());
+
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "nozzle_diameter",    "0.4,0.4" },
+            { "first_layer_height", 0.2 },
+            { "layer_height",       0.2 }
+        });
+        Print print;
+        print.apply(model, config);
+        print.set_status_silent();
+        PrintObject *print_object = print.objects_mutable().front();
+        print_object->slice();
+
+        WHEN("The layers are segmented") {
+            std::vector<std::vector<ExPolygons>> segmentation = multi_material_segmentation_by_painting(*print_object, []() {});
+            REQUIRE(segmentation.size() == print_object->layers().size());
+            THEN("The middle layers are split by the bisectors of the corners of the +X side") {
+                // Away from the top and bottom solid layers, which are painted by the 1st extruder over the whole layer.
+                // The points closer to the +X side than to the others form a triangle of 20 x 10mm.
+                size_t num_checked = 0;
+                for (size_t layer_idx = 0; layer_idx < segmentation.size(); ++ layer_idx)
+                    if (double print_z = print_object->get_layer(int(layer_idx))->print_z; print_z > 5. && print_z < 15.) {
+                        REQUIRE(segmentation[layer_idx].size() == 3);
+                        CHECK(area(segmentation[layer_idx][0]) == Approx(0.).margin(scaled<double>(1.) * scaled<double>(1.)));
+                        CHECK(area(segmentation[layer_idx][1]) == Approx(scaled<double>(20.) * scaled<double>(15.)).epsilon(0.02));
+                        CHECK(area(segmentation[layer_idx][2]) == Approx(scaled<double>(20.) * scaled<double>(5.)).epsilon(0.02));
+                        ++ num_checked;
+                    }
+                REQUIRE(num_checked > 40);
+            }
+            THEN("Segmenting again produces the same regions") {
+                std::vector<std::vector<ExPolygons>> segmentation2 = multi_material_segmentation_by_painting(*print_object, []() {});
+                REQUIRE(segmentation2.size() == segmentation.size());
+                for (size_t layer_idx = 0; layer_idx < segmentation.size(); ++ layer_idx) {
+                    REQUIRE(segmentation2[layer_idx].size() == segmentation[layer_idx].size());
+                    for (size_t extruder_idx = 0; extruder_idx < segmentation[layer_idx].size(); ++ extruder_idx)
+                        REQUIRE(segmentation2[layer_idx][extruder_idx] == segmentation[layer_idx][extruder_idx]);
+                }
+            }
+        }
+    }
+}
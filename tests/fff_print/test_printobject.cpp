@@ -3,12 +3,63 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/SlicingAdaptive.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+
+#include <cfloat>
 
 #include "test_data.hpp"
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
 
+// Reference of SlicingAdaptive::next_layer_height(): a linear scan over all faces of the object sorted by their Z span,
+// calculating the layer height allowed by each face from scratch, as it was done before the faces were indexed.
+static float next_layer_height_linear_scan(const SlicingParameters &slicing_params, const ModelObject &object, float print_z, float quality_factor)
+{
+    TriangleMesh         mesh           = object.raw_mesh();
+    const ModelInstance &first_instance = *object.instances.front();
+    mesh.transform(first_instance.get_matrix(), first_instance.is_left_handed());
+    std::vector<SlicingAdaptive::FaceZ> faces;
+    for (const stl_triangle_vertex_indices &face : mesh.its.indices) {
+        stl_vertex vertex[3] = { mesh.its.vertices[face[0]], mesh.its.vertices[face[1]], mesh.its.vertices[face[2]] };
+        stl_vertex n         = face_normal_normalized(vertex);
+        faces.push_back({ { std::min(std::min(vertex[0].z(), vertex[1].z()), vertex[2].z()), std::max(std::max(vertex[0].z(), vertex[1].z()), vertex[2].z()) },
+            std::abs(n.z()), std::sqrt(n.x() * n.x() + n.y() * n.y()) });
+    }
+    std::sort(faces.begin(), faces.end(), [](const SlicingAdaptive::FaceZ &f1, const SlicingAdaptive::FaceZ &f2) { return f1.z_span < f2.z_span; });
+
+    const float max_surface_deviation = float(quality_factor < 0.5f ?
+        lerp(slicing_params.min_layer_height, slicing_params.layer_height, 2. * quality_factor) :
+        lerp(slicing_params.max_layer_height, slicing_params.layer_height, 2. * (1. - quality_factor)));
+    auto layer_height_from_slope = [max_surface_deviation](const SlicingAdaptive::FaceZ &face) {
+        return std::min(max_surface_deviation / 0.184f, (face.n_cos > 1e-5) ? float(1.44 * max_surface_deviation * sqrt(face.n_sin / face.n_cos)) : FLT_MAX);
+    };
+
+    float  height = float(slicing_params.max_layer_height);
+    size_t iface  = 0;
+    // Faces spanning print_z, skipping those touching print_z from below.
+    for (; iface < faces.size() && faces[iface].z_span.first < print_z; ++ iface)
+        if (faces[iface].z_span.second >= print_z + EPSILON)
+            height = std::min(height, layer_height_from_slope(faces[iface]));
+    height = std::max(height, float(slicing_params.min_layer_height));
+    // Faces starting inside the new layer.
+    if (height > float(slicing_params.min_layer_height)) {
+        for (; iface < faces.size() && faces[iface].z_span.first < print_z + height; ++ iface) {
+            if (faces[iface].z_span.second < print_z + EPSILON)
+                continue;
+            float reduced_height = layer_height_from_slope(faces[iface]);
+            float z_diff         = faces[iface].z_span.first - print_z;
+            if (reduced_height < z_diff)
+                height = z_diff;
+            else if (reduced_height < height)
+                height = reduced_height;
+        }
+        height = std::max(height, float(slicing_params.min_layer_height));
+    }
+    return height;
+}
+
 SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
     GIVEN("20mm cube and default initial config, initial layer height of 2mm") {
         WHEN("generate_object_layers() is called for 2mm layer heights and nozzle diameter of 3mm") {
@@ -87,3 +138,145 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: reslicing after the layer height profile was edited", "[PrintObject]") {
+    GIVEN("50mm sphere sliced with 0.2mm layers") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "first_layer_height", 0.2 },
+            { "layer_height",       0.2 }
+        });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::sphere_50mm}, print, model, config);
+        print.process();
+        const PrintObject        *object = print.objects().front();
+        std::vector<const Layer*> layers_before(object->layers().begin(), object->layers().end());
+        const SlicingParameters  &slicing_params = object->slicing_parameters();
+        const double              height = slicing_params.object_print_z_max - slicing_params.object_print_z_min;
+        WHEN("The upper half is sliced with 0.1mm layers") {
+            const std::vector<coordf_t> profile { 0., 0.2, 0.5 * height, 0.2, 0.5 * height, 0.1, height, 0.1 };
+            model.objects.front()->layer_height_profile.set(profile);
+            print.apply(model, config);
+            print.process();
+            THEN("The PrintObject is kept and the layers of the lower half are reused") {
+                REQUIRE(print.objects().front() == object);
+                size_t num_reused = 0;
+                for (size_t i = 1; i < layers_before.size() && layers_before[i]->print_z < 0.5 * height - 1.; ++ i, ++ num_reused)
+                    REQUIRE(object->layers()[i] == layers_before[i]);
+                REQUIRE(num_reused > 0);
+            }
+            THEN("The layers are the same as when sliced from scratch") {
+                Slic3r::Print print2;
+                Slic3r::Model model2;
+                Slic3r::Test::init_print({TestMesh::sphere_50mm}, print2, model2, config);
+                model2.objects.front()->layer_height_profile.set(profile);
+                print2.apply(model2, config);
+                print2.process();
+                ConstLayerPtrsAdaptor layers  = object->layers();
+                ConstLayerPtrsAdaptor layers2 = print2.objects().front()->layers();
+                REQUIRE(layers.size() == layers2.size());
+                for (size_t i = 0; i < layers.size(); ++ i) {
+                    REQUIRE(layers[i]->id() == layers2[i]->id());
+                    REQUIRE(layers[i]->print_z == Approx(layers2[i]->print_z));
+                    REQUIRE(layers[i]->lslices.size() == layers2[i]->lslices.size());
+                    for (size_t j = 0; j < layers[i]->lslices.size(); ++ j)
+                        REQUIRE(layers[i]->lslices[j].area() == Approx(layers2[i]->lslices[j].area()));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("PrintObject: slicing engines", "[PrintObject]") {
+    GIVEN("50mm sphere sliced with 0.2mm layers") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "first_layer_height", 0.2 },
+            { "layer_height",       0.2 }
+        });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::sphere_50mm}, print, model, config);
+        print.process();
+        ConstLayerPtrsAdaptor layers = print.objects().front()->layers();
+        for (const char *engine : { "sweep", "sweep_edges" }) {
+            WHEN("slicing_engine is set to " << engine) {
+                config.set_deserialize_strict({ { "slicing_engine", engine } });
+                Slic3r::Print print2;
+                Slic3r::Model model2;
+                Slic3r::Test::init_print({TestMesh::sphere_50mm}, print2, model2, config);
+                print2.process();
+                THEN("The layers are the same as sliced per facet") {
+                    ConstLayerPtrsAdaptor layers2 = print2.objects().front()->layers();
+                    REQUIRE(layers.size() == layers2.size());
+                    for (size_t i = 0; i < layers.size(); ++ i) {
+                        REQUIRE(layers[i]->print_z == Approx(layers2[i]->print_z));
+                        REQUIRE(layers[i]->lslices.size() == layers2[i]->lslices.size());
+                        for (size_t j = 0; j < layers[i]->lslices.size(); ++ j)
+                            REQUIRE(layers[i]->lslices[j].area() == Approx(layers2[i]->lslices[j].area()));
+                    }
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("PrintObject: adaptive layer height profile", "[PrintObject]") {
+    GIVEN("50mm sphere") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({
+            { "first_layer_height", 0.2 },
+            { "layer_height",       0.2 }
+        });
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::sphere_50mm}, print, model, config);
+        const ModelObject       &model_object   = *model.objects.front();
+        const SlicingParameters &slicing_params = print.objects().front()->slicing_parameters();
+        WHEN("The faces of the sphere are prepared once") {
+            SlicingAdaptive as;
+            as.set_slicing_parameters(slicing_params);
+            as.prepare(model_object);
+            THEN("The prepared faces match the object") {
+                REQUIRE(as.prepared_for(model_object));
+            }
+            THEN("The layer heights are those of a linear scan over the faces") {
+                const double height = slicing_params.object_print_z_max - slicing_params.object_print_z_min;
+                for (float quality_factor : { 0.f, 0.25f, 0.5f, 0.75f, 1.f })
+                    for (double print_z = 0.; print_z < height; print_z += 0.37)
+                        REQUIRE(as.next_layer_height(float(print_z), quality_factor) ==
+                            Approx(next_layer_height_linear_scan(slicing_params, model_object, float(print_z), quality_factor)).epsilon(1e-5));
+            }
+            THEN("The prepared faces do not match the object once its volume is replaced") {
+                model.objects.front()->volumes.front()->set_new_unique_id();
+                REQUIRE(! as.prepared_for(model_object));
+            }
+            THEN("The profiles for all quality factors are the same as when calculated from scratch") {
+                for (float quality_factor : { 0.f, 0.25f, 0.5f, 0.75f, 1.f }) {
+                    std::vector<double> profile = layer_height_profile_adaptive(slicing_params, as, quality_factor);
+                    REQUIRE(profile == layer_height_profile_adaptive(slicing_params, model_object, quality_factor));
+                    for (size_t i = 1; i < profile.size(); i += 2) {
+                        REQUIRE(profile[i] >= slicing_params.min_layer_height - EPSILON);
+                        REQUIRE(profile[i] <= slicing_params.max_layer_height + EPSILON);
+                    }
+                }
+            }
+            THEN("Lower quality factors produce more layers") {
+                REQUIRE(layer_height_profile_adaptive(slicing_params, as, 0.f).size() > layer_height_profile_adaptive(slicing_params, as, 1.f).size());
+            }
+        }
+        WHEN("The adaptive profile is smoothed") {
+            std::vector<double> profile  = layer_height_profile_adaptive(slicing_params, model_object, 0.5f);
+            std::vector<double> smoothed = smooth_height_profile(profile, slicing_params, HeightProfileSmoothingParams(5, true));
+            THEN("The layers stay at the same Z and they do not get thicker") {
+                REQUIRE(smoothed.size() == profile.size());
+                for (size_t i = 0; i < profile.size(); i += 2) {
+                    REQUIRE(smoothed[i] == profile[i]);
+                    REQUIRE(smoothed[i + 1] <= profile[i + 1]);
+                    REQUIRE(smoothed[i + 1] >= slicing_params.min_layer_height);
+                }
+            }
+        }
+    }
+}
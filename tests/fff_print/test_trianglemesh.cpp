@@ -177,6 +177,35 @@ SCENARIO( "TriangleMesh: slice behavior.") {
     }
 }
 
+TEST_CASE("Sweep slicing engines match the per facet engine", "[TriangleMeshSlicer]") {
+    for (Slic3r::Test::TestMesh test_mesh : { Slic3r::Test::TestMesh::ipadstand, Slic3r::Test::TestMesh::cube_with_concave_hole,
+                                               Slic3r::Test::TestMesh::sloping_hole, Slic3r::Test::TestMesh::overhang, Slic3r::Test::TestMesh::A }) {
+        TriangleMesh      mesh = Slic3r::Test::mesh(test_mesh);
+        BoundingBoxf3     bbox = mesh.bounding_box();
+        std::vector<float> zs;
+        // Slicing planes aligned with the vertices are included.
+        for (double z = bbox.min.z(); z <= bbox.max.z(); z += 0.05)
+            zs.emplace_back(float(z));
+        MeshSlicingParamsEx params;
+        params.trafo = Geometry::assemble_transform(Vec3d::Zero(), Vec3d(0.1, 0.2, 0.3));
+        std::vector<ExPolygons> per_facet = slice_mesh_ex(mesh.its, zs, params);
+        for (MeshSlicingParams::SlicingEngine engine : { MeshSlicingParams::SlicingEngine::Sweep, MeshSlicingParams::SlicingEngine::SweepEdges }) {
+            params.engine = engine;
+            std::vector<ExPolygons> sweep = slice_mesh_ex(mesh.its, zs, params);
+            REQUIRE(per_facet.size() == sweep.size());
+            for (size_t i = 0; i < zs.size(); ++ i) {
+                REQUIRE(per_facet[i].size() == sweep[i].size());
+                double area = 0., area_sweep = 0.;
+                for (const ExPolygon &expoly : per_facet[i])
+                    area += expoly.area();
+                for (const ExPolygon &expoly : sweep[i])
+                    area_sweep += expoly.area();
+                REQUIRE(area_sweep == Approx(area));
+            }
+        }
+    }
+}
+
 SCENARIO( "make_xxx functions produce meshes.") {
     GIVEN("make_cube() function") {
         WHEN("make_cube() is called with arguments 20,20,20") {
@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/libslic3r.h"
+#include "libslic3r/Model.hpp"
+#include "libslic3r/ModelArrange.hpp"
+#include "libslic3r/Print.hpp"
+#include "libslic3r/Format/3mf.hpp"
+#include "libslic3r/Format/ZaxeArchive.hpp"
+
+#include <boost/filesystem.hpp>
+#include <miniz.h>
+
+#include "test_data.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::Test;
+
+static bool archive_has_entry(const std::string &path, const char *name)
+{
+    mz_zip_archive archive;
+    mz_zip_zero_struct(&archive);
+    if (! mz_zip_reader_init_file(&archive, path.c_str(), 0))
+        return false;
+    bool found = mz_zip_reader_locate_file(&archive, name, nullptr, 0) >= 0;
+    mz_zip_reader_end(&archive);
+    return found;
+}
+
+SCENARIO("Model embedded into a Zaxe archive", "[ZaxeArchive]") {
+    GIVEN("a sliced print for a Z3 of a cube with two instances") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize_strict({ { "printer_model", "Z3" } });
+        Model model;
+        ModelObject *object = model.add_object();
+        object->name = "cube";
+        object->add_volume(mesh(TestMesh::cube_20x20x20));
+        object->add_instance();
+        object->add_instance();
+        arrange_objects(model, InfiniteBed{}, ArrangeParams{ scaled(min_object_distance(config)) });
+        object->ensure_on_bed();
+        Print print;
+        print.auto_assign_extruders(object);
+        print.apply(model, config);
+        print.process();
+
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        boost::filesystem::create_directories(dir);
+        const std::string gcode_path = print.export_gcode((dir / "cube.gcode").string(), nullptr, nullptr);
+        const std::string zaxe_path  = (dir / "cube.zaxe").string();
+        ZaxeArchive archive;
+
+        WHEN("exported with the default model format") {
+            archive.export_print(zaxe_path, {}, print, gcode_path);
+            THEN("the archive embeds a binary STL") {
+                REQUIRE(archive_has_entry(zaxe_path, "model.stl"));
+                REQUIRE(! archive_has_entry(zaxe_path, "3D/3dmodel.model"));
+            }
+        }
+        WHEN("exported with the indexed model format") {
+            archive.set_model_format(ZaxeArchive::ModelFormat::Indexed);
+            archive.export_print(zaxe_path, {}, print, gcode_path);
+            REQUIRE(! archive_has_entry(zaxe_path, "model.stl"));
+            THEN("the 3MF model reads back with the mesh stored once and an instance per copy") {
+                Model                     loaded;
+                DynamicPrintConfig        loaded_config;
+                ConfigSubstitutionContext ctxt { ForwardCompatibilitySubstitutionRule::Disable };
+                REQUIRE(load_3mf(zaxe_path.c_str(), loaded_config, ctxt, &loaded, false));
+                REQUIRE(loaded.objects.size() == 1);
+                REQUIRE(loaded.objects.front()->volumes.size() == 1);
+                REQUIRE(loaded.objects.front()->instances.size() == 2);
+                const TriangleMesh &loaded_mesh = loaded.objects.front()->volumes.front()->mesh();
+                REQUIRE(loaded_mesh.its.indices.size() == object->volumes.front()->mesh().its.indices.size());
+                REQUIRE(loaded_mesh.its.vertices.size() == object->volumes.front()->mesh().its.vertices.size());
+                // The instances keep their distance on the bed.
+                const Vec3d offset        = object->instances[1]->get_offset() - object->instances[0]->get_offset();
+                const Vec3d loaded_offset = loaded.objects.front()->instances[1]->get_transformation().get_matrix().translation() -
+                                            loaded.objects.front()->instances[0]->get_transformation().get_matrix().translation();
+                REQUIRE(is_approx(loaded_offset, offset, 1e-3));
+                REQUIRE(loaded.objects.front()->instance_bounding_box(0).size().isApprox(Vec3d(20., 20., 20.), 1e-4));
+            }
+        }
+        boost::filesystem::remove_all(dir);
+    }
+}
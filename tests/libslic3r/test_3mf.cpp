@@ -4,7 +4,18 @@
 #include "libslic3r/Format/3mf.hpp"
 #include "libslic3r/Format/STL.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <sstream>
+
+#include <boost/core/null_deleter.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+
+#include <miniz.h>
 
 using namespace Slic3r;
 
@@ -131,3 +142,138 @@ SCENARIO("2D convex hull of sinking object", "[3mf]") {
     }
 }
 
+
+// Copies the 3mf archive, passing the .model file through edit().
+static void edit_3mf_model(const std::string &src, const std::string &dst, std::function<void(std::string&)> edit)
+{
+    mz_zip_archive in, out;
+    mz_zip_zero_struct(&in);
+    mz_zip_zero_struct(&out);
+    REQUIRE(mz_zip_reader_init_file(&in, src.c_str(), 0));
+    REQUIRE(mz_zip_writer_init_file(&out, dst.c_str(), 0));
+    for (mz_uint i = 0; i < mz_zip_reader_get_num_files(&in); ++ i) {
+        mz_zip_archive_file_stat stat;
+        REQUIRE(mz_zip_reader_file_stat(&in, i, &stat));
+        size_t size = 0;
+        void  *data = mz_zip_reader_extract_to_heap(&in, i, &size, 0);
+        REQUIRE(data != nullptr);
+        std::string content((const char*)data, size);
+        mz_free(data);
+        if (std::string(stat.m_filename) == "3D/3dmodel.model")
+            edit(content);
+        REQUIRE(mz_zip_writer_add_mem(&out, stat.m_filename, content.data(), content.size(), MZ_DEFAULT_COMPRESSION));
+    }
+    mz_zip_reader_end(&in);
+    REQUIRE(mz_zip_writer_finalize_archive(&out));
+    mz_zip_writer_end(&out);
+}
+
+// Loads the 3mf file, returning the errors logged meanwhile.
+static std::string load_3mf_logged(const std::string &path, Model &model, bool &result)
+{
+    using sink_t = boost::log::sinks::synchronous_sink<boost::log::sinks::text_ostream_backend>;
+    auto stream = boost::make_shared<std::ostringstream>();
+    auto sink   = boost::make_shared<sink_t>();
+    sink->locked_backend()->add_stream(stream);
+    boost::log::core::get()->add_sink(sink);
+    DynamicPrintConfig config;
+    ConfigSubstitutionContext ctxt{ ForwardCompatibilitySubstitutionRule::Disable };
+    result = load_3mf(path.c_str(), config, ctxt, &model, false);
+    boost::log::core::get()->remove_sink(sink);
+    sink->flush();
+    return stream->str();
+}
+
+SCENARIO("Meshes parsed ahead of expat", "[3mf]") {
+    GIVEN("a painted mesh large enough to be parsed in several blocks, saved to 3mf") {
+        Model src_model;
+        ModelObject *src_object = src_model.add_object();
+        ModelVolume *src_volume = src_object->add_volume(make_sphere(10., PI / 180.));
+        src_object->add_instance();
+        const int num_triangles = int(src_volume->mesh().its.indices.size());
+        REQUIRE(num_triangles > 100000);
+        for (int i = 0; i < num_triangles; i += 997) {
+            src_volume->mmu_segmentation_facets.set_triangle_from_string(i, "8");
+            src_volume->supported_facets.set_triangle_from_string(i, "4");
+        }
+        for (int i = 0; i < num_triangles; i += 1999)
+            src_volume->seam_facets.set_triangle_from_string(i, "1C");
+
+        const std::string src_file = std::string(TEST_DATA_DIR) + "/test_3mf/painted.3mf";
+        const std::string dst_file = std::string(TEST_DATA_DIR) + "/test_3mf/painted_edited.3mf";
+        REQUIRE(store_3mf(src_file.c_str(), &src_model, nullptr, false));
+
+        auto same_volume = [](const ModelVolume &v1, const ModelVolume &v2) {
+            const indexed_triangle_set &its1 = v1.mesh().its;
+            const indexed_triangle_set &its2 = v2.mesh().its;
+            if (its1.vertices != its2.vertices || its1.indices != its2.indices)
+                return false;
+            for (int i = 0; i < int(its1.indices.size()); ++ i)
+                if (v1.mmu_segmentation_facets.get_triangle_as_string(i) != v2.mmu_segmentation_facets.get_triangle_as_string(i) ||
+                    v1.supported_facets.get_triangle_as_string(i) != v2.supported_facets.get_triangle_as_string(i) ||
+                    v1.seam_facets.get_triangle_as_string(i) != v2.seam_facets.get_triangle_as_string(i))
+                    return false;
+            return true;
+        };
+
+        Model fast_model;
+        bool  fast_result = false;
+        load_3mf_logged(src_file, fast_model, fast_result);
+        REQUIRE(fast_result);
+        REQUIRE(fast_model.objects.size() == 1);
+        REQUIRE(fast_model.objects.front()->volumes.size() == 1);
+        const ModelVolume &fast_volume = *fast_model.objects.front()->volumes.front();
+
+        WHEN("the mesh is loaded by the parser ahead of expat") {
+            THEN("the painted facets are read back at their triangles") {
+                REQUIRE(fast_volume.mesh().its.indices.size() == size_t(num_triangles));
+                bool painting_matches = true;
+                for (int i = 0; i < num_triangles; ++ i)
+                    painting_matches &=
+                        fast_volume.mmu_segmentation_facets.get_triangle_as_string(i) == (i % 997 ? "" : "8") &&
+                        fast_volume.supported_facets.get_triangle_as_string(i) == (i % 997 ? "" : "4") &&
+                        fast_volume.seam_facets.get_triangle_as_string(i) == (i % 1999 ? "" : "1C");
+                REQUIRE(painting_matches);
+            }
+        }
+        WHEN("a comment in the mesh leaves it to expat") {
+            edit_3mf_model(src_file, dst_file, [](std::string &model) {
+                size_t pos = model.find("<vertices>");
+                REQUIRE(pos != std::string::npos);
+                model.insert(pos + 10, "<!-- not a vertex -->");
+            });
+            Model model;
+            bool  result = false;
+            load_3mf_logged(dst_file, model, result);
+            THEN("the geometry and painting are the same as parsed ahead of expat") {
+                REQUIRE(result);
+                REQUIRE(model.objects.size() == 1);
+                REQUIRE(model.objects.front()->volumes.size() == 1);
+                REQUIRE(same_volume(*model.objects.front()->volumes.front(), fast_volume));
+            }
+        }
+        WHEN("the model is malformed after the mesh") {
+            size_t line = 0;
+            edit_3mf_model(src_file, dst_file, [&line](std::string &model) {
+                size_t pos = model.find("</mesh>");
+                REQUIRE(pos != std::string::npos);
+                pos = model.find('\n', pos) + 1;
+                model.insert(pos, "<broken attr=>\n");
+                line = std::count(model.begin(), model.begin() + pos, '\n') + 1;
+            });
+            Model model;
+            bool  result = true;
+            std::string log = load_3mf_logged(dst_file, model, result);
+            THEN("the error names the line in the file, not in the text left to expat") {
+                REQUIRE(! result);
+                REQUIRE(line > 100000);
+                size_t pos = log.find("at line " + std::to_string(line));
+                REQUIRE(pos != std::string::npos);
+                pos += 8 + std::to_string(line).size();
+                REQUIRE((pos == log.size() || ! isdigit(log[pos])));
+            }
+        }
+        boost::filesystem::remove(src_file);
+        boost::filesystem::remove(dst_file);
+    }
+}
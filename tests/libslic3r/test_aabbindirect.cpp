@@ -1,6 +1,8 @@
 #include <catch2/catch.hpp>
 #include <test_utils.hpp>
 
+#include <random>
+
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/AABBTreeIndirect.hpp>
 
@@ -58,3 +60,60 @@ TEST_CASE("Building a tree over a box, ray caster and closest query", "[AABBIndi
     REQUIRE(closest_point.y() == Approx(0.5));
     REQUIRE(closest_point.z() == Approx(1.));
 }
+
+TEST_CASE("Wide tree queries match the binary tree", "[AABBIndirect]")
+{
+    indexed_triangle_set its = its_make_sphere(1., PI / 50.);
+    its_merge(its, its_make_cube(0.5, 0.5, 0.5));
+
+    auto tree      = AABBTreeIndirect::build_aabb_tree_over_indexed_triangle_set(its.vertices, its.indices);
+    auto wide_tree = AABBTreeIndirect::build_wide_aabb_tree_over_indexed_triangle_set(its.vertices, its.indices);
+    REQUIRE(! wide_tree.empty());
+    REQUIRE(wide_tree.nodes().size() < tree.nodes().size() / 2);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coord(-2., 2.);
+    std::vector<Vec3d> origins, dirs;
+    for (size_t i = 0; i < 1000; ++ i) {
+        Vec3d origin(coord(rng), coord(rng), coord(rng));
+        // Pairs of rays share their origin.
+        if (i % 2 == 1)
+            origin = origins.back();
+        origins.emplace_back(origin);
+        dirs.emplace_back(Vec3d(coord(rng), coord(rng), coord(rng)).normalized());
+    }
+
+    std::vector<igl::Hit> batch_hits;
+    size_t num_batch_hits = AABBTreeIndirect::intersect_rays_first_hit(its.vertices, its.indices, wide_tree, origins, dirs, batch_hits);
+    REQUIRE(batch_hits.size() == origins.size());
+
+    size_t num_hits = 0;
+    for (size_t i = 0; i < origins.size(); ++ i) {
+        igl::Hit hit, wide_hit;
+        bool intersected      = AABBTreeIndirect::intersect_ray_first_hit(its.vertices, its.indices, tree, origins[i], dirs[i], hit);
+        bool wide_intersected = AABBTreeIndirect::intersect_ray_first_hit(its.vertices, its.indices, wide_tree, origins[i], dirs[i], wide_hit);
+        REQUIRE(intersected == wide_intersected);
+        REQUIRE((batch_hits[i].id >= 0) == intersected);
+        if (intersected) {
+            ++ num_hits;
+            CHECK(wide_hit.t == Approx(hit.t));
+            CHECK(batch_hits[i].t == Approx(hit.t));
+        }
+
+        std::vector<igl::Hit> hits, wide_hits;
+        AABBTreeIndirect::intersect_ray_all_hits(its.vertices, its.indices, tree, origins[i], dirs[i], hits);
+        AABBTreeIndirect::intersect_ray_all_hits(its.vertices, its.indices, wide_tree, origins[i], dirs[i], wide_hits);
+        REQUIRE(hits.size() == wide_hits.size());
+
+        size_t hit_idx, wide_hit_idx;
+        Vec3d  closest_point, wide_closest_point;
+        double squared_distance      = AABBTreeIndirect::squared_distance_to_indexed_triangle_set(
+            its.vertices, its.indices, tree, origins[i], hit_idx, closest_point);
+        double wide_squared_distance = AABBTreeIndirect::squared_distance_to_indexed_triangle_set(
+            its.vertices, its.indices, wide_tree, origins[i], wide_hit_idx, wide_closest_point);
+        CHECK(wide_squared_distance == Approx(squared_distance));
+        CHECK((wide_closest_point - closest_point).norm() < EPSILON);
+    }
+    CHECK(num_batch_hits == num_hits);
+    CHECK(num_hits > 0);
+}
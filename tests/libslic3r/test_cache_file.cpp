@@ -0,0 +1,51 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/CacheFile.hpp"
+
+#include <boost/filesystem.hpp>
+
+using namespace Slic3r;
+
+TEST_CASE("Cache file digests", "[CacheFile]") {
+    // Test vector of FIPS 180-2.
+    REQUIRE(cache_digest(std::string("abc")).hex() == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    REQUIRE(cache_digest(std::string("abc")) != cache_digest(std::string("abd")));
+    // Data fed in pieces hashes as a whole.
+    CacheHasher hasher;
+    hasher.update("a", 1);
+    hasher.update("bc", 2);
+    REQUIRE(hasher.digest() == cache_digest(std::string("abc")));
+}
+
+TEST_CASE("Cache files are written, hashed and evicted", "[CacheFile]") {
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    auto write = [&dir](const std::string &name, size_t size) {
+        return write_cache_file((dir / name).string(), [size](std::ostream &out) { out << std::string(size, 'a'); });
+    };
+    for (int i = 0; i < 4; ++ i) {
+        REQUIRE(write(std::to_string(i) + ".bin", 100));
+        // Older files are used less recently.
+        boost::filesystem::last_write_time(dir / (std::to_string(i) + ".bin"), 1000000 + i);
+    }
+    REQUIRE(write("other.txt", 1000));
+
+    SECTION("The digest of a file is the digest of its content") {
+        CacheDigest digest;
+        uint64_t    size = 0;
+        REQUIRE(cache_digest_file((dir / "2.bin").string().c_str(), digest, size));
+        REQUIRE(size == 100);
+        REQUIRE(digest == cache_digest(std::string(100, 'a')));
+        REQUIRE(! cache_digest_file((dir / "missing.bin").string().c_str(), digest, size));
+    }
+    SECTION("The least recently used files of the extension are evicted") {
+        touch_cache_file((dir / "0.bin").string());
+        evict_cache_files(dir.string(), ".bin", 250);
+        REQUIRE(boost::filesystem::exists(dir / "0.bin"));
+        REQUIRE(! boost::filesystem::exists(dir / "1.bin"));
+        REQUIRE(! boost::filesystem::exists(dir / "2.bin"));
+        REQUIRE(boost::filesystem::exists(dir / "3.bin"));
+        REQUIRE(boost::filesystem::exists(dir / "other.txt"));
+    }
+
+    boost::filesystem::remove_all(dir);
+}
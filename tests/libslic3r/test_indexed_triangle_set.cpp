@@ -102,6 +102,55 @@ TEST_CASE("Split two watertight meshes", "[its_split][its]") {
     debug_write_obj(res, "parts_watertight");
 }
 
+TEST_CASE("Parallel split matches the sequential one", "[its_split][its]") {
+    using namespace Slic3r;
+
+    // Two spheres touching at a single vertex and an open cube.
+    auto sphere1 = its_make_sphere(10., 2 * PI / 50.), sphere2 = sphere1;
+    auto cube = its_make_cube(10., 10., 10.);
+    cube.indices.pop_back();
+    its_transform(sphere2, identity3f().translate(Vec3f{0.f, 0.f, 20.f}));
+    its_transform(cube, identity3f().translate(Vec3f{30.f, 0.f, 0.f}));
+    its_merge(sphere1, sphere2);
+    its_merge(sphere1, cube);
+    its_merge_vertices(sphere1);
+
+    std::vector<indexed_triangle_set> res     = its_split(sphere1);
+    std::vector<indexed_triangle_set> res_par = its_split_par(sphere1);
+
+    REQUIRE(its_number_of_patches_par(sphere1) == its_number_of_patches(sphere1));
+    REQUIRE(res_par.size() == res.size());
+    for (size_t i = 0; i < res.size(); ++ i) {
+        REQUIRE(res_par[i].indices.size() == res[i].indices.size());
+        REQUIRE(res_par[i].vertices.size() == res[i].vertices.size());
+        REQUIRE(its_volume(res_par[i]) == Approx(its_volume(res[i])));
+    }
+}
+
+TEST_CASE("Parallel repair matches the sequential one", "[its]") {
+    using namespace Slic3r;
+
+    // A sphere with each face having its own vertices, a degenerate face and an unreferenced vertex.
+    auto sphere = its_make_sphere(10., 2 * PI / 50.);
+    indexed_triangle_set its;
+    for (const stl_triangle_vertex_indices &face : sphere.indices) {
+        int idx = int(its.vertices.size());
+        for (int i = 0; i < 3; ++ i)
+            its.vertices.emplace_back(sphere.vertices[face(i)]);
+        its.indices.emplace_back(idx, idx + 1, idx + 2);
+    }
+    its.indices.emplace_back(0, 0, 1);
+    its.vertices.emplace_back(Vec3f(100.f, 100.f, 100.f));
+
+    indexed_triangle_set its_par = its;
+    REQUIRE(its_merge_vertices_par(its_par) == its_merge_vertices(its));
+    REQUIRE(its_remove_degenerate_faces_par(its_par) == its_remove_degenerate_faces(its));
+    REQUIRE(its_compactify_vertices_par(its_par) == its_compactify_vertices(its));
+    REQUIRE(its_par.vertices == its.vertices);
+    REQUIRE(its_par.indices == its.indices);
+    REQUIRE(its.vertices.size() == sphere.vertices.size());
+}
+
 #include <libslic3r/QuadricEdgeCollapse.hpp>
 static float triangle_area(const Vec3f &v0, const Vec3f &v1, const Vec3f &v2)
 {
@@ -282,6 +331,30 @@ TEST_CASE("Simplify mesh by Quadric edge collapse to 5%", "[its]")
     CHECK(is_similar(its, mesh.its, cfg));
 }
 
+TEST_CASE("Simplify mesh by parallel Quadric edge collapse", "[its]")
+{
+    // big enough to be split into regions
+    indexed_triangle_set its_ = its_make_sphere(10., PI / 200.);
+    REQUIRE(its_.indices.size() > 100000);
+    indexed_triangle_set its = its_; // copy
+    uint32_t wanted_count = its.indices.size() * 0.05;
+    float max_error = std::numeric_limits<float>::max();
+    std::vector<int> statuses;
+    its_quadric_edge_collapse_par(its, wanted_count, &max_error, nullptr,
+                                  [&statuses](int status) { statuses.push_back(status); });
+    CHECK(its.indices.size() <= wanted_count);
+    CHECK(its.indices.size() + 2 >= wanted_count);
+    CHECK(std::is_sorted(statuses.begin(), statuses.end()));
+    CHECK(std::adjacent_find(statuses.begin(), statuses.end()) == statuses.end());
+    CHECK(fabs(its_volume(its_) - its_volume(its)) < 0.01 * its_volume(its_));
+
+    CompareConfig cfg;
+    cfg.max_average_distance = 0.01f;
+    cfg.max_distance         = 0.05f;
+    CHECK(is_similar(its_, its, cfg));
+    CHECK(is_similar(its, its_, cfg));
+}
+
 bool exist_triangle_with_twice_vertices(const std::vector<stl_triangle_vertex_indices>& indices)
 {
     for (const auto &face : indices)
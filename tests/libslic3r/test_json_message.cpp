@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/JsonMessage.hpp"
+
+using namespace Slic3r;
+
+TEST_CASE("JsonReader parses a printer status message", "[JsonMessage]") {
+    JsonReader json(R"({"event": "hello", "device_model": "Z3", "nozzle": "0.6", "elapsed_time": 12.5,
+                        "is_printing": "True", "has_pin": false, "filename": "a \"b\"\\c ç",
+                        "nested": {"a": [1, 2, {"b": "}"}]}, "empty": null})");
+
+    REQUIRE(! json.empty());
+    REQUIRE(json.get_string("event") == "hello");
+    REQUIRE(json.get_string("device_model") == "Z3");
+    REQUIRE(json.get_float("nozzle") == Approx(0.6f));
+    REQUIRE(json.get_double("elapsed_time") == Approx(12.5));
+    REQUIRE(json.get_string("elapsed_time") == "12.5");
+    REQUIRE(json.get_bool("is_printing"));
+    REQUIRE(! json.get_bool("has_pin", true));
+    REQUIRE(json.get_string("filename") == "a \"b\"\\c \xc3\xa7");
+    REQUIRE(json.get_string("nested") == R"({"a": [1, 2, {"b": "}"}]})");
+    REQUIRE(json.get_string("empty", "default") == "default");
+    REQUIRE(json.get_int("missing", 7) == 7);
+    REQUIRE(! json.has("missing"));
+
+    SECTION("Copies of the reader stay valid") {
+        JsonReader copy = json;
+        json = JsonReader();
+        REQUIRE(copy.get_string("event") == "hello");
+    }
+}
+
+TEST_CASE("JsonReader rejects malformed messages", "[JsonMessage]") {
+    REQUIRE(JsonReader("").empty());
+    REQUIRE(JsonReader("[1, 2]").empty());
+    REQUIRE(JsonReader(R"({"event": "hello")").empty());
+    REQUIRE(JsonReader(R"({"event" "hello"})").empty());
+    REQUIRE(! JsonReader().parse(R"({"a": "unterminated})"));
+    REQUIRE(JsonReader().parse("{}"));
+}
+
+TEST_CASE("JsonReader rejects ints out of range", "[JsonMessage]") {
+    JsonReader json(R"({"port": 9294, "big": 1e12, "small": -3000000000, "nan": "nan", "inf": "-inf"})");
+
+    REQUIRE(json.get_int("port") == 9294);
+    REQUIRE(json.get_int("big", -1) == -1);
+    REQUIRE(json.get_int("small", -1) == -1);
+    REQUIRE(json.get_int("nan", -1) == -1);
+    REQUIRE(json.get_int("inf", -1) == -1);
+}
+
+TEST_CASE("JsonWriter round trip", "[JsonMessage]") {
+    JsonWriter writer;
+    writer.add("request", "say_hi")
+          .add("quoted", "line\n\"quote\"")
+          .add("int", 42)
+          .add("flag", true)
+          .add_number_or_string("layer_height", "0.2")
+          .add_number_or_string("version", "3.0.0")
+          .add_number_or_string("negative", "-15");
+    std::string out = std::move(writer).str();
+
+    REQUIRE(out.find(R"("layer_height":0.2)") != std::string::npos);
+    REQUIRE(out.find(R"("version":"3.0.0")") != std::string::npos);
+    REQUIRE(out.find(R"("negative":-15)") != std::string::npos);
+
+    JsonReader json(out);
+    REQUIRE(json.get_string("request") == "say_hi");
+    REQUIRE(json.get_string("quoted") == "line\n\"quote\"");
+    REQUIRE(json.get_int("int") == 42);
+    REQUIRE(json.get_bool("flag"));
+    REQUIRE(json.get_double("layer_height") == Approx(0.2));
+    REQUIRE(json.get_string("version") == "3.0.0");
+}
+
+TEST_CASE("JsonWriter recognizes plain numbers", "[JsonMessage]") {
+    REQUIRE(JsonWriter::is_plain_number("0"));
+    REQUIRE(JsonWriter::is_plain_number("-12.50"));
+    REQUIRE(! JsonWriter::is_plain_number(""));
+    REQUIRE(! JsonWriter::is_plain_number("12."));
+    REQUIRE(! JsonWriter::is_plain_number(".5"));
+    REQUIRE(! JsonWriter::is_plain_number("1e5"));
+    REQUIRE(! JsonWriter::is_plain_number("01:02:03"));
+}
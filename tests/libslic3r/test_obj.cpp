@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/Format/OBJ.hpp"
+#include "libslic3r/Format/objparser.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+// Serial reference: ObjParser, converted the way load_obj() did before it parsed in parallel.
+static bool obj_read_mesh_serial(const char *path, indexed_triangle_set &its)
+{
+    ObjParser::ObjData data;
+    if (! ObjParser::objparse(path, data))
+        return false;
+    for (size_t i = 0; i < data.coordinates.size(); i += 4)
+        its.vertices.emplace_back(data.coordinates[i], data.coordinates[i + 1], data.coordinates[i + 2]);
+    int indices[4];
+    int cnt = 0;
+    for (const ObjParser::ObjVertex &vertex : data.vertices)
+        if (vertex.coordIdx == -1) {
+            if (cnt != 3 && cnt != 4)
+                return false;
+            its.indices.emplace_back(indices[0], indices[1], indices[2]);
+            if (cnt == 4)
+                its.indices.emplace_back(indices[0], indices[2], indices[3]);
+            cnt = 0;
+        } else if (cnt == 4)
+            return false;
+        else
+            indices[cnt ++] = vertex.coordIdx;
+    return true;
+}
+
+TEST_CASE("Parallel OBJ parser matches the serial one at any block size", "[OBJ]") {
+    // Each group adds 4 vertices, references them absolutely, relatively and as a quad, and references
+    // the very first vertices of the file, which lie in another block for the small block sizes.
+    // Odd groups use CRLF line ends, face lines are long enough to be cut by the block boundaries.
+    std::string obj = "# generated\nmtllib none.mtl\n";
+    for (int group = 0; group < 200; ++ group) {
+        const char *eol  = group % 2 ? "\r\n" : "\n";
+        const int   base = 4 * group + 1;
+        const float z    = float(group) * 0.5f;
+        for (int i = 0; i < 4; ++ i)
+            obj += "v " + std::to_string(i == 1 || i == 2 ? 10 : 0) + " " + std::to_string(i >= 2 ? 10 : 0) + " " + std::to_string(z) + " 0.5 0.5 0.5" + eol;
+        obj += std::string("vt 0 0") + eol + "vn 0 0 1" + eol + "  " + eol;
+        obj += "f " + std::to_string(base) + " " + std::to_string(base + 1) + " " + std::to_string(base + 2) + eol;
+        obj += "f " + std::to_string(base) + "/1 " + std::to_string(base + 2) + "/1 " + std::to_string(base + 3) + "/1" + eol;
+        obj += std::string("f -4//1 -3//1 -2//1 -1//1") + eol;
+        obj += "f\t-1/1/1\t1/1/1   2/1/1 " + std::string(eol) + "# comment f 1 2 3" + eol;
+    }
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.obj");
+    {
+        boost::nowide::ofstream out(path.string(), std::ios::binary);
+        out << obj;
+    }
+
+    indexed_triangle_set serial;
+    REQUIRE(obj_read_mesh_serial(path.string().c_str(), serial));
+    REQUIRE(serial.vertices.size() == 800);
+    REQUIRE(serial.indices.size() == 1000);
+
+    for (size_t block_size : { size_t(0), size_t(7), size_t(64), size_t(333), size_t(4096) }) {
+        indexed_triangle_set its;
+        REQUIRE(load_obj(path.string().c_str(), its, block_size));
+        CHECK(its.vertices == serial.vertices);
+        CHECK(its.indices == serial.indices);
+    }
+
+    SECTION("Invalid indices are rejected in any block") {
+        {
+            boost::nowide::ofstream out(path.string(), std::ios::binary | std::ios::app);
+            out << "f 1 2 801\n";
+        }
+        indexed_triangle_set its;
+        CHECK(! load_obj(path.string().c_str(), its, 64));
+    }
+
+    boost::filesystem::remove(path);
+}
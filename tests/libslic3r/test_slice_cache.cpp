@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/Model.hpp"
+#include "libslic3r/PrintConfig.hpp"
+#include "libslic3r/SliceCache.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+static Model cube_model()
+{
+    Model model;
+    ModelObject *object = model.add_object();
+    object->name = "cube";
+    object->add_volume(TriangleMesh(its_make_cube(10., 10., 10.)));
+    object->add_instance();
+    return model;
+}
+
+SCENARIO("Slice cache keys", "[SliceCache]") {
+    GIVEN("a model and a config") {
+        Model              model  = cube_model();
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        const CacheDigest  key    = slice_cache_key(model, config);
+        THEN("the key is reproducible") {
+            REQUIRE(slice_cache_key(cube_model(), DynamicPrintConfig::full_print_config()) == key);
+        }
+        THEN("the key changes with the model") {
+            model.objects.front()->instances.front()->set_offset(Vec3d(1., 0., 0.));
+            REQUIRE(slice_cache_key(model, config) != key);
+        }
+        THEN("the key changes with the config, including the G-code only options") {
+            config.set_key_value("temperature", new ConfigOptionInts { 123 });
+            REQUIRE(slice_cache_key(model, config) != key);
+        }
+        THEN("the key changes with the painted facets") {
+            model.objects.front()->volumes.front()->supported_facets.set_triangle_from_string(0, "4");
+            REQUIRE(slice_cache_key(model, config) != key);
+        }
+        THEN("the key changes with the extra data") {
+            REQUIRE(slice_cache_key(model, config, "cube") != key);
+        }
+    }
+}
+
+SCENARIO("Slice cache files", "[SliceCache]") {
+    GIVEN("a slice cache directory") {
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        const CacheDigest key       = slice_cache_key(cube_model(), DynamicPrintConfig::full_print_config());
+        const CacheDigest other_key = slice_cache_key(cube_model(), DynamicPrintConfig::full_print_config(), "other");
+        const SlicedFiles stored    { { ".gcode", "G1 X10 Y10\n" }, { ".zaxe", std::string("PK\0\x03", 4) } };
+        SlicedFiles       loaded;
+        WHEN("nothing was stored") {
+            THEN("the cache misses") {
+                REQUIRE(! load_slice_cache(dir.string(), key, loaded));
+                REQUIRE(loaded.empty());
+            }
+        }
+        WHEN("the files were stored") {
+            store_slice_cache(dir.string(), key, stored);
+            THEN("the files are loaded back for the same key") {
+                REQUIRE(load_slice_cache(dir.string(), key, loaded));
+                REQUIRE(loaded == stored);
+            }
+            THEN("the cache misses for another key") {
+                REQUIRE(! load_slice_cache(dir.string(), other_key, loaded));
+            }
+        }
+        WHEN("the cache file was written by another version") {
+            store_slice_cache(dir.string(), key, stored);
+            const boost::filesystem::path path = dir / (key.hex() + ".slice");
+            REQUIRE(boost::filesystem::exists(path));
+            {
+                // The version follows the magic.
+                const uint32_t version = SLICE_CACHE_VERSION + 1;
+                boost::nowide::fstream file(path.string(), std::ios::binary | std::ios::in | std::ios::out);
+                file.seekp(8);
+                file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+            }
+            THEN("it is rejected") {
+                REQUIRE(! load_slice_cache(dir.string(), key, loaded));
+                REQUIRE(loaded.empty());
+            }
+        }
+        WHEN("the cache file stores another key than its name") {
+            store_slice_cache(dir.string(), key, stored);
+            boost::filesystem::rename(dir / (key.hex() + ".slice"), dir / (other_key.hex() + ".slice"));
+            THEN("it is rejected") {
+                REQUIRE(! load_slice_cache(dir.string(), other_key, loaded));
+            }
+        }
+        WHEN("the cache grows over its size limit") {
+            store_slice_cache(dir.string(), key, stored);
+            const boost::filesystem::path path = dir / (key.hex() + ".slice");
+            const uint64_t file_size = boost::filesystem::file_size(path);
+            // Make the first file the least recently used one, the file times have a resolution of a second.
+            boost::filesystem::last_write_time(path, boost::filesystem::last_write_time(path) - 10);
+            store_slice_cache(dir.string(), other_key, stored, file_size + file_size / 2);
+            THEN("the least recently used files are evicted") {
+                REQUIRE(! load_slice_cache(dir.string(), key, loaded));
+                REQUIRE(load_slice_cache(dir.string(), other_key, loaded));
+            }
+        }
+        boost::filesystem::remove_all(dir);
+    }
+}
@@ -0,0 +1,122 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/AppConfig.hpp"
+#include "libslic3r/Format/STEP.hpp"
+#include "libslic3r/Utils.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+using namespace Slic3r;
+
+static OCCTResult tessellated_triangle(const std::string &name)
+{
+    OCCTResult result;
+    result.volumes.emplace_back();
+    result.volumes.front().volume_name = name;
+    result.volumes.front().vertices    = { { 0.f, 0.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } };
+    result.volumes.front().indices     = { { 0, 1, 2 } };
+    return result;
+}
+
+SCENARIO("STEP tessellation cache", "[STEP]") {
+    GIVEN("a data directory and a source file") {
+        const std::string       old_data_dir = data_dir();
+        boost::filesystem::path dir          = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        boost::filesystem::create_directories(dir);
+        set_data_dir(dir.string());
+        auto write_source = [&dir](const std::string &name, const std::string &content) {
+            std::string path = (dir / name).string();
+            boost::nowide::ofstream(path, std::ios::binary) << content;
+            return path;
+        };
+        std::string    source = write_source("part.step", "ISO-10303-21;");
+        LoadStepParams params;
+        OCCTResult     loaded;
+        StepCacheKey   key;
+
+        WHEN("the tessellation is not cached yet") {
+            REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            THEN("the key names a file of the cache folder of the data directory") {
+                REQUIRE(boost::filesystem::path(key.path).parent_path() == dir / "cache" / "step");
+                REQUIRE(key.source_size == 13);
+                REQUIRE(! boost::filesystem::exists(key.path));
+            }
+        }
+        WHEN("the tessellation is stored") {
+            REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            store_step_cache(key, tessellated_triangle("part"), params.max_cache_size);
+            THEN("it is loaded back for the same content and tolerances") {
+                REQUIRE(load_step_cache(write_source("copy.step", "ISO-10303-21;").c_str(), params, loaded, key));
+                REQUIRE(loaded.volumes.size() == 1);
+                REQUIRE(loaded.volumes.front().volume_name == "part");
+                REQUIRE(loaded.volumes.front().vertices == tessellated_triangle("part").volumes.front().vertices);
+                REQUIRE(loaded.volumes.front().indices == tessellated_triangle("part").volumes.front().indices);
+            }
+            THEN("it is not loaded for other tolerances") {
+                params.linear_deflection *= 2.;
+                REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            }
+            THEN("it is not loaded for another content") {
+                write_source("part.step", "ISO-10303-22;");
+                REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            }
+            THEN("it is not loaded if written by another version") {
+                const uint32_t version = STEP_CACHE_VERSION + 1;
+                {
+                    // The version follows the magic.
+                    boost::nowide::fstream file(key.path, std::ios::binary | std::ios::in | std::ios::out);
+                    file.seekp(8);
+                    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+                }
+                REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            }
+        }
+        WHEN("the cache grows over its size limit") {
+            std::string other = write_source("other.step", "ISO-10303-21;\nEND-ISO-10303-21;");
+            StepCacheKey other_key;
+            REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+            store_step_cache(key, tessellated_triangle("part"), params.max_cache_size);
+            const uint64_t file_size = boost::filesystem::file_size(key.path);
+            // Make the first file the least recently used one, the file times have a resolution of a second.
+            boost::filesystem::last_write_time(key.path, boost::filesystem::last_write_time(key.path) - 10);
+            REQUIRE(! load_step_cache(other.c_str(), params, loaded, other_key));
+            store_step_cache(other_key, tessellated_triangle("other"), file_size + file_size / 2);
+            THEN("the least recently used tessellation is evicted") {
+                REQUIRE(! load_step_cache(source.c_str(), params, loaded, key));
+                REQUIRE(load_step_cache(other.c_str(), params, loaded, other_key));
+                REQUIRE(loaded.volumes.front().volume_name == "other");
+            }
+        }
+
+        set_data_dir(old_data_dir);
+        boost::filesystem::remove_all(dir);
+    }
+}
+
+SCENARIO("STEP tessellation tolerances of the application config", "[STEP]") {
+    GIVEN("an application config") {
+        AppConfig config(AppConfig::EAppMode::Editor);
+        WHEN("the tolerances are positive") {
+            config.set("step_linear_deflection", "0.01");
+            config.set("step_angle_deflection", "0.5");
+            config.set_defaults();
+            THEN("they are kept") {
+                REQUIRE(config.get("step_linear_deflection") == "0.01");
+                REQUIRE(config.get("step_angle_deflection") == "0.5");
+            }
+        }
+        WHEN("the tolerances are not positive numbers") {
+            config.set("step_linear_deflection", "-0.01");
+            config.set("step_angle_deflection", "abc");
+            config.set_defaults();
+            THEN("they are reset to the defaults") {
+                REQUIRE(config.get("step_linear_deflection") == "0.005");
+                REQUIRE(config.get("step_angle_deflection") == "1");
+            }
+            config.set("step_linear_deflection", "0");
+            config.set_defaults();
+            REQUIRE(config.get("step_linear_deflection") == "0.005");
+        }
+    }
+}
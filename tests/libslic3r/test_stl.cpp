@@ -1,7 +1,12 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/Model.hpp"
+#include "libslic3r/Format/MeshCache.hpp"
 #include "libslic3r/Format/STL.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
 
 using namespace Slic3r;
 
@@ -35,8 +40,7 @@ SCENARIO("Reading an STL file", "[stl]") {
 				REQUIRE(is_approx(model.objects.front()->volumes.front()->mesh().size(), Vec3d(20, 20, 20)));
 			}
 		}
-#if 0
-		// ASCII STLs ending with just carriage returns are not supported. These were used by the old Macs, while the Unix based MacOS uses LFs as any other Unix.
+		// ASCII STLs ending with just carriage returns were used by the old Macs, while the Unix based MacOS uses LFs as any other Unix.
 		WHEN("line endings CR") {
 			Slic3r::Model model;
 			THEN("load should succeed") {
@@ -44,8 +48,6 @@ SCENARIO("Reading an STL file", "[stl]") {
 				REQUIRE(is_approx(model.objects.front()->volumes.front()->mesh().size(), Vec3d(20, 20, 20)));
 			}
 		}
-
-#endif
 		WHEN("nonstandard STL file (text after ending tags, invalid normals, for example infinities)") {
 			Slic3r::Model model;
 			THEN("load should succeed") {
@@ -55,3 +57,102 @@ SCENARIO("Reading an STL file", "[stl]") {
 		}
 	}
 }
+
+SCENARIO("Shared vertices of a loaded STL", "[stl]") {
+	GIVEN("a closed 20mm box in binary and ASCII formats") {
+		THEN("the corners are welded into 8 vertices and the stats are those of a closed mesh needing no repair") {
+			for (const char *path : { "Geräte/20mmbox-čřšřěá.stl", "ASCII/20mmbox-LF.stl" }) {
+				TriangleMesh mesh;
+				REQUIRE(mesh.ReadSTLFile(stl_path(path).c_str()));
+				REQUIRE(mesh.its.indices.size() == 12);
+				REQUIRE(mesh.its.vertices.size() == 8);
+				REQUIRE(mesh.stats().volume == Approx(8000.));
+				REQUIRE(mesh.stats().number_of_parts == 1);
+				REQUIRE(mesh.stats().open_edges == 0);
+				REQUIRE(! mesh.stats().repaired());
+			}
+		}
+	}
+}
+
+SCENARIO("Mesh cache of a loaded STL", "[stl]") {
+	GIVEN("a mesh cache directory") {
+		boost::filesystem::path cache_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+		set_mesh_cache_dir(cache_dir.string());
+		WHEN("the same STL file is loaded twice") {
+			Slic3r::Model model, model_cached;
+			std::string path = stl_path("ASCII/20mmbox-LF.stl");
+			TriangleMesh cached;
+			MeshCacheKey key;
+			REQUIRE(! load_mesh_cache(path.c_str(), cached, key));
+			REQUIRE(boost::filesystem::path(key.path).parent_path() == cache_dir);
+			REQUIRE(! boost::filesystem::exists(key.path));
+			REQUIRE(Slic3r::load_stl(path.c_str(), &model));
+			REQUIRE(boost::filesystem::exists(key.path));
+			REQUIRE(load_mesh_cache(path.c_str(), cached, key));
+			REQUIRE(Slic3r::load_stl(path.c_str(), &model_cached));
+			THEN("the second load returns the mesh and stats of the first one") {
+				for (const TriangleMesh *mesh : std::initializer_list<const TriangleMesh*>{ &cached, &model_cached.objects.front()->volumes.front()->mesh() }) {
+					const TriangleMesh &loaded = model.objects.front()->volumes.front()->mesh();
+					REQUIRE(mesh->its.vertices == loaded.its.vertices);
+					REQUIRE(mesh->its.indices == loaded.its.indices);
+					REQUIRE(mesh->stats().volume == loaded.stats().volume);
+					REQUIRE(mesh->stats().number_of_parts == loaded.stats().number_of_parts);
+					REQUIRE(mesh->stats().open_edges == loaded.stats().open_edges);
+					REQUIRE(is_approx(mesh->size(), loaded.size()));
+				}
+			}
+		}
+		WHEN("the cached file was written by another version or for another content") {
+			std::string path = stl_path("ASCII/20mmbox-LF.stl");
+			Slic3r::Model model;
+			REQUIRE(Slic3r::load_stl(path.c_str(), &model));
+			std::vector<boost::filesystem::path> files(boost::filesystem::directory_iterator(cache_dir), boost::filesystem::directory_iterator{});
+			REQUIRE(files.size() == 1);
+			// Named by the 64 hex digits of the SHA-256 of the source file.
+			REQUIRE(files.front().filename().string().size() == 64 + 5);
+			REQUIRE(files.front().extension() == ".mesh");
+			auto patch = [&files](size_t offset, const char *data, size_t size) {
+				boost::nowide::fstream file(files.front().string(), std::ios::binary | std::ios::in | std::ios::out);
+				file.seekp(offset);
+				file.write(data, size);
+			};
+			TriangleMesh cached;
+			MeshCacheKey key;
+			REQUIRE(load_mesh_cache(path.c_str(), cached, key));
+			THEN("the cache is not used") {
+				SECTION("another MESH_CACHE_VERSION") {
+					const uint32_t version = MESH_CACHE_VERSION + 1;
+					patch(8, reinterpret_cast<const char*>(&version), sizeof(version));
+					REQUIRE(! load_mesh_cache(path.c_str(), cached, key));
+				}
+				SECTION("another source digest") {
+					// Digest follows the magic, the version, the number of facets and vertices and the source size.
+					patch(8 + 4 + 4 + 8 + 8, "\0\0\0\0", 4);
+					REQUIRE(! load_mesh_cache(path.c_str(), cached, key));
+				}
+			}
+		}
+		WHEN("the cache grows over its size limit") {
+			// Room for a single cached 20mm box.
+			set_mesh_cache_dir(cache_dir.string(), 512);
+			std::string path1 = stl_path("ASCII/20mmbox-LF.stl");
+			std::string path2 = stl_path("Geräte/20mmbox-čřšřěá.stl");
+			Slic3r::Model model1, model2;
+			REQUIRE(Slic3r::load_stl(path1.c_str(), &model1));
+			TriangleMesh cached;
+			MeshCacheKey key1, key2;
+			REQUIRE(load_mesh_cache(path1.c_str(), cached, key1));
+			// Make the first file the least recently used one, the file times have a resolution of a second.
+			boost::filesystem::last_write_time(key1.path, boost::filesystem::last_write_time(key1.path) - 10);
+			REQUIRE(Slic3r::load_stl(path2.c_str(), &model2));
+			THEN("the least recently used mesh is evicted") {
+				REQUIRE(! load_mesh_cache(path1.c_str(), cached, key1));
+				REQUIRE(load_mesh_cache(path2.c_str(), cached, key2));
+				REQUIRE(std::distance(boost::filesystem::directory_iterator(cache_dir), boost::filesystem::directory_iterator{}) == 1);
+			}
+		}
+		set_mesh_cache_dir(std::string());
+		boost::filesystem::remove_all(cache_dir);
+	}
+}
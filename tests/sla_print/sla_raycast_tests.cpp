@@ -94,3 +94,34 @@ TEST_CASE("Raycaster with loaded drillholes", "[sla_raycast]")
     test_support_model_collision("20mm_cube.obj", {}, hcfg, holes);
 }
 #endif
+
+TEST_CASE("Batch of rays gives the same hits as single rays", "[sla_raycast]")
+{
+    TriangleMesh mesh = load_model("20mm_cube.obj");
+    mesh.merge(TriangleMesh(its_make_sphere(5., PI / 20.)));
+    sla::IndexedMesh emesh{mesh};
+
+    // Rays from a grid of sources around the cube in all directions, more rays than a single block.
+    std::vector<Vec3d> sources, dirs;
+    for (double x = -5.; x <= 25.; x += 2.5)
+        for (double y = -5.; y <= 25.; y += 2.5)
+            for (double z = -5.; z <= 25.; z += 5.)
+                for (const Vec3d &dir : { Vec3d(1., 0., 0.), Vec3d(0., -1., 0.), Vec3d(0., 0., 1.), Vec3d(Vec3d(-1., 1., -1.).normalized()) }) {
+                    sources.emplace_back(x, y, z);
+                    dirs.emplace_back(dir);
+                }
+
+    sla::IndexedMesh::RayHits hits = emesh.query_ray_hit(sources, dirs);
+    REQUIRE(hits.size() == sources.size());
+
+    size_t num_hits = 0;
+    for (size_t i = 0; i < sources.size(); ++ i) {
+        sla::IndexedMesh::hit_result hit = emesh.query_ray_hit(sources[i], dirs[i]);
+        REQUIRE(hits.is_hit(i) == hit.is_hit());
+        if (hit.is_hit()) {
+            ++ num_hits;
+            REQUIRE(hits.distances[i] == Approx(hit.distance()));
+        }
+    }
+    REQUIRE(num_hits > 0);
+}
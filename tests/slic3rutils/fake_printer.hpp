@@ -0,0 +1,77 @@
+#ifndef slic3rutils_fake_printer_hpp_
+#define slic3rutils_fake_printer_hpp_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "slic3r/Utils/WebSocket.hpp"
+
+namespace Slic3r {
+namespace test {
+
+static const char *FAKE_PRINTER_HELLO = "{\"event\":\"hello\",\"name\":\"Fake\",\"device_model\":\"z3\",\"nozzle\":\"0.4\"}";
+
+// Fake printer: accepts a single websocket client, greets it with a "hello" event
+// (FAKE_PRINTER_HELLO unless given other messages) and echoes every message back.
+class FakePrinter : public std::enable_shared_from_this<FakePrinter>
+{
+public:
+    explicit FakePrinter(net::io_context &ioc, std::vector<std::string> greeting = { FAKE_PRINTER_HELLO }) :
+        m_acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)),
+        m_ws(ioc),
+        m_greeting(std::move(greeting))
+    {}
+
+    int port() const { return m_acceptor.local_endpoint().port(); }
+
+    void start()
+    {
+        m_acceptor.async_accept(beast::get_lowest_layer(m_ws).socket(), [self = shared_from_this()](beast::error_code ec) {
+            if (ec) return;
+            self->m_ws.async_accept([self](beast::error_code ec) {
+                if (! ec) self->greet(0);
+            });
+        });
+    }
+
+    void stop()
+    {
+        beast::error_code ec;
+        m_acceptor.close(ec);
+        beast::get_lowest_layer(m_ws).socket().close(ec);
+    }
+
+private:
+    void greet(size_t idx)
+    {
+        if (idx == m_greeting.size())
+            return read();
+        m_ws.async_write(net::buffer(m_greeting[idx]), [self = shared_from_this(), idx](beast::error_code ec, size_t) {
+            if (! ec) self->greet(idx + 1);
+        });
+    }
+
+    void read()
+    {
+        m_ws.async_read(m_buffer, [self = shared_from_this()](beast::error_code ec, size_t) {
+            if (ec) return;
+            self->m_out = beast::buffers_to_string(self->m_buffer.data());
+            self->m_buffer.consume(self->m_buffer.size());
+            self->m_ws.async_write(net::buffer(self->m_out), [self](beast::error_code ec, size_t) {
+                if (! ec) self->read();
+            });
+        });
+    }
+
+    tcp::acceptor                        m_acceptor;
+    websocket::stream<beast::tcp_stream> m_ws;
+    beast::flat_buffer                   m_buffer;
+    std::string                          m_out;
+    std::vector<std::string>             m_greeting;
+};
+
+} // namespace test
+} // namespace Slic3r
+
+#endif // slic3rutils_fake_printer_hpp_
@@ -0,0 +1,156 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
+#include "slic3r/Utils/Fleet.hpp"
+
+#include "fake_printer.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::test;
+
+namespace {
+
+// Synchronous HTTP request to the fleet endpoint.
+std::string fleet_request(unsigned short port, http::verb method, const std::string &target, const std::string &body, unsigned &status)
+{
+    net::io_context   ioc;
+    beast::tcp_stream stream(ioc);
+    stream.connect(tcp::endpoint(net::ip::make_address("127.0.0.1"), port));
+    http::request<http::string_body> req(method, target, 11);
+    req.set(http::field::host, "127.0.0.1");
+    req.body() = body;
+    req.prepare_payload();
+    http::write(stream, req);
+    beast::flat_buffer                buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    status = res.result_int();
+    return res.body();
+}
+
+// Waits up to 10 seconds for the predicate to become true.
+template<typename Predicate> bool wait_for(Predicate pred)
+{
+    for (int i = 0; i < 200; ++ i) {
+        if (pred())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return pred();
+}
+
+unsigned short free_udp_port()
+{
+    net::io_context ioc;
+    net::ip::udp::socket socket(ioc, net::ip::udp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    return socket.local_endpoint().port();
+}
+
+} // namespace
+
+TEST_CASE("Fleet discovers a machine and serves its state", "[Fleet]") {
+    net::io_context printers_ioc;
+    auto printer = std::make_shared<FakePrinter>(printers_ioc);
+    printer->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    Fleet::Params params;
+    params.http_port      = 0;
+    params.broadcast_port = free_udp_port();
+
+    std::atomic<int>  num_sliced { 0 };
+    std::atomic<bool> zaxe_requested { false };
+    boost::filesystem::path temp_dir; // output of the slices if set.
+    {
+        Fleet fleet(params, [&](const std::string &input, const std::string &config, bool make_zaxe, Fleet::SliceResult &result) -> std::string {
+            ++ num_sliced;
+            zaxe_requested = make_zaxe;
+            if (! temp_dir.empty()) {
+                boost::filesystem::create_directories(temp_dir);
+                result.temp_dir  = temp_dir.string();
+                result.zaxe_path = (temp_dir / "model.zaxe").string();
+                boost::nowide::ofstream(result.zaxe_path) << "zaxe";
+            }
+            return input == "missing.stl" ? "Cannot read missing.stl" : std::string();
+        });
+        REQUIRE(fleet.httpPort() != 0);
+
+        // Announce the fake printer the way a real one does.
+        {
+            net::io_context ioc;
+            net::ip::udp::socket socket(ioc, net::ip::udp::v4());
+            std::string announce = "{\"ip\":\"127.0.0.1\",\"port\":" + std::to_string(printer->port()) + ",\"id\":\"Fake\"}";
+            socket.send_to(net::buffer(announce), net::ip::udp::endpoint(net::ip::make_address("127.0.0.1"), params.broadcast_port));
+        }
+
+        unsigned status = 0;
+        std::string machines;
+        CHECK(wait_for([&]() {
+            machines = fleet_request(fleet.httpPort(), http::verb::get, "/machines", "", status);
+            return machines.find("\"ip\":\"127.0.0.1\"") != std::string::npos;
+        }));
+        CHECK(status == 200);
+        CHECK(machines.find("\"name\":\"Fake\"") != std::string::npos);
+        CHECK(machines.find("\"model\":\"z3\"") != std::string::npos);
+        CHECK(machines.find("\"lite\":false") != std::string::npos);
+
+        SECTION("Requests without machines are rejected") {
+            fleet_request(fleet.httpPort(), http::verb::post, "/jobs", "{\"input\":\"model.stl\"}", status);
+            CHECK(status == 400);
+            fleet_request(fleet.httpPort(), http::verb::get, "/unknown", "", status);
+            CHECK(status == 404);
+        }
+
+        SECTION("A failed slice fails the job on all of its machines") {
+            std::string job = fleet_request(fleet.httpPort(), http::verb::post, "/jobs",
+                "{\"input\":\"missing.stl\",\"machines\":[\"127.0.0.1\"]}", status);
+            CHECK(status == 202);
+            CHECK(job.find("\"id\":1") != std::string::npos);
+            CHECK(wait_for([&]() {
+                job = fleet_request(fleet.httpPort(), http::verb::get, "/jobs/1", "", status);
+                return job.find("\"state\":\"failed\",\"error\"") != std::string::npos;
+            }));
+            CHECK(num_sliced == 1);
+            // Z3 takes a .zaxe archive.
+            CHECK(zaxe_requested);
+            CHECK(job.find("{\"ip\":\"127.0.0.1\",\"state\":\"failed\"") != std::string::npos);
+        }
+
+        SECTION("Machines not on the network fail right after slicing") {
+            std::string job = fleet_request(fleet.httpPort(), http::verb::post, "/jobs",
+                "{\"input\":\"model.stl\",\"machines\":[\"10.255.255.1\"]}", status);
+            CHECK(status == 202);
+            CHECK(wait_for([&]() {
+                job = fleet_request(fleet.httpPort(), http::verb::get, "/jobs", "", status);
+                return job.find("\"state\":\"failed\"") != std::string::npos;
+            }));
+            CHECK(num_sliced == 1);
+        }
+
+        SECTION("The sliced files are removed once the job is finished") {
+            temp_dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+            std::string job = fleet_request(fleet.httpPort(), http::verb::post, "/jobs",
+                "{\"input\":\"model.stl\",\"machines\":[\"10.255.255.1\"]}", status);
+            CHECK(status == 202);
+            CHECK(wait_for([&]() {
+                job = fleet_request(fleet.httpPort(), http::verb::get, "/jobs/1", "", status);
+                return job.find("\"state\":\"failed\"") != std::string::npos && ! boost::filesystem::exists(temp_dir);
+            }));
+            CHECK(num_sliced == 1);
+            CHECK(job.find("\"zaxe\"") == std::string::npos);
+        }
+    }
+
+    printers_ioc.stop();
+    printers_thread.join();
+}
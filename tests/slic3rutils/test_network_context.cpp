@@ -0,0 +1,245 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "slic3r/Utils/NetworkContext.hpp"
+#include "slic3r/Utils/WebSocket.hpp"
+
+#include "fake_printer.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::test;
+
+TEST_CASE("Hundreds of websocket sessions share a single network context", "[NetworkContext]") {
+    static constexpr size_t num_printers = 256;
+
+    // Fake printers run on their own io_context & thread.
+    net::io_context printers_ioc;
+    std::vector<std::shared_ptr<FakePrinter>> printers;
+    for (size_t i = 0; i < num_printers; ++ i) {
+        printers.emplace_back(std::make_shared<FakePrinter>(printers_ioc));
+        printers.back()->start();
+    }
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    NetworkContext ctx(2);
+    REQUIRE(ctx.num_threads() == 2);
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::atomic<size_t>     num_hello { 0 };
+    std::atomic<size_t>     num_echo { 0 };
+    std::atomic<size_t>     num_errors { 0 };
+    auto notify = [&mtx, &cv]() { std::lock_guard<std::mutex> lock(mtx); cv.notify_all(); };
+
+    std::vector<std::shared_ptr<Websocket>> sessions;
+    for (const std::shared_ptr<FakePrinter> &printer : printers) {
+        auto ws = std::make_shared<Websocket>("127.0.0.1", printer->port(), ctx.io_context());
+        Websocket *pws = ws.get();
+        ws->addReadEventHandler([&, pws](std::string message) {
+            if (message.find("\"hello\"") != std::string::npos) {
+                ++ num_hello;
+                pws->send("{\"request\":\"say_hi\"}");
+            } else if (message == "{\"request\":\"say_hi\"}")
+                ++ num_echo;
+            notify();
+        });
+        ws->addErrorEventHandler([&](std::string) { ++ num_errors; notify(); });
+        ws->run();
+        sessions.emplace_back(std::move(ws));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(60), [&]() { return num_echo + num_errors >= num_printers; });
+    }
+
+    CHECK(num_errors == 0);
+    CHECK(num_hello == num_printers);
+    CHECK(num_echo == num_printers);
+
+    for (std::shared_ptr<Websocket> &ws : sessions)
+        ws->close();
+    ctx.stop();
+    sessions.clear();
+
+    net::post(printers_ioc, [&printers]() { for (auto &printer : printers) printer->stop(); });
+    printers_ioc.stop();
+    printers_thread.join();
+}
+
+TEST_CASE("Messages sent before the handshake are queued", "[NetworkContext]") {
+    net::io_context printers_ioc;
+    auto printer = std::make_shared<FakePrinter>(printers_ioc);
+    printer->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    NetworkContext ctx(1);
+    std::mutex               mtx;
+    std::condition_variable  cv;
+    std::vector<std::string> received;
+
+    auto ws = std::make_shared<Websocket>("127.0.0.1", printer->port(), ctx.io_context());
+    ws->addReadEventHandler([&](std::string message) {
+        std::lock_guard<std::mutex> lock(mtx);
+        received.emplace_back(std::move(message));
+        cv.notify_all();
+    });
+    ws->run();
+    // Not connected yet: both go to the write queue and are sent in order after the handshake.
+    ws->send("first");
+    ws->send("second");
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait_for(lock, std::chrono::seconds(10), [&]() { return received.size() >= 3; });
+        REQUIRE(received.size() == 3);
+        CHECK(received[1] == "first");
+        CHECK(received[2] == "second");
+    }
+
+    ws->close();
+    ctx.stop();
+    ws.reset();
+    printers_ioc.stop();
+    printers_thread.join();
+}
+
+TEST_CASE("Closing a session keeps the message being written alive", "[NetworkContext]") {
+    net::io_context printers_ioc;
+    auto printer = std::make_shared<FakePrinter>(printers_ioc);
+    printer->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    NetworkContext ctx(1);
+    std::mutex              mtx;
+    std::condition_variable cv;
+    bool                    hello = false;
+    std::atomic<size_t>     num_errors { 0 };
+
+    auto ws = std::make_shared<Websocket>("127.0.0.1", printer->port(), ctx.io_context());
+    ws->addReadEventHandler([&](std::string message) {
+        std::lock_guard<std::mutex> lock(mtx);
+        hello = true;
+        cv.notify_all();
+    });
+    ws->addErrorEventHandler([&](std::string) { ++ num_errors; });
+    ws->run();
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        REQUIRE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return hello; }));
+    }
+
+    // A large message is still being written when the close is requested, the messages
+    // queued behind it are dropped, the one in flight has to outlive the write.
+    ws->send(std::string(16 << 20, 'x'));
+    ws->send("dropped");
+    ws->close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    CHECK(num_errors == 0);
+
+    ctx.stop();
+    ws.reset();
+    net::post(printers_ioc, [printer]() { printer->stop(); });
+    printers_ioc.stop();
+    printers_thread.join();
+}
+
+TEST_CASE("Delayed transfers wait on the curl thread and complete on shutdown", "[NetworkContext]") {
+    // Nothing listens on the port, the transfers fail as soon as they start.
+    net::io_context ioc;
+    tcp::acceptor   acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    std::string     url = "http://127.0.0.1:" + std::to_string(acceptor.local_endpoint().port()) + "/";
+    acceptor.close();
+    auto make_easy = [&url]() {
+        CURL *easy = ::curl_easy_init();
+        ::curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+        return easy;
+    };
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+    std::vector<CURLcode>   results;
+    auto done = [&](CURLcode res) {
+        std::lock_guard<std::mutex> lock(mtx);
+        results.emplace_back(res);
+        cv.notify_all();
+    };
+
+    auto curl = std::make_unique<CurlMulti>();
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration delayed_by;
+    curl->add(make_easy(), [&](CURL*, CURLcode res) {
+        delayed_by = std::chrono::steady_clock::now() - start;
+        done(res);
+    }, std::chrono::milliseconds(300));
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        REQUIRE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return results.size() == 1; }));
+    }
+    CHECK(results.front() != CURLE_OK);
+    CHECK(results.front() != CURLE_ABORTED_BY_CALLBACK);
+    CHECK(delayed_by >= std::chrono::milliseconds(300));
+
+    // A retry far in the future is aborted by the shutdown, so is another retry added by its completion.
+    CurlMulti *pcurl = curl.get();
+    curl->add(make_easy(), [&](CURL*, CURLcode res) {
+        done(res);
+        pcurl->add(make_easy(), [&](CURL*, CURLcode res) { done(res); }, std::chrono::seconds(60));
+    }, std::chrono::seconds(60));
+    curl.reset();
+    REQUIRE(results.size() == 3);
+    CHECK(results[1] == CURLE_ABORTED_BY_CALLBACK);
+    CHECK(results[2] == CURLE_ABORTED_BY_CALLBACK);
+}
+
+TEST_CASE("A failed session drops its queue and reports the error once", "[NetworkContext]") {
+    net::io_context printers_ioc;
+    auto printer = std::make_shared<FakePrinter>(printers_ioc);
+    printer->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    NetworkContext ctx(1);
+    std::mutex              mtx;
+    std::condition_variable cv;
+    bool                    hello = false;
+    std::atomic<size_t>     num_errors { 0 };
+
+    auto ws = std::make_shared<Websocket>("127.0.0.1", printer->port(), ctx.io_context());
+    ws->addReadEventHandler([&](std::string) {
+        std::lock_guard<std::mutex> lock(mtx);
+        hello = true;
+        cv.notify_all();
+    });
+    ws->addErrorEventHandler([&](std::string) { ++ num_errors; cv.notify_all(); });
+    ws->run();
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        REQUIRE(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return hello; }));
+    }
+
+    // The printer goes away while messages are being sent.
+    net::post(printers_ioc, [printer]() { printer->stop(); });
+    for (int i = 0; i < 100; ++ i) {
+        ws->send(std::string(64 << 10, 'x'));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        CHECK(cv.wait_for(lock, std::chrono::seconds(10), [&]() { return num_errors > 0; }));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    CHECK(num_errors == 1);
+
+    ws->close();
+    ctx.stop();
+    ws.reset();
+    printers_ioc.stop();
+    printers_thread.join();
+}
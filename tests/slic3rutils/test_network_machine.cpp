@@ -0,0 +1,277 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/beast/http.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+#include <boost/optional.hpp>
+
+#include "slic3r/Utils/NetworkMachine.hpp"
+
+#include "fake_printer.hpp"
+
+using namespace Slic3r;
+using namespace Slic3r::test;
+
+namespace {
+
+const char *HTTP_PRINTER_HELLO = "{\"event\":\"hello\",\"name\":\"Fake\",\"device_model\":\"z3\",\"nozzle\":\"0.4\",\"protocol\":\"http\"}";
+
+// Fake upload.cgi of the HTTP machines, on all the IPv4 interfaces. Stores the bodies of
+// the accepted uploads, the failures asked for by failNext() are answered with 503.
+class FakeUploadServer : public std::enable_shared_from_this<FakeUploadServer>
+{
+public:
+    explicit FakeUploadServer(net::io_context &ioc) :
+        m_acceptor(ioc, tcp::endpoint(net::ip::address_v4::any(), 0))
+    {}
+
+    unsigned short port() const { return m_acceptor.local_endpoint().port(); }
+
+    void start()
+    {
+        m_acceptor.async_accept([self = shared_from_this()](beast::error_code ec, tcp::socket socket) {
+            if (ec) return;
+            std::make_shared<Session>(self, std::move(socket))->read();
+            self->start();
+        });
+    }
+
+    void stop()
+    {
+        beast::error_code ec;
+        m_acceptor.close(ec);
+    }
+
+    std::vector<std::string> bodies() const
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_bodies;
+    }
+
+    int requests() const { return m_requests; }
+    void failNext(int num_failures) { m_failures = num_failures; }
+
+private:
+    struct Session : std::enable_shared_from_this<Session>
+    {
+        Session(std::shared_ptr<FakeUploadServer> server, tcp::socket socket) : server(std::move(server)), stream(std::move(socket)) {}
+
+        void read()
+        {
+            parser.emplace();
+            parser->body_limit(16 << 20);
+            http::async_read(stream, buffer, *parser, [self = shared_from_this()](beast::error_code ec, size_t) {
+                if (ec) return;
+                http::request<http::string_body> req = self->parser->release();
+                self->res = {};
+                self->res.version(req.version());
+                self->res.keep_alive(req.keep_alive());
+                ++ self->server->m_requests;
+                if (self->server->m_failures > 0) {
+                    -- self->server->m_failures;
+                    self->res.result(http::status::service_unavailable);
+                } else {
+                    self->res.result(http::status::ok);
+                    std::lock_guard<std::mutex> lock(self->server->m_mtx);
+                    self->server->m_bodies.emplace_back(std::move(req.body()));
+                }
+                self->res.prepare_payload();
+                http::async_write(self->stream, self->res, [self](beast::error_code ec, size_t) {
+                    if (! ec && self->res.keep_alive())
+                        self->read();
+                });
+            });
+        }
+
+        std::shared_ptr<FakeUploadServer>                        server;
+        beast::tcp_stream                                        stream;
+        beast::flat_buffer                                       buffer;
+        boost::optional<http::request_parser<http::string_body>> parser;
+        http::response<http::empty_body>                         res;
+    };
+
+    tcp::acceptor            m_acceptor;
+    std::atomic<int>         m_failures { 0 };
+    std::atomic<int>         m_requests { 0 };
+    mutable std::mutex       m_mtx;
+    std::vector<std::string> m_bodies;
+};
+
+// Waits up to 30 seconds for the predicate to become true.
+template<typename Predicate> bool wait_for(Predicate pred)
+{
+    for (int i = 0; i < 600; ++ i) {
+        if (pred())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return pred();
+}
+
+} // namespace
+
+TEST_CASE("Batch upload of one payload to HTTP machines", "[NetworkMachine]") {
+    // Printers and the upload server run on their own io_context & thread.
+    net::io_context printers_ioc;
+    std::vector<std::shared_ptr<FakePrinter>> printers;
+    for (int i = 0; i < 2; ++ i) {
+        printers.emplace_back(std::make_shared<FakePrinter>(printers_ioc, std::vector<std::string>{ HTTP_PRINTER_HELLO }));
+        printers.back()->start();
+    }
+    auto server = std::make_shared<FakeUploadServer>(printers_ioc);
+    server->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    boost::filesystem::path path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%.gcode");
+    std::string content;
+    for (int i = 0; content.size() < 200000; ++ i)
+        content += "G1 X" + std::to_string(i % 200) + " Y" + std::to_string(i % 170) + "\n";
+    boost::nowide::ofstream(path.string(), std::ios::binary) << content;
+
+    std::atomic<int> num_open { 0 };
+    {
+        NetworkMachineContainer container([&num_open](wxEventType type, NetworkMachine*) {
+            if (type == EVT_MACHINE_OPEN)
+                ++ num_open;
+        });
+        // Both resolve to the loopback, the container keys the machines by ip.
+        const std::vector<std::string> ips { "127.0.0.1", "localhost" };
+        for (size_t i = 0; i < ips.size(); ++ i)
+            container.addMachine(ips[i], printers[i]->port(), "Fake")->setUploadPorts(server->port(), 9494);
+        REQUIRE(wait_for([&]() { return num_open == int(ips.size()); }));
+        for (const std::string &ip : ips)
+            REQUIRE(container.getMachine(ip)->snapshot().attr.isHttp);
+
+        std::mutex                 mtx;
+        std::map<std::string, int> num_done;
+        std::map<std::string, int> last_progress;
+        bool                       all_succeeded = true;
+        auto on_progress = [&](const std::string &ip, int percent) { std::lock_guard<std::mutex> lock(mtx); last_progress[ip] = percent; };
+        auto on_done     = [&](const std::string &ip, bool success) { std::lock_guard<std::mutex> lock(mtx); ++ num_done[ip]; all_succeeded &= success; };
+        auto check_uploaded = [&](int num_failures) {
+            REQUIRE(wait_for([&]() { std::lock_guard<std::mutex> lock(mtx); return num_done.size() == ips.size(); }));
+            // Late callbacks of a duplicate would show up meanwhile.
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            std::lock_guard<std::mutex> lock(mtx);
+            CHECK(all_succeeded);
+            for (const std::string &ip : ips) {
+                CHECK(num_done[ip] == 1);
+                CHECK(last_progress[ip] > 0);
+                CHECK(container.getMachine(ip)->snapshot().progress == 100);
+                CHECK(! container.getMachine(ip)->isUploading());
+            }
+            CHECK(server->requests() == int(ips.size()) + num_failures);
+            std::vector<std::string> bodies = server->bodies();
+            REQUIRE(bodies.size() == ips.size());
+            for (const std::string &body : bodies) {
+                CHECK(body.find("filename=\"upload.gcode\"") != std::string::npos);
+                CHECK(body.find(content) != std::string::npos);
+            }
+        };
+
+        SECTION("Every machine is sent the file once, listed twice or not") {
+            REQUIRE(container.uploadBatch({ "127.0.0.1", "localhost", "127.0.0.1" }, path.string(), "upload.gcode", on_progress, on_done));
+            check_uploaded(0);
+        }
+        SECTION("An attempt answered by 503 is retried and sends the whole file again") {
+            server->failNext(1);
+            REQUIRE(container.uploadBatch(ips, path.string(), "upload.gcode", on_progress, on_done, 1));
+            check_uploaded(1);
+        }
+        SECTION("Unknown machines and missing files fail at once") {
+            REQUIRE(container.uploadBatch({ "127.0.0.3" }, path.string(), "", nullptr, on_done));
+            std::lock_guard<std::mutex> lock(mtx);
+            CHECK(num_done["127.0.0.3"] == 1);
+            CHECK(! all_succeeded);
+            CHECK(server->requests() == 0);
+            CHECK(! container.uploadBatch(ips, path.string() + ".missing", "", nullptr, nullptr));
+        }
+    }
+
+    boost::filesystem::remove(path);
+    net::post(printers_ioc, [&printers, server]() {
+        for (auto &printer : printers) printer->stop();
+        server->stop();
+    });
+    printers_ioc.stop();
+    printers_thread.join();
+}
+
+TEST_CASE("Machine messages are coalesced and read back from snapshots", "[NetworkMachine]") {
+    // The printing & heating states always change together, a snapshot showing them apart
+    // would be torn by the network thread.
+    std::vector<std::string> greeting { FAKE_PRINTER_HELLO };
+    for (int i = 0; i < 500; ++ i) {
+        const char *state = i % 2 ? "False" : "True";
+        greeting.emplace_back(std::string("{\"event\":\"states_update\",\"is_printing\":\"") + state + "\",\"is_heating\":\"" + state + "\"}");
+        greeting.emplace_back("{\"event\":\"print_progress\",\"progress\":" + std::to_string(i % 100) + "}");
+    }
+    greeting.emplace_back("{\"event\":\"states_update\",\"is_printing\":\"True\",\"is_heating\":\"True\"}");
+    greeting.emplace_back("{\"event\":\"print_progress\",\"progress\":42}");
+    greeting.emplace_back("{\"event\":\"new_name\",\"name\":\"Renamed\"}");
+    const size_t num_updates = greeting.size() - 1;
+
+    net::io_context printers_ioc;
+    auto printer = std::make_shared<FakePrinter>(printers_ioc, greeting);
+    printer->start();
+    std::thread printers_thread([&printers_ioc]() { printers_ioc.run(); });
+
+    std::atomic<int> num_open { 0 };
+    std::atomic<int> num_pending_events { 0 };
+    {
+        NetworkMachineContainer container([&](wxEventType type, NetworkMachine*) {
+            if (type == EVT_MACHINE_OPEN)
+                ++ num_open;
+            else if (type == EVT_MACHINE_UPDATES_PENDING)
+                ++ num_pending_events;
+        });
+        std::shared_ptr<NetworkMachine> nm = container.addMachine("127.0.0.1", printer->port(), "Fake");
+        REQUIRE(nm);
+
+        // Plays the UI thread: takes the pending updates and shows a copy of the state.
+        std::atomic<bool> torn { false };
+        std::atomic<int>  num_frames { 0 };
+        MachineSnapshot   state;
+        uint32_t          updates = 0;
+        bool done = wait_for([&]() {
+            updates |= nm->takePendingUpdates();
+            state = nm->snapshot();
+            ++ num_frames;
+            if (num_open > 0 && state.states.printing != state.states.heating)
+                torn = true;
+            return state.name == "Renamed";
+        });
+        REQUIRE(done);
+        updates |= nm->takePendingUpdates();
+        state = nm->snapshot();
+
+        CHECK(! torn);
+        CHECK((updates & (MachineUpdate::States | MachineUpdate::Progress | MachineUpdate::Name)) ==
+              (MachineUpdate::States | MachineUpdate::Progress | MachineUpdate::Name));
+        CHECK(state.states.printing);
+        CHECK(state.states.heating);
+        CHECK(state.progress == 42);
+        CHECK(state.attr.deviceModel == "z3");
+
+        MachineUpdateStats stats = nm->updateStats();
+        CHECK(stats.posted == num_updates);
+        CHECK(stats.dropped == 0);
+        // The UI is woken up only by the first update pending in a frame.
+        CHECK(num_pending_events >= 1);
+        CHECK(size_t(num_pending_events) <= stats.posted - stats.merged);
+        CHECK(num_pending_events <= num_frames + 1);
+    }
+
+    net::post(printers_ioc, [printer]() { printer->stop(); });
+    printers_ioc.stop();
+    printers_thread.join();
+}